@@ -0,0 +1,734 @@
+// End-to-end benchmark: runs the golden dashcam clips through the whole
+// HEAVY_PROCESS_VIDEO path and reports speed, resources and accuracy as
+// JSON, so a change to the decoder, the models or OCR voting can be compared
+// run against run.
+//
+//   dashcam_bench [--manifest bench/golden/clips.json] [--clips-dir dir]
+//                 [--only day_4k,...] [--out result.json] [--work-dir dir]
+//                 [--gpu 0] [--lowres-height 720] [--decode-only]
+//
+// Each clip is published as a HEAVY_PROCESS_VIDEO task to an in-process task
+// server (in-memory store, loopback HTTP), pulled back, run by a
+// HeavyProcessor, written to heavy_output under the work dir and completed
+// with its FINALIZE_VIDEO, as on the workhorse. Checkpoints, the governor
+// and read-ahead of the next clip are off so every run does the same work.
+//
+// The manifest lists the clips (paths relative to --clips-dir, by default
+// the manifest's directory); the clips themselves are too large for the
+// repository. A clip entry may pin "fingerprint" (fingerprint_file, 16 hex
+// digits); a clip that no longer matches is refused rather than benchmarked.
+// The report carries every clip's fingerprint for pinning.
+//
+// Ground truth, one file per clip:
+//   {"annotated_frames": [120, 240, ...],
+//    "boxes": [{"frame": 120, "class": "vehicle" | "plate", "box": [x0, y0, x1, y1]}, ...],
+//    "plates": [{"text": "AB12CDE", "first_frame": 100, "last_frame": 180}, ...]}
+// Boxes are full-resolution pixels, and every vehicle and plate of an
+// annotated frame is listed. Detections count as found at IoU >= 0.5; a
+// frame the motion filter dropped misses its boxes. A plate counts as read
+// when a track overlapping its frames voted its text.
+//
+// Per clip: frames/s over the run, latency percentiles of every span in the
+// run's trace (stage calls, model passes, reads), stage occupancy, peak RSS
+// and peak VRAM. Peak VRAM is device memory in use beyond what was free
+// before the models were loaded (so it includes them), sampled every 10 ms;
+// run on an otherwise idle GPU. Exit status 1 if any clip failed.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <json/value.h>
+#include <json/writer.h>
+
+#include "common/hash.hpp"
+#include "common/http/http_server.hpp"
+#include "common/json_util.hpp"
+#include "common/plate_text.hpp"
+#include "common/task.hpp"
+#include "common/trace.hpp"
+#include "server/task_api.hpp"
+#include "server/task_queue.hpp"
+#include "server/task_store.hpp"
+#include "worker/gpu/device_info.hpp"
+#include "worker/heavy/heavy_output.hpp"
+#include "worker/heavy/heavy_processor.hpp"
+#include "worker/inference/detection.hpp"
+#include "worker/task/task_client.hpp"
+
+using namespace dashcam;
+using namespace dashcam::worker;
+
+namespace {
+
+struct Options {
+  std::filesystem::path manifest = "bench/golden/clips.json";
+  std::filesystem::path clips_dir;  // empty: the manifest's directory
+  std::set<std::string> only;
+  std::filesystem::path out;        // empty: stdout
+  std::filesystem::path work_dir = "cache/bench";
+  int gpu = 0;
+  int lowres_height = 720;
+  bool decode_only = false;
+};
+
+// Spans kept per clip; large enough that a golden clip never wraps.
+constexpr std::size_t kTraceEvents = std::size_t{1} << 21;
+constexpr float kMatchIou = 0.5f;
+
+Json::Value read_json_file(const std::filesystem::path& path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    throw std::runtime_error("cannot open " + path.string());
+  }
+  std::ostringstream text;
+  text << in.rdbuf();
+  try {
+    return parse_json(text.str());
+  } catch (const std::invalid_argument& e) {
+    throw std::runtime_error(path.string() + ": " + e.what());
+  }
+}
+
+std::set<std::string> split_names(const std::string& text) {
+  std::set<std::string> names;
+  std::stringstream in(text);
+  std::string name;
+  while (std::getline(in, name, ',')) {
+    if (!name.empty()) {
+      names.insert(name);
+    }
+  }
+  return names;
+}
+
+// The main server's side of the path: the real store, queue and task
+// endpoints over loopback, with a throwaway database.
+class MockTaskServer {
+ public:
+  MockTaskServer()
+      : store_(":memory:"),
+        queue_(store_, std::chrono::minutes(10)),
+        api_(queue_),
+        http_(server_options(queue_),
+              [this](const http::Request& request) {
+                if (auto response = api_.handle(request)) {
+                  return std::move(*response);
+                }
+                return http::error_response(404, "not found");
+              }),
+        thread_([this] { http_.run(); }) {}
+  ~MockTaskServer() {
+    http_.stop();
+    thread_.join();
+  }
+
+  MockTaskServer(const MockTaskServer&) = delete;
+  MockTaskServer& operator=(const MockTaskServer&) = delete;
+
+  unsigned short port() const { return http_.port(); }
+  server::TaskStore& store() { return store_; }
+
+ private:
+  static http::ServerOptions server_options(server::TaskQueue& queue) {
+    http::ServerOptions options;
+    options.address = "127.0.0.1";
+    options.port = 0;
+    options.on_stop = [&queue] { queue.shutdown(); };
+    return options;
+  }
+
+  server::TaskStore store_;
+  server::TaskQueue queue_;
+  server::TaskApi api_;
+  http::HttpServer http_;
+  std::thread thread_;
+};
+
+// Resident-set high-water mark of the process. reset() starts a new one
+// where the kernel allows it (Linux 4.0+); elsewhere the peak stays
+// process-wide.
+struct PeakRss {
+  static void reset() {
+    std::ofstream("/proc/self/clear_refs") << "5";
+  }
+  static std::int64_t read() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+      if (line.rfind("VmHWM:", 0) == 0) {
+        return std::atoll(line.c_str() + 6) * 1024;
+      }
+    }
+    return -1;
+  }
+};
+
+// Lowest free device memory seen while alive, polled every 10 ms.
+class VramSampler {
+ public:
+  explicit VramSampler(int device)
+      : device_(device), min_free_(free_device_memory(device)), thread_([this] { poll(); }) {}
+  ~VramSampler() {
+    stop_ = true;
+    thread_.join();
+  }
+
+  VramSampler(const VramSampler&) = delete;
+  VramSampler& operator=(const VramSampler&) = delete;
+
+  std::size_t min_free() const { return min_free_.load(); }
+
+ private:
+  void poll() {
+    use_device(device_);
+    while (!stop_) {
+      std::size_t free = free_device_memory(device_);
+      std::size_t seen = min_free_.load();
+      while (free < seen && !min_free_.compare_exchange_weak(seen, free)) {
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  }
+
+  int device_;
+  std::atomic<std::size_t> min_free_;
+  std::atomic<bool> stop_{false};
+  std::thread thread_;
+};
+
+// Nearest-rank percentile of sorted durations, in milliseconds.
+double percentile_ms(const std::vector<std::int64_t>& sorted_ns, double p) {
+  auto rank = static_cast<std::size_t>(p * static_cast<double>(sorted_ns.size() - 1) + 0.5);
+  return static_cast<double>(sorted_ns[rank]) / 1e6;
+}
+
+// Every span name of the run with its count and latency percentiles;
+// stage calls (category "stage") first, in pipeline order, with the items
+// they handled.
+Json::Value latency_json(const TraceBuffer& trace, const std::vector<StageSnapshot>& stages) {
+  std::map<std::pair<std::string, std::string>, std::vector<std::int64_t>> spans;
+  std::map<std::pair<std::string, std::string>, std::int64_t> items;
+  for (const TraceEvent& event : trace.events()) {
+    std::pair<std::string, std::string> key{event.category, event.name};
+    spans[key].push_back(event.dur_ns);
+    // A stage span's arg is its batch size; single-item calls leave it -1.
+    items[key] += event.arg < 0 ? 1 : event.arg;
+  }
+  std::vector<std::pair<std::string, std::string>> order;
+  for (const StageSnapshot& stage : stages) {
+    if (spans.count({"stage", stage.name}) > 0) {
+      order.emplace_back("stage", stage.name);
+    }
+  }
+  for (const auto& [key, durations] : spans) {
+    if (key.first != "stage") {
+      order.push_back(key);
+    }
+  }
+
+  Json::Value out(Json::arrayValue);
+  for (const auto& key : order) {
+    std::vector<std::int64_t>& durations = spans[key];
+    std::sort(durations.begin(), durations.end());
+    std::int64_t total = 0;
+    for (std::int64_t d : durations) {
+      total += d;
+    }
+    Json::Value span(Json::objectValue);
+    span["category"] = key.first;
+    span["name"] = key.second;
+    span["count"] = Json::UInt64(durations.size());
+    if (key.first == "stage") {
+      span["items"] = Json::Int64(items[key]);
+    }
+    span["total_s"] = static_cast<double>(total) / 1e9;
+    span["p50_ms"] = percentile_ms(durations, 0.50);
+    span["p90_ms"] = percentile_ms(durations, 0.90);
+    span["p99_ms"] = percentile_ms(durations, 0.99);
+    span["max_ms"] = static_cast<double>(durations.back()) / 1e6;
+    out.append(span);
+  }
+  return out;
+}
+
+Json::Value stages_json(const std::vector<StageSnapshot>& stages) {
+  Json::Value out(Json::arrayValue);
+  for (const StageSnapshot& s : stages) {
+    Json::Value stage(Json::objectValue);
+    stage["name"] = s.name;
+    stage["threads"] = Json::UInt64(s.threads);
+    stage["items_in"] = Json::UInt64(s.items_in);
+    stage["items_out"] = Json::UInt64(s.items_out);
+    stage["occupancy"] = s.occupancy;
+    stage["busy_s"] = s.busy_s;
+    stage["starved_s"] = s.starved_s;
+    stage["blocked_s"] = s.blocked_s;
+    out.append(stage);
+  }
+  return out;
+}
+
+struct TruthBox {
+  std::int64_t frame = 0;
+  ObjectClass cls = ObjectClass::Vehicle;
+  Box box;
+};
+
+struct TruthPlate {
+  std::string text;  // normalized
+  std::int64_t first_frame = 0;
+  std::int64_t last_frame = 0;
+};
+
+struct Truth {
+  std::set<std::int64_t> annotated_frames;
+  std::vector<TruthBox> boxes;
+  std::vector<TruthPlate> plates;
+};
+
+Truth load_truth(const std::filesystem::path& path) {
+  Json::Value json = read_json_file(path);
+  Truth truth;
+  for (const Json::Value& frame : json["annotated_frames"]) {
+    truth.annotated_frames.insert(frame.asInt64());
+  }
+  for (const Json::Value& entry : json["boxes"]) {
+    TruthBox box;
+    box.frame = entry["frame"].asInt64();
+    std::string cls = entry["class"].asString();
+    if (cls == "vehicle") {
+      box.cls = ObjectClass::Vehicle;
+    } else if (cls == "plate") {
+      box.cls = ObjectClass::Plate;
+    } else {
+      throw std::runtime_error(path.string() + ": unknown class " + cls);
+    }
+    const Json::Value& b = entry["box"];
+    if (!b.isArray() || b.size() != 4) {
+      throw std::runtime_error(path.string() + ": box is not [x0, y0, x1, y1]");
+    }
+    box.box = {b[0].asFloat(), b[1].asFloat(), b[2].asFloat(), b[3].asFloat()};
+    truth.boxes.push_back(box);
+  }
+  for (const Json::Value& entry : json["plates"]) {
+    truth.plates.push_back({normalize_plate(entry["text"].asString()),
+                            entry["first_frame"].asInt64(), entry["last_frame"].asInt64()});
+  }
+  return truth;
+}
+
+struct MatchCounts {
+  std::int64_t tp = 0;
+  std::int64_t fp = 0;
+  std::int64_t fn = 0;
+};
+
+Json::Value match_json(const MatchCounts& m) {
+  Json::Value out(Json::objectValue);
+  out["tp"] = Json::Int64(m.tp);
+  out["fp"] = Json::Int64(m.fp);
+  out["fn"] = Json::Int64(m.fn);
+  out["precision"] = m.tp + m.fp > 0 ? static_cast<double>(m.tp) / (m.tp + m.fp) : 0.0;
+  out["recall"] = m.tp + m.fn > 0 ? static_cast<double>(m.tp) / (m.tp + m.fn) : 0.0;
+  return out;
+}
+
+// Greedy matching per annotated frame and class: detections by descending
+// score, each taking the unmatched truth box it overlaps most.
+MatchCounts match_boxes(const Truth& truth, const DetectionColumns& detections, ObjectClass cls) {
+  std::map<std::int64_t, std::vector<Box>> expected;
+  for (const TruthBox& box : truth.boxes) {
+    if (box.cls == cls) {
+      expected[box.frame].push_back(box.box);
+    }
+  }
+  std::map<std::int64_t, std::vector<std::pair<float, Box>>> found;
+  for (std::size_t i = 0; i < detections.size(); ++i) {
+    if (detections.cls[i] == static_cast<std::uint8_t>(cls) &&
+        truth.annotated_frames.count(detections.frame[i]) > 0) {
+      found[detections.frame[i]].emplace_back(
+          detections.score[i],
+          Box{detections.x0[i], detections.y0[i], detections.x1[i], detections.y1[i]});
+    }
+  }
+
+  MatchCounts counts;
+  for (std::int64_t frame : truth.annotated_frames) {
+    std::vector<Box>& want = expected[frame];
+    std::vector<std::pair<float, Box>>& got = found[frame];
+    std::sort(got.begin(), got.end(),
+              [](const auto& a, const auto& b) { return a.first > b.first; });
+    std::vector<bool> taken(want.size(), false);
+    for (const auto& [score, box] : got) {
+      std::size_t best = want.size();
+      float best_iou = kMatchIou;
+      for (std::size_t j = 0; j < want.size(); ++j) {
+        float overlap = iou(box, want[j]);
+        if (!taken[j] && overlap >= best_iou) {
+          best = j;
+          best_iou = overlap;
+        }
+      }
+      if (best < want.size()) {
+        taken[best] = true;
+        ++counts.tp;
+      } else {
+        ++counts.fp;
+      }
+    }
+    counts.fn += static_cast<std::int64_t>(std::count(taken.begin(), taken.end(), false));
+  }
+  return counts;
+}
+
+// Per truth plate, the closest text among the tracks overlapping its
+// frames: exact, equal up to OCR confusions, and 1 - edit distance / length.
+Json::Value ocr_json(const Truth& truth, const std::vector<PlateRead>& plates) {
+  std::int64_t exact = 0;
+  std::int64_t folded = 0;
+  std::int64_t tracked = 0;
+  double char_accuracy = 0.0;
+  for (const TruthPlate& want : truth.plates) {
+    bool seen = false;
+    bool is_exact = false;
+    bool is_folded = false;
+    double best = 0.0;
+    double length = static_cast<double>(std::max<std::size_t>(want.text.size(), 1));
+    for (const PlateRead& read : plates) {
+      if (read.last_frame < want.first_frame || read.first_frame > want.last_frame) {
+        continue;
+      }
+      seen = true;
+      if (read.text.empty()) {
+        continue;
+      }
+      is_exact = is_exact || read.text == want.text;
+      is_folded = is_folded || fold_confusables(read.text) == fold_confusables(want.text);
+      best = std::max(best, 1.0 - std::min(1.0, plate_distance(read.text, want.text, length) /
+                                                    length));
+    }
+    tracked += seen ? 1 : 0;
+    exact += is_exact ? 1 : 0;
+    folded += is_folded ? 1 : 0;
+    char_accuracy += best;
+  }
+  std::int64_t reads = 0;
+  for (const PlateRead& read : plates) {
+    reads += read.text.empty() ? 0 : 1;
+  }
+
+  double count = static_cast<double>(std::max<std::size_t>(truth.plates.size(), 1));
+  Json::Value out(Json::objectValue);
+  out["plates"] = Json::UInt64(truth.plates.size());
+  out["tracked"] = Json::Int64(tracked);
+  out["read_exact"] = Json::Int64(exact);
+  out["read_folded"] = Json::Int64(folded);
+  out["exact_rate"] = static_cast<double>(exact) / count;
+  out["char_accuracy"] = char_accuracy / count;
+  out["tracks"] = Json::UInt64(plates.size());
+  out["tracks_read"] = Json::Int64(reads);
+  return out;
+}
+
+struct Clip {
+  std::string name;
+  std::filesystem::path video;
+  std::filesystem::path truth;
+  std::string conditions;
+  std::string resolution;
+  std::string fingerprint;  // pinned in the manifest; empty when not
+};
+
+std::vector<Clip> load_manifest(const Options& options) {
+  Json::Value json = read_json_file(options.manifest);
+  std::filesystem::path dir =
+      options.clips_dir.empty() ? options.manifest.parent_path() : options.clips_dir;
+  std::vector<Clip> clips;
+  for (const Json::Value& entry : json["clips"]) {
+    Clip clip;
+    clip.name = entry["name"].asString();
+    if (!options.only.empty() && options.only.count(clip.name) == 0) {
+      continue;
+    }
+    clip.video = dir / entry["video"].asString();
+    if (entry.isMember("truth")) {
+      clip.truth = dir / entry["truth"].asString();
+    }
+    clip.conditions = entry["conditions"].asString();
+    clip.resolution = entry["resolution"].asString();
+    clip.fingerprint = entry["fingerprint"].asString();
+    clips.push_back(std::move(clip));
+  }
+  return clips;
+}
+
+Json::Value build_json(const HeavyProcessConfig& config,
+                       const std::optional<DetectorConfig>& detector) {
+  Json::Value out(Json::objectValue);
+  out["cuda"] = bool(DASHCAM_WITH_CUDA);
+  out["nvdec"] = bool(DASHCAM_WITH_NVDEC);
+  out["tensorrt"] = bool(DASHCAM_WITH_TENSORRT);
+  out["nvenc"] = bool(DASHCAM_WITH_NVENC);
+  GpuDeviceInfo device = query_device(config.decoder.gpu_device);
+  out["device"] = device.cache_tag();
+  out["queue_capacity"] = Json::UInt64(config.queue_capacity);
+  out["detect_threads"] = Json::UInt64(config.detect_threads);
+  out["surfaces"] = Json::UInt64(config.decoder.surface_count);
+  out["lowres_height"] = config.transcode.height;
+  if (detector) {
+    Json::Value models(Json::objectValue);
+    for (const std::filesystem::path& model : {detector->vehicle_model, detector->plate_model}) {
+      std::error_code ec;
+      models[model.filename().string()] =
+          std::filesystem::exists(model, ec) ? to_hex(hash_file(model)) : "missing";
+    }
+    out["models"] = models;
+    out["precision"] = to_string(detector->precision);
+    out["max_batch"] = detector->max_batch;
+    out["plate_search"] =
+        detector->plate_search == PlateSearchMode::Proposals ? "proposals" : "full_frame";
+  } else {
+    out["models"] = Json::Value(Json::nullValue);
+  }
+  return out;
+}
+
+// Publishes the clip as a task, pulls it and runs it as the worker does.
+Json::Value run_clip(const Clip& clip, const Options& options, HeavyProcessor& processor,
+                     MockTaskServer& server, std::size_t free_before_models) {
+  Json::Value out(Json::objectValue);
+  out["name"] = clip.name;
+  out["conditions"] = clip.conditions;
+  out["resolution"] = clip.resolution;
+
+  std::string fingerprint = to_hex(fingerprint_file(clip.video));
+  out["fingerprint"] = fingerprint;
+  if (!clip.fingerprint.empty() && clip.fingerprint != fingerprint) {
+    throw std::runtime_error("fingerprint " + fingerprint + " does not match the pinned " +
+                             clip.fingerprint);
+  }
+  // Decode-only runs detect nothing, so there is nothing to score.
+  std::optional<Truth> truth;
+  if (!clip.truth.empty() && !options.decode_only) {
+    truth = load_truth(clip.truth);
+  }
+
+  TaskClient client("127.0.0.1", server.port(), "bench");
+  NewTask heavy;
+  heavy.task_type = std::string(kHeavyProcessVideo);
+  heavy.video_id = clip.name;
+  heavy.inputs.push_back({"indoor_nas", clip.video.generic_string(), "video"});
+  client.create({&heavy, 1});
+  const std::vector<std::string> types{std::string(kHeavyProcessVideo)};
+  std::vector<Task> tasks = client.pull(types, 1);
+  if (tasks.empty()) {
+    throw std::runtime_error("published task was not handed out");
+  }
+  const Task& task = tasks.front();
+
+  PeakRss::reset();
+  HeavyResult result;
+  double run_s = 0.0;
+  std::size_t min_free = 0;
+  {
+    VramSampler vram(options.gpu);
+    auto start = std::chrono::steady_clock::now();
+    result = processor.run(task.inputs.front().path, find_shard(task.params));
+    run_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    min_free = vram.min_free();
+  }
+  std::int64_t peak_rss = PeakRss::read();
+
+  auto publish_start = std::chrono::steady_clock::now();
+  std::filesystem::path output;
+  TaskCompletion completion;
+  {
+    TraceBinding bind(result.trace.get());
+    {
+      ScopedTrace span("write_output", "publish");
+      output = write_heavy_output(options.work_dir / "heavy_output", task.video_id, result);
+    }
+    completion.task_id = task.task_id;
+    NewTask finalize;
+    finalize.task_type = std::string(kFinalizeVideo);
+    finalize.video_id = task.video_id;
+    finalize.inputs.push_back({"indoor_nas", output.generic_string(), "heavy_output"});
+    finalize.inputs.push_back(task.inputs.front());
+    completion.publish.push_back(std::move(finalize));
+  }
+  std::vector<CompletionResult> completed;
+  {
+    TraceBinding bind(result.trace.get());
+    ScopedTrace span("complete", "publish");
+    completed = client.complete({&completion, 1});
+  }
+  double publish_s =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - publish_start).count();
+  if (completed.empty() || completed.front().status != CompletionStatus::Completed) {
+    throw std::runtime_error("task was not completed");
+  }
+
+  out["frames_decoded"] = Json::Int64(result.frames_decoded);
+  out["frames_kept"] = Json::Int64(result.frames_kept);
+  out["run_s"] = run_s;
+  out["publish_s"] = publish_s;
+  out["fps"] = run_s > 0 ? static_cast<double>(result.frames_decoded) / run_s : 0.0;
+  out["motion_kernel"] = result.motion_kernel;
+  out["peak_rss_bytes"] = Json::Int64(peak_rss);
+  if (free_before_models > 0) {
+    out["peak_vram_bytes"] =
+        Json::UInt64(free_before_models - std::min(min_free, free_before_models));
+  } else {
+    out["peak_vram_bytes"] = Json::Value(Json::nullValue);
+  }
+  out["stages"] = stages_json(result.stages);
+  if (result.trace) {
+    out["latency"] = latency_json(*result.trace, result.stages);
+    out["spans_overwritten"] = Json::UInt64(result.trace->overwritten());
+  }
+  out["read_mib_s"] = result.io.read_s > 0
+                          ? static_cast<double>(result.io.bytes_read) / (1 << 20) / result.io.read_s
+                          : 0.0;
+  out["decode_stall_s"] = result.io.stall_s;
+  out["ocr_calls"] = Json::UInt64(result.ocr.ocr_calls);
+
+  if (truth) {
+    Json::Value accuracy(Json::objectValue);
+    accuracy["annotated_frames"] = Json::UInt64(truth->annotated_frames.size());
+    accuracy["vehicle"] = match_json(match_boxes(*truth, result.detections, ObjectClass::Vehicle));
+    accuracy["plate"] = match_json(match_boxes(*truth, result.detections, ObjectClass::Plate));
+    accuracy["ocr"] = ocr_json(*truth, result.plates);
+    out["accuracy"] = accuracy;
+  } else {
+    out["accuracy"] = Json::Value(Json::nullValue);
+  }
+
+  std::fprintf(stderr, "%s: %lld frames in %.2f s (%.1f frames/s), %lld kept\n",
+               clip.name.c_str(), static_cast<long long>(result.frames_decoded), run_s,
+               out["fps"].asDouble(), static_cast<long long>(result.frames_kept));
+  std::error_code ec;
+  std::filesystem::remove_all(output, ec);
+  return out;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  bool usage = false;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (arg == "--manifest" && has_value) {
+      options.manifest = argv[++i];
+    } else if (arg == "--clips-dir" && has_value) {
+      options.clips_dir = argv[++i];
+    } else if (arg == "--only" && has_value) {
+      options.only = split_names(argv[++i]);
+    } else if (arg == "--out" && has_value) {
+      options.out = argv[++i];
+    } else if (arg == "--work-dir" && has_value) {
+      options.work_dir = argv[++i];
+    } else if (arg == "--gpu" && has_value) {
+      options.gpu = std::max(0, std::atoi(argv[++i]));
+    } else if (arg == "--lowres-height" && has_value) {
+      options.lowres_height = std::max(0, std::atoi(argv[++i]));
+    } else if (arg == "--decode-only") {
+      options.decode_only = true;
+    } else {
+      usage = true;
+      break;
+    }
+  }
+  if (usage) {
+    std::fprintf(stderr,
+                 "usage: %s [--manifest clips.json] [--clips-dir dir] [--only name,...] "
+                 "[--out result.json] [--work-dir dir] [--gpu 0] [--lowres-height 720] "
+                 "[--decode-only]\n",
+                 argv[0]);
+    return 2;
+  }
+
+  try {
+    std::vector<Clip> clips = load_manifest(options);
+    if (clips.empty()) {
+      throw std::runtime_error("no clips selected in " + options.manifest.string());
+    }
+
+    HeavyProcessConfig config;
+    config.decoder.gpu_device = options.gpu;
+    config.transcode.height = options.lowres_height;
+    config.transcode.scratch_dir = options.work_dir / "lowres";
+    config.trace_events = kTraceEvents;
+    std::optional<DetectorConfig> detector_config;
+    if (!options.decode_only) {
+      detector_config.emplace();
+      detector_config->gpu_device = options.gpu;
+    }
+
+    use_device(options.gpu);
+    std::size_t free_before_models = free_device_memory(options.gpu);
+    std::shared_ptr<Detector> detector;
+    if (detector_config) {
+      detector = std::make_shared<Detector>(*detector_config);
+    }
+    HeavyProcessor processor(config, detector);
+    MockTaskServer server;
+
+    Json::Value report(Json::objectValue);
+    report["schema"] = "dashcam_bench/1";
+    report["build"] = build_json(config, detector_config);
+    report["clips"] = Json::Value(Json::arrayValue);
+    std::int64_t frames = 0;
+    double run_s = 0.0;
+    bool ok = true;
+    for (const Clip& clip : clips) {
+      try {
+        Json::Value result = run_clip(clip, options, processor, server, free_before_models);
+        frames += result["frames_decoded"].asInt64();
+        run_s += result["run_s"].asDouble();
+        report["clips"].append(result);
+      } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s: %s\n", clip.name.c_str(), e.what());
+        Json::Value failed(Json::objectValue);
+        failed["name"] = clip.name;
+        failed["error"] = e.what();
+        report["clips"].append(failed);
+        ok = false;
+      }
+    }
+    Json::Value total(Json::objectValue);
+    total["frames"] = Json::Int64(frames);
+    total["run_s"] = run_s;
+    total["fps"] = run_s > 0 ? static_cast<double>(frames) / run_s : 0.0;
+    total["tasks_completed"] = Json::Int64(server.store().counts().complete);
+    report["total"] = total;
+
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "  ";
+    std::string text = Json::writeString(builder, report) + "\n";
+    if (options.out.empty()) {
+      std::fwrite(text.data(), 1, text.size(), stdout);
+    } else {
+      std::ofstream(options.out, std::ios::binary) << text;
+    }
+    return ok ? 0 : 1;
+  } catch (const std::exception& e) {
+    std::fprintf(stderr, "dashcam_bench: %s\n", e.what());
+    return 1;
+  }
+}
@@ -0,0 +1,163 @@
+// Interpolating a synthetic 1-hour trip's GPS (1 Hz fixes, one 40 s tunnel
+// gap, crossing the antimeridian and north) onto every frame at 30 fps:
+// a per-frame binary search against the merge pass with each kernel.
+//
+//   gps_interp_bench [minutes] [fps] [repeats]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "common/cpu_features.hpp"
+#include "worker/gps/gps_align.hpp"
+
+using namespace dashcam;
+using namespace dashcam::worker;
+
+namespace {
+
+GpsTrack make_trip(int minutes) {
+  GpsTrack track;
+  std::mt19937 rng(7);
+  std::normal_distribution<double> jitter(0.0, 2e-6);
+  double lat = -16.5;
+  double lon = 179.8;
+  double bearing = 300.0;
+  int seconds = minutes * 60;
+  for (int s = 0; s <= seconds; ++s) {
+    if (s >= seconds / 3 && s < seconds / 3 + 40) {
+      continue;  // tunnel
+    }
+    // Slow turns, so the bearing keeps crossing north.
+    bearing = std::fmod(bearing + 3.0 * std::sin(s / 90.0) + 360.0, 360.0);
+    double speed = 12.0 + 6.0 * std::sin(s / 300.0);
+    double rad = bearing * M_PI / 180.0;
+    lat += speed * std::cos(rad) / 111'320.0 + jitter(rng);
+    lon += speed * std::sin(rad) / (111'320.0 * std::cos(lat * M_PI / 180.0)) + jitter(rng);
+    lon = lon - 360.0 * std::floor((lon + 180.0) / 360.0);
+    track.append(static_cast<std::int64_t>(s) * 1'000'000 + 250'000, lat, lon, speed, bearing,
+                 3.0 + (s % 7));
+  }
+  return track;
+}
+
+// The per-frame search the merge replaces, with the same gap rules.
+void plan_by_search(const GpsTrack& track, std::span<const std::int64_t> t_us,
+                    const GpsAlignConfig& config, GpsSegments& out) {
+  const std::vector<std::int64_t>& t = track.t_us;
+  std::size_t m = t.size();
+  out.a.assign(t_us.size(), -1);
+  out.b.assign(t_us.size(), -1);
+  out.w.assign(t_us.size(), 0.0);
+  for (std::size_t i = 0; i < t_us.size(); ++i) {
+    std::int64_t f = t_us[i];
+    auto hi = static_cast<std::size_t>(std::upper_bound(t.begin(), t.end(), f) - t.begin());
+    auto hold = [&](std::size_t row) { out.a[i] = out.b[i] = static_cast<std::int32_t>(row); };
+    if (hi == 0) {
+      if (t[0] - f <= config.hold_us) {
+        hold(0);
+      }
+    } else if (hi == m) {
+      if (f - t[m - 1] <= config.hold_us) {
+        hold(m - 1);
+      }
+    } else if (t[hi] - t[hi - 1] > config.max_gap_us) {
+      if (f - t[hi - 1] <= config.hold_us) {
+        hold(hi - 1);
+      } else if (t[hi] - f <= config.hold_us) {
+        hold(hi);
+      }
+    } else {
+      out.a[i] = static_cast<std::int32_t>(hi - 1);
+      out.b[i] = static_cast<std::int32_t>(hi);
+      out.w[i] = static_cast<double>(f - t[hi - 1]) / static_cast<double>(t[hi] - t[hi - 1]);
+    }
+  }
+}
+
+bool same(const std::vector<double>& a, const std::vector<double>& b) {
+  return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(double)) == 0;
+}
+
+bool same(const GpsFixes& a, const GpsFixes& b) {
+  return same(a.lat, b.lat) && same(a.lon, b.lon) && same(a.speed, b.speed) &&
+         same(a.bearing, b.bearing) && same(a.accuracy, b.accuracy);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int minutes = argc > 1 ? std::atoi(argv[1]) : 60;
+  double fps = argc > 2 ? std::atof(argv[2]) : 30.0;
+  int repeats = argc > 3 ? std::atoi(argv[3]) : 20;
+  if (minutes < 1 || fps <= 0 || repeats < 1) {
+    std::fprintf(stderr, "usage: %s [minutes] [fps] [repeats]\n", argv[0]);
+    return 2;
+  }
+
+  GpsTrack track = make_trip(minutes);
+  std::vector<std::int64_t> frames(static_cast<std::size_t>(minutes * 60 * fps));
+  for (std::size_t i = 0; i < frames.size(); ++i) {
+    frames[i] = static_cast<std::int64_t>(static_cast<double>(i) * 1e6 / fps);
+  }
+  GpsAlignConfig config;
+
+  std::vector<GpsKernel> kernels{{"scalar", &gps_interp_scalar}};
+#if DASHCAM_HAVE_X86_SIMD
+  if (cpu_features().avx2) {
+    kernels.push_back({"avx2", &gps_interp_avx2});
+  }
+#endif
+
+  struct Variant {
+    const char* name;
+    bool search;
+    GpsKernel kernel;
+  };
+  std::vector<Variant> variants{{"search+scalar", true, kernels.front()}};
+  for (const GpsKernel& k : kernels) {
+    variants.push_back({k.name, false, k});
+  }
+
+  std::printf("%zu fixes, %zu frames (%d min at %.0f fps), runtime pick: %s\n", track.size(),
+              frames.size(), minutes, fps, select_gps_kernel().name);
+  std::printf("%-14s %12s %10s %8s\n", "variant", "Mframes/s", "ns/frame", "exact");
+  GpsFixes reference;
+  bool ok = true;
+  for (const Variant& v : variants) {
+    GpsSegments segments;
+    GpsFixes fixes;
+    fixes.resize(frames.size());
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeats; ++r) {
+      if (v.search) {
+        plan_by_search(track, frames, config, segments);
+      } else {
+        plan_gps_segments(track, frames, config, segments);
+      }
+      v.kernel.fn(track, segments, fixes);
+    }
+    double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (reference.size() == 0) {
+      reference = fixes;
+    }
+    bool exact = same(fixes, reference);
+    ok = ok && exact;
+    double per_frame = seconds / repeats / static_cast<double>(frames.size());
+    std::printf("%-14s %12.1f %10.2f %8s\n", v.name, 1e-6 / per_frame, per_frame * 1e9,
+                exact ? "yes" : "NO");
+  }
+
+  std::size_t located = 0;
+  for (double lat : reference.lat) {
+    located += std::isnan(lat) ? 0 : 1;
+  }
+  std::printf("%zu of %zu frames located\n", located, frames.size());
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,276 @@
+#include "common/column_file.hpp"
+
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+#include "common/hash.hpp"
+
+namespace dashcam {
+
+static_assert(std::endian::native == std::endian::little, "column files are little-endian");
+
+namespace {
+
+constexpr char kMagic[8] = {'D', 'C', 'C', 'O', 'L', 'U', 'M', 'N'};
+constexpr std::uint32_t kFormatVersion = 1;
+constexpr std::size_t kSchemaBytes = 32;
+constexpr std::size_t kNameBytes = 24;
+constexpr std::size_t kHeaderBytes = 8 + 4 + 4 + 8 + 8 + kSchemaBytes;
+constexpr std::size_t kEntryBytes = kNameBytes + 4 + 4 + 8 + 8 + 8;
+constexpr std::uint64_t kAlign = 64;
+
+std::uint64_t align_up(std::uint64_t value) { return (value + kAlign - 1) / kAlign * kAlign; }
+
+template <typename T>
+void put(std::vector<char>& out, T value) {
+  const char* bytes = reinterpret_cast<const char*>(&value);
+  out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+void put_text(std::vector<char>& out, const std::string& text, std::size_t width) {
+  std::size_t start = out.size();
+  out.resize(start + width, '\0');
+  std::memcpy(out.data() + start, text.data(), std::min(text.size(), width));
+}
+
+template <typename T>
+T get(const unsigned char* p) {
+  T value;
+  std::memcpy(&value, p, sizeof(T));
+  return value;
+}
+
+std::string get_text(const unsigned char* p, std::size_t width) {
+  const char* text = reinterpret_cast<const char*>(p);
+  return std::string(text, strnlen(text, width));
+}
+
+bool valid_type(std::uint32_t type) { return type >= 1 && type <= 5; }
+
+Json::Value value_at(const unsigned char* column, ColumnType type, std::uint64_t row) {
+  const unsigned char* p = column + row * column_type_size(type);
+  switch (type) {
+    case ColumnType::UInt8:
+      return Json::UInt(*p);
+    case ColumnType::Int32:
+      return get<std::int32_t>(p);
+    case ColumnType::Int64:
+      return Json::Int64(get<std::int64_t>(p));
+    case ColumnType::Float32: {
+      float v = get<float>(p);
+      return std::isfinite(v) ? Json::Value(v) : Json::Value();
+    }
+    case ColumnType::Float64: {
+      double v = get<double>(p);
+      return std::isfinite(v) ? Json::Value(v) : Json::Value();
+    }
+  }
+  return Json::Value();
+}
+
+}  // namespace
+
+std::size_t column_type_size(ColumnType type) {
+  switch (type) {
+    case ColumnType::UInt8:
+      return 1;
+    case ColumnType::Int32:
+    case ColumnType::Float32:
+      return 4;
+    case ColumnType::Int64:
+    case ColumnType::Float64:
+      return 8;
+  }
+  return 0;
+}
+
+const char* to_string(ColumnType type) {
+  switch (type) {
+    case ColumnType::UInt8:
+      return "u8";
+    case ColumnType::Int32:
+      return "i32";
+    case ColumnType::Int64:
+      return "i64";
+    case ColumnType::Float32:
+      return "f32";
+    case ColumnType::Float64:
+      return "f64";
+  }
+  return "unknown";
+}
+
+ColumnFileWriter::ColumnFileWriter(std::string schema) : schema_(std::move(schema)) {
+  if (schema_.empty() || schema_.size() >= kSchemaBytes) {
+    throw std::invalid_argument("column file schema must be 1-31 characters");
+  }
+}
+
+void ColumnFileWriter::add_raw(std::string name, ColumnType type, const void* data,
+                               std::uint64_t rows) {
+  if (name.empty() || name.size() >= kNameBytes) {
+    throw std::invalid_argument("column name must be 1-23 characters: " + name);
+  }
+  for (const Pending& column : columns_) {
+    if (column.name == name) {
+      throw std::invalid_argument("duplicate column " + name);
+    }
+  }
+  if (!columns_.empty() && columns_.front().rows != rows) {
+    throw std::invalid_argument("column " + name + " has " + std::to_string(rows) +
+                                " rows, expected " + std::to_string(columns_.front().rows));
+  }
+  columns_.push_back({std::move(name), type, data, rows});
+}
+
+void ColumnFileWriter::write(const std::filesystem::path& path) const {
+  std::uint64_t rows = columns_.empty() ? 0 : columns_.front().rows;
+
+  std::vector<char> directory;
+  std::uint64_t offset = align_up(kHeaderBytes + kEntryBytes * columns_.size());
+  std::vector<std::uint64_t> offsets;
+  for (const Pending& column : columns_) {
+    std::uint64_t bytes = rows * column_type_size(column.type);
+    put_text(directory, column.name, kNameBytes);
+    put(directory, static_cast<std::uint32_t>(column.type));
+    put(directory, std::uint32_t{0});
+    put(directory, offset);
+    put(directory, bytes);
+    put(directory, xxh64(column.data, static_cast<std::size_t>(bytes)));
+    offsets.push_back(offset);
+    offset = align_up(offset + bytes);
+  }
+
+  std::vector<char> header;
+  header.insert(header.end(), kMagic, kMagic + sizeof(kMagic));
+  put(header, kFormatVersion);
+  put(header, static_cast<std::uint32_t>(columns_.size()));
+  put(header, rows);
+  put(header, xxh64(directory.data(), directory.size()));
+  put_text(header, schema_, kSchemaBytes);
+
+  auto tmp = path;
+  tmp += ".tmp";
+  {
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    out.write(header.data(), static_cast<std::streamsize>(header.size()));
+    out.write(directory.data(), static_cast<std::streamsize>(directory.size()));
+    std::uint64_t written = header.size() + directory.size();
+    static constexpr char kPadding[kAlign] = {};
+    for (std::size_t i = 0; i < columns_.size(); ++i) {
+      out.write(kPadding, static_cast<std::streamsize>(offsets[i] - written));
+      auto bytes = static_cast<std::streamsize>(rows * column_type_size(columns_[i].type));
+      out.write(static_cast<const char*>(columns_[i].data), bytes);
+      written = offsets[i] + static_cast<std::uint64_t>(bytes);
+    }
+    if (!out) {
+      throw std::runtime_error("cannot write " + tmp.string());
+    }
+  }
+  std::filesystem::rename(tmp, path);
+}
+
+ColumnFile::ColumnFile(const std::filesystem::path& path) : map_(path) {
+  data_ = map_.data();
+  size_ = map_.size();
+  auto bad = [&](const std::string& why) {
+    return std::runtime_error("invalid column file " + path.string() + ": " + why);
+  };
+  if (size_ < kHeaderBytes || std::memcmp(data_, kMagic, sizeof(kMagic)) != 0) {
+    throw bad("missing header");
+  }
+  auto version = get<std::uint32_t>(data_ + 8);
+  if (version != kFormatVersion) {
+    throw bad("unsupported format version " + std::to_string(version));
+  }
+  auto count = get<std::uint32_t>(data_ + 12);
+  rows_ = get<std::uint64_t>(data_ + 16);
+  auto checksum = get<std::uint64_t>(data_ + 24);
+  schema_ = get_text(data_ + 32, kSchemaBytes);
+  if (kHeaderBytes + std::uint64_t{count} * kEntryBytes > size_) {
+    throw bad("truncated directory");
+  }
+  const unsigned char* directory = data_ + kHeaderBytes;
+  if (xxh64(directory, count * kEntryBytes) != checksum) {
+    throw bad("directory checksum mismatch");
+  }
+  for (std::uint32_t i = 0; i < count; ++i) {
+    const unsigned char* entry = directory + i * kEntryBytes;
+    ColumnInfo info;
+    info.name = get_text(entry, kNameBytes);
+    auto type = get<std::uint32_t>(entry + kNameBytes);
+    info.offset = get<std::uint64_t>(entry + kNameBytes + 8);
+    info.bytes = get<std::uint64_t>(entry + kNameBytes + 16);
+    info.checksum = get<std::uint64_t>(entry + kNameBytes + 24);
+    if (!valid_type(type)) {
+      throw bad("column " + info.name + " has unknown type " + std::to_string(type));
+    }
+    info.type = static_cast<ColumnType>(type);
+    if (info.offset % kAlign != 0 || info.bytes != rows_ * column_type_size(info.type) ||
+        info.offset > size_ || info.bytes > size_ - info.offset) {
+      throw bad("column " + info.name + " out of bounds");
+    }
+    columns_.push_back(std::move(info));
+  }
+}
+
+const ColumnInfo* ColumnFile::find(std::string_view name) const {
+  for (const ColumnInfo& info : columns_) {
+    if (info.name == name) {
+      return &info;
+    }
+  }
+  return nullptr;
+}
+
+const ColumnInfo& ColumnFile::require(std::string_view name, ColumnType type) const {
+  const ColumnInfo* info = find(name);
+  if (info == nullptr) {
+    throw std::runtime_error("no column " + std::string(name) + " in " + schema_);
+  }
+  if (info->type != type) {
+    throw std::runtime_error("column " + std::string(name) + " is " + to_string(info->type) +
+                             ", not " + to_string(type));
+  }
+  return *info;
+}
+
+bool ColumnFile::verify() const {
+  for (const ColumnInfo& info : columns_) {
+    if (xxh64(data_ + info.offset, static_cast<std::size_t>(info.bytes)) != info.checksum) {
+      return false;
+    }
+  }
+  return true;
+}
+
+Json::Value to_json(const ColumnFile& file, std::uint64_t max_rows) {
+  Json::Value out(Json::objectValue);
+  out["schema"] = file.schema();
+  out["rows"] = Json::UInt64(file.rows());
+  Json::Value columns(Json::arrayValue);
+  for (const ColumnInfo& info : file.columns()) {
+    Json::Value column(Json::objectValue);
+    column["name"] = info.name;
+    column["type"] = to_string(info.type);
+    columns.append(column);
+  }
+  out["columns"] = columns;
+
+  Json::Value data(Json::arrayValue);
+  std::uint64_t rows = std::min(file.rows(), max_rows);
+  for (std::uint64_t row = 0; row < rows; ++row) {
+    Json::Value item(Json::objectValue);
+    for (const ColumnInfo& info : file.columns()) {
+      item[info.name] =
+          value_at(static_cast<const unsigned char*>(file.data(info)), info.type, row);
+    }
+    data.append(item);
+  }
+  out["data"] = data;
+  return out;
+}
+
+}  // namespace dashcam
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <json/value.h>
+
+#include "common/mapped_file.hpp"
+
+namespace dashcam {
+
+// Versioned columnar file for per-frame metadata (detections, candidates):
+// one fixed-width array per column, each 64-byte aligned, so a reader can
+// mmap the file and use a column in place without parsing the others.
+//
+// Layout, little-endian:
+//   header     magic "DCCOLUMN", u32 format version, u32 column count,
+//              u64 row count, xxh64 of the directory, char schema[32]
+//   directory  per column: char name[24], u32 type, u32 reserved,
+//              u64 offset, u64 bytes, xxh64 of the data
+//   data       the columns, each at a 64-byte aligned offset
+//
+// `schema` names the column set and its version ("detections/1"); readers
+// check it before trusting column names.
+enum class ColumnType : std::uint32_t {
+  UInt8 = 1,
+  Int32 = 2,
+  Int64 = 3,
+  Float32 = 4,
+  Float64 = 5,
+};
+
+template <typename T>
+constexpr ColumnType column_type_of();
+template <>
+constexpr ColumnType column_type_of<std::uint8_t>() { return ColumnType::UInt8; }
+template <>
+constexpr ColumnType column_type_of<std::int32_t>() { return ColumnType::Int32; }
+template <>
+constexpr ColumnType column_type_of<std::int64_t>() { return ColumnType::Int64; }
+template <>
+constexpr ColumnType column_type_of<float>() { return ColumnType::Float32; }
+template <>
+constexpr ColumnType column_type_of<double>() { return ColumnType::Float64; }
+
+std::size_t column_type_size(ColumnType type);
+const char* to_string(ColumnType type);
+
+struct ColumnInfo {
+  std::string name;
+  ColumnType type = ColumnType::UInt8;
+  std::uint64_t offset = 0;
+  std::uint64_t bytes = 0;
+  std::uint64_t checksum = 0;
+};
+
+// Collects columns of equal length and writes them out in one go. Columns
+// are not copied: the spans must stay valid until write() returns.
+class ColumnFileWriter {
+ public:
+  explicit ColumnFileWriter(std::string schema);
+
+  template <typename T>
+  void add(std::string name, std::span<const T> values) {
+    add_raw(std::move(name), column_type_of<T>(), values.data(), values.size());
+  }
+
+  // Writes to a temporary file next to `path` and renames it into place.
+  // Throws std::invalid_argument for mismatched columns and
+  // std::runtime_error on I/O errors.
+  void write(const std::filesystem::path& path) const;
+
+ private:
+  struct Pending {
+    std::string name;
+    ColumnType type;
+    const void* data;
+    std::uint64_t rows;
+  };
+
+  void add_raw(std::string name, ColumnType type, const void* data, std::uint64_t rows);
+
+  std::string schema_;
+  std::vector<Pending> columns_;
+};
+
+// Read-only mapping of a column file. Opening validates the header and
+// directory (not the data); columns are views into the mapping.
+class ColumnFile {
+ public:
+  // Throws std::runtime_error if the file cannot be mapped or is not a
+  // column file of a supported version.
+  explicit ColumnFile(const std::filesystem::path& path);
+
+  const std::string& schema() const { return schema_; }
+  std::uint64_t rows() const { return rows_; }
+  const std::vector<ColumnInfo>& columns() const { return columns_; }
+  const ColumnInfo* find(std::string_view name) const;
+
+  // Throws std::runtime_error if the column is missing or of another type.
+  template <typename T>
+  std::span<const T> column(std::string_view name) const {
+    const ColumnInfo& info = require(name, column_type_of<T>());
+    return {reinterpret_cast<const T*>(data_ + info.offset), static_cast<std::size_t>(rows_)};
+  }
+
+  // Untyped view of a column from columns().
+  const void* data(const ColumnInfo& info) const { return data_ + info.offset; }
+
+  // Checks every column's checksum; reads the whole file.
+  bool verify() const;
+
+ private:
+  const ColumnInfo& require(std::string_view name, ColumnType type) const;
+
+  MappedFile map_;
+  const unsigned char* data_ = nullptr;
+  std::size_t size_ = 0;
+  std::string schema_;
+  std::uint64_t rows_ = 0;
+  std::vector<ColumnInfo> columns_;
+};
+
+// Debugging export: {"schema", "rows", "columns": [{"name", "type"}],
+// "data": [{column: value, ...}, ...]} with at most `max_rows` rows.
+Json::Value to_json(const ColumnFile& file, std::uint64_t max_rows = UINT64_MAX);
+
+}  // namespace dashcam
@@ -0,0 +1,44 @@
+#include "common/cpu_features.hpp"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+namespace dashcam {
+
+namespace {
+
+CpuFeatures detect() {
+  CpuFeatures f;
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  // libgcc also checks XCR0, so these are false when the OS does not save
+  // the wider registers.
+  __builtin_cpu_init();
+  f.avx2 = __builtin_cpu_supports("avx2");
+  f.avx512bw = __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+  int regs[4] = {};
+  __cpuid(regs, 1);
+  bool osxsave = (regs[2] & (1 << 27)) != 0;
+  if (!osxsave) {
+    return f;
+  }
+  unsigned long long xcr0 = _xgetbv(0);
+  bool ymm = (xcr0 & 0x6) == 0x6;
+  bool zmm = (xcr0 & 0xE6) == 0xE6;
+  __cpuidex(regs, 7, 0);
+  f.avx2 = ymm && (regs[1] & (1 << 5)) != 0;
+  f.avx512bw = zmm && (regs[1] & (1 << 16)) != 0 && (regs[1] & (1 << 30)) != 0;
+#endif
+  return f;
+}
+
+}  // namespace
+
+const CpuFeatures& cpu_features() {
+  static const CpuFeatures features = detect();
+  return features;
+}
+
+}  // namespace dashcam
@@ -0,0 +1,13 @@
+#pragma once
+
+namespace dashcam {
+
+// x86 vector extensions usable on this machine (CPU and OS support both).
+struct CpuFeatures {
+  bool avx2 = false;
+  bool avx512bw = false;  // implies AVX-512F
+};
+
+const CpuFeatures& cpu_features();
+
+}  // namespace dashcam
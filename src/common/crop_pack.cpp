@@ -0,0 +1,166 @@
+#include "common/crop_pack.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace dashcam {
+
+namespace {
+
+void write_file(const std::filesystem::path& path, const void* data, std::size_t bytes) {
+  auto tmp = path;
+  tmp += ".tmp";
+  {
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    out.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+    if (!out) {
+      throw std::runtime_error("cannot write " + tmp.string());
+    }
+  }
+  std::filesystem::rename(tmp, path);
+}
+
+}  // namespace
+
+void CropPackWriter::append(const CropEntry& entry, std::span<const std::uint8_t> jpeg) {
+  offset_.push_back(static_cast<std::int64_t>(data_.size()));
+  bytes_.push_back(static_cast<std::int64_t>(jpeg.size()));
+  data_.insert(data_.end(), jpeg.begin(), jpeg.end());
+  track_.push_back(entry.track);
+  frame_.push_back(entry.frame);
+  x0_.push_back(entry.x0);
+  y0_.push_back(entry.y0);
+  x1_.push_back(entry.x1);
+  y1_.push_back(entry.y1);
+  score_.push_back(entry.score);
+  quality_.push_back(entry.quality);
+  width_.push_back(entry.width);
+  height_.push_back(entry.height);
+}
+
+void CropPackWriter::write(const std::filesystem::path& dir) const {
+  write_file(dir / kCropPackFile, data_.data(), data_.size());
+  ColumnFileWriter writer(kCropSchema);
+  writer.add<std::int32_t>("track", track_);
+  writer.add<std::int64_t>("frame", frame_);
+  writer.add<float>("x0", x0_);
+  writer.add<float>("y0", y0_);
+  writer.add<float>("x1", x1_);
+  writer.add<float>("y1", y1_);
+  writer.add<float>("score", score_);
+  writer.add<float>("quality", quality_);
+  writer.add<std::int32_t>("width", width_);
+  writer.add<std::int32_t>("height", height_);
+  writer.add<std::int64_t>("offset", offset_);
+  writer.add<std::int64_t>("bytes", bytes_);
+  writer.write(dir / kCropIndexFile);
+}
+
+CropPack::CropPack(const std::filesystem::path& dir)
+    : index_(dir / kCropIndexFile), data_(dir / kCropPackFile) {
+  if (index_.schema() != kCropSchema) {
+    throw std::runtime_error((dir / kCropIndexFile).string() + ": schema " + index_.schema() +
+                             ", expected " + kCropSchema);
+  }
+  // Fail here rather than at first use if a column is missing or retyped.
+  static const std::pair<const char*, ColumnType> kColumns[] = {
+      {"track", ColumnType::Int32},   {"frame", ColumnType::Int64},   {"x0", ColumnType::Float32},
+      {"y0", ColumnType::Float32},    {"x1", ColumnType::Float32},    {"y1", ColumnType::Float32},
+      {"score", ColumnType::Float32}, {"quality", ColumnType::Float32},
+      {"width", ColumnType::Int32},   {"height", ColumnType::Int32},  {"offset", ColumnType::Int64},
+      {"bytes", ColumnType::Int64},
+  };
+  for (const auto& [name, type] : kColumns) {
+    const ColumnInfo* info = index_.find(name);
+    if (info == nullptr || info->type != type) {
+      throw std::runtime_error((dir / kCropIndexFile).string() + ": column " + name +
+                               " missing or not " + to_string(type));
+    }
+  }
+  auto offset = index_.column<std::int64_t>("offset");
+  auto bytes = index_.column<std::int64_t>("bytes");
+  for (std::size_t i = 0; i < size(); ++i) {
+    if (offset[i] < 0 || bytes[i] < 0 ||
+        static_cast<std::uint64_t>(offset[i]) + static_cast<std::uint64_t>(bytes[i]) >
+            data_.size()) {
+      throw std::runtime_error((dir / kCropPackFile).string() + ": crop " + std::to_string(i) +
+                               " out of bounds");
+    }
+  }
+}
+
+CropEntry CropPack::entry(std::size_t i) const {
+  CropEntry e;
+  e.track = index_.column<std::int32_t>("track")[i];
+  e.frame = index_.column<std::int64_t>("frame")[i];
+  e.x0 = index_.column<float>("x0")[i];
+  e.y0 = index_.column<float>("y0")[i];
+  e.x1 = index_.column<float>("x1")[i];
+  e.y1 = index_.column<float>("y1")[i];
+  e.score = index_.column<float>("score")[i];
+  e.quality = index_.column<float>("quality")[i];
+  e.width = index_.column<std::int32_t>("width")[i];
+  e.height = index_.column<std::int32_t>("height")[i];
+  return e;
+}
+
+std::span<const std::uint8_t> CropPack::jpeg(std::size_t i) const {
+  auto offset = static_cast<std::size_t>(index_.column<std::int64_t>("offset")[i]);
+  auto bytes = static_cast<std::size_t>(index_.column<std::int64_t>("bytes")[i]);
+  return data_.bytes().subspan(offset, bytes);
+}
+
+std::vector<std::size_t> CropPack::best_per_track() const {
+  auto track = index_.column<std::int32_t>("track");
+  auto quality = index_.column<float>("quality");
+  std::map<std::int32_t, std::size_t> best;
+  for (std::size_t i = 0; i < size(); ++i) {
+    auto [it, inserted] = best.try_emplace(track[i], i);
+    if (!inserted && quality[i] > quality[it->second]) {
+      it->second = i;
+    }
+  }
+  std::vector<std::size_t> out;
+  out.reserve(best.size());
+  for (const auto& [id, i] : best) {
+    out.push_back(i);
+  }
+  return out;
+}
+
+bool has_crop_pack(const std::filesystem::path& dir) {
+  return std::filesystem::exists(dir / kCropIndexFile);
+}
+
+std::size_t expand_crop_pack(const CropPack& pack, const std::filesystem::path& out_dir,
+                             bool best_only) {
+  std::vector<std::size_t> rows;
+  if (best_only) {
+    rows = pack.best_per_track();
+  } else {
+    rows.resize(pack.size());
+    for (std::size_t i = 0; i < rows.size(); ++i) {
+      rows[i] = i;
+    }
+  }
+  std::filesystem::create_directories(out_dir);
+  for (std::size_t i : rows) {
+    CropEntry e = pack.entry(i);
+    char name[64];
+    if (best_only) {
+      std::snprintf(name, sizeof(name), "%d_best_crop.jpg", e.track);
+    } else {
+      std::snprintf(name, sizeof(name), "track-%d_frame-%06lld.jpg", e.track,
+                    static_cast<long long>(e.frame));
+    }
+    std::span<const std::uint8_t> jpeg = pack.jpeg(i);
+    write_file(out_dir / name, jpeg.data(), jpeg.size());
+  }
+  return rows.size();
+}
+
+}  // namespace dashcam
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+#include "common/column_file.hpp"
+#include "common/mapped_file.hpp"
+
+namespace dashcam {
+
+// Per-video plate-crop container in a heavy_output directory (workhorse.md
+// §3.3): every archived crop's JPEG back to back in `plate_crops.bin`, and
+// an index `plate_crops.dcol` (column file, schema "crops/1") with one row
+// per crop in write order. One pair of files instead of a file per crop, so
+// neither the OCR pass nor the NAS sees thousands of small writes; the
+// archival step expands it into plates/ or serves crops straight out of it.
+//
+// Index columns: track (i32), frame (i64), x0 y0 x1 y1 (f32, cropped region
+// in frame pixels), score quality (f32), width height (i32, pixels),
+// offset bytes (i64, the JPEG's range in the .bin file).
+inline constexpr const char* kCropSchema = "crops/1";
+inline constexpr const char* kCropPackFile = "plate_crops.bin";
+inline constexpr const char* kCropIndexFile = "plate_crops.dcol";
+
+struct CropEntry {
+  std::int32_t track = -1;
+  std::int64_t frame = 0;
+  float x0 = 0.0f, y0 = 0.0f, x1 = 0.0f, y1 = 0.0f;
+  float score = 0.0f;
+  float quality = 0.0f;
+  std::int32_t width = 0;
+  std::int32_t height = 0;
+};
+
+// Collects encoded crops in memory; write() stores the pack.
+class CropPackWriter {
+ public:
+  void append(const CropEntry& entry, std::span<const std::uint8_t> jpeg);
+
+  std::size_t size() const { return track_.size(); }
+  bool empty() const { return track_.empty(); }
+  std::size_t bytes() const { return data_.size(); }
+
+  // Writes both files of the pack into `dir` (tmp + rename, data before the
+  // index, so an index always describes a complete .bin).
+  void write(const std::filesystem::path& dir) const;
+
+ private:
+  std::vector<std::uint8_t> data_;
+  std::vector<std::int32_t> track_, width_, height_;
+  std::vector<std::int64_t> frame_, offset_, bytes_;
+  std::vector<float> x0_, y0_, x1_, y1_, score_, quality_;
+};
+
+// Read-only mapping of a crop pack; jpeg() views point into the mapping and
+// can be sent as they are.
+class CropPack {
+ public:
+  // Throws std::runtime_error if either file is missing, the index is not a
+  // crops/1 file, or an entry points outside the .bin file.
+  explicit CropPack(const std::filesystem::path& dir);
+
+  std::size_t size() const { return static_cast<std::size_t>(index_.rows()); }
+  CropEntry entry(std::size_t i) const;
+  std::span<const std::uint8_t> jpeg(std::size_t i) const;
+
+  // Index of the highest-quality crop of each track, in track order.
+  std::vector<std::size_t> best_per_track() const;
+
+ private:
+  ColumnFile index_;
+  MappedFile data_;
+};
+
+// True when `dir` holds a crop pack index.
+bool has_crop_pack(const std::filesystem::path& dir);
+
+// Writes the pack's crops into `out_dir` as separate JPEGs: every crop as
+// track-<id>_frame-<n>.jpg, or with `best_only` one <id>_best_crop.jpg per
+// track (shed_NAS.md plates/). Returns the number of files written.
+std::size_t expand_crop_pack(const CropPack& pack, const std::filesystem::path& out_dir,
+                             bool best_only);
+
+}  // namespace dashcam
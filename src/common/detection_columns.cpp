@@ -0,0 +1,74 @@
+#include "common/detection_columns.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace dashcam {
+
+void DetectionColumns::reserve(std::size_t rows) {
+  frame.reserve(rows);
+  pts_us.reserve(rows);
+  for (auto* column : {&x0, &y0, &x1, &y1, &score}) {
+    column->reserve(rows);
+  }
+  cls.reserve(rows);
+  track.reserve(rows);
+  lat.reserve(rows);
+  lon.reserve(rows);
+}
+
+void DetectionColumns::append(std::int64_t frame_index, std::int64_t pts, float bx0, float by0,
+                              float bx1, float by1, float det_score, std::uint8_t det_cls,
+                              std::int32_t track_id, double latitude, double longitude) {
+  frame.push_back(frame_index);
+  pts_us.push_back(pts);
+  x0.push_back(bx0);
+  y0.push_back(by0);
+  x1.push_back(bx1);
+  y1.push_back(by1);
+  score.push_back(det_score);
+  cls.push_back(det_cls);
+  track.push_back(track_id);
+  lat.push_back(latitude);
+  lon.push_back(longitude);
+}
+
+void DetectionColumns::write(const std::filesystem::path& path) const {
+  ColumnFileWriter writer(kDetectionSchema);
+  writer.add<std::int64_t>("frame", frame);
+  writer.add<std::int64_t>("pts_us", pts_us);
+  writer.add<float>("x0", x0);
+  writer.add<float>("y0", y0);
+  writer.add<float>("x1", x1);
+  writer.add<float>("y1", y1);
+  writer.add<float>("score", score);
+  writer.add<std::uint8_t>("cls", cls);
+  writer.add<std::int32_t>("track", track);
+  writer.add<double>("lat", lat);
+  writer.add<double>("lon", lon);
+  writer.write(path);
+}
+
+DetectionTable::DetectionTable(const std::filesystem::path& path) : file_(path) {
+  if (file_.schema() != kDetectionSchema) {
+    throw std::runtime_error(path.string() + ": schema " + file_.schema() + ", expected " +
+                             kDetectionSchema);
+  }
+  // Fail here rather than at first use if a column is missing or retyped.
+  static const std::pair<const char*, ColumnType> kColumns[] = {
+      {"frame", ColumnType::Int64},   {"pts_us", ColumnType::Int64}, {"x0", ColumnType::Float32},
+      {"y0", ColumnType::Float32},    {"x1", ColumnType::Float32},   {"y1", ColumnType::Float32},
+      {"score", ColumnType::Float32}, {"cls", ColumnType::UInt8},    {"track", ColumnType::Int32},
+      {"lat", ColumnType::Float64},   {"lon", ColumnType::Float64},
+  };
+  for (const auto& [name, type] : kColumns) {
+    const ColumnInfo* info = file_.find(name);
+    if (info == nullptr || info->type != type) {
+      throw std::runtime_error(path.string() + ": column " + name + " missing or not " +
+                               to_string(type));
+    }
+  }
+}
+
+}  // namespace dashcam
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <span>
+#include <vector>
+
+#include "common/column_file.hpp"
+
+namespace dashcam {
+
+// `detections.dcol` in a heavy_output directory (workhorse.md §3.7): one row
+// per §3.2 detection of every kept frame, in frame order, as a column file
+// (column_file.hpp) with schema "detections/1". Jetson candidates use the
+// same schema with track -1.
+//
+// Columns: frame (i64, numbered as in the whole video), pts_us (i64),
+// x0 y0 x1 y1 (f32, full-resolution pixels), score (f32), cls (u8,
+// 0 vehicle / 1 plate / 2 pedestrian), track (i32, plate track id, -1 for
+// none), lat lon (f64 degrees, NaN until §3.5 GPS alignment has a fix).
+inline constexpr const char* kDetectionSchema = "detections/1";
+inline constexpr const char* kDetectionFile = "detections.dcol";
+
+inline constexpr double kNoFix = std::numeric_limits<double>::quiet_NaN();
+
+// Rows being collected for a detection file.
+struct DetectionColumns {
+  std::vector<std::int64_t> frame;
+  std::vector<std::int64_t> pts_us;
+  std::vector<float> x0, y0, x1, y1;
+  std::vector<float> score;
+  std::vector<std::uint8_t> cls;
+  std::vector<std::int32_t> track;
+  std::vector<double> lat, lon;
+
+  std::size_t size() const { return frame.size(); }
+  void reserve(std::size_t rows);
+  void append(std::int64_t frame_index, std::int64_t pts, float bx0, float by0, float bx1,
+              float by1, float det_score, std::uint8_t det_cls, std::int32_t track_id,
+              double latitude = kNoFix, double longitude = kNoFix);
+
+  void write(const std::filesystem::path& path) const;
+};
+
+// Typed, zero-copy view of a detection file. Only the columns a caller
+// touches are paged in.
+class DetectionTable {
+ public:
+  // Throws std::runtime_error if the file is not a detections/1 file.
+  explicit DetectionTable(const std::filesystem::path& path);
+
+  std::size_t size() const { return static_cast<std::size_t>(file_.rows()); }
+  const ColumnFile& file() const { return file_; }
+
+  std::span<const std::int64_t> frame() const { return file_.column<std::int64_t>("frame"); }
+  std::span<const std::int64_t> pts_us() const { return file_.column<std::int64_t>("pts_us"); }
+  std::span<const float> x0() const { return file_.column<float>("x0"); }
+  std::span<const float> y0() const { return file_.column<float>("y0"); }
+  std::span<const float> x1() const { return file_.column<float>("x1"); }
+  std::span<const float> y1() const { return file_.column<float>("y1"); }
+  std::span<const float> score() const { return file_.column<float>("score"); }
+  std::span<const std::uint8_t> cls() const { return file_.column<std::uint8_t>("cls"); }
+  std::span<const std::int32_t> track() const { return file_.column<std::int32_t>("track"); }
+  std::span<const double> lat() const { return file_.column<double>("lat"); }
+  std::span<const double> lon() const { return file_.column<double>("lon"); }
+
+ private:
+  ColumnFile file_;
+};
+
+}  // namespace dashcam
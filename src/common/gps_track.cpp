@@ -0,0 +1,66 @@
+#include "common/gps_track.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace dashcam {
+
+void GpsTrack::append(std::int64_t t, double latitude, double longitude, double speed_mps,
+                      double bearing_deg, double accuracy_m) {
+  t_us.push_back(t);
+  lat.push_back(latitude);
+  lon.push_back(longitude);
+  speed.push_back(speed_mps);
+  bearing.push_back(bearing_deg);
+  accuracy.push_back(accuracy_m);
+}
+
+void GpsTrack::sort() {
+  std::vector<std::size_t> order(size());
+  std::iota(order.begin(), order.end(), std::size_t{0});
+  std::stable_sort(order.begin(), order.end(),
+                   [this](std::size_t a, std::size_t b) { return t_us[a] < t_us[b]; });
+  GpsTrack sorted;
+  for (std::size_t i : order) {
+    if (!sorted.empty() && sorted.t_us.back() == t_us[i]) {
+      continue;
+    }
+    sorted.append(t_us[i], lat[i], lon[i], speed[i], bearing[i], accuracy[i]);
+  }
+  *this = std::move(sorted);
+}
+
+void GpsTrack::write(const std::filesystem::path& path) const {
+  ColumnFileWriter writer(kGpsSchema);
+  writer.add<std::int64_t>("t_us", t_us);
+  writer.add<double>("lat", lat);
+  writer.add<double>("lon", lon);
+  writer.add<double>("speed", speed);
+  writer.add<double>("bearing", bearing);
+  writer.add<double>("accuracy", accuracy);
+  writer.write(path);
+}
+
+GpsTable::GpsTable(const std::filesystem::path& path) : file_(path) {
+  if (file_.schema() != kGpsSchema) {
+    throw std::runtime_error(path.string() + ": schema " + file_.schema() + ", expected " +
+                             kGpsSchema);
+  }
+  static const std::pair<const char*, ColumnType> kColumns[] = {
+      {"t_us", ColumnType::Int64},    {"lat", ColumnType::Float64},
+      {"lon", ColumnType::Float64},   {"speed", ColumnType::Float64},
+      {"bearing", ColumnType::Float64}, {"accuracy", ColumnType::Float64},
+  };
+  for (const auto& [name, type] : kColumns) {
+    const ColumnInfo* info = file_.find(name);
+    if (info == nullptr || info->type != type) {
+      throw std::runtime_error(path.string() + ": column " + name + " missing or not " +
+                               to_string(type));
+    }
+  }
+}
+
+}  // namespace dashcam
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <span>
+#include <vector>
+
+#include "common/column_file.hpp"
+
+namespace dashcam {
+
+// A video's GPS log (workhorse.md §3.5) in struct-of-arrays form, one row
+// per fix, sorted by time. Stored as `gps.dcol` (column file, schema
+// "gps/1") next to detections.dcol; the WebUI route map reads it as is.
+//
+// Columns: t_us (i64, microseconds from the start of the video, the same
+// clock as FrameSurface::pts_us), lat lon (f64 degrees), speed (f64 m/s),
+// bearing (f64 degrees clockwise from north, [0, 360)), accuracy (f64
+// metres, NaN when the source does not say).
+inline constexpr const char* kGpsSchema = "gps/1";
+inline constexpr const char* kGpsFile = "gps.dcol";
+
+inline constexpr double kNoValue = std::numeric_limits<double>::quiet_NaN();
+
+struct GpsTrack {
+  std::vector<std::int64_t> t_us;
+  std::vector<double> lat, lon;
+  std::vector<double> speed;
+  std::vector<double> bearing;
+  std::vector<double> accuracy;
+
+  std::size_t size() const { return t_us.size(); }
+  bool empty() const { return t_us.empty(); }
+  void append(std::int64_t t, double latitude, double longitude, double speed_mps,
+              double bearing_deg, double accuracy_m = kNoValue);
+
+  // Sorts rows by time and drops repeated timestamps (keeping the first).
+  void sort();
+
+  void write(const std::filesystem::path& path) const;
+};
+
+// Typed, zero-copy view of a gps.dcol file.
+class GpsTable {
+ public:
+  // Throws std::runtime_error if the file is not a gps/1 file.
+  explicit GpsTable(const std::filesystem::path& path);
+
+  std::size_t size() const { return static_cast<std::size_t>(file_.rows()); }
+
+  std::span<const std::int64_t> t_us() const { return file_.column<std::int64_t>("t_us"); }
+  std::span<const double> lat() const { return file_.column<double>("lat"); }
+  std::span<const double> lon() const { return file_.column<double>("lon"); }
+  std::span<const double> speed() const { return file_.column<double>("speed"); }
+  std::span<const double> bearing() const { return file_.column<double>("bearing"); }
+  std::span<const double> accuracy() const { return file_.column<double>("accuracy"); }
+
+ private:
+  ColumnFile file_;
+};
+
+}  // namespace dashcam
@@ -0,0 +1,172 @@
+#include "common/hash.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+namespace dashcam {
+
+namespace {
+
+constexpr std::uint64_t kPrime1 = 11400714785074694791ULL;
+constexpr std::uint64_t kPrime2 = 14029467366897019727ULL;
+constexpr std::uint64_t kPrime3 = 1609587929392839161ULL;
+constexpr std::uint64_t kPrime4 = 9650029242287828579ULL;
+constexpr std::uint64_t kPrime5 = 2870177450012600261ULL;
+
+std::uint64_t rotl(std::uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+// Input is read little-endian, matching the reference implementation on the
+// x86 machines we run on.
+std::uint64_t read64(const unsigned char* p) {
+  std::uint64_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+std::uint32_t read32(const unsigned char* p) {
+  std::uint32_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+std::uint64_t round(std::uint64_t acc, std::uint64_t input) {
+  acc += input * kPrime2;
+  acc = rotl(acc, 31);
+  return acc * kPrime1;
+}
+
+std::uint64_t merge_round(std::uint64_t acc, std::uint64_t value) {
+  acc ^= round(0, value);
+  return acc * kPrime1 + kPrime4;
+}
+
+}  // namespace
+
+Xxh64::Xxh64(std::uint64_t seed)
+    : v_{seed + kPrime1 + kPrime2, seed + kPrime2, seed, seed - kPrime1}, seed_(seed) {}
+
+void Xxh64::update(const void* data, std::size_t size) {
+  const auto* p = static_cast<const unsigned char*>(data);
+  const unsigned char* end = p + size;
+  total_ += size;
+
+  if (buffered_ + size < sizeof(buffer_)) {
+    std::memcpy(buffer_ + buffered_, p, size);
+    buffered_ += size;
+    return;
+  }
+  if (buffered_ > 0) {
+    std::size_t fill = sizeof(buffer_) - buffered_;
+    std::memcpy(buffer_ + buffered_, p, fill);
+    for (int lane = 0; lane < 4; ++lane) {
+      v_[lane] = round(v_[lane], read64(buffer_ + 8 * lane));
+    }
+    p += fill;
+    buffered_ = 0;
+  }
+  while (end - p >= 32) {
+    for (int lane = 0; lane < 4; ++lane) {
+      v_[lane] = round(v_[lane], read64(p + 8 * lane));
+    }
+    p += 32;
+  }
+  buffered_ = static_cast<std::size_t>(end - p);
+  std::memcpy(buffer_, p, buffered_);
+}
+
+std::uint64_t Xxh64::digest() const {
+  std::uint64_t h;
+  if (total_ >= 32) {
+    h = rotl(v_[0], 1) + rotl(v_[1], 7) + rotl(v_[2], 12) + rotl(v_[3], 18);
+    for (auto v : v_) {
+      h = merge_round(h, v);
+    }
+  } else {
+    h = seed_ + kPrime5;
+  }
+  h += total_;
+
+  const unsigned char* p = buffer_;
+  const unsigned char* end = buffer_ + buffered_;
+  while (end - p >= 8) {
+    h ^= round(0, read64(p));
+    h = rotl(h, 27) * kPrime1 + kPrime4;
+    p += 8;
+  }
+  if (end - p >= 4) {
+    h ^= static_cast<std::uint64_t>(read32(p)) * kPrime1;
+    h = rotl(h, 23) * kPrime2 + kPrime3;
+    p += 4;
+  }
+  while (p < end) {
+    h ^= static_cast<std::uint64_t>(*p) * kPrime5;
+    h = rotl(h, 11) * kPrime1;
+    ++p;
+  }
+
+  h ^= h >> 33;
+  h *= kPrime2;
+  h ^= h >> 29;
+  h *= kPrime3;
+  h ^= h >> 32;
+  return h;
+}
+
+std::uint64_t xxh64(const void* data, std::size_t size, std::uint64_t seed) {
+  Xxh64 state(seed);
+  state.update(data, size);
+  return state.digest();
+}
+
+std::uint64_t hash_file(const std::filesystem::path& path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    throw std::runtime_error("cannot open " + path.string());
+  }
+  Xxh64 state;
+  std::vector<char> chunk(1 << 20);
+  while (in) {
+    in.read(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+    state.update(chunk.data(), static_cast<std::size_t>(in.gcount()));
+  }
+  if (in.bad()) {
+    throw std::runtime_error("read failed: " + path.string());
+  }
+  return state.digest();
+}
+
+std::uint64_t fingerprint_file(const std::filesystem::path& path, std::size_t sample_bytes) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    throw std::runtime_error("cannot open " + path.string());
+  }
+  std::uint64_t size = std::filesystem::file_size(path);
+  Xxh64 state;
+  state.update(&size, sizeof(size));
+  std::vector<char> chunk(sample_bytes);
+  std::uint64_t sample = std::min<std::uint64_t>(sample_bytes, size);
+  for (std::uint64_t offset : {std::uint64_t(0), (size - sample) / 2, size - sample}) {
+    in.seekg(static_cast<std::streamoff>(offset));
+    in.read(chunk.data(), static_cast<std::streamsize>(sample));
+    if (in.gcount() != static_cast<std::streamsize>(sample)) {
+      throw std::runtime_error("read failed: " + path.string());
+    }
+    state.update(chunk.data(), static_cast<std::size_t>(sample));
+  }
+  return state.digest();
+}
+
+std::string to_hex(std::uint64_t value) {
+  static constexpr char kDigits[] = "0123456789abcdef";
+  std::string out(16, '0');
+  for (int i = 15; i >= 0; --i) {
+    out[static_cast<std::size_t>(i)] = kDigits[value & 0xF];
+    value >>= 4;
+  }
+  return out;
+}
+
+}  // namespace dashcam
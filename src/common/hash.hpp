@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+namespace dashcam {
+
+// XXH64, used wherever we need a fast, stable content fingerprint (model
+// files, videos, parameter sets). Not cryptographic.
+class Xxh64 {
+ public:
+  explicit Xxh64(std::uint64_t seed = 0);
+
+  void update(const void* data, std::size_t size);
+  std::uint64_t digest() const;
+
+ private:
+  std::uint64_t v_[4];
+  std::uint64_t seed_;
+  std::uint64_t total_ = 0;
+  unsigned char buffer_[32];
+  std::size_t buffered_ = 0;
+};
+
+std::uint64_t xxh64(const void* data, std::size_t size, std::uint64_t seed = 0);
+
+// Hashes the whole file. Throws std::runtime_error if it cannot be read.
+std::uint64_t hash_file(const std::filesystem::path& path);
+
+// Cheap stand-in for hash_file on multi-GB videos read over the LAN: hashes
+// the size plus `sample_bytes` from the start, middle and end of the file.
+// Dashcam recordings differ in all three, so this identifies the content
+// without reading it all. Throws std::runtime_error if it cannot be read.
+std::uint64_t fingerprint_file(const std::filesystem::path& path,
+                               std::size_t sample_bytes = 1 << 20);
+
+// 16 lowercase hex digits.
+std::string to_hex(std::uint64_t value);
+
+}  // namespace dashcam
@@ -0,0 +1,135 @@
+#include "common/http/http_client.hpp"
+
+#include <charconv>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+
+#include <boost/asio.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+
+namespace dashcam::http {
+
+namespace asio = boost::asio;
+namespace beast = boost::beast;
+using tcp = asio::ip::tcp;
+
+std::pair<std::string, unsigned short> parse_endpoint(std::string_view endpoint) {
+  std::size_t colon = endpoint.rfind(':');
+  if (colon == std::string_view::npos || colon == 0) {
+    throw std::invalid_argument("expected host:port, got '" + std::string(endpoint) + "'");
+  }
+  std::string_view port_text = endpoint.substr(colon + 1);
+  unsigned short port = 0;
+  auto [end, ec] = std::from_chars(port_text.data(), port_text.data() + port_text.size(), port);
+  if (ec != std::errc() || end != port_text.data() + port_text.size() || port == 0) {
+    throw std::invalid_argument("bad port in '" + std::string(endpoint) + "'");
+  }
+  return {std::string(endpoint.substr(0, colon)), port};
+}
+
+std::string local_host_name() {
+  beast::error_code ec;
+  std::string name = asio::ip::host_name(ec);
+  return ec || name.empty() ? std::string("worker") : name;
+}
+
+struct HttpClient::Impl {
+  std::string host;
+  std::string port;
+  asio::io_context io;
+  std::optional<tcp::socket> socket;
+  beast::flat_buffer buffer;
+
+  void connect() {
+    tcp::resolver resolver(io);
+    beast::error_code ec;
+    auto endpoints = resolver.resolve(host, port, ec);
+    if (ec) {
+      throw std::runtime_error("http: cannot resolve " + host + ": " + ec.message());
+    }
+    socket.emplace(io);
+    asio::connect(*socket, endpoints, ec);
+    if (ec) {
+      socket.reset();
+      throw std::runtime_error("http: cannot connect to " + host + ":" + port + ": " +
+                               ec.message());
+    }
+    socket->set_option(tcp::no_delay(true));
+    buffer.clear();
+  }
+
+  // Empty optional when the connection broke before a response arrived.
+  std::optional<Response> exchange(const beast::http::request<beast::http::string_body>& req) {
+    beast::error_code ec;
+    beast::http::write(*socket, req, ec);
+    if (ec) {
+      return std::nullopt;
+    }
+    beast::http::response_parser<beast::http::string_body> parser;
+    parser.body_limit(std::numeric_limits<std::uint64_t>::max());
+    beast::http::read(*socket, buffer, parser, ec);
+    if (ec) {
+      return std::nullopt;
+    }
+    auto& in = parser.get();
+    Response response;
+    response.status = static_cast<int>(in.result_int());
+    response.content_type = std::string(in[beast::http::field::content_type]);
+    for (const auto& field : in) {
+      response.headers.emplace_back(std::string(field.name_string()), std::string(field.value()));
+    }
+    response.body = std::move(in.body());
+    if (!in.keep_alive()) {
+      socket.reset();
+    }
+    return response;
+  }
+};
+
+HttpClient::HttpClient(std::string host, unsigned short port) : impl_(std::make_unique<Impl>()) {
+  impl_->host = std::move(host);
+  impl_->port = std::to_string(port);
+}
+
+HttpClient::~HttpClient() = default;
+
+Response HttpClient::request(std::string_view method, std::string_view target, std::string body,
+                             const Headers& headers) {
+  beast::http::request<beast::http::string_body> req;
+  req.method_string(beast::string_view(method.data(), method.size()));
+  req.target(beast::string_view(target.data(), target.size()));
+  req.version(11);
+  req.set(beast::http::field::host, impl_->host);
+  req.keep_alive(true);
+  if (!body.empty()) {
+    req.set(beast::http::field::content_type, "application/json");
+  }
+  for (const auto& [name, value] : headers) {
+    req.set(name, value);
+  }
+  req.body() = std::move(body);
+  req.prepare_payload();
+
+  bool reused = impl_->socket.has_value();
+  if (!reused) {
+    impl_->connect();
+  }
+  if (auto response = impl_->exchange(req)) {
+    return std::move(*response);
+  }
+  impl_->socket.reset();
+  if (reused) {
+    // The server may have closed an idle keep-alive connection.
+    impl_->connect();
+    if (auto response = impl_->exchange(req)) {
+      return std::move(*response);
+    }
+    impl_->socket.reset();
+  }
+  throw std::runtime_error("http: " + std::string(method) + " " + std::string(target) + " to " +
+                           impl_->host + ":" + impl_->port + " failed");
+}
+
+}  // namespace dashcam::http
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "common/http/http_message.hpp"
+
+namespace dashcam::http {
+
+// "host:port" -> {host, port}. Throws std::invalid_argument.
+std::pair<std::string, unsigned short> parse_endpoint(std::string_view endpoint);
+
+std::string local_host_name();
+
+// Blocking HTTP/1.1 client holding one keep-alive connection. A request that
+// fails on a reused connection is retried once on a fresh one. Not
+// thread-safe; use one client per thread. Throws std::runtime_error when the
+// server cannot be reached.
+class HttpClient {
+ public:
+  HttpClient(std::string host, unsigned short port);
+  ~HttpClient();
+
+  HttpClient(const HttpClient&) = delete;
+  HttpClient& operator=(const HttpClient&) = delete;
+
+  Response request(std::string_view method, std::string_view target, std::string body = {},
+                   const Headers& headers = {});
+  Response get(std::string_view target) { return request("GET", target); }
+  Response post(std::string_view target, std::string body) {
+    return request("POST", target, std::move(body));
+  }
+
+ private:
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace dashcam::http
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace dashcam::http {
+
+using Headers = std::vector<std::pair<std::string, std::string>>;
+
+// Case-insensitive lookup; the first match wins.
+std::optional<std::string_view> find_header(const Headers& headers, std::string_view name);
+
+struct Request {
+  std::string method;  // "GET", "POST", ...
+  std::string target;  // path and query, e.g. "/tasks/pull?limit=4"
+  Headers headers;
+  std::string body;
+
+  std::string_view path() const;
+  // Decoded value of the first `name=` query parameter.
+  std::optional<std::string> query(std::string_view name) const;
+  // The `name=` parameter as whole Unix seconds, in microseconds. Throws
+  // std::invalid_argument unless it is an integer whose microseconds, plus
+  // up to a second, fit in 64 bits.
+  std::optional<std::int64_t> query_seconds_us(std::string_view name) const;
+  std::optional<std::string_view> header(std::string_view name) const {
+    return find_header(headers, name);
+  }
+};
+
+struct Response {
+  int status = 200;
+  std::string content_type = "application/json";
+  Headers headers;
+  std::string body;
+
+  std::optional<std::string_view> header(std::string_view name) const {
+    return find_header(headers, name);
+  }
+};
+
+Response json_response(int status, std::string body);
+Response error_response(int status, std::string_view message);
+
+// Percent-decoding for query components ('+' is a space).
+std::string url_decode(std::string_view text);
+std::string url_encode(std::string_view text);
+
+}  // namespace dashcam::http
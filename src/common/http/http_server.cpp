@@ -0,0 +1,158 @@
+#include "common/http/http_server.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <thread>
+
+#include <boost/asio.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+
+namespace dashcam::http {
+
+namespace asio = boost::asio;
+namespace beast = boost::beast;
+using tcp = asio::ip::tcp;
+
+struct HttpServer::Impl {
+  ServerOptions options;
+  Handler handler;
+  asio::io_context io;
+  tcp::acceptor acceptor{io};
+  std::optional<asio::signal_set> signals;
+
+  std::mutex mutex;
+  std::condition_variable idle;
+  std::set<tcp::socket*> sockets;  // open connections, for shutdown on stop()
+  std::size_t active = 0;
+  std::atomic<bool> stopping{false};
+
+  void accept() {
+    acceptor.async_accept([this](beast::error_code ec, tcp::socket socket) {
+      if (ec) {
+        if (!stopping) {
+          std::fprintf(stderr, "http: accept failed: %s\n", ec.message().c_str());
+          accept();
+        }
+        return;
+      }
+      // Registered here, not on the session thread, so a shutdown in run()
+      // between the two cannot miss the connection.
+      auto owned = std::make_unique<tcp::socket>(std::move(socket));
+      {
+        std::lock_guard lock(mutex);
+        ++active;
+        sockets.insert(owned.get());
+      }
+      std::thread([this, s = std::move(owned)] { session(*s); }).detach();
+      accept();
+    });
+  }
+
+  void session(tcp::socket& socket) {
+    serve(socket);
+    beast::error_code ec;
+    socket.shutdown(tcp::socket::shutdown_send, ec);
+    std::lock_guard lock(mutex);
+    sockets.erase(&socket);
+    --active;
+    idle.notify_all();
+  }
+
+  void serve(tcp::socket& socket) {
+    beast::flat_buffer buffer;
+    while (!stopping) {
+      beast::http::request_parser<beast::http::string_body> parser;
+      parser.body_limit(options.max_body_bytes);
+      beast::error_code ec;
+      beast::http::read(socket, buffer, parser, ec);
+      if (ec) {
+        return;  // closed by the client, or malformed
+      }
+      auto& in = parser.get();
+
+      Request request;
+      request.method = std::string(in.method_string());
+      request.target = std::string(in.target());
+      for (const auto& field : in) {
+        request.headers.emplace_back(std::string(field.name_string()), std::string(field.value()));
+      }
+      request.body = std::move(in.body());
+
+      Response response;
+      try {
+        response = handler(request);
+      } catch (const std::exception& e) {
+        std::fprintf(stderr, "http: %s %s failed: %s\n", request.method.c_str(),
+                     request.target.c_str(), e.what());
+        response = error_response(500, e.what());
+      }
+
+      beast::http::response<beast::http::string_body> out{
+          static_cast<beast::http::status>(response.status), in.version()};
+      out.set(beast::http::field::content_type, response.content_type);
+      for (const auto& [name, value] : response.headers) {
+        out.set(name, value);
+      }
+      out.keep_alive(in.keep_alive());
+      out.body() = std::move(response.body);
+      out.prepare_payload();
+      beast::http::write(socket, out, ec);
+      if (ec || !out.keep_alive()) {
+        return;
+      }
+    }
+  }
+};
+
+HttpServer::HttpServer(ServerOptions options, Handler handler) : impl_(std::make_unique<Impl>()) {
+  impl_->options = std::move(options);
+  impl_->handler = std::move(handler);
+  tcp::endpoint endpoint{asio::ip::make_address(impl_->options.address), impl_->options.port};
+  impl_->acceptor.open(endpoint.protocol());
+  impl_->acceptor.set_option(asio::socket_base::reuse_address(true));
+  impl_->acceptor.bind(endpoint);
+  impl_->acceptor.listen();
+  if (impl_->options.handle_signals) {
+    impl_->signals.emplace(impl_->io, SIGINT, SIGTERM);
+    impl_->signals->async_wait([this](beast::error_code ec, int) {
+      if (!ec) {
+        stop();
+      }
+    });
+  }
+}
+
+HttpServer::~HttpServer() { stop(); }
+
+unsigned short HttpServer::port() const { return impl_->acceptor.local_endpoint().port(); }
+
+void HttpServer::run() {
+  impl_->accept();
+  impl_->io.run();
+  if (impl_->options.on_stop) {
+    impl_->options.on_stop();
+  }
+
+  std::unique_lock lock(impl_->mutex);
+  for (tcp::socket* s : impl_->sockets) {
+    beast::error_code ec;
+    s->shutdown(tcp::socket::shutdown_both, ec);
+  }
+  impl_->idle.wait(lock, [&] { return impl_->active == 0; });
+}
+
+void HttpServer::stop() {
+  if (impl_->stopping.exchange(true)) {
+    return;
+  }
+  // Ends run(); the acceptor and signal set are closed with the io_context.
+  impl_->io.stop();
+}
+
+}  // namespace dashcam::http
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "common/http/http_message.hpp"
+
+namespace dashcam::http {
+
+using Handler = std::function<Response(const Request&)>;
+
+struct ServerOptions {
+  std::string address = "0.0.0.0";
+  unsigned short port = 8080;  // 0 picks a free port (see HttpServer::port())
+  // Stop cleanly on SIGINT/SIGTERM (for the service executables).
+  bool handle_signals = false;
+  std::size_t max_body_bytes = 64 * 1024 * 1024;
+  // Called once serving stops, before run() waits for open connections;
+  // lets blocked handlers (long-polls) return.
+  std::function<void()> on_stop;
+};
+
+// Minimal HTTP/1.1 server. Each connection gets its own thread and calls the
+// handler synchronously, so a handler may block (e.g. long-poll) without
+// holding up other clients. Handler exceptions become 500 responses.
+class HttpServer {
+ public:
+  HttpServer(ServerOptions options, Handler handler);
+  ~HttpServer();
+
+  HttpServer(const HttpServer&) = delete;
+  HttpServer& operator=(const HttpServer&) = delete;
+
+  unsigned short port() const;
+
+  // Serves until stop() (from any thread) or a handled signal; returns once
+  // every connection thread has finished.
+  void run();
+  void stop();
+
+ private:
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace dashcam::http
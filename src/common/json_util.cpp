@@ -0,0 +1,29 @@
+#include "common/json_util.hpp"
+
+#include <memory>
+#include <stdexcept>
+
+#include <json/reader.h>
+#include <json/writer.h>
+
+namespace dashcam {
+
+Json::Value parse_json(std::string_view text) {
+  Json::CharReaderBuilder builder;
+  builder["collectComments"] = false;
+  std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+  Json::Value root;
+  std::string errors;
+  if (!reader->parse(text.data(), text.data() + text.size(), &root, &errors)) {
+    throw std::invalid_argument("invalid JSON: " + errors);
+  }
+  return root;
+}
+
+std::string to_json_string(const Json::Value& value) {
+  Json::StreamWriterBuilder builder;
+  builder["indentation"] = "";
+  return Json::writeString(builder, value);
+}
+
+}  // namespace dashcam
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include <json/value.h>
+
+namespace dashcam {
+
+// Throws std::invalid_argument on malformed input, so HTTP handlers can map
+// it straight to 400.
+Json::Value parse_json(std::string_view text);
+
+// Compact, single-line output (wire format).
+std::string to_json_string(const Json::Value& value);
+
+}  // namespace dashcam
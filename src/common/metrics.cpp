@@ -0,0 +1,223 @@
+#include "common/metrics.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <stdexcept>
+
+namespace dashcam {
+
+namespace {
+
+void append_escaped(std::string& out, std::string_view text, bool quotes) {
+  for (char c : text) {
+    if (c == '\\') {
+      out += "\\\\";
+    } else if (c == '\n') {
+      out += "\\n";
+    } else if (c == '"' && quotes) {
+      out += "\\\"";
+    } else {
+      out += c;
+    }
+  }
+}
+
+void append_number(std::string& out, double value) {
+  if (std::isinf(value)) {
+    out += value > 0 ? "+Inf" : "-Inf";
+    return;
+  }
+  // Shortest text that reads back as the same double: 0.0005, not
+  // 0.00050000000000000001.
+  char text[32];
+  auto result = std::to_chars(text, text + sizeof text, value);
+  out.append(text, result.ptr);
+}
+
+// name{k="v",...,extra="value"} with the extra label (histogram le) last.
+void append_series(std::string& out, std::string_view name, std::string_view suffix,
+                   const Labels& labels, std::string_view extra_key = {},
+                   std::string_view extra_value = {}) {
+  out += name;
+  out += suffix;
+  if (labels.empty() && extra_key.empty()) {
+    return;
+  }
+  out += '{';
+  bool first = true;
+  auto label = [&](std::string_view key, std::string_view value) {
+    if (!first) {
+      out += ',';
+    }
+    first = false;
+    out += key;
+    out += "=\"";
+    append_escaped(out, value, true);
+    out += '"';
+  };
+  for (const auto& [key, value] : labels) {
+    label(key, value);
+  }
+  if (!extra_key.empty()) {
+    label(extra_key, extra_value);
+  }
+  out += '}';
+}
+
+}  // namespace
+
+Histogram::Histogram(std::vector<double> bounds)
+    : bounds_(std::move(bounds)),
+      buckets_(std::make_unique<std::atomic<std::uint64_t>[]>(bounds_.size() + 1)) {
+  if (!std::is_sorted(bounds_.begin(), bounds_.end())) {
+    throw std::invalid_argument("histogram bounds must be ascending");
+  }
+}
+
+void Histogram::observe(double value) {
+  auto bucket = std::lower_bound(bounds_.begin(), bounds_.end(), value) - bounds_.begin();
+  buckets_[static_cast<std::size_t>(bucket)].fetch_add(1, std::memory_order_relaxed);
+  sum_.fetch_add(value, std::memory_order_relaxed);
+}
+
+std::vector<std::uint64_t> Histogram::counts() const {
+  std::vector<std::uint64_t> out(bounds_.size() + 1);
+  for (std::size_t i = 0; i < out.size(); ++i) {
+    out[i] = buckets_[i].load(std::memory_order_relaxed);
+  }
+  return out;
+}
+
+std::uint64_t Histogram::count() const {
+  std::uint64_t total = 0;
+  for (std::size_t i = 0; i <= bounds_.size(); ++i) {
+    total += buckets_[i].load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+std::vector<double> latency_buckets() {
+  std::vector<double> bounds;
+  for (double b = 0.0005; b < 70.0; b *= 2) {
+    bounds.push_back(b);
+  }
+  return bounds;
+}
+
+MetricsRegistry::Family& MetricsRegistry::family(std::string_view name, std::string_view help,
+                                                 Kind kind) {
+  auto it = families_.find(name);
+  if (it == families_.end()) {
+    it = families_.emplace(std::string(name), Family{kind, std::string(help), {}, {}, {}, {}})
+             .first;
+  } else if (it->second.kind != kind) {
+    throw std::logic_error("metric " + std::string(name) + " registered with another kind");
+  }
+  return it->second;
+}
+
+Counter& MetricsRegistry::counter(std::string_view name, std::string_view help,
+                                  const Labels& labels) {
+  std::lock_guard lock(mutex_);
+  auto& slot = family(name, help, Kind::Counter).counters[labels];
+  if (!slot) {
+    slot = std::make_unique<Counter>();
+  }
+  return *slot;
+}
+
+Gauge& MetricsRegistry::gauge(std::string_view name, std::string_view help,
+                              const Labels& labels) {
+  std::lock_guard lock(mutex_);
+  auto& slot = family(name, help, Kind::Gauge).gauges[labels];
+  if (!slot) {
+    slot = std::make_unique<Gauge>();
+  }
+  return *slot;
+}
+
+Histogram& MetricsRegistry::histogram(std::string_view name, std::string_view help,
+                                      const Labels& labels, const std::vector<double>& bounds) {
+  std::lock_guard lock(mutex_);
+  Family& f = family(name, help, Kind::Histogram);
+  if (f.histograms.empty()) {
+    f.bounds = bounds;
+  }
+  auto& slot = f.histograms[labels];
+  if (!slot) {
+    slot = std::make_unique<Histogram>(f.bounds);
+  }
+  return *slot;
+}
+
+std::string MetricsRegistry::render_prometheus() const {
+  std::lock_guard lock(mutex_);
+  std::string out;
+  for (const auto& [name, f] : families_) {
+    out += "# HELP ";
+    out += name;
+    out += ' ';
+    append_escaped(out, f.help, false);
+    out += "\n# TYPE ";
+    out += name;
+    switch (f.kind) {
+      case Kind::Counter:
+        out += " counter\n";
+        for (const auto& [labels, c] : f.counters) {
+          append_series(out, name, "", labels);
+          out += ' ';
+          out += std::to_string(c->value());
+          out += '\n';
+        }
+        break;
+      case Kind::Gauge:
+        out += " gauge\n";
+        for (const auto& [labels, g] : f.gauges) {
+          append_series(out, name, "", labels);
+          out += ' ';
+          append_number(out, g->value());
+          out += '\n';
+        }
+        break;
+      case Kind::Histogram:
+        out += " histogram\n";
+        for (const auto& [labels, h] : f.histograms) {
+          // Buckets are read one by one while writers keep adding, so the
+          // total is taken from the same reads to keep _count == +Inf.
+          std::vector<std::uint64_t> counts = h->counts();
+          std::uint64_t cumulative = 0;
+          for (std::size_t i = 0; i < counts.size(); ++i) {
+            cumulative += counts[i];
+            std::string le;
+            if (i < h->bounds().size()) {
+              append_number(le, h->bounds()[i]);
+            } else {
+              le = "+Inf";
+            }
+            append_series(out, name, "_bucket", labels, "le", le);
+            out += ' ';
+            out += std::to_string(cumulative);
+            out += '\n';
+          }
+          append_series(out, name, "_sum", labels);
+          out += ' ';
+          append_number(out, h->sum());
+          out += '\n';
+          append_series(out, name, "_count", labels);
+          out += ' ';
+          out += std::to_string(cumulative);
+          out += '\n';
+        }
+        break;
+    }
+  }
+  return out;
+}
+
+MetricsRegistry& default_metrics() {
+  static MetricsRegistry registry;
+  return registry;
+}
+
+}  // namespace dashcam
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace dashcam {
+
+// Process metrics in the Prometheus data model, cheap enough for per-frame
+// paths: a registered metric is a few atomics, updated without locks. Look
+// a metric up once (registration takes a lock) and keep the reference; it
+// lives as long as its registry.
+
+class Counter {
+ public:
+  void add(std::uint64_t n = 1) { value_.fetch_add(n, std::memory_order_relaxed); }
+  std::uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+ private:
+  std::atomic<std::uint64_t> value_{0};
+};
+
+class Gauge {
+ public:
+  void set(double v) { value_.store(v, std::memory_order_relaxed); }
+  void add(double v) { value_.fetch_add(v, std::memory_order_relaxed); }
+  double value() const { return value_.load(std::memory_order_relaxed); }
+
+ private:
+  std::atomic<double> value_{0.0};
+};
+
+// Fixed upper bounds, ascending; observations above the last one land in
+// the implicit +Inf bucket.
+class Histogram {
+ public:
+  explicit Histogram(std::vector<double> bounds);
+
+  void observe(double value);
+
+  const std::vector<double>& bounds() const { return bounds_; }
+  // Per-bucket (not cumulative) counts, +Inf last.
+  std::vector<std::uint64_t> counts() const;
+  std::uint64_t count() const;
+  double sum() const { return sum_.load(std::memory_order_relaxed); }
+
+ private:
+  std::vector<double> bounds_;
+  std::unique_ptr<std::atomic<std::uint64_t>[]> buckets_;
+  std::atomic<double> sum_{0.0};
+};
+
+// Seconds, 0.5 ms to about a minute, doubling: wide enough for one NAS read
+// or one detector batch as well as a whole completion round trip.
+std::vector<double> latency_buckets();
+
+using Labels = std::vector<std::pair<std::string, std::string>>;
+
+class MetricsRegistry {
+ public:
+  // The same name and labels always return the same metric. A name keeps
+  // the kind (and histogram bounds) it was first registered with; asking
+  // for another kind throws std::logic_error.
+  Counter& counter(std::string_view name, std::string_view help, const Labels& labels = {});
+  Gauge& gauge(std::string_view name, std::string_view help, const Labels& labels = {});
+  Histogram& histogram(std::string_view name, std::string_view help, const Labels& labels = {},
+                       const std::vector<double>& bounds = latency_buckets());
+
+  // Text exposition format 0.0.4, for GET /metrics.
+  std::string render_prometheus() const;
+
+ private:
+  enum class Kind { Counter, Gauge, Histogram };
+  struct Family {
+    Kind kind;
+    std::string help;
+    std::vector<double> bounds;
+    std::map<Labels, std::unique_ptr<Counter>> counters;
+    std::map<Labels, std::unique_ptr<Gauge>> gauges;
+    std::map<Labels, std::unique_ptr<Histogram>> histograms;
+  };
+
+  Family& family(std::string_view name, std::string_view help, Kind kind);
+
+  mutable std::mutex mutex_;
+  std::map<std::string, Family, std::less<>> families_;
+};
+
+// The registry every process-level metric goes to, exported by each
+// executable's /metrics endpoint.
+MetricsRegistry& default_metrics();
+
+// Content type of render_prometheus() output.
+inline constexpr std::string_view kPrometheusContentType = "text/plain; version=0.0.4";
+
+}  // namespace dashcam
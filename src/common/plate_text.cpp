@@ -0,0 +1,94 @@
+#include "common/plate_text.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+
+namespace dashcam {
+
+namespace {
+
+char fold(char c) {
+  switch (c) {
+    case 'O':
+    case 'D':
+    case 'Q':
+      return '0';
+    case 'I':
+    case 'L':
+      return '1';
+    case 'Z':
+      return '2';
+    case 'S':
+      return '5';
+    case 'G':
+      return '6';
+    case 'B':
+      return '8';
+    default:
+      return c;
+  }
+}
+
+}  // namespace
+
+std::string normalize_plate(std::string_view text) {
+  std::string out;
+  out.reserve(text.size());
+  for (char c : text) {
+    auto u = static_cast<unsigned char>(c);
+    if (std::isalnum(u)) {
+      out.push_back(static_cast<char>(std::toupper(u)));
+    }
+  }
+  return out;
+}
+
+std::string fold_confusables(std::string_view plate) {
+  std::string out(plate);
+  std::transform(out.begin(), out.end(), out.begin(), fold);
+  return out;
+}
+
+bool confusable(char a, char b) { return a != b && fold(a) == fold(b); }
+
+std::vector<std::string> plate_grams(std::string_view folded) {
+  std::string padded = "^" + std::string(folded) + "$";
+  std::vector<std::string> grams;
+  for (std::size_t i = 0; i + 2 <= padded.size(); ++i) {
+    grams.push_back(padded.substr(i, 2));
+  }
+  std::sort(grams.begin(), grams.end());
+  grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+  return grams;
+}
+
+double plate_distance(std::string_view a, std::string_view b, double bound) {
+  double over = bound + 1.0;
+  if (static_cast<double>(std::max(a.size(), b.size()) - std::min(a.size(), b.size())) > bound) {
+    return over;
+  }
+  // Two rows of the usual dynamic programme; plates are short.
+  std::vector<double> prev(b.size() + 1), row(b.size() + 1);
+  for (std::size_t j = 0; j <= b.size(); ++j) {
+    prev[j] = static_cast<double>(j);
+  }
+  for (std::size_t i = 1; i <= a.size(); ++i) {
+    row[0] = static_cast<double>(i);
+    double best = row[0];
+    for (std::size_t j = 1; j <= b.size(); ++j) {
+      char x = a[i - 1];
+      char y = b[j - 1];
+      double substitute = x == y ? 0.0 : confusable(x, y) ? kConfusionCost : 1.0;
+      row[j] = std::min({prev[j - 1] + substitute, prev[j] + 1.0, row[j - 1] + 1.0});
+      best = std::min(best, row[j]);
+    }
+    if (best > bound) {
+      return over;
+    }
+    std::swap(prev, row);
+  }
+  return prev[b.size()];
+}
+
+}  // namespace dashcam
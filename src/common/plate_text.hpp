@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace dashcam {
+
+// Uppercase alphanumerics only, so "ab-12 cd" and "AB12CD" vote together.
+std::string normalize_plate(std::string_view text);
+
+// Maps each character of a normalized plate to the representative of its
+// OCR confusion class (0/O/D/Q, 1/I/L, 2/Z, 5/S, 6/G, 8/B), so texts that
+// differ only by such misreads fold to the same string.
+std::string fold_confusables(std::string_view plate);
+
+// True when `a` and `b` are distinct members of one confusion class.
+bool confusable(char a, char b);
+
+// Distinct padded bigrams of a folded plate ("^A", "AB", ..., "C$"): a plate
+// of n characters has n + 1, and one edit changes at most two of them.
+std::vector<std::string> plate_grams(std::string_view folded);
+
+// Edit distance between normalized plates where substituting one character
+// for a confusable one costs kConfusionCost and every other edit costs 1.
+// Returns a value above `bound` as soon as the distance is known to exceed
+// it.
+inline constexpr double kConfusionCost = 0.5;
+double plate_distance(std::string_view a, std::string_view b, double bound);
+
+}  // namespace dashcam
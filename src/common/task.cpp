@@ -0,0 +1,284 @@
+#include "common/task.hpp"
+
+#include <stdexcept>
+#include <string>
+
+namespace dashcam {
+
+namespace {
+
+const Json::Value& require(const Json::Value& json, const char* key) {
+  if (!json.isObject() || !json.isMember(key)) {
+    throw std::invalid_argument(std::string("missing field '") + key + "'");
+  }
+  return json[key];
+}
+
+std::string require_string(const Json::Value& json, const char* key) {
+  const Json::Value& v = require(json, key);
+  if (!v.isString()) {
+    throw std::invalid_argument(std::string("field '") + key + "' must be a string");
+  }
+  return v.asString();
+}
+
+std::string optional_string(const Json::Value& json, const char* key) {
+  if (!json.isMember(key) || json[key].isNull()) {
+    return {};
+  }
+  if (!json[key].isString()) {
+    throw std::invalid_argument(std::string("field '") + key + "' must be a string");
+  }
+  return json[key].asString();
+}
+
+std::int64_t require_int(const Json::Value& json, const char* key) {
+  const Json::Value& v = require(json, key);
+  if (!v.isIntegral()) {
+    throw std::invalid_argument(std::string("field '") + key + "' must be an integer");
+  }
+  return v.asInt64();
+}
+
+const Json::Value& optional_array(const Json::Value& json, const char* key) {
+  static const Json::Value empty(Json::arrayValue);
+  if (!json.isMember(key) || json[key].isNull()) {
+    return empty;
+  }
+  if (!json[key].isArray()) {
+    throw std::invalid_argument(std::string("field '") + key + "' must be an array");
+  }
+  return json[key];
+}
+
+std::vector<TaskInput> inputs_from_json(const Json::Value& json) {
+  std::vector<TaskInput> inputs;
+  for (const Json::Value& item : optional_array(json, "inputs")) {
+    inputs.push_back(task_input_from_json(item));
+  }
+  return inputs;
+}
+
+Json::Value params_from_json(const Json::Value& json) {
+  if (!json.isMember("params") || json["params"].isNull()) {
+    return Json::Value(Json::objectValue);
+  }
+  if (!json["params"].isObject()) {
+    throw std::invalid_argument("field 'params' must be an object");
+  }
+  return json["params"];
+}
+
+Json::Value inputs_to_json(const std::vector<TaskInput>& inputs) {
+  Json::Value out(Json::arrayValue);
+  for (const TaskInput& input : inputs) {
+    out.append(to_json(input));
+  }
+  return out;
+}
+
+}  // namespace
+
+const char* to_string(TaskState state) {
+  return state == TaskState::Pending ? "pending" : "complete";
+}
+
+TaskState task_state_from_string(std::string_view text) {
+  if (text == "pending") {
+    return TaskState::Pending;
+  }
+  if (text == "complete") {
+    return TaskState::Complete;
+  }
+  throw std::invalid_argument("unknown task state '" + std::string(text) + "'");
+}
+
+const char* to_string(CompletionStatus status) {
+  switch (status) {
+    case CompletionStatus::Completed:
+      return "completed";
+    case CompletionStatus::AlreadyComplete:
+      return "already_complete";
+    case CompletionStatus::NotFound:
+      return "not_found";
+  }
+  return "not_found";
+}
+
+CompletionStatus completion_status_from_string(std::string_view text) {
+  if (text == "completed") {
+    return CompletionStatus::Completed;
+  }
+  if (text == "already_complete") {
+    return CompletionStatus::AlreadyComplete;
+  }
+  if (text == "not_found") {
+    return CompletionStatus::NotFound;
+  }
+  throw std::invalid_argument("unknown completion status '" + std::string(text) + "'");
+}
+
+Json::Value to_json(const TaskInput& input) {
+  Json::Value out(Json::objectValue);
+  out["device"] = input.device;
+  out["path"] = input.path;
+  if (!input.type.empty()) {
+    out["type"] = input.type;
+  }
+  return out;
+}
+
+Json::Value to_json(const NewTask& task) {
+  Json::Value out(Json::objectValue);
+  out["task_type"] = task.task_type;
+  out["video_id"] = task.video_id;
+  out["inputs"] = inputs_to_json(task.inputs);
+  out["params"] = task.params;
+  return out;
+}
+
+Json::Value to_json(const Task& task) {
+  Json::Value out(Json::objectValue);
+  out["task_id"] = Json::Int64(task.task_id);
+  out["task_type"] = task.task_type;
+  out["video_id"] = task.video_id;
+  out["state"] = to_string(task.state);
+  out["inputs"] = inputs_to_json(task.inputs);
+  out["params"] = task.params;
+  out["created_at"] = Json::Int64(task.created_at);
+  out["completed_at"] = task.completed_at ? Json::Value(Json::Int64(*task.completed_at))
+                                          : Json::Value(Json::nullValue);
+  return out;
+}
+
+Json::Value to_json(const TaskCompletion& completion) {
+  Json::Value out(Json::objectValue);
+  out["task_id"] = Json::Int64(completion.task_id);
+  Json::Value publish(Json::arrayValue);
+  for (const NewTask& task : completion.publish) {
+    publish.append(to_json(task));
+  }
+  out["publish"] = publish;
+  return out;
+}
+
+Json::Value to_json(const CompletionResult& result) {
+  Json::Value out(Json::objectValue);
+  out["task_id"] = Json::Int64(result.task_id);
+  out["status"] = to_string(result.status);
+  Json::Value published(Json::arrayValue);
+  for (std::int64_t id : result.published) {
+    published.append(Json::Int64(id));
+  }
+  out["published"] = published;
+  return out;
+}
+
+TaskInput task_input_from_json(const Json::Value& json) {
+  TaskInput input;
+  input.device = require_string(json, "device");
+  input.path = require_string(json, "path");
+  input.type = optional_string(json, "type");
+  return input;
+}
+
+NewTask new_task_from_json(const Json::Value& json) {
+  NewTask task;
+  task.task_type = require_string(json, "task_type");
+  task.video_id = require_string(json, "video_id");
+  if (!safe_video_id(task.video_id)) {
+    throw std::invalid_argument("field 'video_id' is not a valid video id");
+  }
+  task.inputs = inputs_from_json(json);
+  task.params = params_from_json(json);
+  if (task.task_type.empty()) {
+    throw std::invalid_argument("field 'task_type' must not be empty");
+  }
+  return task;
+}
+
+Task task_from_json(const Json::Value& json) {
+  Task task;
+  task.task_id = require_int(json, "task_id");
+  task.task_type = require_string(json, "task_type");
+  task.video_id = require_string(json, "video_id");
+  if (!safe_video_id(task.video_id)) {
+    throw std::invalid_argument("field 'video_id' is not a valid video id");
+  }
+  task.state = task_state_from_string(require_string(json, "state"));
+  task.inputs = inputs_from_json(json);
+  task.params = params_from_json(json);
+  task.created_at = require_int(json, "created_at");
+  if (json.isMember("completed_at") && !json["completed_at"].isNull()) {
+    task.completed_at = require_int(json, "completed_at");
+  }
+  return task;
+}
+
+TaskCompletion task_completion_from_json(const Json::Value& json) {
+  TaskCompletion completion;
+  completion.task_id = require_int(json, "task_id");
+  for (const Json::Value& item : optional_array(json, "publish")) {
+    completion.publish.push_back(new_task_from_json(item));
+  }
+  return completion;
+}
+
+CompletionResult completion_result_from_json(const Json::Value& json) {
+  CompletionResult result;
+  result.task_id = require_int(json, "task_id");
+  result.status = completion_status_from_string(require_string(json, "status"));
+  for (const Json::Value& id : optional_array(json, "published")) {
+    if (!id.isIntegral()) {
+      throw std::invalid_argument("field 'published' must hold integers");
+    }
+    result.published.push_back(id.asInt64());
+  }
+  return result;
+}
+
+bool safe_video_id(std::string_view id) {
+  return !id.empty() && id != "." && id != ".." && id.find('/') == std::string_view::npos &&
+         id.find('\\') == std::string_view::npos && id.find('\0') == std::string_view::npos;
+}
+
+const TaskInput* find_input(const std::vector<TaskInput>& inputs, std::string_view type) {
+  for (const TaskInput& input : inputs) {
+    if (input.type == type) {
+      return &input;
+    }
+  }
+  return nullptr;
+}
+
+Json::Value to_json(const ShardSpec& shard) {
+  Json::Value out(Json::objectValue);
+  out["index"] = shard.index;
+  out["count"] = shard.count;
+  out["first_frame"] = Json::Int64(shard.first_frame);
+  out["end_frame"] = Json::Int64(shard.end_frame);
+  return out;
+}
+
+ShardSpec shard_from_json(const Json::Value& json) {
+  ShardSpec shard;
+  shard.index = static_cast<int>(require_int(json, "index"));
+  shard.count = static_cast<int>(require_int(json, "count"));
+  shard.first_frame = require_int(json, "first_frame");
+  shard.end_frame = require_int(json, "end_frame");
+  if (shard.count < 1 || shard.index < 0 || shard.index >= shard.count ||
+      shard.first_frame < 0 || (shard.end_frame >= 0 && shard.end_frame <= shard.first_frame)) {
+    throw std::invalid_argument("invalid shard " + std::to_string(shard.index) + "/" +
+                                std::to_string(shard.count));
+  }
+  return shard;
+}
+
+std::optional<ShardSpec> find_shard(const Json::Value& params) {
+  if (!params.isObject() || !params.isMember("shard")) {
+    return std::nullopt;
+  }
+  return shard_from_json(params["shard"]);
+}
+
+}  // namespace dashcam
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <json/value.h>
+
+namespace dashcam {
+
+// Task types (task_system_overview.md §8). Each names the device class that
+// may run it.
+inline constexpr std::string_view kIngestVideo = "INGEST_VIDEO";
+inline constexpr std::string_view kPreprocessVideo = "PREPROCESS_VIDEO";
+inline constexpr std::string_view kHeavyProcessVideo = "HEAVY_PROCESS_VIDEO";
+inline constexpr std::string_view kFinalizeVideo = "FINALIZE_VIDEO";
+inline constexpr std::string_view kArchiveVideo = "ARCHIVE_VIDEO";
+
+// Input type of the rear camera's video in a HEAVY_PROCESS_VIDEO task that
+// processes a front/rear pair together (main_server.md §5.1). The task's
+// video_id is the front's; params["pair"]["rear_video_id"] names the rear's.
+inline constexpr std::string_view kRearVideoInput = "video_rear";
+
+// The only two persistent states (task_system_overview.md §2).
+enum class TaskState { Pending, Complete };
+
+const char* to_string(TaskState state);
+TaskState task_state_from_string(std::string_view text);
+
+// One entry of a task's `inputs` (main_server.md §2).
+struct TaskInput {
+  std::string device;  // e.g. "indoor_nas"
+  std::string path;
+  std::string type;    // optional, e.g. "video"
+};
+
+// A task as published by ingestion or by a completing parent, before the
+// server has assigned it an id.
+struct NewTask {
+  std::string task_type;
+  std::string video_id;
+  std::vector<TaskInput> inputs;
+  Json::Value params{Json::objectValue};  // extraction rate, thresholds, ...
+};
+
+struct Task {
+  std::int64_t task_id = 0;
+  std::string task_type;
+  std::string video_id;
+  TaskState state = TaskState::Pending;
+  std::vector<TaskInput> inputs;
+  Json::Value params{Json::objectValue};
+  std::int64_t created_at = 0;  // ms since the Unix epoch
+  std::optional<std::int64_t> completed_at;
+};
+
+// Marks `task_id` complete and publishes `publish` in the same transaction
+// (task_system_overview.md §5).
+struct TaskCompletion {
+  std::int64_t task_id = 0;
+  std::vector<NewTask> publish;
+};
+
+enum class CompletionStatus {
+  Completed,        // this call completed it; its remote tasks were published
+  AlreadyComplete,  // completed earlier; nothing was published again
+  NotFound,
+};
+
+struct CompletionResult {
+  std::int64_t task_id = 0;
+  CompletionStatus status = CompletionStatus::NotFound;
+  std::vector<std::int64_t> published;  // ids of the new tasks
+};
+
+// One keyframe-aligned frame range of a video split across workers
+// (main_server.md §5.1). Carried as params["shard"] by HEAVY_PROCESS_VIDEO
+// shards and by the FINALIZE_VIDEO parts they publish; the server joins the
+// parts of a video into one task once all `count` are in.
+struct ShardSpec {
+  int index = 0;
+  int count = 1;
+  std::int64_t first_frame = 0;  // a keyframe
+  std::int64_t end_frame = -1;   // exclusive; -1 runs to the end of the video
+};
+
+const char* to_string(CompletionStatus status);
+CompletionStatus completion_status_from_string(std::string_view text);
+
+// JSON wire format. The *_from_json functions throw std::invalid_argument on
+// missing or mistyped fields.
+Json::Value to_json(const TaskInput& input);
+Json::Value to_json(const NewTask& task);
+Json::Value to_json(const Task& task);
+Json::Value to_json(const TaskCompletion& completion);
+Json::Value to_json(const CompletionResult& result);
+Json::Value to_json(const ShardSpec& shard);
+
+TaskInput task_input_from_json(const Json::Value& json);
+NewTask new_task_from_json(const Json::Value& json);
+Task task_from_json(const Json::Value& json);
+TaskCompletion task_completion_from_json(const Json::Value& json);
+CompletionResult completion_result_from_json(const Json::Value& json);
+ShardSpec shard_from_json(const Json::Value& json);
+
+// params["shard"] of a task that is one shard of its video.
+std::optional<ShardSpec> find_shard(const Json::Value& params);
+
+// Video ids name directories under the metadata directory, so one must not
+// be empty, "." or "..", or contain a path separator or NUL.
+bool safe_video_id(std::string_view id);
+
+// First input of the given type, if any.
+const TaskInput* find_input(const std::vector<TaskInput>& inputs, std::string_view type);
+
+}  // namespace dashcam
@@ -0,0 +1,186 @@
+#include "common/trace.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+namespace dashcam {
+
+namespace {
+
+thread_local TraceBuffer* t_current = nullptr;
+
+std::atomic<std::uint32_t> g_next_tid{1};
+
+std::int64_t since(TraceBuffer::Clock::time_point origin, TraceBuffer::Clock::time_point t) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(t - origin).count();
+}
+
+void append_json_string(std::string& out, std::string_view text) {
+  out += '"';
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char escaped[8];
+      std::snprintf(escaped, sizeof escaped, "\\u%04x", static_cast<unsigned>(c));
+      out += escaped;
+    } else {
+      out += c;
+    }
+  }
+  out += '"';
+}
+
+// Microseconds with nanosecond digits, as the format allows.
+void append_micros(std::string& out, std::int64_t ns) {
+  char text[32];
+  std::snprintf(text, sizeof text, "%lld.%03lld", static_cast<long long>(ns / 1000),
+                static_cast<long long>(ns % 1000));
+  out += text;
+}
+
+}  // namespace
+
+std::uint32_t trace_thread_id() {
+  thread_local std::uint32_t id = g_next_tid.fetch_add(1, std::memory_order_relaxed);
+  return id;
+}
+
+TraceBuffer* current_trace() { return t_current; }
+
+void bind_trace(TraceBuffer* buffer) { t_current = buffer; }
+
+TraceBinding::TraceBinding(TraceBuffer* buffer) : previous_(t_current) { t_current = buffer; }
+
+TraceBinding::~TraceBinding() { t_current = previous_; }
+
+TraceBuffer::TraceBuffer(std::size_t capacity)
+    : origin_(Clock::now()),
+      capacity_(std::max<std::size_t>(capacity, 1)),
+      slots_(std::make_unique<Slot[]>(capacity_)) {}
+
+void TraceBuffer::record(const char* name, const char* category, Clock::time_point start,
+                         Clock::time_point end, std::int64_t arg) {
+  std::uint64_t index = next_.fetch_add(1, std::memory_order_relaxed);
+  Slot& slot = slots_[index % capacity_];
+  // Seqlock: a reader that sees the same nonzero seq before and after its
+  // copy got a consistent span.
+  slot.seq.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.name.store(name, std::memory_order_relaxed);
+  slot.category.store(category, std::memory_order_relaxed);
+  slot.tid.store(trace_thread_id(), std::memory_order_relaxed);
+  slot.start_ns.store(since(origin_, start), std::memory_order_relaxed);
+  slot.dur_ns.store(since(start, end), std::memory_order_relaxed);
+  slot.arg.store(arg, std::memory_order_relaxed);
+  slot.seq.store(index + 1, std::memory_order_release);
+}
+
+const char* TraceBuffer::intern(std::string_view text) {
+  std::lock_guard lock(mutex_);
+  auto it = strings_.find(text);
+  if (it == strings_.end()) {
+    it = strings_.emplace(text).first;
+  }
+  return it->c_str();
+}
+
+void TraceBuffer::name_thread(std::string_view name) {
+  std::lock_guard lock(mutex_);
+  thread_names_[trace_thread_id()] = std::string(name);
+}
+
+std::uint64_t TraceBuffer::overwritten() const {
+  std::uint64_t n = recorded();
+  return n > capacity_ ? n - capacity_ : 0;
+}
+
+std::vector<TraceEvent> TraceBuffer::events() const {
+  std::uint64_t end = next_.load(std::memory_order_acquire);
+  std::uint64_t begin = end > capacity_ ? end - capacity_ : 0;
+  std::vector<TraceEvent> out;
+  out.reserve(static_cast<std::size_t>(end - begin));
+  for (std::uint64_t i = begin; i < end; ++i) {
+    const Slot& slot = slots_[i % capacity_];
+    std::uint64_t seq = slot.seq.load(std::memory_order_acquire);
+    if (seq != i + 1) {
+      continue;  // being written, or already overwritten by a newer span
+    }
+    TraceEvent e;
+    e.name = slot.name.load(std::memory_order_relaxed);
+    e.category = slot.category.load(std::memory_order_relaxed);
+    e.tid = slot.tid.load(std::memory_order_relaxed);
+    e.start_ns = slot.start_ns.load(std::memory_order_relaxed);
+    e.dur_ns = slot.dur_ns.load(std::memory_order_relaxed);
+    e.arg = slot.arg.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.seq.load(std::memory_order_relaxed) == seq) {
+      out.push_back(e);
+    }
+  }
+  return out;
+}
+
+std::string TraceBuffer::chrome_trace_json(std::string_view process_name) const {
+  std::vector<TraceEvent> spans = events();
+  std::map<std::uint32_t, std::string> threads;
+  {
+    std::lock_guard lock(mutex_);
+    threads = thread_names_;
+  }
+  std::string out;
+  out.reserve(spans.size() * 112 + 256);
+  out += "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"overwritten\":";
+  out += std::to_string(overwritten());
+  out += "},\"traceEvents\":[\n";
+  out += "{\"ph\":\"M\",\"pid\":1,\"tid\":0,\"name\":\"process_name\",\"args\":{\"name\":";
+  append_json_string(out, process_name);
+  out += "}}";
+  for (const auto& [tid, name] : threads) {
+    out += ",\n{\"ph\":\"M\",\"pid\":1,\"tid\":";
+    out += std::to_string(tid);
+    out += ",\"name\":\"thread_name\",\"args\":{\"name\":";
+    append_json_string(out, name);
+    out += "}}";
+  }
+  for (const TraceEvent& e : spans) {
+    out += ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":";
+    out += std::to_string(e.tid);
+    out += ",\"name\":";
+    append_json_string(out, e.name != nullptr ? e.name : "?");
+    out += ",\"cat\":";
+    append_json_string(out, e.category != nullptr ? e.category : "");
+    out += ",\"ts\":";
+    append_micros(out, e.start_ns);
+    out += ",\"dur\":";
+    append_micros(out, e.dur_ns);
+    if (e.arg >= 0) {
+      out += ",\"args\":{\"n\":";
+      out += std::to_string(e.arg);
+      out += '}';
+    }
+    out += '}';
+  }
+  out += "\n]}\n";
+  return out;
+}
+
+void TraceBuffer::write_chrome_trace(const std::filesystem::path& path,
+                                     std::string_view process_name) const {
+  std::string json = chrome_trace_json(process_name);
+  std::filesystem::path tmp = path;
+  tmp += ".tmp";
+  {
+    std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+    file.write(json.data(), static_cast<std::streamsize>(json.size()));
+    if (!file) {
+      throw std::runtime_error("cannot write " + tmp.string());
+    }
+  }
+  std::filesystem::rename(tmp, path);
+}
+
+}  // namespace dashcam
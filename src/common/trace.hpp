@@ -0,0 +1,146 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace dashcam {
+
+// One completed span: `name` ran on thread `tid` from `start_ns` for
+// `dur_ns` (both relative to the buffer's creation). `arg` is a span's
+// size where it has one (bytes read, batch size), else -1.
+struct TraceEvent {
+  const char* name = nullptr;
+  const char* category = nullptr;
+  std::uint32_t tid = 0;
+  std::int64_t start_ns = 0;
+  std::int64_t dur_ns = 0;
+  std::int64_t arg = -1;
+};
+
+// Fixed-size ring of trace spans. Recording is a few relaxed atomic stores
+// into the next slot, never a lock or an allocation; once the ring is full
+// the oldest spans are overwritten, so a long task keeps its most recent
+// stretch. Readers may run alongside writers: a slot being overwritten
+// while it is read is skipped.
+//
+// Names and categories must outlive the buffer: string literals, or
+// strings passed through intern() once at setup.
+class TraceBuffer {
+ public:
+  explicit TraceBuffer(std::size_t capacity = std::size_t{1} << 16);
+
+  TraceBuffer(const TraceBuffer&) = delete;
+  TraceBuffer& operator=(const TraceBuffer&) = delete;
+
+  using Clock = std::chrono::steady_clock;
+
+  void record(const char* name, const char* category, Clock::time_point start,
+              Clock::time_point end, std::int64_t arg = -1);
+
+  // A copy of `text` that lives as long as the buffer.
+  const char* intern(std::string_view text);
+  // Labels the calling thread in dumps (the stage it runs, say).
+  void name_thread(std::string_view name);
+
+  // Spans still in the ring, oldest first.
+  std::vector<TraceEvent> events() const;
+  std::uint64_t recorded() const { return next_.load(std::memory_order_relaxed); }
+  std::uint64_t overwritten() const;
+
+  // Chrome trace event format (loads in Perfetto and chrome://tracing):
+  // complete ("X") events in microseconds plus thread-name metadata.
+  std::string chrome_trace_json(std::string_view process_name) const;
+  // Writes chrome_trace_json() to `path` via a temporary file.
+  void write_chrome_trace(const std::filesystem::path& path,
+                          std::string_view process_name) const;
+
+ private:
+  struct Slot {
+    std::atomic<std::uint64_t> seq{0};  // 1 + index of the span held; 0 while written
+    std::atomic<const char*> name{nullptr};
+    std::atomic<const char*> category{nullptr};
+    std::atomic<std::uint32_t> tid{0};
+    std::atomic<std::int64_t> start_ns{0};
+    std::atomic<std::int64_t> dur_ns{0};
+    std::atomic<std::int64_t> arg{-1};
+  };
+
+  Clock::time_point origin_;
+  std::size_t capacity_;
+  std::unique_ptr<Slot[]> slots_;
+  std::atomic<std::uint64_t> next_{0};
+
+  mutable std::mutex mutex_;
+  std::set<std::string, std::less<>> strings_;
+  std::map<std::uint32_t, std::string> thread_names_;
+};
+
+// Small process-wide id of the calling thread, as used in TraceEvent::tid.
+std::uint32_t trace_thread_id();
+
+// The buffer spans on this thread go to (null: not traced). Each thread of
+// a traced task binds the task's buffer, so code deep in a stage records
+// spans without being handed one.
+TraceBuffer* current_trace();
+
+// Binds `buffer` on the calling thread for the scope's lifetime, restoring
+// the previous binding after.
+class TraceBinding {
+ public:
+  explicit TraceBinding(TraceBuffer* buffer);
+  ~TraceBinding();
+
+  TraceBinding(const TraceBinding&) = delete;
+  TraceBinding& operator=(const TraceBinding&) = delete;
+
+ private:
+  TraceBuffer* previous_;
+};
+
+// Binds `buffer` on the calling thread until the thread ends or another
+// binding replaces it; for threads that serve one task only.
+void bind_trace(TraceBuffer* buffer);
+
+// Records the scope as one span into the thread's current buffer, if any.
+class ScopedTrace {
+ public:
+  ScopedTrace(const char* name, const char* category, std::int64_t arg = -1)
+      : ScopedTrace(current_trace(), name, category, arg) {}
+  ScopedTrace(TraceBuffer* buffer, const char* name, const char* category, std::int64_t arg = -1)
+      : buffer_(buffer), name_(name), category_(category), arg_(arg) {
+    if (buffer_ != nullptr) {
+      start_ = TraceBuffer::Clock::now();
+    }
+  }
+  ~ScopedTrace() {
+    if (buffer_ != nullptr) {
+      buffer_->record(name_, category_, start_, TraceBuffer::Clock::now(), arg_);
+    }
+  }
+
+  ScopedTrace(const ScopedTrace&) = delete;
+  ScopedTrace& operator=(const ScopedTrace&) = delete;
+
+  // For sizes only known at the end of the span.
+  void set_arg(std::int64_t arg) { arg_ = arg; }
+
+ private:
+  TraceBuffer* buffer_;
+  const char* name_;
+  const char* category_;
+  std::int64_t arg_;
+  TraceBuffer::Clock::time_point start_;
+};
+
+}  // namespace dashcam
@@ -0,0 +1,257 @@
+#include "media/frame_source.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#if DASHCAM_WITH_FFMPEG
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libswscale/swscale.h>
+}
+#endif
+
+namespace dashcam::media {
+
+namespace {
+
+constexpr const char* kY4mMagic = "YUV4MPEG2";
+constexpr std::size_t kBareFrameHeader = 6;  // "FRAME\n"
+
+YuvImage blank_image(int width, int height) {
+  YuvImage image;
+  image.width = width;
+  image.height = height;
+  image.y.resize(static_cast<std::size_t>(width) * static_cast<std::size_t>(height));
+  auto chroma = static_cast<std::size_t>(image.chroma_width()) *
+                static_cast<std::size_t>(image.chroma_height());
+  image.u.resize(chroma);
+  image.v.resize(chroma);
+  return image;
+}
+
+// Frames of a y4m clip sit at fixed offsets when every frame header is a
+// bare "FRAME\n", which is what our clip tooling writes; each is a
+// keyframe, so a frame is one seek and one read.
+class Y4mFrameSource : public FrameSource {
+ public:
+  explicit Y4mFrameSource(const std::filesystem::path& path)
+      : path_(path), in_(path, std::ios::binary) {
+    if (!in_) {
+      throw std::runtime_error("cannot open " + path.string());
+    }
+    std::string header;
+    std::getline(in_, header);
+    std::istringstream fields(header);
+    std::string token;
+    fields >> token;
+    if (token != kY4mMagic) {
+      throw bad_clip("missing YUV4MPEG2 signature");
+    }
+    while (fields >> token) {
+      if (token[0] == 'W') {
+        width_ = std::stoi(token.substr(1));
+      } else if (token[0] == 'H') {
+        height_ = std::stoi(token.substr(1));
+      } else if (token[0] == 'F') {
+        auto colon = token.find(':');
+        double num = std::stod(token.substr(1, colon - 1));
+        double den = colon == std::string::npos ? 1.0 : std::stod(token.substr(colon + 1));
+        fps_ = den > 0 ? num / den : 0.0;
+      } else if (token[0] == 'C' && token.rfind("C420", 0) != 0) {
+        throw bad_clip("only 4:2:0 chroma is supported, got " + token);
+      }
+    }
+    if (width_ <= 0 || height_ <= 0) {
+      throw bad_clip("missing frame size");
+    }
+    YuvImage probe = blank_image(width_, height_);
+    frame_bytes_ = probe.y.size() + probe.u.size() + probe.v.size();
+    body_ = static_cast<std::uint64_t>(in_.tellg());
+    auto file_bytes = static_cast<std::uint64_t>(std::filesystem::file_size(path));
+    frame_count_ =
+        static_cast<std::int64_t>((file_bytes - body_) / (frame_bytes_ + kBareFrameHeader));
+  }
+
+  YuvImage frame(std::int64_t index) override {
+    if (index < 0 || index >= frame_count_) {
+      throw std::out_of_range("frame " + std::to_string(index) + " of " + path_.string());
+    }
+    in_.clear();
+    in_.seekg(static_cast<std::streamoff>(body_ + static_cast<std::uint64_t>(index) *
+                                                      (frame_bytes_ + kBareFrameHeader)));
+    std::string frame_header;
+    if (!std::getline(in_, frame_header) || frame_header != "FRAME") {
+      throw bad_clip("frame headers are not bare; cannot seek");
+    }
+    YuvImage image = blank_image(width_, height_);
+    in_.read(reinterpret_cast<char*>(image.y.data()), static_cast<std::streamsize>(image.y.size()));
+    in_.read(reinterpret_cast<char*>(image.u.data()), static_cast<std::streamsize>(image.u.size()));
+    in_.read(reinterpret_cast<char*>(image.v.data()), static_cast<std::streamsize>(image.v.size()));
+    if (!in_) {
+      throw bad_clip("truncated frame " + std::to_string(index));
+    }
+    return image;
+  }
+
+ private:
+  std::runtime_error bad_clip(const std::string& why) const {
+    return std::runtime_error("invalid y4m clip " + path_.string() + ": " + why);
+  }
+
+  std::filesystem::path path_;
+  std::ifstream in_;
+  int width_ = 0;
+  int height_ = 0;
+  std::size_t frame_bytes_ = 0;
+  std::uint64_t body_ = 0;
+};
+
+#if DASHCAM_WITH_FFMPEG
+
+void check_av(int status, const std::string& what) {
+  if (status < 0) {
+    char buffer[AV_ERROR_MAX_STRING_SIZE] = {};
+    av_strerror(status, buffer, sizeof(buffer));
+    throw std::runtime_error(what + ": " + buffer);
+  }
+}
+
+// Software decode of the archive MP4. The low-res encoder writes closed
+// two-second GOPs without B-frames (workhorse.md §3), so decode order is
+// display order and a frame needs only the packets from the keyframe at or
+// before it: a seek costs at most one GOP of decoding, and a frame later in
+// the GOP just being decoded costs only the frames in between.
+class FfmpegFrameSource : public FrameSource {
+ public:
+  explicit FfmpegFrameSource(const std::filesystem::path& path) : path_(path) {
+    check_av(avformat_open_input(&format_, path.string().c_str(), nullptr, nullptr),
+             "open " + path.string());
+    check_av(avformat_find_stream_info(format_, nullptr), "probe " + path.string());
+    stream_index_ = av_find_best_stream(format_, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    check_av(stream_index_, "no video stream in " + path.string());
+    stream_ = format_->streams[stream_index_];
+    const AVCodec* codec = avcodec_find_decoder(stream_->codecpar->codec_id);
+    if (codec == nullptr) {
+      throw std::runtime_error("no decoder for " + path.string());
+    }
+    codec_ = avcodec_alloc_context3(codec);
+    check_av(avcodec_parameters_to_context(codec_, stream_->codecpar), "codec parameters");
+    check_av(avcodec_open2(codec_, codec, nullptr), "open decoder");
+    packet_ = av_packet_alloc();
+    decoded_ = av_frame_alloc();
+    fps_ = av_q2d(stream_->avg_frame_rate);
+
+    // MP4 index entries are samples in stream order: the frame numbering.
+    int entries = avformat_index_get_entries_count(stream_);
+    frame_count_ = entries > 0 ? entries : stream_->nb_frames;
+    for (int i = 0; i < entries; ++i) {
+      if (avformat_index_get_entry(stream_, i)->flags & AVINDEX_KEYFRAME) {
+        keyframes_.push_back(i);
+      }
+    }
+    if (keyframes_.empty() || keyframes_.front() != 0) {
+      keyframes_.insert(keyframes_.begin(), 0);
+    }
+  }
+
+  ~FfmpegFrameSource() override {
+    sws_freeContext(scaler_);
+    av_frame_free(&decoded_);
+    av_packet_free(&packet_);
+    avcodec_free_context(&codec_);
+    avformat_close_input(&format_);
+  }
+
+  YuvImage frame(std::int64_t index) override {
+    if (index < 0 || index >= frame_count_) {
+      throw std::out_of_range("frame " + std::to_string(index) + " of " + path_.string());
+    }
+    std::int64_t key = *(std::upper_bound(keyframes_.begin(), keyframes_.end(), index) - 1);
+    // Decoding on is cheaper than seeking unless a keyframe lies between.
+    if (index < next_index_ || key > next_index_) {
+      seek(key);
+    }
+    while (true) {
+      int status = avcodec_receive_frame(codec_, decoded_);
+      if (status == 0) {
+        if (next_index_++ == index) {
+          return convert(*decoded_);
+        }
+        continue;
+      }
+      if (status == AVERROR_EOF) {
+        throw std::runtime_error("frame " + std::to_string(index) + " missing from " +
+                                 path_.string());
+      }
+      if (status != AVERROR(EAGAIN)) {
+        check_av(status, "decode " + path_.string());
+      }
+      status = av_read_frame(format_, packet_);
+      if (status == AVERROR_EOF) {
+        check_av(avcodec_send_packet(codec_, nullptr), "flush decoder");
+        continue;
+      }
+      check_av(status, "read " + path_.string());
+      if (packet_->stream_index == stream_index_) {
+        status = avcodec_send_packet(codec_, packet_);
+      }
+      av_packet_unref(packet_);
+      check_av(status, "decode " + path_.string());
+    }
+  }
+
+ private:
+  void seek(std::int64_t key) {
+    const AVIndexEntry* entry = avformat_index_get_entry(stream_, static_cast<int>(key));
+    std::int64_t timestamp = entry != nullptr ? entry->timestamp : 0;
+    check_av(av_seek_frame(format_, stream_index_, timestamp, AVSEEK_FLAG_BACKWARD),
+             "seek " + path_.string());
+    avcodec_flush_buffers(codec_);
+    next_index_ = key;
+  }
+
+  YuvImage convert(const AVFrame& frame) {
+    YuvImage image = blank_image(frame.width, frame.height);
+    scaler_ = sws_getCachedContext(scaler_, frame.width, frame.height,
+                                   static_cast<AVPixelFormat>(frame.format), frame.width,
+                                   frame.height, AV_PIX_FMT_YUV420P, SWS_POINT, nullptr, nullptr,
+                                   nullptr);
+    std::uint8_t* planes[3] = {image.y.data(), image.u.data(), image.v.data()};
+    int pitches[3] = {image.width, image.chroma_width(), image.chroma_width()};
+    sws_scale(scaler_, frame.data, frame.linesize, 0, frame.height, planes, pitches);
+    return image;
+  }
+
+  std::filesystem::path path_;
+  AVFormatContext* format_ = nullptr;
+  AVStream* stream_ = nullptr;
+  AVCodecContext* codec_ = nullptr;
+  AVPacket* packet_ = nullptr;
+  AVFrame* decoded_ = nullptr;
+  SwsContext* scaler_ = nullptr;
+  int stream_index_ = -1;
+  std::vector<std::int64_t> keyframes_;
+  std::int64_t next_index_ = 0;  // frame the decoder produces next
+};
+
+#endif
+
+}  // namespace
+
+std::unique_ptr<FrameSource> open_frame_source(const std::filesystem::path& path) {
+  if (path.extension() == ".y4m") {
+    return std::make_unique<Y4mFrameSource>(path);
+  }
+#if DASHCAM_WITH_FFMPEG
+  return std::make_unique<FfmpegFrameSource>(path);
+#else
+  throw std::runtime_error("cannot decode " + path.string() + ": built without FFmpeg");
+#endif
+}
+
+}  // namespace dashcam::media
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+namespace dashcam::media {
+
+// One decoded frame, planar I420 (4:2:0), tightly packed.
+struct YuvImage {
+  int width = 0;
+  int height = 0;
+  std::vector<std::uint8_t> y, u, v;
+
+  int chroma_width() const { return (width + 1) / 2; }
+  int chroma_height() const { return (height + 1) / 2; }
+};
+
+// Random access to the frames of an archived video (shed_NAS.md
+// video_lowres.mp4). Frame numbers are sample numbers in stream order, the
+// numbering of the video index and of detections.dcol. Not thread-safe:
+// a source keeps its decoder between calls, so frames read in order, as a
+// scrubbing timeline asks for them, continue from where the last one
+// stopped instead of seeking again.
+class FrameSource {
+ public:
+  virtual ~FrameSource() = default;
+
+  std::int64_t frame_count() const { return frame_count_; }
+  double fps() const { return fps_; }
+
+  // Throws std::out_of_range past the end and std::runtime_error when the
+  // frame cannot be decoded.
+  virtual YuvImage frame(std::int64_t index) = 0;
+
+ protected:
+  std::int64_t frame_count_ = 0;
+  double fps_ = 0.0;
+};
+
+// A .y4m clip (read in place) or, on builds with DASHCAM_WITH_FFMPEG, any
+// MP4 FFmpeg decodes. Throws std::runtime_error for files it cannot open.
+std::unique_ptr<FrameSource> open_frame_source(const std::filesystem::path& path);
+
+}  // namespace dashcam::media
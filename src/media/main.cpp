@@ -0,0 +1,77 @@
+// dashcam-media: serves the Shed NAS archive to the WebUI (shed_NAS.md §5),
+// rendering timeline frames on demand instead of storing them.
+//
+//   dashcam-media [--archive /archive] [--listen 0.0.0.0:8090]
+//                 [--cache-dir cache/frames | --no-disk-cache] [--cache-gb 20]
+//                 [--memory-mb 256] [--quality 80]
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <string>
+
+#include "common/http/http_client.hpp"
+#include "common/http/http_server.hpp"
+#include "media/media_api.hpp"
+#include "media/media_cache.hpp"
+
+using namespace dashcam;
+
+int main(int argc, char** argv) {
+  std::string listen = "0.0.0.0:8090";
+  media::MediaConfig config;
+  media::MediaCacheConfig cache_config;
+  for (int i = 1; i < argc; ++i) {
+    bool has_value = i + 1 < argc;
+    if (std::strcmp(argv[i], "--archive") == 0 && has_value) {
+      config.archive_dir = argv[++i];
+    } else if (std::strcmp(argv[i], "--listen") == 0 && has_value) {
+      listen = argv[++i];
+    } else if (std::strcmp(argv[i], "--cache-dir") == 0 && has_value) {
+      cache_config.disk_dir = argv[++i];
+    } else if (std::strcmp(argv[i], "--no-disk-cache") == 0) {
+      cache_config.disk_dir.clear();
+    } else if (std::strcmp(argv[i], "--cache-gb") == 0 && has_value) {
+      cache_config.disk_bytes = static_cast<std::uint64_t>(std::max(1, std::atoi(argv[++i])))
+                                << 30;
+    } else if (std::strcmp(argv[i], "--memory-mb") == 0 && has_value) {
+      cache_config.memory_bytes = static_cast<std::size_t>(std::max(1, std::atoi(argv[++i])))
+                                  << 20;
+    } else if (std::strcmp(argv[i], "--quality") == 0 && has_value) {
+      config.jpeg_quality = std::clamp(std::atoi(argv[++i]), 1, 100);
+    } else {
+      std::fprintf(stderr,
+                   "usage: %s [--archive /archive] [--listen 0.0.0.0:8090]\n"
+                   "       [--cache-dir cache/frames | --no-disk-cache] [--cache-gb 20]\n"
+                   "       [--memory-mb 256] [--quality 80]\n",
+                   argv[0]);
+      return 2;
+    }
+  }
+
+  try {
+    auto [address, port] = http::parse_endpoint(listen);
+    media::MediaCache cache(cache_config);
+    media::MediaApi api(config, cache);
+
+    http::ServerOptions options;
+    options.address = address;
+    options.port = port;
+    options.handle_signals = true;
+    http::HttpServer server(options, [&](const http::Request& request) {
+      if (auto response = api.handle(request)) {
+        return std::move(*response);
+      }
+      return http::error_response(404, "not found");
+    });
+    std::fprintf(stderr, "dashcam-media: %s on %s:%u\n", config.archive_dir.string().c_str(),
+                 address.c_str(), static_cast<unsigned>(server.port()));
+    server.run();
+  } catch (const std::exception& e) {
+    std::fprintf(stderr, "dashcam-media: %s\n", e.what());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,291 @@
+#include "media/media_api.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "media/thumbnail.hpp"
+
+namespace dashcam::media {
+
+namespace {
+
+constexpr std::string_view kPrefix = "/archive/";
+
+template <typename T>
+std::optional<T> parse_number(std::string_view text) {
+  T value{};
+  auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+  if (ec != std::errc() || end != text.data() + text.size() || text.empty()) {
+    return std::nullopt;
+  }
+  return value;
+}
+
+// Archive-relative path components; nothing that could leave the archive.
+std::optional<std::vector<std::string>> split_path(std::string_view path) {
+  std::vector<std::string> parts;
+  while (!path.empty()) {
+    std::size_t slash = path.find('/');
+    std::string part = http::url_decode(path.substr(0, slash));
+    if (part.empty() || part == "." || part == ".." ||
+        part.find_first_of(std::string_view("/\\\0", 3)) != std::string::npos) {
+      return std::nullopt;
+    }
+    parts.push_back(std::move(part));
+    if (slash == std::string_view::npos) {
+      break;
+    }
+    path.remove_prefix(slash + 1);
+  }
+  return parts;
+}
+
+const char* content_type_of(const std::filesystem::path& path) {
+  std::string ext = path.extension().string();
+  if (ext == ".mp4") {
+    return "video/mp4";
+  }
+  if (ext == ".jpg" || ext == ".jpeg") {
+    return "image/jpeg";
+  }
+  if (ext == ".json") {
+    return "application/json";
+  }
+  return "application/octet-stream";
+}
+
+std::string read_bytes(const std::filesystem::path& path, std::uint64_t offset,
+                       std::uint64_t length) {
+  std::ifstream in(path, std::ios::binary);
+  std::string out(static_cast<std::size_t>(length), '\0');
+  in.seekg(static_cast<std::streamoff>(offset));
+  if (!in.read(out.data(), static_cast<std::streamsize>(length))) {
+    throw std::runtime_error("cannot read " + path.string());
+  }
+  return out;
+}
+
+}  // namespace
+
+std::optional<ByteRange> parse_range(std::string_view header, std::uint64_t size,
+                                     std::uint64_t chunk) {
+  constexpr std::string_view kUnit = "bytes=";
+  if (header.substr(0, kUnit.size()) != kUnit || header.find(',') != std::string_view::npos) {
+    return std::nullopt;
+  }
+  header.remove_prefix(kUnit.size());
+  std::size_t dash = header.find('-');
+  if (dash == std::string_view::npos) {
+    return std::nullopt;
+  }
+  std::string_view first_text = header.substr(0, dash);
+  std::string_view last_text = header.substr(dash + 1);
+  ByteRange range;
+  if (first_text.empty()) {
+    // "bytes=-N": the last N bytes.
+    std::optional<std::uint64_t> suffix = parse_number<std::uint64_t>(last_text);
+    if (!suffix) {
+      return std::nullopt;
+    }
+    if (*suffix == 0 || size == 0) {
+      throw std::out_of_range("empty suffix range");
+    }
+    range.first = size - std::min(*suffix, size);
+    range.last = size - 1;
+    return range;
+  }
+  std::optional<std::uint64_t> first = parse_number<std::uint64_t>(first_text);
+  if (!first) {
+    return std::nullopt;
+  }
+  if (*first >= size) {
+    throw std::out_of_range("range starts past the end");
+  }
+  range.first = *first;
+  if (last_text.empty()) {
+    range.last = std::min(size - 1, *first + std::max<std::uint64_t>(chunk, 1) - 1);
+  } else {
+    std::optional<std::uint64_t> last = parse_number<std::uint64_t>(last_text);
+    if (!last || *last < *first) {
+      return std::nullopt;
+    }
+    range.last = std::min(size - 1, *last);
+  }
+  return range;
+}
+
+MediaApi::MediaApi(MediaConfig config, MediaCache& cache)
+    : config_(std::move(config)), cache_(cache) {}
+
+std::optional<http::Response> MediaApi::handle(const http::Request& request) {
+  std::string_view path = request.path();
+  if (path.substr(0, kPrefix.size()) != kPrefix) {
+    return std::nullopt;
+  }
+  if (request.method != "GET") {
+    return http::error_response(405, "GET only");
+  }
+  std::optional<std::vector<std::string>> parts = split_path(path.substr(kPrefix.size()));
+  if (!parts || parts->size() < 2) {
+    return http::error_response(404, "not found");
+  }
+  // /archive/<video_id>/frames/<frame>.jpg
+  const std::string& leaf = parts->back();
+  if (parts->size() == 3 && (*parts)[1] == "frames" && leaf.size() > 4 &&
+      leaf.compare(leaf.size() - 4, 4, ".jpg") == 0) {
+    std::optional<std::int64_t> index =
+        parse_number<std::int64_t>(std::string_view(leaf).substr(0, leaf.size() - 4));
+    if (index && *index >= 0) {
+      int width = 0;
+      if (auto text = request.query("width")) {
+        std::optional<int> value = parse_number<int>(*text);
+        if (!value || *value <= 0 || *value > config_.max_width) {
+          return http::error_response(400,
+                                      "width must be 1-" + std::to_string(config_.max_width));
+        }
+        width = *value;
+      }
+      return frame(parts->front(), *index, width);
+    }
+  }
+  std::filesystem::path file = config_.archive_dir;
+  for (const std::string& part : *parts) {
+    file /= part;
+  }
+  return this->file(request, file);
+}
+
+http::Response MediaApi::frame(const std::string& video_id, std::int64_t index, int width) {
+  std::filesystem::path dir = config_.archive_dir / video_id;
+  std::filesystem::path video = dir / "video_lowres.mp4";
+  std::error_code ec;
+  if (!std::filesystem::is_regular_file(video, ec)) {
+    video = dir / "video_lowres.y4m";
+  }
+  std::filesystem::file_time_type modified = std::filesystem::last_write_time(video, ec);
+  if (ec) {
+    return http::error_response(404, "no video for " + video_id);
+  }
+  // The file's time is part of the key, so a re-archived video does not
+  // serve stale frames.
+  std::string key = video.generic_string() + "#" + std::to_string(index) + "@" +
+                    std::to_string(width) + "/" +
+                    std::to_string(modified.time_since_epoch().count());
+
+  std::optional<std::string> jpeg = cache_.get(key);
+  if (!jpeg) {
+    std::shared_future<std::string> pending;
+    std::promise<std::string> promise;
+    bool owner = false;
+    {
+      std::lock_guard lock(mutex_);
+      auto it = rendering_.find(key);
+      if (it == rendering_.end()) {
+        pending = promise.get_future().share();
+        rendering_.emplace(key, pending);
+        owner = true;
+      } else {
+        pending = it->second;
+      }
+    }
+    if (owner) {
+      try {
+        std::string rendered = render(video, index, width);
+        cache_.put(key, rendered);
+        promise.set_value(std::move(rendered));
+      } catch (...) {
+        promise.set_exception(std::current_exception());
+      }
+      std::lock_guard lock(mutex_);
+      rendering_.erase(key);
+    }
+    try {
+      jpeg = pending.get();
+    } catch (const std::out_of_range& e) {
+      return http::error_response(404, e.what());
+    }
+  }
+  http::Response response;
+  response.content_type = "image/jpeg";
+  // Keys change when the video does, so frames can be cached for good.
+  response.headers.emplace_back("Cache-Control", "public, max-age=86400");
+  response.body = std::move(*jpeg);
+  return response;
+}
+
+std::string MediaApi::render(const std::filesystem::path& video, std::int64_t index, int width) {
+  std::shared_ptr<OpenVideo> open = open_video(video);
+  YuvImage image;
+  {
+    std::lock_guard lock(open->mutex);
+    std::error_code ec;
+    std::filesystem::file_time_type modified = std::filesystem::last_write_time(video, ec);
+    if (!open->source || modified != open->modified) {
+      open->source.reset();
+      open->source = open_frame_source(video);
+      open->modified = modified;
+    }
+    image = open->source->frame(index);
+  }
+  return encode_jpeg(resize_frame(image, width), config_.jpeg_quality);
+}
+
+std::shared_ptr<MediaApi::OpenVideo> MediaApi::open_video(const std::filesystem::path& video) {
+  std::string key = video.generic_string();
+  std::lock_guard lock(mutex_);
+  auto it = std::find_if(open_.begin(), open_.end(),
+                         [&](const auto& entry) { return entry.first == key; });
+  if (it != open_.end()) {
+    open_.splice(open_.begin(), open_, it);
+    return open_.front().second;
+  }
+  open_.emplace_front(key, std::make_shared<OpenVideo>());
+  // A decoder still in use lives on until its request finishes.
+  while (open_.size() > std::max<std::size_t>(config_.open_videos, 1)) {
+    open_.pop_back();
+  }
+  return open_.front().second;
+}
+
+http::Response MediaApi::file(const http::Request& request, const std::filesystem::path& path) {
+  std::error_code ec;
+  if (!std::filesystem::is_regular_file(path, ec)) {
+    return http::error_response(404, "not found");
+  }
+  std::uint64_t size = std::filesystem::file_size(path, ec);
+  http::Response response;
+  response.content_type = content_type_of(path);
+  response.headers.emplace_back("Accept-Ranges", "bytes");
+  std::optional<ByteRange> range;
+  if (auto header = request.header("Range")) {
+    try {
+      range = parse_range(*header, size, config_.range_chunk_bytes);
+    } catch (const std::out_of_range& e) {
+      response = http::error_response(416, e.what());
+      response.headers.emplace_back("Content-Range", "bytes */" + std::to_string(size));
+      return response;
+    }
+  }
+  if (!range) {
+    if (size > config_.max_full_bytes) {
+      return http::error_response(400, "files over " + std::to_string(config_.max_full_bytes) +
+                                           " bytes are read by Range");
+    }
+    response.body = read_bytes(path, 0, size);
+    return response;
+  }
+  response.status = 206;
+  response.headers.emplace_back("Content-Range", "bytes " + std::to_string(range->first) + "-" +
+                                                     std::to_string(range->last) + "/" +
+                                                     std::to_string(size));
+  response.body = read_bytes(path, range->first, range->last - range->first + 1);
+  return response;
+}
+
+}  // namespace dashcam::media
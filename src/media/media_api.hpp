@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+#include "common/http/http_message.hpp"
+#include "media/frame_source.hpp"
+#include "media/media_cache.hpp"
+
+namespace dashcam::media {
+
+struct MediaConfig {
+  std::filesystem::path archive_dir = "/archive";
+  int jpeg_quality = 80;
+  int max_width = 1920;
+  // Videos whose decoder stays open between requests.
+  std::size_t open_videos = 8;
+  // An open-ended range ("bytes=N-") is answered with at most this much.
+  std::uint64_t range_chunk_bytes = 8u << 20;
+  // Larger files must be fetched by range; bodies are held in memory.
+  std::uint64_t max_full_bytes = 64u << 20;
+};
+
+// The Shed NAS media service (shed_NAS.md §5, web_ui_overview.md §4.2):
+//
+//   GET /archive/<video_id>/frames/<frame>.jpg?width=W
+//   GET /archive/<path>        (Range: bytes=... for partial content)
+//
+// Frames are decoded from the video's video_lowres.mp4 (or .y4m) when
+// first asked for, resized to `width` (never up) and kept in the cache, so
+// nothing is pre-rendered into the archive. Concurrent requests for the
+// same frame decode it once. Any other archive file is served as is, with
+// single byte ranges so the player can seek without downloading the video.
+class MediaApi {
+ public:
+  MediaApi(MediaConfig config, MediaCache& cache);
+
+  // Empty when the request is not for an archive route.
+  std::optional<http::Response> handle(const http::Request& request);
+
+ private:
+  // A video's open decoder; its mutex serializes reads through it.
+  struct OpenVideo {
+    std::mutex mutex;
+    std::unique_ptr<FrameSource> source;
+    std::filesystem::file_time_type modified;
+  };
+
+  http::Response frame(const std::string& video_id, std::int64_t index, int width);
+  std::string render(const std::filesystem::path& video, std::int64_t index, int width);
+  std::shared_ptr<OpenVideo> open_video(const std::filesystem::path& video);
+  http::Response file(const http::Request& request, const std::filesystem::path& path);
+
+  MediaConfig config_;
+  MediaCache& cache_;
+
+  std::mutex mutex_;
+  std::list<std::pair<std::string, std::shared_ptr<OpenVideo>>> open_;  // most recent first
+  std::unordered_map<std::string, std::shared_future<std::string>> rendering_;
+};
+
+// The byte range of a `size`-byte file a Range header asks for, inclusive;
+// std::nullopt when it is not a single "bytes=" range (the whole file is
+// then sent, as HTTP allows). Open-ended ranges are cut to `chunk` bytes.
+// Throws std::out_of_range when the range starts past the end.
+struct ByteRange {
+  std::uint64_t first = 0, last = 0;
+};
+std::optional<ByteRange> parse_range(std::string_view header, std::uint64_t size,
+                                     std::uint64_t chunk);
+
+}  // namespace dashcam::media
@@ -0,0 +1,162 @@
+#include "media/media_cache.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "common/hash.hpp"
+
+namespace dashcam::media {
+
+MediaCache::MediaCache(MediaCacheConfig config) : config_(std::move(config)) {
+  if (config_.disk_dir.empty()) {
+    return;
+  }
+  std::filesystem::create_directories(config_.disk_dir);
+  std::vector<std::pair<std::filesystem::file_time_type, DiskEntry>> found;
+  for (const auto& item : std::filesystem::directory_iterator(config_.disk_dir)) {
+    std::error_code ec;
+    std::string name = item.path().filename().string();
+    if (!item.is_regular_file(ec) || item.path().extension() != ".bin") {
+      // Left behind by an interrupted write.
+      if (name.find(".tmp") != std::string::npos) {
+        std::filesystem::remove(item.path(), ec);
+      }
+      continue;
+    }
+    found.push_back({item.last_write_time(ec), DiskEntry{name, item.file_size(ec)}});
+  }
+  std::sort(found.begin(), found.end(),
+            [](const auto& a, const auto& b) { return a.first > b.first; });
+  for (auto& [time, entry] : found) {
+    stats_.disk_bytes += entry.bytes;
+    disk_.push_back(std::move(entry));
+    disk_index_[disk_.back().file] = std::prev(disk_.end());
+  }
+}
+
+std::string MediaCache::file_name(const std::string& key) {
+  return to_hex(xxh64(key.data(), key.size())) + ".bin";
+}
+
+std::filesystem::path MediaCache::disk_path(const std::string& file) const {
+  return config_.disk_dir / file;
+}
+
+std::optional<std::string> MediaCache::get(const std::string& key) {
+  std::string file;
+  {
+    std::lock_guard lock(mutex_);
+    if (auto it = memory_index_.find(key); it != memory_index_.end()) {
+      memory_.splice(memory_.begin(), memory_, it->second);
+      ++stats_.memory_hits;
+      return it->second->value;
+    }
+    file = file_name(key);
+    auto it = disk_index_.find(file);
+    if (it == disk_index_.end()) {
+      ++stats_.misses;
+      return std::nullopt;
+    }
+    disk_.splice(disk_.begin(), disk_, it->second);
+  }
+  // Read outside the lock; a file evicted meanwhile is just a miss. The
+  // key is stored in front of the value, so a hash collision is one too.
+  std::ifstream in(disk_path(file), std::ios::binary);
+  std::string stored_key;
+  std::string value;
+  bool found = in && std::getline(in, stored_key, '\0') && stored_key == key;
+  if (found) {
+    value.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  }
+  std::lock_guard lock(mutex_);
+  if (!found) {
+    ++stats_.misses;
+    return std::nullopt;
+  }
+  ++stats_.disk_hits;
+  remember(key, value);
+  return value;
+}
+
+void MediaCache::put(const std::string& key, const std::string& value) {
+  std::string file = file_name(key);
+  bool to_disk = !config_.disk_dir.empty() && value.size() < config_.disk_bytes;
+  if (to_disk) {
+    // Written before it is indexed: readers never see a partial file.
+    std::filesystem::path path = disk_path(file);
+    std::filesystem::path tmp = path;
+    tmp += ".tmp";
+    {
+      std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+      out.write(key.data(), static_cast<std::streamsize>(key.size()));
+      out.put('\0');
+      out.write(value.data(), static_cast<std::streamsize>(value.size()));
+      to_disk = static_cast<bool>(out.flush());
+    }
+    std::error_code ec;
+    if (to_disk) {
+      std::filesystem::rename(tmp, path, ec);
+    }
+    if (!to_disk || ec) {
+      std::fprintf(stderr, "frame cache: cannot write %s\n", path.string().c_str());
+      std::filesystem::remove(tmp, ec);
+      to_disk = false;
+    }
+  }
+
+  std::vector<std::string> evicted;
+  {
+    std::lock_guard lock(mutex_);
+    remember(key, value);
+    if (to_disk) {
+      std::uint64_t bytes = key.size() + 1 + value.size();
+      if (auto it = disk_index_.find(file); it != disk_index_.end()) {
+        stats_.disk_bytes -= it->second->bytes;
+        disk_.erase(it->second);
+      }
+      disk_.push_front(DiskEntry{file, bytes});
+      disk_index_[file] = disk_.begin();
+      stats_.disk_bytes += bytes;
+      while (stats_.disk_bytes > config_.disk_bytes && disk_.size() > 1) {
+        stats_.disk_bytes -= disk_.back().bytes;
+        evicted.push_back(std::move(disk_.back().file));
+        disk_index_.erase(evicted.back());
+        disk_.pop_back();
+      }
+    }
+  }
+  for (const std::string& name : evicted) {
+    std::error_code ec;
+    std::filesystem::remove(disk_path(name), ec);
+  }
+}
+
+void MediaCache::remember(const std::string& key, const std::string& value) {
+  if (value.size() > config_.memory_bytes) {
+    return;
+  }
+  if (auto it = memory_index_.find(key); it != memory_index_.end()) {
+    stats_.memory_bytes -= it->second->value.size();
+    memory_.erase(it->second);
+  }
+  memory_.push_front(MemoryEntry{key, value});
+  memory_index_[key] = memory_.begin();
+  stats_.memory_bytes += value.size();
+  while (stats_.memory_bytes > config_.memory_bytes) {
+    stats_.memory_bytes -= memory_.back().value.size();
+    memory_index_.erase(memory_.back().key);
+    memory_.pop_back();
+  }
+}
+
+MediaCache::Stats MediaCache::stats() {
+  std::lock_guard lock(mutex_);
+  return stats_;
+}
+
+}  // namespace dashcam::media
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace dashcam::media {
+
+struct MediaCacheConfig {
+  std::size_t memory_bytes = 256u << 20;
+  // Local SSD; empty keeps the cache in memory only.
+  std::filesystem::path disk_dir = "cache/frames";
+  std::uint64_t disk_bytes = 20ull << 30;
+};
+
+// Two-level LRU of rendered media (frame JPEGs) by key: a byte-bounded
+// memory level in front of a byte-bounded directory on the SSD, so
+// scrubbing back over a stretch of timeline is served without touching the
+// archive disks. An entry evicted from memory stays on the SSD; a disk hit
+// moves it back into memory. Disk entries survive restarts: the directory
+// is rescanned at startup, oldest first by modification time. Thread-safe.
+class MediaCache {
+ public:
+  explicit MediaCache(MediaCacheConfig config);
+
+  std::optional<std::string> get(const std::string& key);
+  void put(const std::string& key, const std::string& value);
+
+  struct Stats {
+    std::uint64_t memory_hits = 0, disk_hits = 0, misses = 0;
+    std::size_t memory_bytes = 0;
+    std::uint64_t disk_bytes = 0;
+  };
+  Stats stats();
+
+ private:
+  struct MemoryEntry {
+    std::string key;
+    std::string value;
+  };
+  struct DiskEntry {
+    std::string file;
+    std::uint64_t bytes;
+  };
+
+  void remember(const std::string& key, const std::string& value);  // mutex_ held
+  std::filesystem::path disk_path(const std::string& file) const;
+  static std::string file_name(const std::string& key);
+
+  MediaCacheConfig config_;
+  std::mutex mutex_;
+  // Most recently used first.
+  std::list<MemoryEntry> memory_;
+  std::unordered_map<std::string, std::list<MemoryEntry>::iterator> memory_index_;
+  std::list<DiskEntry> disk_;
+  std::unordered_map<std::string, std::list<DiskEntry>::iterator> disk_index_;  // by file
+  Stats stats_;
+};
+
+}  // namespace dashcam::media
@@ -0,0 +1,134 @@
+#include "media/thumbnail.hpp"
+
+#include <algorithm>
+#include <csetjmp>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <vector>
+
+#include <jpeglib.h>
+
+namespace dashcam::media {
+
+namespace {
+
+// Averages each destination pixel's source footprint; in integer steps,
+// the footprints of neighbouring pixels differ by at most one source pixel.
+void box_scale(const std::uint8_t* src, int src_w, int src_h, std::uint8_t* dst, int dst_w,
+               int dst_h) {
+  std::vector<int> x0(static_cast<std::size_t>(dst_w) + 1);
+  for (int x = 0; x <= dst_w; ++x) {
+    x0[static_cast<std::size_t>(x)] = static_cast<int>(static_cast<long long>(x) * src_w / dst_w);
+  }
+  std::vector<std::uint32_t> sums(static_cast<std::size_t>(dst_w));
+  for (int y = 0; y < dst_h; ++y) {
+    int top = static_cast<int>(static_cast<long long>(y) * src_h / dst_h);
+    int bottom =
+        std::max(top + 1, static_cast<int>(static_cast<long long>(y + 1) * src_h / dst_h));
+    std::fill(sums.begin(), sums.end(), 0);
+    for (int sy = top; sy < bottom; ++sy) {
+      const std::uint8_t* row =
+          src + static_cast<std::size_t>(sy) * static_cast<std::size_t>(src_w);
+      for (int x = 0; x < dst_w; ++x) {
+        int left = x0[static_cast<std::size_t>(x)];
+        int right = std::max(left + 1, x0[static_cast<std::size_t>(x) + 1]);
+        std::uint32_t sum = 0;
+        for (int sx = left; sx < right; ++sx) {
+          sum += row[sx];
+        }
+        sums[static_cast<std::size_t>(x)] += sum;
+      }
+    }
+    std::uint8_t* out = dst + static_cast<std::size_t>(y) * static_cast<std::size_t>(dst_w);
+    for (int x = 0; x < dst_w; ++x) {
+      int left = x0[static_cast<std::size_t>(x)];
+      auto area = static_cast<std::uint32_t>(
+          (std::max(left + 1, x0[static_cast<std::size_t>(x) + 1]) - left) * (bottom - top));
+      out[x] = static_cast<std::uint8_t>((sums[static_cast<std::size_t>(x)] + area / 2) / area);
+    }
+  }
+}
+
+struct ErrorManager {
+  jpeg_error_mgr base;
+  std::jmp_buf jump;
+  char message[JMSG_LENGTH_MAX];
+};
+
+void on_error(j_common_ptr cinfo) {
+  auto* errors = reinterpret_cast<ErrorManager*>(cinfo->err);
+  (*cinfo->err->format_message)(cinfo, errors->message);
+  std::longjmp(errors->jump, 1);
+}
+
+}  // namespace
+
+YuvImage resize_frame(const YuvImage& frame, int width) {
+  if (width <= 0 || width >= frame.width) {
+    return frame;
+  }
+  width = std::max(2, width & ~1);
+  int height = std::max(2, static_cast<int>(static_cast<long long>(frame.height) * width /
+                                            frame.width) & ~1);
+  YuvImage out;
+  out.width = width;
+  out.height = height;
+  out.y.resize(static_cast<std::size_t>(width) * static_cast<std::size_t>(height));
+  auto chroma = static_cast<std::size_t>(out.chroma_width()) *
+                static_cast<std::size_t>(out.chroma_height());
+  out.u.resize(chroma);
+  out.v.resize(chroma);
+  box_scale(frame.y.data(), frame.width, frame.height, out.y.data(), width, height);
+  box_scale(frame.u.data(), frame.chroma_width(), frame.chroma_height(), out.u.data(),
+            out.chroma_width(), out.chroma_height());
+  box_scale(frame.v.data(), frame.chroma_width(), frame.chroma_height(), out.v.data(),
+            out.chroma_width(), out.chroma_height());
+  return out;
+}
+
+std::string encode_jpeg(const YuvImage& frame, int quality) {
+  jpeg_compress_struct cinfo{};
+  ErrorManager errors{};
+  cinfo.err = jpeg_std_error(&errors.base);
+  errors.base.error_exit = on_error;
+  unsigned char* buffer = nullptr;
+  unsigned long length = 0;
+  if (setjmp(errors.jump) != 0) {
+    jpeg_destroy_compress(&cinfo);
+    std::free(buffer);
+    throw std::runtime_error(std::string("jpeg encode failed: ") + errors.message);
+  }
+  jpeg_create_compress(&cinfo);
+  jpeg_mem_dest(&cinfo, &buffer, &length);
+  cinfo.image_width = static_cast<JDIMENSION>(frame.width);
+  cinfo.image_height = static_cast<JDIMENSION>(frame.height);
+  cinfo.input_components = 3;
+  cinfo.in_color_space = JCS_YCbCr;
+  jpeg_set_defaults(&cinfo);
+  jpeg_set_quality(&cinfo, std::clamp(quality, 1, 100), TRUE);
+  jpeg_start_compress(&cinfo, TRUE);
+  // libjpeg takes interleaved rows and subsamples chroma again itself.
+  std::vector<JSAMPLE> row(static_cast<std::size_t>(frame.width) * 3);
+  const auto cw = static_cast<std::size_t>(frame.chroma_width());
+  while (cinfo.next_scanline < cinfo.image_height) {
+    std::size_t y = cinfo.next_scanline;
+    const std::uint8_t* luma = frame.y.data() + y * static_cast<std::size_t>(frame.width);
+    const std::uint8_t* u = frame.u.data() + y / 2 * cw;
+    const std::uint8_t* v = frame.v.data() + y / 2 * cw;
+    for (std::size_t x = 0; x < static_cast<std::size_t>(frame.width); ++x) {
+      row[3 * x] = luma[x];
+      row[3 * x + 1] = u[x / 2];
+      row[3 * x + 2] = v[x / 2];
+    }
+    JSAMPROW rows[1] = {row.data()};
+    jpeg_write_scanlines(&cinfo, rows, 1);
+  }
+  jpeg_finish_compress(&cinfo);
+  std::string jpeg(reinterpret_cast<const char*>(buffer), length);
+  jpeg_destroy_compress(&cinfo);
+  std::free(buffer);
+  return jpeg;
+}
+
+}  // namespace dashcam::media
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <string>
+
+#include "media/frame_source.hpp"
+
+namespace dashcam::media {
+
+// Box-filtered downscale to `width` (even, aspect kept); frames narrower
+// than that are returned as they are, never upscaled.
+YuvImage resize_frame(const YuvImage& frame, int width);
+
+// Baseline 4:2:0 JPEG of a frame; `quality` 1-100. Throws
+// std::runtime_error when libjpeg fails.
+std::string encode_jpeg(const YuvImage& frame, int quality);
+
+}  // namespace dashcam::media
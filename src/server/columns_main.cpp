@@ -0,0 +1,55 @@
+// dashcam-columns: prints a column file (detections.dcol, candidates) as
+// JSON, for debugging (common/column_file.hpp).
+//
+//   dashcam-columns file.dcol [--rows N] [--verify]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <string>
+
+#include <json/writer.h>
+
+#include "common/column_file.hpp"
+
+using namespace dashcam;
+
+int main(int argc, char** argv) {
+  const char* path = nullptr;
+  std::uint64_t rows = UINT64_MAX;
+  bool verify = false;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--rows") == 0 && i + 1 < argc) {
+      rows = std::strtoull(argv[++i], nullptr, 10);
+    } else if (std::strcmp(argv[i], "--verify") == 0) {
+      verify = true;
+    } else if (path == nullptr && argv[i][0] != '-') {
+      path = argv[i];
+    } else {
+      path = nullptr;
+      break;
+    }
+  }
+  if (path == nullptr) {
+    std::fprintf(stderr, "usage: %s file.dcol [--rows N] [--verify]\n", argv[0]);
+    return 2;
+  }
+
+  try {
+    ColumnFile file(path);
+    if (verify && !file.verify()) {
+      std::fprintf(stderr, "dashcam-columns: %s: checksum mismatch\n", path);
+      return 1;
+    }
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "  ";
+    std::string text = Json::writeString(builder, to_json(file, rows));
+    std::fwrite(text.data(), 1, text.size(), stdout);
+    std::fputc('\n', stdout);
+  } catch (const std::exception& e) {
+    std::fprintf(stderr, "dashcam-columns: %s\n", e.what());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,45 @@
+// dashcam-crops: expands a heavy_output crop pack (common/crop_pack.hpp)
+// into separate JPEGs, e.g. into /archive/<video_id>/plates/ (shed_NAS.md).
+//
+//   dashcam-crops heavy_output_dir out_dir [--best]
+
+#include <cstdio>
+#include <cstring>
+#include <exception>
+
+#include "common/crop_pack.hpp"
+
+using namespace dashcam;
+
+int main(int argc, char** argv) {
+  const char* pack_dir = nullptr;
+  const char* out_dir = nullptr;
+  bool best = false;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--best") == 0) {
+      best = true;
+    } else if (pack_dir == nullptr && argv[i][0] != '-') {
+      pack_dir = argv[i];
+    } else if (out_dir == nullptr && argv[i][0] != '-') {
+      out_dir = argv[i];
+    } else {
+      out_dir = nullptr;
+      break;
+    }
+  }
+  if (pack_dir == nullptr || out_dir == nullptr) {
+    std::fprintf(stderr, "usage: %s heavy_output_dir out_dir [--best]\n", argv[0]);
+    return 2;
+  }
+
+  try {
+    CropPack pack(pack_dir);
+    std::size_t written = expand_crop_pack(pack, out_dir, best);
+    std::fprintf(stderr, "dashcam-crops: %zu of %zu crops written to %s\n", written, pack.size(),
+                 out_dir);
+  } catch (const std::exception& e) {
+    std::fprintf(stderr, "dashcam-crops: %s\n", e.what());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,174 @@
+#include "server/finalizer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "common/crop_pack.hpp"
+#include "common/detection_columns.hpp"
+#include "common/gps_track.hpp"
+#include "common/json_util.hpp"
+#include "server/task_store.hpp"
+
+namespace dashcam::server {
+
+namespace {
+
+constexpr const char* kWorkerId = "main_server";
+
+Json::Value read_summary(const TaskInput& input) {
+  std::filesystem::path file = std::filesystem::path(input.path) / "summary.json";
+  std::ifstream in(file, std::ios::binary);
+  if (!in) {
+    throw std::runtime_error("cannot open " + file.string());
+  }
+  std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  return parse_json(text);
+}
+
+}  // namespace
+
+Finalizer::Finalizer(TaskQueue& queue, FinalizerConfig config, SightingIndex* sightings)
+    : queue_(queue), config_(std::move(config)), sightings_(sightings) {
+  thread_ = std::thread([this] { run(); });
+}
+
+Finalizer::~Finalizer() { stop(); }
+
+void Finalizer::stop() {
+  stopping_ = true;
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void Finalizer::run() {
+  const std::vector<std::string> types{std::string(kFinalizeVideo)};
+  while (!stopping_) {
+    std::vector<Task> tasks = queue_.pull(kWorkerId, types, 8, std::chrono::seconds(10));
+    for (const Task& task : tasks) {
+      try {
+        finalize(task);
+        failures_.erase(task.task_id);
+      } catch (const std::exception& e) {
+        // The task stays pending and is retried later, backing off so one
+        // that keeps failing does not spin; inputs may still be syncing to
+        // the NAS.
+        int failures = failures_[task.task_id]++;
+        auto delay = config_.retry_delay * (std::int64_t{1} << std::min(failures, 16));
+        delay = std::min<std::chrono::seconds>(delay, config_.retry_max);
+        queue_.defer(task.task_id, delay);
+        std::fprintf(stderr, "finalize task %lld (%s) failed, retrying in %llds: %s\n",
+                     static_cast<long long>(task.task_id), task.video_id.c_str(),
+                     static_cast<long long>(delay.count()), e.what());
+      }
+    }
+  }
+}
+
+void Finalizer::finalize(const Task& task) {
+  std::vector<Json::Value> parts;
+  std::vector<std::filesystem::path> columns;
+  std::vector<std::filesystem::path> dirs;
+  bool have_columns = true;
+  for (const TaskInput& input : task.inputs) {
+    if (input.type == "heavy_output") {
+      parts.push_back(read_summary(input));
+      dirs.emplace_back(input.path);
+      columns.push_back(std::filesystem::path(input.path) / kDetectionFile);
+      have_columns = have_columns && std::filesystem::exists(columns.back());
+    }
+  }
+  if (parts.empty()) {
+    throw std::invalid_argument("no heavy_output input");
+  }
+  std::vector<TrackIdMap> track_ids;
+  Json::Value summary =
+      parts.size() == 1 ? parts.front() : merge_heavy_outputs(parts, config_.merge, &track_ids);
+
+  // The low-res video comes in one part per shard, each starting on a
+  // keyframe at timestamp 0; archiving joins them in this order by stream
+  // copy.
+  Json::Value lowres(Json::arrayValue);
+  for (std::size_t i = 0; i < parts.size(); ++i) {
+    const Json::Value& file = parts[i]["lowres"]["file"];
+    if (file.isString()) {
+      lowres.append((dirs[i] / file.asString()).generic_string());
+    }
+  }
+  summary["lowres_parts"] = lowres;
+
+  // Ids are checked when tasks are created; this guards tasks queued before.
+  if (!safe_video_id(task.video_id)) {
+    throw std::invalid_argument("bad video id: " + task.video_id);
+  }
+  std::filesystem::path dir = config_.metadata_dir / task.video_id;
+  std::filesystem::create_directories(dir);
+  // Outputs written before detections.dcol existed only have a summary.
+  if (have_columns) {
+    std::filesystem::path detections = dir / kDetectionFile;
+    if (columns.size() == 1) {
+      std::filesystem::path tmp = dir / "detections.dcol.tmp";
+      std::filesystem::copy_file(columns.front(), tmp,
+                                 std::filesystem::copy_options::overwrite_existing);
+      std::filesystem::rename(tmp, detections);
+    } else {
+      merge_detection_files(columns, track_ids, detections);
+    }
+  }
+  // Every shard carries the whole video's GPS log; one copy is kept.
+  for (const std::filesystem::path& part : dirs) {
+    if (std::filesystem::exists(part / kGpsFile)) {
+      std::filesystem::path tmp = dir / "gps.dcol.tmp";
+      std::filesystem::copy_file(part / kGpsFile, tmp,
+                                 std::filesystem::copy_options::overwrite_existing);
+      std::filesystem::rename(tmp, dir / kGpsFile);
+      break;
+    }
+  }
+  // Shard crop packs are joined next to the shard directories, under the
+  // video's heavy_output directory, so archiving expands one pack per video
+  // with video-wide track ids.
+  if (dirs.size() > 1 && std::any_of(dirs.begin(), dirs.end(), has_crop_pack)) {
+    merge_crop_packs(dirs, track_ids, dirs.front().parent_path());
+  }
+  std::filesystem::path file = dir / "summary.json";
+  std::filesystem::path tmp = dir / "summary.json.tmp";
+  {
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    out << to_json_string(summary);
+    if (!out) {
+      throw std::runtime_error("cannot write " + tmp.string());
+    }
+  }
+  std::filesystem::rename(tmp, file);
+
+  // Indexed last: a failure before this point leaves the old sightings, and
+  // the retry replaces them.
+  std::size_t indexed = 0;
+  if (sightings_ != nullptr) {
+    std::optional<DetectionTable> detections;
+    if (have_columns) {
+      detections.emplace(dir / kDetectionFile);
+    }
+    std::vector<Sighting> found =
+        sightings_from_summary(task.video_id, summary, detections ? &*detections : nullptr);
+    sightings_->replace_video(video_record_from_summary(task.video_id, summary, unix_millis()),
+                              found);
+    indexed = found.size();
+  }
+
+  TaskCompletion completion;
+  completion.task_id = task.task_id;
+  queue_.complete({&completion, 1});
+  std::fprintf(stderr, "finalized %s from %zu heavy output(s), %u plates, %zu sightings indexed\n",
+               task.video_id.c_str(), parts.size(), summary["plates"].size(), indexed);
+}
+
+}  // namespace dashcam::server
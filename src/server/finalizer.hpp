@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <thread>
+#include <unordered_map>
+
+#include "common/task.hpp"
+#include "server/heavy_merge.hpp"
+#include "server/sighting_index.hpp"
+#include "server/task_queue.hpp"
+
+namespace dashcam::server {
+
+struct FinalizerConfig {
+  // Per-video metadata written by finalization, `<dir>/<video_id>/summary.json`.
+  std::filesystem::path metadata_dir = "metadata";
+  MergeConfig merge;
+  // A failed task is retried after this, doubling with each further failure
+  // up to retry_max.
+  std::chrono::seconds retry_delay{30};
+  std::chrono::seconds retry_max{std::chrono::minutes(30)};
+};
+
+// Runs FINALIZE_VIDEO tasks on the server itself (main_server.md §5.3),
+// pulling them from the queue like any other device. Each task's
+// `heavy_output` inputs are read (their paths must be reachable from the
+// server), merged when the video was processed in shards, and written out as
+// the video's metadata before the task is completed. With `sightings` set,
+// the video's plate sightings are (re)indexed there as well.
+class Finalizer {
+ public:
+  Finalizer(TaskQueue& queue, FinalizerConfig config, SightingIndex* sightings = nullptr);
+  ~Finalizer();
+
+  Finalizer(const Finalizer&) = delete;
+  Finalizer& operator=(const Finalizer&) = delete;
+
+  // Returns once the current task is done; call TaskQueue::shutdown() first
+  // so a waiting pull returns at once.
+  void stop();
+
+ private:
+  void run();
+  void finalize(const Task& task);
+
+  TaskQueue& queue_;
+  FinalizerConfig config_;
+  SightingIndex* sightings_;
+  std::unordered_map<std::int64_t, int> failures_;  // by task id, until it succeeds
+  std::atomic<bool> stopping_{false};
+  std::thread thread_;
+};
+
+}  // namespace dashcam::server
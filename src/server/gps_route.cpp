@@ -0,0 +1,159 @@
+#include "server/gps_route.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <span>
+#include <utility>
+
+namespace dashcam::server {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+// Tile size of the WebUI map, in pixels.
+constexpr double kTilePixels = 256.0;
+
+void put_varint(std::string& out, std::uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<char>(value));
+}
+
+void put_zigzag(std::string& out, std::int64_t value) {
+  put_varint(out,
+             (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63));
+}
+
+// value / unit rounded, plus one; 0 for unknown or negative values.
+std::uint64_t optional_units(double value, double unit) {
+  if (!std::isfinite(value) || value < 0.0) {
+    return 0;
+  }
+  return static_cast<std::uint64_t>(std::llround(value / unit)) + 1;
+}
+
+Json::Value optional_number(double value) {
+  return std::isfinite(value) ? Json::Value(value) : Json::Value();
+}
+
+}  // namespace
+
+double route_tolerance_deg(int zoom) {
+  return 360.0 / (kTilePixels * std::ldexp(1.0, zoom)) / 2.0;
+}
+
+std::vector<std::uint32_t> simplify_route(const GpsTable& gps, int zoom) {
+  const std::size_t n = gps.size();
+  std::vector<std::uint32_t> rows;
+  if (zoom < 0 || n <= 2) {
+    rows.resize(n);
+    for (std::size_t i = 0; i < n; ++i) {
+      rows[i] = static_cast<std::uint32_t>(i);
+    }
+    return rows;
+  }
+  std::span<const double> lat = gps.lat();
+  std::span<const double> lon = gps.lon();
+  double mean_lat = 0.0;
+  for (double v : lat) {
+    mean_lat += v;
+  }
+  const double scale = std::cos(mean_lat / static_cast<double>(n) * kPi / 180.0);
+  const double tolerance = route_tolerance_deg(zoom);
+  const double tolerance2 = tolerance * tolerance;
+
+  // Iterative, so a long drive cannot overflow the stack.
+  std::vector<bool> keep(n, false);
+  keep[0] = keep[n - 1] = true;
+  std::vector<std::pair<std::size_t, std::size_t>> spans{{0, n - 1}};
+  while (!spans.empty()) {
+    auto [first, last] = spans.back();
+    spans.pop_back();
+    const double ax = lon[first] * scale, ay = lat[first];
+    const double dx = lon[last] * scale - ax, dy = lat[last] - ay;
+    const double length2 = dx * dx + dy * dy;
+    double worst = -1.0;
+    std::size_t worst_i = first;
+    for (std::size_t i = first + 1; i < last; ++i) {
+      double px = lon[i] * scale - ax, py = lat[i] - ay;
+      // Distance to the segment, not the line: a route can double back.
+      double t = length2 > 0.0 ? std::clamp((px * dx + py * dy) / length2, 0.0, 1.0) : 0.0;
+      double ex = px - t * dx, ey = py - t * dy;
+      double d2 = ex * ex + ey * ey;
+      if (d2 > worst) {
+        worst = d2;
+        worst_i = i;
+      }
+    }
+    if (worst > tolerance2) {
+      keep[worst_i] = true;
+      if (worst_i - first > 1) {
+        spans.emplace_back(first, worst_i);
+      }
+      if (last - worst_i > 1) {
+        spans.emplace_back(worst_i, last);
+      }
+    }
+  }
+  for (std::size_t i = 0; i < n; ++i) {
+    if (keep[i]) {
+      rows.push_back(static_cast<std::uint32_t>(i));
+    }
+  }
+  return rows;
+}
+
+Json::Value route_json(const GpsTable& gps, const std::vector<std::uint32_t>& rows) {
+  std::span<const std::int64_t> t_us = gps.t_us();
+  std::span<const double> lat = gps.lat(), lon = gps.lon();
+  std::span<const double> speed = gps.speed(), bearing = gps.bearing();
+  std::span<const double> accuracy = gps.accuracy();
+  Json::Value out(Json::objectValue);
+  out["rows"] = Json::UInt64(rows.size());
+  Json::Value& t = out["t_us"] = Json::Value(Json::arrayValue);
+  Json::Value& la = out["lat"] = Json::Value(Json::arrayValue);
+  Json::Value& lo = out["lon"] = Json::Value(Json::arrayValue);
+  Json::Value& sp = out["speed"] = Json::Value(Json::arrayValue);
+  Json::Value& be = out["bearing"] = Json::Value(Json::arrayValue);
+  Json::Value& ac = out["accuracy"] = Json::Value(Json::arrayValue);
+  for (std::uint32_t i : rows) {
+    t.append(Json::Int64(t_us[i]));
+    la.append(lat[i]);
+    lo.append(lon[i]);
+    sp.append(optional_number(speed[i]));
+    be.append(optional_number(bearing[i]));
+    ac.append(optional_number(accuracy[i]));
+  }
+  return out;
+}
+
+std::string encode_route(const GpsTable& gps, const std::vector<std::uint32_t>& rows) {
+  std::span<const std::int64_t> t_us = gps.t_us();
+  std::span<const double> lat = gps.lat(), lon = gps.lon();
+  std::span<const double> speed = gps.speed(), bearing = gps.bearing();
+  std::span<const double> accuracy = gps.accuracy();
+  std::string out = "DCGP";
+  out.push_back(1);
+  out.append(3, '\0');
+  put_varint(out, rows.size());
+  out.reserve(out.size() + rows.size() * 12);
+  std::int64_t t0 = 0, lat0 = 0, lon0 = 0;
+  for (std::uint32_t i : rows) {
+    std::int64_t la = std::llround(lat[i] * 1e7), lo = std::llround(lon[i] * 1e7);
+    put_zigzag(out, t_us[i] - t0);
+    put_zigzag(out, la - lat0);
+    put_zigzag(out, lo - lon0);
+    t0 = t_us[i];
+    lat0 = la;
+    lon0 = lo;
+    put_varint(out, optional_units(speed[i], 0.01));
+    put_varint(out, optional_units(bearing[i], 0.01));
+    put_varint(out, optional_units(accuracy[i], 0.01));
+  }
+  return out;
+}
+
+}  // namespace dashcam::server
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <json/value.h>
+
+#include "common/gps_track.hpp"
+
+namespace dashcam::server {
+
+// Rows of `gps` to draw at a map zoom (web_ui_overview.md §3.3 route map):
+// Douglas-Peucker on the track, with a tolerance of half a 256-pixel-tile
+// pixel at `zoom` (on an equirectangular projection scaled by the cosine of
+// the track's mean latitude), so the simplified line is the same on screen.
+// The first and last rows are always kept; a negative zoom keeps every row.
+std::vector<std::uint32_t> simplify_route(const GpsTable& gps, int zoom);
+
+// Tolerance in degrees of latitude for `zoom`.
+double route_tolerance_deg(int zoom);
+
+// {"rows": n, "t_us": [...], "lat": [...], "lon": [...], "speed": [...],
+//  "bearing": [...], "accuracy": [...]}, the chosen rows column by column;
+// unknown values are null.
+Json::Value route_json(const GpsTable& gps, const std::vector<std::uint32_t>& rows);
+
+// Binary route, little-endian:
+//   magic "DCGP", u8 version (1), u8 0, u16 0, varint n, then per row
+//   zigzag varint deltas of t_us, lat and lon (in 1e-7 degrees) from the
+//   previous row (from 0 for the first), and varints of speed (cm/s),
+//   bearing (0.01 degrees) and accuracy (cm), each plus one, 0 when unknown.
+// Varints are LEB128. A fix at 1 Hz is typically 10-12 bytes against about
+// 120 in JSON.
+std::string encode_route(const GpsTable& gps, const std::vector<std::uint32_t>& rows);
+
+}  // namespace dashcam::server
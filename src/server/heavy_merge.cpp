@@ -0,0 +1,236 @@
+#include "server/heavy_merge.hpp"
+
+#include <algorithm>
+#include <array>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "common/crop_pack.hpp"
+#include "common/detection_columns.hpp"
+
+namespace dashcam::server {
+
+namespace {
+
+using Box = std::array<float, 4>;  // x0, y0, x1, y1
+
+Box box_of(const Json::Value& json) {
+  Box box{};
+  if (json.isArray() && json.size() == 4) {
+    for (Json::ArrayIndex i = 0; i < 4; ++i) {
+      box[i] = json[i].asFloat();
+    }
+  }
+  return box;
+}
+
+float area(const Box& r) { return std::max(0.0f, r[2] - r[0]) * std::max(0.0f, r[3] - r[1]); }
+
+float iou(const Box& a, const Box& b) {
+  float w = std::min(a[2], b[2]) - std::max(a[0], b[0]);
+  float h = std::min(a[3], b[3]) - std::max(a[1], b[1]);
+  if (w <= 0.0f || h <= 0.0f) {
+    return 0.0f;
+  }
+  float inter = w * h;
+  return inter / (area(a) + area(b) - inter);
+}
+
+bool texts_agree(const Json::Value& a, const Json::Value& b) {
+  std::string ta = a["text"].asString();
+  std::string tb = b["text"].asString();
+  return ta.empty() || tb.empty() || ta == tb;
+}
+
+// Appends `next` (the continuation after a boundary) onto `track`.
+void stitch(Json::Value& track, const Json::Value& next) {
+  track["last_frame"] = next["last_frame"];
+  track["last_box"] = next["last_box"];
+  track["reads"] = track["reads"].asInt() + next["reads"].asInt();
+  track["crops_seen"] = Json::Int64(track["crops_seen"].asInt64() + next["crops_seen"].asInt64());
+  if (next["best_quality"].asFloat() > track["best_quality"].asFloat()) {
+    track["best_frame"] = next["best_frame"];
+    track["best_box"] = next["best_box"];
+    track["best_quality"] = next["best_quality"];
+  }
+  if (track["text"].asString().empty()) {
+    track["text"] = next["text"];
+    track["share"] = next["share"];
+    track["converged"] = next["converged"];
+  } else if (!next["text"].asString().empty()) {
+    track["share"] = std::max(track["share"].asFloat(), next["share"].asFloat());
+    track["converged"] = track["converged"].asBool() || next["converged"].asBool();
+  }
+}
+
+}  // namespace
+
+Json::Value merge_heavy_outputs(std::span<const Json::Value> shards, const MergeConfig& config,
+                                std::vector<TrackIdMap>* track_ids) {
+  Json::Value out(Json::objectValue);
+  std::int64_t frames_decoded = 0;
+  std::int64_t frames_kept = 0;
+  std::uint64_t tracks = 0;
+  std::uint64_t crops_seen = 0;
+  std::uint64_t ocr_calls = 0;
+  std::vector<Json::Value> plates;
+  // The (shard, track id) pairs each entry of `plates` was stitched from.
+  std::vector<std::vector<std::pair<std::size_t, int>>> sources;
+
+  for (std::size_t s = 0; s < shards.size(); ++s) {
+    const Json::Value& shard = shards[s];
+    frames_decoded += shard["frames_decoded"].asInt64();
+    frames_kept += shard["frames_kept"].asInt64();
+    tracks += shard["ocr"]["tracks"].asUInt64();
+    crops_seen += shard["ocr"]["crops_seen"].asUInt64();
+    ocr_calls += shard["ocr"]["ocr_calls"].asUInt64();
+
+    std::vector<Json::Value> incoming(shard["plates"].begin(), shard["plates"].end());
+    std::vector<bool> taken(incoming.size(), false);
+    if (s > 0 && shard["shard"].isObject()) {
+      // Greedy one-to-one matching across the boundary, best overlap first.
+      std::int64_t boundary = shard["shard"]["first_frame"].asInt64();
+      std::vector<std::tuple<float, std::size_t, std::size_t>> pairs;
+      for (std::size_t a = 0; a < plates.size(); ++a) {
+        if (plates[a]["last_frame"].asInt64() < boundary - config.boundary_frames) {
+          continue;
+        }
+        Box last = box_of(plates[a]["last_box"]);
+        for (std::size_t b = 0; b < incoming.size(); ++b) {
+          if (incoming[b]["first_frame"].asInt64() >= boundary + config.boundary_frames ||
+              !texts_agree(plates[a], incoming[b])) {
+            continue;
+          }
+          float overlap = iou(last, box_of(incoming[b]["first_box"]));
+          if (overlap >= config.min_iou) {
+            pairs.emplace_back(overlap, a, b);
+          }
+        }
+      }
+      std::sort(pairs.begin(), pairs.end(),
+                [](const auto& x, const auto& y) { return std::get<0>(x) > std::get<0>(y); });
+      std::vector<bool> continued(plates.size(), false);
+      for (const auto& [overlap, a, b] : pairs) {
+        if (continued[a] || taken[b]) {
+          continue;
+        }
+        stitch(plates[a], incoming[b]);
+        sources[a].emplace_back(s, incoming[b]["track_id"].asInt());
+        continued[a] = true;
+        taken[b] = true;
+        --tracks;
+      }
+    }
+    for (std::size_t b = 0; b < incoming.size(); ++b) {
+      if (!taken[b]) {
+        sources.push_back({{s, incoming[b]["track_id"].asInt()}});
+        plates.push_back(std::move(incoming[b]));
+      }
+    }
+  }
+
+  std::vector<std::size_t> order(plates.size());
+  for (std::size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+    return plates[a]["first_frame"].asInt64() < plates[b]["first_frame"].asInt64();
+  });
+  if (track_ids != nullptr) {
+    track_ids->assign(shards.size(), {});
+  }
+  Json::Value merged(Json::arrayValue);
+  for (std::size_t i = 0; i < order.size(); ++i) {
+    Json::Value& plate = plates[order[i]];
+    plate["track_id"] = static_cast<int>(i);
+    if (track_ids != nullptr) {
+      for (const auto& [shard, id] : sources[order[i]]) {
+        (*track_ids)[shard][id] = static_cast<int>(i);
+      }
+    }
+    merged.append(std::move(plate));
+  }
+
+  out["shards"] = static_cast<int>(shards.size());
+  out["frames_decoded"] = Json::Int64(frames_decoded);
+  out["frames_kept"] = Json::Int64(frames_kept);
+  out["plates"] = merged;
+  Json::Value ocr(Json::objectValue);
+  ocr["tracks"] = Json::UInt64(tracks);
+  ocr["crops_seen"] = Json::UInt64(crops_seen);
+  ocr["ocr_calls"] = Json::UInt64(ocr_calls);
+  out["ocr"] = ocr;
+  // Every shard loads the whole video's GPS log; only the located
+  // detections differ.
+  if (!shards.empty() && shards.front()["gps"].isObject()) {
+    Json::Value gps = shards.front()["gps"];
+    std::uint64_t located = 0;
+    for (const Json::Value& shard : shards) {
+      located += shard["gps"]["detections_located"].asUInt64();
+    }
+    gps["detections_located"] = Json::UInt64(located);
+    out["gps"] = gps;
+  }
+  return out;
+}
+
+void merge_detection_files(std::span<const std::filesystem::path> shards,
+                           std::span<const TrackIdMap> track_ids,
+                           const std::filesystem::path& out) {
+  std::vector<DetectionTable> tables;
+  std::size_t rows = 0;
+  for (const auto& path : shards) {
+    tables.emplace_back(path);
+    rows += tables.back().size();
+  }
+  DetectionColumns merged;
+  merged.reserve(rows);
+  for (std::size_t s = 0; s < tables.size(); ++s) {
+    const DetectionTable& t = tables[s];
+    auto frame = t.frame();
+    auto pts = t.pts_us();
+    auto x0 = t.x0();
+    auto y0 = t.y0();
+    auto x1 = t.x1();
+    auto y1 = t.y1();
+    auto score = t.score();
+    auto cls = t.cls();
+    auto track = t.track();
+    auto lat = t.lat();
+    auto lon = t.lon();
+    for (std::size_t i = 0; i < t.size(); ++i) {
+      std::int32_t id = track[i];
+      if (id >= 0 && s < track_ids.size()) {
+        auto it = track_ids[s].find(id);
+        id = it != track_ids[s].end() ? it->second : -1;
+      }
+      merged.append(frame[i], pts[i], x0[i], y0[i], x1[i], y1[i], score[i], cls[i], id, lat[i],
+                    lon[i]);
+    }
+  }
+  merged.write(out);
+}
+
+void merge_crop_packs(std::span<const std::filesystem::path> shard_dirs,
+                      std::span<const TrackIdMap> track_ids, const std::filesystem::path& out_dir) {
+  CropPackWriter merged;
+  for (std::size_t s = 0; s < shard_dirs.size(); ++s) {
+    if (!has_crop_pack(shard_dirs[s])) {
+      continue;
+    }
+    CropPack pack(shard_dirs[s]);
+    for (std::size_t i = 0; i < pack.size(); ++i) {
+      CropEntry entry = pack.entry(i);
+      if (s < track_ids.size()) {
+        auto it = track_ids[s].find(entry.track);
+        entry.track = it != track_ids[s].end() ? it->second : -1;
+      }
+      merged.append(entry, pack.jpeg(i));
+    }
+  }
+  merged.write(out_dir);
+}
+
+}  // namespace dashcam::server
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include <json/value.h>
+
+namespace dashcam::server {
+
+struct MergeConfig {
+  // A track ending within this many frames before a shard boundary may be
+  // continued by one starting within as many frames after it.
+  std::int64_t boundary_frames = 30;
+  // Overlap needed between the last box before the boundary and the first
+  // box after it (the plate barely moves in a frame or two).
+  float min_iou = 0.2f;
+};
+
+// Combines the heavy_output summaries (worker/heavy/heavy_output.hpp) of a
+// video's shards, given in shard order, into one summary for the whole
+// video. Frame counts and OCR stats add up; plate tracks cut by a shard
+// boundary are stitched back into one when their boxes line up across it and
+// their texts agree (or one is unread), so each physical plate keeps a
+// single timeline. Track ids are renumbered across the video.
+//
+// With `track_ids` set, it receives one map per shard from the shard's track
+// ids to the merged ones, for merge_detection_files.
+using TrackIdMap = std::unordered_map<int, int>;
+Json::Value merge_heavy_outputs(std::span<const Json::Value> shards, const MergeConfig& config,
+                                std::vector<TrackIdMap>* track_ids = nullptr);
+
+// Concatenates the shards' detections.dcol files (already in frame order,
+// shards in order) into `out`, renumbering track ids through `track_ids`.
+// Columns are read in place from the mapped files.
+void merge_detection_files(std::span<const std::filesystem::path> shards,
+                           std::span<const TrackIdMap> track_ids,
+                           const std::filesystem::path& out);
+
+// Concatenates the shards' crop packs (common/crop_pack.hpp) into one pack
+// in `out_dir`, renumbering track ids the same way. Shards without a pack
+// are skipped.
+void merge_crop_packs(std::span<const std::filesystem::path> shard_dirs,
+                      std::span<const TrackIdMap> track_ids, const std::filesystem::path& out_dir);
+
+}  // namespace dashcam::server
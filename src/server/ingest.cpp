@@ -0,0 +1,83 @@
+#include "server/ingest.hpp"
+
+#include <algorithm>
+#include <optional>
+#include <stdexcept>
+#include <system_error>
+
+#include "common/hash.hpp"
+
+namespace dashcam::server {
+
+VideoContent read_video_content(const std::filesystem::path& path) {
+  std::error_code ec;
+  std::uintmax_t size = std::filesystem::file_size(path, ec);
+  if (ec) {
+    throw std::runtime_error("cannot read " + path.string() + ": " + ec.message());
+  }
+  return {to_hex(fingerprint_file(path)), static_cast<std::int64_t>(size)};
+}
+
+std::vector<ShardSpec> plan_shards(const VideoIndex& index, const IngestConfig& config) {
+  std::vector<ShardSpec> shards;
+  std::int64_t first = 0;
+  while (true) {
+    auto next = std::lower_bound(index.keyframes.begin(), index.keyframes.end(),
+                                 first + config.shard_frames);
+    if (next == index.keyframes.end() || index.frame_count - *next < config.min_shard_frames) {
+      shards.push_back({0, 0, first, -1});
+      break;
+    }
+    shards.push_back({0, 0, first, *next});
+    first = *next;
+  }
+  for (std::size_t i = 0; i < shards.size(); ++i) {
+    shards[i].index = static_cast<int>(i);
+    shards[i].count = static_cast<int>(shards.size());
+  }
+  return shards;
+}
+
+std::vector<NewTask> plan_heavy_tasks(const std::string& video_id, const TaskInput& video,
+                                      const Json::Value& params, const IngestConfig& config) {
+  NewTask task;
+  task.task_type = std::string(kHeavyProcessVideo);
+  task.video_id = video_id;
+  task.inputs.push_back(video);
+  task.params = params.isObject() ? params : Json::Value(Json::objectValue);
+
+  // Indexing also validates the file, so it runs even when sharding is off.
+  std::optional<VideoIndex> index = read_video_index(video.path);
+  std::vector<ShardSpec> shards;
+  if (index && config.shard_frames > 0) {
+    shards = plan_shards(*index, config);
+  }
+  if (shards.size() <= 1) {
+    return {task};
+  }
+  std::vector<NewTask> tasks;
+  for (const ShardSpec& shard : shards) {
+    NewTask& t = tasks.emplace_back(task);
+    t.params["shard"] = to_json(shard);
+  }
+  return tasks;
+}
+
+NewTask plan_paired_task(const std::string& front_id, const TaskInput& front,
+                         const std::string& rear_id, const TaskInput& rear,
+                         const Json::Value& params) {
+  // Indexed only to validate the files, as in plan_heavy_tasks().
+  read_video_index(front.path);
+  read_video_index(rear.path);
+  NewTask task;
+  task.task_type = std::string(kHeavyProcessVideo);
+  task.video_id = front_id;
+  task.inputs.push_back(front);
+  task.inputs.push_back(rear);
+  task.inputs.back().type = std::string(kRearVideoInput);
+  task.params = params.isObject() ? params : Json::Value(Json::objectValue);
+  task.params["pair"]["rear_video_id"] = rear_id;
+  return task;
+}
+
+}  // namespace dashcam::server
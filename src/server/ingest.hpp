@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "common/task.hpp"
+#include "server/task_store.hpp"
+#include "server/video_index.hpp"
+
+namespace dashcam::server {
+
+struct IngestConfig {
+  // Target length of one HEAVY_PROCESS_VIDEO shard (5 min at 30 fps). Each
+  // shard ends at the first keyframe at or past this length, so shards are
+  // slightly longer than the target, never shorter (except the last).
+  // 0 never splits.
+  std::int64_t shard_frames = 9000;
+  // A final shard shorter than this is folded into the one before it;
+  // startup and merge overhead are not worth paying for a few seconds.
+  std::int64_t min_shard_frames = 1800;
+};
+
+// Keyframe-aligned frame ranges covering the whole video, in order. A video
+// shorter than two shards gives a single range. config.shard_frames > 0.
+std::vector<ShardSpec> plan_shards(const VideoIndex& index, const IngestConfig& config);
+
+// Identifies the video's content for the ingestion duplicate check: the
+// sampled fingerprint_file() hash (a few MiB read, wherever the file is) and
+// the size. Renamed or re-pulled copies of a file get the same content.
+// Throws std::runtime_error when the file is unreadable.
+VideoContent read_video_content(const std::filesystem::path& path);
+
+// HEAVY_PROCESS_VIDEO tasks for a newly ingested video (main_server.md §5.1):
+// one per shard, each with params["shard"] set, so several workers can run
+// one long video in parallel. Videos that are short or whose container cannot
+// be indexed get a single unsharded task. Throws std::runtime_error when the
+// file is unreadable or malformed.
+std::vector<NewTask> plan_heavy_tasks(const std::string& video_id, const TaskInput& video,
+                                      const Json::Value& params, const IngestConfig& config);
+
+// The HEAVY_PROCESS_VIDEO task for a front/rear pair of one recording,
+// processed together on one worker (workhorse.md §3): `front` and `rear`
+// (as kRearVideoInput) as inputs and params["pair"]["rear_video_id"] set.
+// Pairs are never sharded. Throws std::runtime_error when either file is
+// unreadable or malformed.
+NewTask plan_paired_task(const std::string& front_id, const TaskInput& front,
+                         const std::string& rear_id, const TaskInput& rear,
+                         const Json::Value& params);
+
+}  // namespace dashcam::server
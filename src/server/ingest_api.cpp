@@ -0,0 +1,150 @@
+#include "server/ingest_api.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "common/json_util.hpp"
+
+namespace dashcam::server {
+
+namespace {
+
+Counter& ingest_counter(const char* outcome) {
+  return default_metrics().counter("dashcam_server_ingest_total",
+                                   "Videos ingested, by whether tasks were queued or the video "
+                                   "was linked to an earlier copy.",
+                                   {{"outcome", outcome}});
+}
+
+// A video file that cannot be read or indexed: the request's fault (422),
+// unlike a failure of the task DB, which throws std::runtime_error as well.
+struct UnreadableVideo : std::runtime_error {
+  using std::runtime_error::runtime_error;
+};
+
+template <typename F>
+auto reading_video(F&& f) {
+  try {
+    return f();
+  } catch (const std::runtime_error& e) {
+    throw UnreadableVideo(e.what());
+  }
+}
+
+}  // namespace
+
+IngestApi::IngestApi(TaskQueue& queue, IngestConfig config)
+    : queue_(queue),
+      config_(config),
+      queued_(ingest_counter("queued")),
+      linked_(ingest_counter("linked")) {}
+
+Json::Value IngestApi::ingest_single(const std::string& video_id, const TaskInput& video,
+                                     const VideoContent& content, const Json::Value& params,
+                                     bool reprocess) {
+  // A known copy is linked without indexing it; ingest() checks again,
+  // under the store's lock, in case another copy lands meanwhile.
+  std::vector<NewTask> tasks;
+  if (reprocess || !queue_.find_content(content)) {
+    tasks = reading_video([&] { return plan_heavy_tasks(video_id, video, params, config_); });
+  }
+  IngestRecord record = queue_.ingest(video_id, content, tasks, reprocess);
+
+  Json::Value ids(Json::arrayValue);
+  for (std::int64_t id : record.task_ids) {
+    ids.append(Json::Int64(id));
+  }
+  Json::Value out(Json::objectValue);
+  out["task_ids"] = ids;
+  out["shards"] = static_cast<int>(record.task_ids.size());
+  if (record.duplicate_of) {
+    out["duplicate_of"] = *record.duplicate_of;
+    linked_.add();
+  } else {
+    queued_.add();
+  }
+  return out;
+}
+
+std::optional<http::Response> IngestApi::handle(const http::Request& request) {
+  if (request.path() != "/videos/ingest") {
+    return std::nullopt;
+  }
+  if (request.method != "POST") {
+    return http::error_response(405, "POST only");
+  }
+  try {
+    Json::Value body = parse_json(request.body);
+    if (!body.isObject() || !body["video_id"].isString() ||
+        !safe_video_id(body["video_id"].asString())) {
+      throw std::invalid_argument("body must have a valid string 'video_id'");
+    }
+    TaskInput video = task_input_from_json(body["video"]);
+    if (video.type.empty()) {
+      video.type = "video";
+    }
+    std::string video_id = body["video_id"].asString();
+    bool reprocess = body["reprocess"].asBool();
+
+    const Json::Value& rear_json = body["rear"];
+    std::optional<TaskInput> rear;
+    std::string rear_id;
+    if (!rear_json.isNull()) {
+      if (!rear_json.isObject() || !rear_json["video_id"].isString() ||
+          !safe_video_id(rear_json["video_id"].asString())) {
+        throw std::invalid_argument("'rear' must have a valid string 'video_id'");
+      }
+      rear_id = rear_json["video_id"].asString();
+      if (rear_id == video_id) {
+        throw std::invalid_argument("'rear' must be another video");
+      }
+      rear = task_input_from_json(rear_json["video"]);
+      rear->type = "video";
+    }
+
+    VideoContent content = reading_video([&] { return read_video_content(video.path); });
+    if (!rear) {
+      return http::json_response(
+          200, to_json_string(ingest_single(video_id, video, content, body["params"], reprocess)));
+    }
+
+    // A pair is queued together only when both videos are new; one that is a
+    // copy of an earlier video is linked to it like any other. The same file
+    // posted as both cameras is a rear copy of the front.
+    VideoContent rear_content = reading_video([&] { return read_video_content(rear->path); });
+    bool same_file = content == rear_content;
+    if (!same_file &&
+        (reprocess || (!queue_.find_content(content) && !queue_.find_content(rear_content)))) {
+      NewTask task = reading_video(
+          [&] { return plan_paired_task(video_id, video, rear_id, *rear, body["params"]); });
+      std::optional<std::vector<std::int64_t>> ids =
+          queue_.ingest_pair(video_id, content, rear_id, rear_content, {&task, 1}, reprocess);
+      if (ids) {
+        Json::Value task_ids(Json::arrayValue);
+        for (std::int64_t id : *ids) {
+          task_ids.append(Json::Int64(id));
+        }
+        Json::Value out(Json::objectValue);
+        out["task_ids"] = task_ids;
+        out["shards"] = 1;
+        out["paired"] = true;
+        out["rear"]["task_ids"] = task_ids;
+        out["rear"]["shards"] = 1;
+        queued_.add(2);
+        return http::json_response(200, to_json_string(out));
+      }
+    }
+    Json::Value out = ingest_single(video_id, video, content, body["params"], reprocess);
+    out["paired"] = false;
+    out["rear"] =
+        ingest_single(rear_id, *rear, rear_content, body["params"], reprocess && !same_file);
+    return http::json_response(200, to_json_string(out));
+  } catch (const UnreadableVideo& e) {
+    return http::error_response(422, e.what());
+  } catch (const std::invalid_argument& e) {
+    return http::error_response(400, e.what());
+  }
+}
+
+}  // namespace dashcam::server
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <optional>
+
+#include "common/http/http_message.hpp"
+#include "common/metrics.hpp"
+#include "server/ingest.hpp"
+#include "server/task_queue.hpp"
+
+namespace dashcam::server {
+
+// Ingestion endpoint (main_server.md §5.1), called when a new video lands on
+// the Indoor NAS:
+//
+//   POST /videos/ingest  {"video_id", "video": TaskInput, "params"?, "reprocess"?,
+//                         "rear"?: {"video_id", "video": TaskInput}}
+//                         -> {"task_ids": [...], "shards": N, "duplicate_of"?,
+//                             "paired"?, "rear"?: {...}}
+//
+// Validates the file and publishes its HEAVY_PROCESS_VIDEO task, or one task
+// per shard for long videos (see plan_heavy_tasks). The video path must be
+// readable from the server.
+//
+// A file whose content (read_video_content) was ingested before, renamed,
+// re-pulled by the sync tool or copied under another camera's name, queues
+// nothing: the video is linked to the earlier one, whose results stand for
+// both, and `duplicate_of` names it. Duplicates are recognised before the
+// container is indexed. "reprocess": true queues the tasks anyway.
+//
+// With "rear", the request is one recording's front video and its rear
+// camera's. When both are new they are queued as a single unsharded task
+// that processes the pair together (plan_paired_task) and "paired" is true;
+// otherwise each is ingested on its own as above and "rear" carries the
+// rear video's fields.
+class IngestApi {
+ public:
+  IngestApi(TaskQueue& queue, IngestConfig config);
+
+  // Empty when the request is not for an ingestion route.
+  std::optional<http::Response> handle(const http::Request& request);
+
+ private:
+  // Ingests one video on its own; the response fields for it.
+  Json::Value ingest_single(const std::string& video_id, const TaskInput& video,
+                            const VideoContent& content, const Json::Value& params,
+                            bool reprocess);
+
+  TaskQueue& queue_;
+  IngestConfig config_;
+  Counter& queued_;
+  Counter& linked_;
+};
+
+}  // namespace dashcam::server
@@ -0,0 +1,74 @@
+#include "server/lease_table.hpp"
+
+#include <algorithm>
+
+namespace dashcam::server {
+
+bool LeaseTable::acquire(std::int64_t task_id, const std::string& worker, Clock::time_point now) {
+  auto [it, inserted] = leases_.try_emplace(task_id, Lease{worker, now + ttl_});
+  if (inserted) {
+    return true;
+  }
+  Lease& lease = it->second;
+  if (lease.worker != worker && lease.expires > now) {
+    return false;
+  }
+  lease.worker = worker;
+  lease.expires = now + ttl_;
+  return true;
+}
+
+std::vector<std::int64_t> LeaseTable::heartbeat(const std::string& worker,
+                                                std::span<const std::int64_t> task_ids,
+                                                Clock::time_point now) {
+  for (auto it = leases_.begin(); it != leases_.end();) {
+    if (it->second.worker != worker) {
+      ++it;
+      continue;
+    }
+    if (std::find(task_ids.begin(), task_ids.end(), it->first) == task_ids.end()) {
+      it = leases_.erase(it);
+      continue;
+    }
+    it->second.expires = now + ttl_;
+    ++it;
+  }
+  std::vector<std::int64_t> lost;
+  for (std::int64_t id : task_ids) {
+    auto it = leases_.find(id);
+    if (it == leases_.end() || it->second.worker != worker) {
+      lost.push_back(id);
+    }
+  }
+  return lost;
+}
+
+void LeaseTable::release(std::int64_t task_id) { leases_.erase(task_id); }
+
+bool LeaseTable::held_by(std::int64_t task_id, const std::string& worker,
+                         Clock::time_point now) const {
+  auto it = leases_.find(task_id);
+  return it != leases_.end() && it->second.worker == worker && it->second.expires > now;
+}
+
+void LeaseTable::defer(std::int64_t task_id, Clock::time_point until) {
+  // Worker ids are never empty, so no acquire() matches the holder.
+  leases_.insert_or_assign(task_id, Lease{std::string(), until});
+}
+
+std::size_t LeaseTable::purge(Clock::time_point now) {
+  std::erase_if(leases_, [now](const auto& entry) { return entry.second.expires <= now; });
+  return leases_.size();
+}
+
+std::optional<LeaseTable::Clock::time_point> LeaseTable::next_expiry() const {
+  std::optional<Clock::time_point> earliest;
+  for (const auto& [id, lease] : leases_) {
+    if (!earliest || lease.expires < *earliest) {
+      earliest = lease.expires;
+    }
+  }
+  return earliest;
+}
+
+}  // namespace dashcam::server
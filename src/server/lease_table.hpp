@@ -0,0 +1,64 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace dashcam::server {
+
+// Soft leases on pending tasks, held only in server memory. A lease keeps
+// concurrent pullers of the same task type from being handed the same task;
+// it is not a task state: the DB still only knows pending/complete, and a
+// server restart starts with no leases (task_system_overview.md §6 holds).
+// Not thread-safe; TaskQueue serialises access.
+class LeaseTable {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit LeaseTable(Clock::duration ttl) : ttl_(ttl) {}
+
+  Clock::duration ttl() const { return ttl_; }
+
+  // Grants the lease if the task is free, its lease has expired, or `worker`
+  // already holds it (a restarted worker re-pulls its own tasks).
+  bool acquire(std::int64_t task_id, const std::string& worker, Clock::time_point now);
+
+  // Renews `worker`'s leases on `task_ids` and drops any other lease it
+  // holds, so a heartbeat is the complete list of tasks still in progress.
+  // Returns the ids in `task_ids` the worker no longer holds (leased to
+  // another worker after expiring, or completed).
+  std::vector<std::int64_t> heartbeat(const std::string& worker,
+                                      std::span<const std::int64_t> task_ids,
+                                      Clock::time_point now);
+
+  void release(std::int64_t task_id);
+
+  // True while `worker` holds an unexpired lease on the task.
+  bool held_by(std::int64_t task_id, const std::string& worker, Clock::time_point now) const;
+
+  // Holds the task for no one until `until`, the worker that held it
+  // included: a task that just failed is not handed straight back.
+  void defer(std::int64_t task_id, Clock::time_point until);
+
+  // Drops expired leases and returns the number still active.
+  std::size_t purge(Clock::time_point now);
+
+  // When the earliest live lease lapses, if any.
+  std::optional<Clock::time_point> next_expiry() const;
+
+ private:
+  struct Lease {
+    std::string worker;
+    Clock::time_point expires;
+  };
+
+  Clock::duration ttl_;
+  std::unordered_map<std::int64_t, Lease> leases_;
+};
+
+}  // namespace dashcam::server
@@ -0,0 +1,113 @@
+// dashcam-server: the main server's task database and metadata endpoints
+// (docs/devices/main_server.md).
+//
+//   dashcam-server [--db tasks.db] [--listen 0.0.0.0:8080] [--lease-seconds 60]
+//                  [--metadata-dir metadata] [--sightings-db sightings.db]
+//                  [--shard-frames 9000]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <string>
+
+#include "common/http/http_client.hpp"
+#include "common/http/http_server.hpp"
+#include "common/metrics.hpp"
+#include "common/trace.hpp"
+#include "server/finalizer.hpp"
+#include "server/ingest_api.hpp"
+#include "server/metadata_api.hpp"
+#include "server/metrics_api.hpp"
+#include "server/search_api.hpp"
+#include "server/task_api.hpp"
+#include "server/task_store.hpp"
+#include "server/tile_api.hpp"
+
+using namespace dashcam;
+
+int main(int argc, char** argv) {
+  std::string db_path = "tasks.db";
+  std::string sightings_path = "sightings.db";
+  std::string listen = "0.0.0.0:8080";
+  int lease_seconds = 60;
+  server::IngestConfig ingest;
+  server::FinalizerConfig finalize;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--db") == 0 && i + 1 < argc) {
+      db_path = argv[++i];
+    } else if (std::strcmp(argv[i], "--listen") == 0 && i + 1 < argc) {
+      listen = argv[++i];
+    } else if (std::strcmp(argv[i], "--lease-seconds") == 0 && i + 1 < argc) {
+      lease_seconds = std::max(1, std::atoi(argv[++i]));
+    } else if (std::strcmp(argv[i], "--metadata-dir") == 0 && i + 1 < argc) {
+      finalize.metadata_dir = argv[++i];
+    } else if (std::strcmp(argv[i], "--sightings-db") == 0 && i + 1 < argc) {
+      sightings_path = argv[++i];
+    } else if (std::strcmp(argv[i], "--shard-frames") == 0 && i + 1 < argc) {
+      ingest.shard_frames = std::max(0LL, std::atoll(argv[++i]));
+      ingest.min_shard_frames = std::min(ingest.min_shard_frames, ingest.shard_frames / 4);
+    } else {
+      std::fprintf(stderr,
+                   "usage: %s [--db tasks.db] [--listen 0.0.0.0:8080] [--lease-seconds 60]\n"
+                   "       [--metadata-dir metadata] [--sightings-db sightings.db]\n"
+                   "       [--shard-frames 9000 (0: never split)]\n",
+                   argv[0]);
+      return 2;
+    }
+  }
+
+  try {
+    auto [address, port] = http::parse_endpoint(listen);
+    server::TaskStore store(db_path);
+    server::TaskQueue queue(store, std::chrono::seconds(lease_seconds));
+    server::TaskApi tasks(queue);
+    server::IngestApi ingestion(queue, ingest);
+    server::SightingIndex sightings(sightings_path);
+    server::SearchApi search(sightings);
+    server::TileApi tiles(sightings);
+    server::MetadataApi metadata(sightings, finalize.metadata_dir, &store);
+    server::Finalizer finalizer(queue, finalize, &sightings);
+    TraceBuffer trace;
+    server::MetricsApi observability(default_metrics(), trace);
+
+    http::ServerOptions options;
+    options.address = address;
+    options.port = port;
+    options.handle_signals = true;
+    options.on_stop = [&] { queue.shutdown(); };
+    http::HttpServer http_server(options, [&](const http::Request& request) {
+      // Connection threads come and go; each request records into the ring.
+      TraceBinding bind(&trace);
+      if (auto response = tasks.handle(request)) {
+        return std::move(*response);
+      }
+      if (auto response = ingestion.handle(request)) {
+        return std::move(*response);
+      }
+      if (auto response = search.handle(request)) {
+        return std::move(*response);
+      }
+      if (auto response = tiles.handle(request)) {
+        return std::move(*response);
+      }
+      if (auto response = metadata.handle(request)) {
+        return std::move(*response);
+      }
+      if (auto response = observability.handle(request)) {
+        return std::move(*response);
+      }
+      return http::error_response(404, "not found");
+    });
+    std::fprintf(stderr, "dashcam-server: %s on %s:%u\n", db_path.c_str(), address.c_str(),
+                 static_cast<unsigned>(http_server.port()));
+    http_server.run();
+    finalizer.stop();
+  } catch (const std::exception& e) {
+    std::fprintf(stderr, "dashcam-server: %s\n", e.what());
+    return 1;
+  }
+  return 0;
+}
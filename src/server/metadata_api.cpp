@@ -0,0 +1,213 @@
+#include "server/metadata_api.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <vector>
+
+#include "common/gps_track.hpp"
+#include "common/json_util.hpp"
+#include "common/task.hpp"
+#include "server/gps_route.hpp"
+#include "server/search_api.hpp"
+#include "server/task_store.hpp"
+
+namespace dashcam::server {
+
+namespace {
+
+constexpr std::size_t kDefaultPage = 100;
+constexpr std::size_t kMaxPage = 1000;
+// Beyond this a tile pixel is under a centimetre; nothing more to drop.
+constexpr int kMaxRouteZoom = 22;
+constexpr std::int64_t kDefaultActivityUs = 30LL * 24 * 3600 * 1000000;
+constexpr std::size_t kDefaultRecent = 20;
+constexpr std::size_t kMaxRecent = 100;
+
+template <typename T>
+T parse_number(std::string_view text, const char* what) {
+  T value{};
+  auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+  if (ec != std::errc() || end != text.data() + text.size() || text.empty()) {
+    throw std::invalid_argument(std::string("bad ") + what + ": " + std::string(text));
+  }
+  return value;
+}
+
+}  // namespace
+
+Json::Value to_json(const VideoRecord& video) {
+  Json::Value out(Json::objectValue);
+  out["video_id"] = video.video_id;
+  out["start_utc_us"] =
+      video.start_utc_us ? Json::Value(Json::Int64(*video.start_utc_us)) : Json::Value();
+  out["finalized_ms"] = Json::Int64(video.finalized_ms);
+  out["frames"] = Json::Int64(video.frames);
+  out["plates"] = video.plates;
+  out["gps_fixes"] = Json::Int64(video.gps_fixes);
+  return out;
+}
+
+Json::Value to_json(const IndexStats& stats) {
+  Json::Value out(Json::objectValue);
+  out["videos"] = Json::Int64(stats.videos);
+  out["frames"] = Json::Int64(stats.frames);
+  out["gps_fixes"] = Json::Int64(stats.gps_fixes);
+  out["sightings"] = Json::Int64(stats.sightings);
+  out["located"] = Json::Int64(stats.located);
+  out["plates"] = Json::Int64(stats.plates);
+  return out;
+}
+
+std::string format_cursor(const VideoCursor& cursor) {
+  return std::to_string(cursor.recorded_us) + ":" + cursor.video_id;
+}
+
+VideoCursor parse_cursor(std::string_view text) {
+  std::size_t colon = text.find(':');
+  if (colon == std::string_view::npos) {
+    throw std::invalid_argument("bad cursor: " + std::string(text));
+  }
+  VideoCursor cursor;
+  cursor.recorded_us = parse_number<std::int64_t>(text.substr(0, colon), "cursor");
+  cursor.video_id = std::string(text.substr(colon + 1));
+  return cursor;
+}
+
+std::optional<http::Response> MetadataApi::handle(const http::Request& request) {
+  std::string_view path = request.path();
+  bool list = path == "/videos/list";
+  if (!list && path != "/stats" && path.substr(0, 5) != "/gps/") {
+    return std::nullopt;
+  }
+  if (request.method != "GET") {
+    return http::error_response(405, "GET only");
+  }
+  try {
+    if (list) {
+      return list_videos(request);
+    }
+    if (path == "/stats") {
+      return stats(request);
+    }
+    std::string video_id = http::url_decode(path.substr(5));
+    if (!safe_video_id(video_id)) {
+      return http::error_response(404, "gps is /gps/<video_id>");
+    }
+    return gps(request, video_id);
+  } catch (const std::invalid_argument& e) {
+    return http::error_response(400, e.what());
+  }
+}
+
+http::Response MetadataApi::list_videos(const http::Request& request) {
+  std::size_t limit = kDefaultPage;
+  if (auto text = request.query("limit")) {
+    limit = parse_number<std::size_t>(*text, "limit");
+    if (limit == 0 || limit > kMaxPage) {
+      throw std::invalid_argument("limit must be 1-" + std::to_string(kMaxPage));
+    }
+  }
+  std::optional<VideoCursor> after;
+  if (auto text = request.query("cursor"); text && !text->empty()) {
+    after = parse_cursor(*text);
+  }
+  VideoPage page = index_.list_videos(after, limit);
+  Json::Value out(Json::objectValue);
+  std::map<std::string, std::vector<std::string>> links;
+  if (links_ != nullptr) {
+    std::vector<std::string> ids;
+    ids.reserve(page.videos.size());
+    for (const VideoRecord& video : page.videos) {
+      ids.push_back(video.video_id);
+    }
+    links = links_->copies_of(ids);
+  }
+  Json::Value& videos = out["videos"] = Json::Value(Json::arrayValue);
+  for (const VideoRecord& video : page.videos) {
+    Json::Value& entry = videos.append(to_json(video));
+    if (links_ != nullptr) {
+      Json::Value& copies = entry["copies"] = Json::Value(Json::arrayValue);
+      if (auto it = links.find(video.video_id); it != links.end()) {
+        for (const std::string& copy : it->second) {
+          copies.append(copy);
+        }
+      }
+    }
+  }
+  out["next_cursor"] = page.next ? Json::Value(format_cursor(*page.next)) : Json::Value();
+  return http::json_response(200, to_json_string(out));
+}
+
+http::Response MetadataApi::gps(const http::Request& request, std::string_view video_id) {
+  std::string format = request.query("format").value_or("json");
+  if (format != "json" && format != "binary") {
+    throw std::invalid_argument("format must be json or binary");
+  }
+  int zoom = -1;
+  if (auto text = request.query("zoom")) {
+    zoom = parse_number<int>(*text, "zoom");
+    if (zoom < 0 || zoom > kMaxRouteZoom) {
+      throw std::invalid_argument("zoom must be 0-" + std::to_string(kMaxRouteZoom));
+    }
+  }
+  std::filesystem::path file = metadata_dir_ / std::string(video_id) / kGpsFile;
+  std::optional<std::string> same_as;
+  if (!std::filesystem::exists(file) && links_ != nullptr) {
+    same_as = links_->original_of(std::string(video_id));
+    if (same_as) {
+      file = metadata_dir_ / *same_as / kGpsFile;
+    }
+  }
+  if (!std::filesystem::exists(file)) {
+    return http::error_response(404, "no gps for " + std::string(video_id));
+  }
+  GpsTable gps(file);
+  std::vector<std::uint32_t> rows = simplify_route(gps, zoom);
+  if (format == "binary") {
+    http::Response response;
+    response.content_type = "application/octet-stream";
+    response.body = encode_route(gps, rows);
+    return response;
+  }
+  Json::Value out = route_json(gps, rows);
+  out["video_id"] = std::string(video_id);
+  out["fixes"] = Json::UInt64(gps.size());
+  if (same_as) {
+    out["same_as"] = *same_as;
+  }
+  return http::json_response(200, to_json_string(out));
+}
+
+http::Response MetadataApi::stats(const http::Request& request) {
+  std::int64_t to = request.query_seconds_us("to").value_or(unix_millis() * 1000);
+  std::int64_t from = request.query_seconds_us("from").value_or(
+      std::max(to, std::numeric_limits<std::int64_t>::min() + kDefaultActivityUs) -
+      kDefaultActivityUs);
+  std::size_t recent = kDefaultRecent;
+  if (auto text = request.query("recent")) {
+    recent = parse_number<std::size_t>(*text, "recent");
+    if (recent > kMaxRecent) {
+      throw std::invalid_argument("recent must be 0-" + std::to_string(kMaxRecent));
+    }
+  }
+  Json::Value out(Json::objectValue);
+  out["totals"] = to_json(index_.stats());
+  Json::Value& days = out["days"] = Json::Value(Json::arrayValue);
+  for (const DayActivity& day : index_.activity(from, to)) {
+    Json::Value item(Json::objectValue);
+    item["day_us"] = Json::Int64(day.day_us);
+    item["videos"] = Json::Int64(day.videos);
+    item["sightings"] = Json::Int64(day.sightings);
+    days.append(item);
+  }
+  Json::Value& plates = out["recent_plates"] = Json::Value(Json::arrayValue);
+  for (const PlateMatch& plate : index_.recent_plates(recent)) {
+    plates.append(to_json(plate));
+  }
+  return http::json_response(200, to_json_string(out));
+}
+
+}  // namespace dashcam::server
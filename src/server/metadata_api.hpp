@@ -0,0 +1,64 @@
+#pragma once
+
+#include <filesystem>
+#include <optional>
+#include <string>
+
+#include <json/value.h>
+
+#include "common/http/http_message.hpp"
+#include "server/sighting_index.hpp"
+#include "server/task_store.hpp"
+
+namespace dashcam::server {
+
+// Per-video metadata for the WebUI (web_ui_overview.md §4.1):
+//
+//   GET /videos/list?limit=N&cursor=C   -> {"videos": [...], "next_cursor"}
+//   GET /gps/<video_id>?format=json|binary&zoom=Z
+//   GET /stats?from=T&to=T&recent=N     -> {"totals", "days", "recent_plates"}
+//
+// The list is newest first, `limit` 100 by default and at most 1000; pass
+// `next_cursor` back as `cursor` for the next page (null after the last).
+// Cursors are keyset positions, not offsets: a page costs the same however
+// deep it is, and videos finalized meanwhile do not shift the pages.
+//
+// /gps returns the video's gps.dcol from the metadata directory, JSON
+// (route_json) by default or binary (encode_route); with `zoom` (0-22) it
+// is simplified for drawing at that zoom (simplify_route).
+//
+// Videos linked at ingestion as copies of another (TaskStore::ingest) have
+// no metadata of their own. With `links`, the list shows them under the
+// video they copy as `"copies"`, and /gps/<copy> serves that video's route
+// with `"same_as"` naming it.
+//
+// /stats is the dashboard (§3.1): archive totals, videos and sightings per
+// recording day from `from` to `to` (UTC seconds; the last 30 days by
+// default) and the `recent` (20, at most 100) most recently seen plates.
+class MetadataApi {
+ public:
+  MetadataApi(SightingIndex& index, std::filesystem::path metadata_dir,
+              TaskStore* links = nullptr)
+      : index_(index), metadata_dir_(std::move(metadata_dir)), links_(links) {}
+
+  // Empty when the request is not for a metadata route.
+  std::optional<http::Response> handle(const http::Request& request);
+
+ private:
+  http::Response list_videos(const http::Request& request);
+  http::Response gps(const http::Request& request, std::string_view video_id);
+  http::Response stats(const http::Request& request);
+
+  SightingIndex& index_;
+  std::filesystem::path metadata_dir_;
+  TaskStore* links_;
+};
+
+Json::Value to_json(const VideoRecord& video);
+Json::Value to_json(const IndexStats& stats);
+
+// "<recorded_us>:<video_id>"; parse_cursor throws std::invalid_argument.
+std::string format_cursor(const VideoCursor& cursor);
+VideoCursor parse_cursor(std::string_view text);
+
+}  // namespace dashcam::server
@@ -0,0 +1,24 @@
+#include "server/metrics_api.hpp"
+
+#include <string>
+
+namespace dashcam::server {
+
+std::optional<http::Response> MetricsApi::handle(const http::Request& request) {
+  std::string_view path = request.path();
+  if (path != "/metrics" && path != "/debug/trace") {
+    return std::nullopt;
+  }
+  if (request.method != "GET") {
+    return http::error_response(405, "GET only");
+  }
+  if (path == "/metrics") {
+    http::Response response;
+    response.content_type = std::string(kPrometheusContentType);
+    response.body = metrics_.render_prometheus();
+    return response;
+  }
+  return http::json_response(200, trace_.chrome_trace_json("dashcam-server"));
+}
+
+}  // namespace dashcam::server
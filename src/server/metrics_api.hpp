@@ -0,0 +1,32 @@
+#pragma once
+
+#include <optional>
+
+#include "common/http/http_message.hpp"
+#include "common/metrics.hpp"
+#include "common/trace.hpp"
+
+namespace dashcam::server {
+
+// Observability endpoints:
+//
+//   GET /metrics       -> Prometheus text exposition of `metrics`
+//   GET /debug/trace   -> the server's recent spans as a Chrome trace (load
+//                         it in Perfetto or chrome://tracing)
+//
+// The trace ring holds the latest spans of every request thread (task
+// pulls and completions, their store transactions), overwritten oldest
+// first.
+class MetricsApi {
+ public:
+  MetricsApi(MetricsRegistry& metrics, TraceBuffer& trace) : metrics_(metrics), trace_(trace) {}
+
+  // Empty when the request is not for one of the routes above.
+  std::optional<http::Response> handle(const http::Request& request);
+
+ private:
+  MetricsRegistry& metrics_;
+  TraceBuffer& trace_;
+};
+
+}  // namespace dashcam::server
@@ -0,0 +1,144 @@
+#include "server/search_api.hpp"
+
+#include <charconv>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "common/json_util.hpp"
+
+namespace dashcam::server {
+
+namespace {
+
+template <typename T>
+T parse_number(std::string_view text, const char* what) {
+  T value{};
+  auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+  if (ec != std::errc() || end != text.data() + text.size()) {
+    throw std::invalid_argument(std::string("bad ") + what + ": " + std::string(text));
+  }
+  return value;
+}
+
+void parse_bbox(std::string_view text, SightingQuery& q) {
+  std::vector<double> values;
+  while (true) {
+    std::size_t comma = text.find(',');
+    values.push_back(parse_number<double>(text.substr(0, comma), "bbox"));
+    if (comma == std::string_view::npos) {
+      break;
+    }
+    text.remove_prefix(comma + 1);
+  }
+  if (values.size() != 4 || values[0] > values[2] || values[0] < -90.0 || values[2] > 90.0 ||
+      values[1] < -180.0 || values[1] > 180.0 || values[3] < -180.0 || values[3] > 180.0) {
+    throw std::invalid_argument("bbox must be south,west,north,east in degrees");
+  }
+  q.south = values[0];
+  q.west = values[1];
+  q.north = values[2];
+  q.east = values[3];
+}
+
+}  // namespace
+
+Json::Value to_json(const Sighting& s) {
+  Json::Value out(Json::objectValue);
+  out["sighting_id"] = Json::Int64(s.sighting_id);
+  out["video_id"] = s.video_id;
+  out["track_id"] = s.track_id;
+  out["plate"] = s.plate;
+  out["share"] = s.share;
+  out["reads"] = s.reads;
+  out["frame"] = Json::Int64(s.frame);
+  out["t_us"] = s.t_us ? Json::Value(Json::Int64(*s.t_us)) : Json::Value();
+  out["lat"] = s.lat ? Json::Value(*s.lat) : Json::Value();
+  out["lon"] = s.lon ? Json::Value(*s.lon) : Json::Value();
+  return out;
+}
+
+Json::Value to_json(const PlateMatch& m) {
+  Json::Value out(Json::objectValue);
+  out["plate"] = m.plate;
+  out["distance"] = m.distance;
+  out["sightings"] = Json::Int64(m.sightings);
+  out["share_sum"] = m.share_sum;
+  out["best_share"] = m.best_share;
+  out["videos"] = Json::Int64(m.videos);
+  out["first_us"] = m.first_us ? Json::Value(Json::Int64(*m.first_us)) : Json::Value();
+  out["last_us"] = m.last_us ? Json::Value(Json::Int64(*m.last_us)) : Json::Value();
+  return out;
+}
+
+std::optional<http::Response> SearchApi::handle(const http::Request& request) {
+  if (request.path() != "/search") {
+    return std::nullopt;
+  }
+  if (request.method != "GET") {
+    return http::error_response(405, "GET only");
+  }
+  try {
+    SightingQuery q;
+    if (auto bbox = request.query("bbox")) {
+      parse_bbox(*bbox, q);
+    }
+    if (auto from = request.query_seconds_us("from")) {
+      q.from_us = *from;
+    }
+    if (auto to = request.query_seconds_us("to")) {
+      // Inclusive of the whole last second.
+      q.to_us = *to + 999999;
+    }
+    if (auto limit = request.query("limit")) {
+      q.limit = parse_number<std::size_t>(*limit, "limit");
+      if (q.limit < 1 || q.limit > kMaxLimit) {
+        throw std::invalid_argument("limit must be 1-" + std::to_string(kMaxLimit));
+      }
+    }
+
+    Json::Value out(Json::objectValue);
+    SightingResult result;
+    if (auto text = request.query("plate")) {
+      PlateQuery pq;
+      pq.text = *text;
+      if (auto distance = request.query("max_distance")) {
+        pq.max_distance = parse_number<double>(*distance, "max_distance");
+        if (!(pq.max_distance >= 0.0 && pq.max_distance <= kMaxDistance)) {
+          throw std::invalid_argument("max_distance must be 0-3");
+        }
+      }
+      if (auto plates = request.query("plates")) {
+        pq.limit = parse_number<std::size_t>(*plates, "plates");
+        if (pq.limit < 1 || pq.limit > kMaxPlates) {
+          throw std::invalid_argument("plates must be 1-" + std::to_string(kMaxPlates));
+        }
+      }
+      Json::Value plates(Json::arrayValue);
+      for (const PlateMatch& match : sightings_.match_plates(pq)) {
+        plates.append(to_json(match));
+        for (Sighting& s : sightings_.plate_sightings(match.plate, q)) {
+          if (result.sightings.size() == q.limit) {
+            result.truncated = true;
+            break;
+          }
+          result.sightings.push_back(std::move(s));
+        }
+      }
+      out["plates"] = plates;
+    } else {
+      result = sightings_.query(q);
+    }
+    Json::Value sightings(Json::arrayValue);
+    for (const Sighting& s : result.sightings) {
+      sightings.append(to_json(s));
+    }
+    out["sightings"] = sightings;
+    out["truncated"] = result.truncated;
+    return http::json_response(200, to_json_string(out));
+  } catch (const std::invalid_argument& e) {
+    return http::error_response(400, e.what());
+  }
+}
+
+}  // namespace dashcam::server
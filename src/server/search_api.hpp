@@ -0,0 +1,44 @@
+#pragma once
+
+#include <optional>
+
+#include "common/http/http_message.hpp"
+#include "server/sighting_index.hpp"
+
+namespace dashcam::server {
+
+// Sighting search for the WebUI Map and Search Views (web_ui_overview.md
+// §3.5-3.6, §4.1):
+//
+//   GET /search?bbox=south,west,north,east&from=T&to=T&limit=N
+//                                    -> {"sightings": [Sighting...], "truncated"}
+//   GET /search?plate=TEXT&max_distance=D&plates=N&...
+//                -> {"plates": [PlateMatch...], "sightings": [...], "truncated"}
+//
+// bbox is in degrees (west > east crosses the antimeridian) and defaults to
+// the whole world; from and to are UTC seconds since the epoch, inclusive;
+// limit defaults to 1000 (at most 10000). Sightings come oldest first.
+//
+// With `plate`, the search is fuzzy over plate texts: up to `plates` (20)
+// texts within `max_distance` (1, at most 3) ranked as by
+// SightingIndex::match_plates, then their sightings in that order, narrowed
+// by bbox and dates when given.
+class SearchApi {
+ public:
+  static constexpr std::size_t kMaxLimit = 10000;
+  static constexpr std::size_t kMaxPlates = 100;
+  static constexpr double kMaxDistance = 3.0;
+
+  explicit SearchApi(SightingIndex& sightings) : sightings_(sightings) {}
+
+  // Empty when the request is not for a search route.
+  std::optional<http::Response> handle(const http::Request& request);
+
+ private:
+  SightingIndex& sightings_;
+};
+
+Json::Value to_json(const Sighting& sighting);
+Json::Value to_json(const PlateMatch& match);
+
+}  // namespace dashcam::server
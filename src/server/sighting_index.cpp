@@ -0,0 +1,1025 @@
+#include "server/sighting_index.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <map>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+
+#include "common/detection_columns.hpp"
+#include "common/plate_text.hpp"
+
+namespace dashcam::server {
+
+namespace {
+
+// Schema 2 adds the plate text index: per distinct text its sighting
+// count and confidence, and an inverted index of its folded bigrams.
+// Schema 3 adds tile_bins, the heatmap pyramid; schema 4 the video list;
+// schema 5 per-text trip counts and first/last sightings, and the dashboard
+// counters.
+constexpr int kSchemaVersion = 5;
+
+constexpr const char* kSchema = R"sql(
+CREATE TABLE IF NOT EXISTS sightings (
+  sighting_id  INTEGER PRIMARY KEY,
+  video_id     TEXT NOT NULL,
+  track_id     INTEGER NOT NULL,
+  plate        TEXT NOT NULL,
+  share        REAL NOT NULL,
+  reads        INTEGER NOT NULL,
+  frame        INTEGER NOT NULL,
+  t_us         INTEGER,
+  lat          REAL,
+  lon          REAL
+);
+CREATE INDEX IF NOT EXISTS sightings_by_video ON sightings (video_id, track_id);
+
+CREATE TABLE IF NOT EXISTS sighting_cells (
+  bucket       INTEGER NOT NULL,
+  cell         INTEGER NOT NULL,
+  t_us         INTEGER NOT NULL,
+  sighting_id  INTEGER NOT NULL,
+  lat          REAL NOT NULL,
+  lon          REAL NOT NULL,
+  PRIMARY KEY (bucket, cell, t_us, sighting_id)
+) WITHOUT ROWID;
+
+-- A text's timeline, and its best share and first and last sighting as
+-- single seeks.
+CREATE INDEX IF NOT EXISTS sightings_by_plate_time ON sightings (plate, t_us);
+CREATE INDEX IF NOT EXISTS sightings_by_plate_share ON sightings (plate, share);
+CREATE TABLE IF NOT EXISTS plates (
+  plate        TEXT PRIMARY KEY,
+  length       INTEGER NOT NULL,
+  sightings    INTEGER NOT NULL,
+  share_sum    REAL NOT NULL,
+  best_share   REAL NOT NULL,
+  videos       INTEGER NOT NULL DEFAULT 0,
+  first_us     INTEGER,
+  last_us      INTEGER
+) WITHOUT ROWID;
+CREATE INDEX IF NOT EXISTS plates_by_length ON plates (length);
+CREATE INDEX IF NOT EXISTS plates_by_last_seen ON plates (last_us);
+CREATE TABLE IF NOT EXISTS plate_grams (
+  gram         TEXT NOT NULL,
+  plate        TEXT NOT NULL,
+  PRIMARY KEY (gram, plate)
+) WITHOUT ROWID;
+
+CREATE TABLE IF NOT EXISTS tile_bins (
+  level        INTEGER NOT NULL,
+  code         INTEGER NOT NULL,
+  day          INTEGER NOT NULL,
+  count        INTEGER NOT NULL,
+  PRIMARY KEY (level, code, day)
+) WITHOUT ROWID;
+
+CREATE TABLE IF NOT EXISTS videos (
+  video_id     TEXT PRIMARY KEY,
+  recorded_us  INTEGER NOT NULL,
+  start_us     INTEGER,
+  finalized_ms INTEGER NOT NULL,
+  frames       INTEGER NOT NULL,
+  plates       INTEGER NOT NULL,
+  gps_fixes    INTEGER NOT NULL
+) WITHOUT ROWID;
+CREATE INDEX IF NOT EXISTS videos_by_time ON videos (recorded_us, video_id);
+
+CREATE TABLE IF NOT EXISTS counters (
+  name         TEXT PRIMARY KEY,
+  value        INTEGER NOT NULL
+) WITHOUT ROWID;
+-- Videos and their sightings by the UTC day the video was recorded.
+CREATE TABLE IF NOT EXISTS activity_days (
+  day          INTEGER PRIMARY KEY,
+  videos       INTEGER NOT NULL,
+  sightings    INTEGER NOT NULL
+);
+)sql";
+
+constexpr const char* kCounterNames[] = {"videos",    "frames",  "gps_fixes",
+                                         "sightings", "located", "plates"};
+
+constexpr std::int64_t kBucketUs = 30LL * 24 * 3600 * 1000000;
+constexpr std::int64_t kDayUs = 24LL * 3600 * 1000000;
+constexpr std::uint32_t kGridMax = (1u << detail::kCellBits) - 1;
+
+std::int64_t floor_div(std::int64_t a, std::int64_t b) {
+  std::int64_t q = a / b;
+  return a < 0 && a % b != 0 ? q - 1 : q;
+}
+
+std::int64_t bucket_of(std::int64_t t_us) { return floor_div(t_us, kBucketUs); }
+
+std::uint32_t grid(double value, double low, double range) {
+  double g = std::floor((value - low) / range * static_cast<double>(kGridMax + 1));
+  return static_cast<std::uint32_t>(std::clamp(g, 0.0, static_cast<double>(kGridMax)));
+}
+
+std::uint32_t grid_x(double lon) { return grid(lon, -180.0, 360.0); }
+std::uint32_t grid_y(double lat) { return grid(lat, -90.0, 180.0); }
+
+// Spreads the low 32 bits of `v` over the even bits.
+std::uint64_t spread(std::uint32_t v) {
+  std::uint64_t x = v;
+  x = (x | (x << 16)) & 0x0000FFFF0000FFFFull;
+  x = (x | (x << 8)) & 0x00FF00FF00FF00FFull;
+  x = (x | (x << 4)) & 0x0F0F0F0F0F0F0F0Full;
+  x = (x | (x << 2)) & 0x3333333333333333ull;
+  x = (x | (x << 1)) & 0x5555555555555555ull;
+  return x;
+}
+
+std::uint64_t morton(std::uint32_t x, std::uint32_t y) { return spread(x) | (spread(y) << 1); }
+
+// Inverse of spread(): the even bits of `x` packed together.
+std::uint32_t compact(std::uint64_t x) {
+  x &= 0x5555555555555555ull;
+  x = (x | (x >> 1)) & 0x3333333333333333ull;
+  x = (x | (x >> 2)) & 0x0F0F0F0F0F0F0F0Full;
+  x = (x | (x >> 4)) & 0x00FF00FF00FF00FFull;
+  x = (x | (x >> 8)) & 0x0000FFFF0000FFFFull;
+  x = (x | (x >> 16)) & 0x00000000FFFFFFFFull;
+  return static_cast<std::uint32_t>(x);
+}
+
+// (level, bin code, day) -> change in count, summed over a video first so
+// re-finalizing it unchanged writes nothing.
+using TileDelta = std::map<std::tuple<int, std::uint64_t, std::int64_t>, std::int64_t>;
+
+void add_to_tiles(TileDelta& delta, double lat, double lon, std::int64_t t_us, int sign) {
+  std::int64_t day = floor_div(t_us, kDayUs);
+  for (int z = 0; z <= kMaxTileZoom; ++z) {
+    int level = z + kTileBinBits;
+    auto [x, y] = detail::mercator_bin(lat, lon, level);
+    delta[{level, morton(x, y), day}] += sign;
+  }
+}
+
+void apply_tiles(Database& db, const TileDelta& delta) {
+  Statement add(db, "INSERT INTO tile_bins (level, code, day, count) VALUES (?, ?, ?, ?) "
+                    "ON CONFLICT (level, code, day) DO UPDATE SET count = count + excluded.count");
+  Statement prune(db, "DELETE FROM tile_bins WHERE level = ? AND code = ? AND day = ? AND "
+                      "count <= 0");
+  for (const auto& [key, change] : delta) {
+    if (change == 0) {
+      continue;
+    }
+    const auto& [level, code, day] = key;
+    add.bind(1, static_cast<std::int64_t>(level))
+        .bind(2, static_cast<std::int64_t>(code))
+        .bind(3, day)
+        .bind(4, change)
+        .run();
+    add.reset();
+    if (change < 0) {
+      prune.bind(1, static_cast<std::int64_t>(level))
+          .bind(2, static_cast<std::int64_t>(code))
+          .bind(3, day)
+          .run();
+      prune.reset();
+    }
+  }
+}
+
+void bind_optional(Statement& s, int index, const std::optional<double>& value) {
+  if (value) {
+    s.bind(index, *value);
+  } else {
+    s.bind_null(index);
+  }
+}
+
+Sighting read_sighting(const Statement& s) {
+  Sighting out;
+  out.sighting_id = s.column_int(0);
+  out.video_id = s.column_text(1);
+  out.track_id = static_cast<int>(s.column_int(2));
+  out.plate = s.column_text(3);
+  out.share = s.column_double(4);
+  out.reads = static_cast<int>(s.column_int(5));
+  out.frame = s.column_int(6);
+  out.t_us = s.column_optional_int(7);
+  if (!s.column_is_null(8) && !s.column_is_null(9)) {
+    out.lat = s.column_double(8);
+    out.lon = s.column_double(9);
+  }
+  return out;
+}
+
+constexpr const char* kSightingColumns =
+    "sighting_id, video_id, track_id, plate, share, reads, frame, t_us, lat, lon";
+
+constexpr const char* kPlateColumns =
+    "plate, sightings, share_sum, best_share, videos, first_us, last_us";
+
+PlateMatch read_plate(const Statement& s) {
+  PlateMatch out;
+  out.plate = s.column_text(0);
+  out.sightings = s.column_int(1);
+  out.share_sum = s.column_double(2);
+  out.best_share = s.column_double(3);
+  out.videos = s.column_int(4);
+  out.first_us = s.column_optional_int(5);
+  out.last_us = s.column_optional_int(6);
+  return out;
+}
+
+bool whole_world(const SightingQuery& q) {
+  return q.south <= -90.0 && q.north >= 90.0 && q.west <= -180.0 && q.east >= 180.0;
+}
+
+bool in_query(const SightingQuery& q, double lat, double lon, std::int64_t t) {
+  bool in_lon = q.west > q.east ? lon >= q.west || lon <= q.east : lon >= q.west && lon <= q.east;
+  return in_lon && lat >= q.south && lat <= q.north && (!q.from_us || t >= *q.from_us) &&
+         (!q.to_us || t <= *q.to_us);
+}
+
+void index_grams(Database& db, const std::string& plate) {
+  Statement add_gram(db, "INSERT OR IGNORE INTO plate_grams (gram, plate) VALUES (?, ?)");
+  for (const std::string& gram : plate_grams(fold_confusables(plate))) {
+    add_gram.bind(1, std::string_view(gram)).bind(2, std::string_view(plate)).run();
+    add_gram.reset();
+  }
+}
+
+// When and how well one video saw a text: what the text's first_us, last_us
+// and best_share are taken from.
+struct PlateSpan {
+  std::optional<std::int64_t> first_us;
+  std::optional<std::int64_t> last_us;
+  double best_share = 0.0;
+
+  bool operator==(const PlateSpan&) const = default;
+};
+
+// A video's contribution to one text's totals, or the change in it. The
+// spans before and after tell a re-finalize that only moved the video's
+// sightings in time (a corrected clock) from one that changed nothing.
+struct PlateChange {
+  std::int64_t sightings = 0;
+  double share_sum = 0.0;
+  std::int64_t videos = 0;
+  PlateSpan before;
+  PlateSpan after;
+};
+using PlateDelta = std::map<std::string, PlateChange>;
+
+// Applies the changes to the texts' rows in `plates` and their bigrams,
+// adding or dropping a text as it gains its first sighting or loses its
+// last. Counts and share sums move by the delta; the best share and the
+// first and last sighting are one seek each on the (plate, share) and
+// (plate, t_us) indexes. So the cost depends on the texts the video
+// touches, not on how often they were seen before. Returns the change in
+// the number of distinct texts.
+std::int64_t apply_plates(Database& db, const PlateDelta& delta) {
+  Statement current(db, "SELECT sightings, share_sum, videos FROM plates WHERE plate = ?");
+  Statement best(db, "SELECT MAX(share) FROM sightings WHERE plate = ?");
+  Statement first(db, "SELECT MIN(t_us) FROM sightings WHERE plate = ?");
+  Statement last(db, "SELECT MAX(t_us) FROM sightings WHERE plate = ?");
+  Statement upsert(db, "INSERT OR REPLACE INTO plates (plate, length, sightings, share_sum, "
+                       "best_share, videos, first_us, last_us) VALUES (?, ?, ?, ?, ?, ?, ?, ?)");
+  Statement drop(db, "DELETE FROM plates WHERE plate = ?");
+  Statement drop_gram(db, "DELETE FROM plate_grams WHERE gram = ? AND plate = ?");
+  std::int64_t texts = 0;
+  for (const auto& [plate, change] : delta) {
+    if (change.sightings == 0 && change.share_sum == 0.0 && change.videos == 0 &&
+        change.before == change.after) {
+      continue;  // re-finalized unchanged
+    }
+    PlateChange total = change;
+    current.bind(1, std::string_view(plate));
+    bool indexed = current.step();
+    if (indexed) {
+      total.sightings += current.column_int(0);
+      total.share_sum += current.column_double(1);
+      total.videos += current.column_int(2);
+    }
+    current.reset();
+    if (total.sightings <= 0) {
+      if (indexed) {
+        drop.bind(1, std::string_view(plate)).run();
+        drop.reset();
+        for (const std::string& gram : plate_grams(fold_confusables(plate))) {
+          drop_gram.bind(1, std::string_view(gram)).bind(2, std::string_view(plate)).run();
+          drop_gram.reset();
+        }
+        --texts;
+      }
+      continue;
+    }
+    if (!indexed) {
+      index_grams(db, plate);
+      ++texts;
+    }
+    auto seek = [&](Statement& s) {
+      s.bind(1, std::string_view(plate));
+      s.step();
+      std::optional<std::int64_t> value = s.column_optional_int(0);
+      double share = s.column_is_null(0) ? 0.0 : s.column_double(0);
+      s.reset();
+      return std::make_pair(value, share);
+    };
+    upsert.bind(1, std::string_view(plate))
+        .bind(2, static_cast<std::int64_t>(plate.size()))
+        .bind(3, total.sightings)
+        .bind(4, std::max(0.0, total.share_sum))
+        .bind(5, seek(best).second)
+        .bind(6, total.videos);
+    if (auto [t, unused] = seek(first); t) {
+      upsert.bind(7, *t);
+    } else {
+      upsert.bind_null(7);
+    }
+    if (auto [t, unused] = seek(last); t) {
+      upsert.bind(8, *t);
+    } else {
+      upsert.bind_null(8);
+    }
+    upsert.run();
+    upsert.reset();
+  }
+  return texts;
+}
+
+void add_to_counter(Database& db, const char* name, std::int64_t change) {
+  if (change == 0) {
+    return;
+  }
+  Statement add(db, "INSERT INTO counters (name, value) VALUES (?, ?) "
+                    "ON CONFLICT (name) DO UPDATE SET value = value + excluded.value");
+  add.bind(1, std::string_view(name)).bind(2, change).run();
+}
+
+void add_to_day(Database& db, std::int64_t recorded_us, std::int64_t videos,
+                std::int64_t sightings) {
+  std::int64_t day = floor_div(recorded_us, kDayUs);
+  Statement add(db, "INSERT INTO activity_days (day, videos, sightings) VALUES (?, ?, ?) "
+                    "ON CONFLICT (day) DO UPDATE SET videos = videos + excluded.videos, "
+                    "sightings = sightings + excluded.sightings");
+  add.bind(1, day).bind(2, videos).bind(3, sightings).run();
+  if (videos < 0) {
+    Statement prune(db, "DELETE FROM activity_days WHERE day = ? AND videos <= 0");
+    prune.bind(1, day).run();
+  }
+}
+
+}  // namespace
+
+namespace detail {
+
+std::uint64_t cell_of(double lat, double lon) { return morton(grid_x(lon), grid_y(lat)); }
+
+std::pair<std::uint32_t, std::uint32_t> mercator_bin(double lat, double lon, int level) {
+  constexpr double kPi = 3.14159265358979323846;
+  constexpr double kMaxLat = 85.05112877980659;
+  double n = std::ldexp(1.0, level);
+  double phi = std::clamp(lat, -kMaxLat, kMaxLat) * kPi / 180.0;
+  double fx = (lon + 180.0) / 360.0;
+  double fy = (1.0 - std::log(std::tan(phi) + 1.0 / std::cos(phi)) / kPi) / 2.0;
+  auto clamp = [&](double f) {
+    return static_cast<std::uint32_t>(std::clamp(std::floor(f * n), 0.0, n - 1.0));
+  };
+  return {clamp(fx), clamp(fy)};
+}
+
+std::vector<std::pair<std::uint64_t, std::uint64_t>> cover_box(double south, double west,
+                                                               double north, double east,
+                                                               int max_cells) {
+  std::uint32_t x0 = grid_x(west), x1 = grid_x(east);
+  std::uint32_t y0 = grid_y(south), y1 = grid_y(north);
+  // The finest level at which the box spans at most max_cells cells; each
+  // of those is one run of codes at full resolution.
+  int shift = 0;
+  while (shift < kCellBits &&
+         static_cast<std::uint64_t>((x1 >> shift) - (x0 >> shift) + 1) *
+                 ((y1 >> shift) - (y0 >> shift) + 1) >
+             static_cast<std::uint64_t>(max_cells)) {
+    ++shift;
+  }
+  std::vector<std::pair<std::uint64_t, std::uint64_t>> runs;
+  for (std::uint32_t y = y0 >> shift; y <= y1 >> shift; ++y) {
+    for (std::uint32_t x = x0 >> shift; x <= x1 >> shift; ++x) {
+      std::uint64_t code = morton(x, y);
+      runs.emplace_back(code << (2 * shift), (code + 1) << (2 * shift));
+    }
+  }
+  std::sort(runs.begin(), runs.end());
+  std::vector<std::pair<std::uint64_t, std::uint64_t>> merged;
+  for (const auto& run : runs) {
+    if (!merged.empty() && merged.back().second == run.first) {
+      merged.back().second = run.second;
+    } else {
+      merged.push_back(run);
+    }
+  }
+  return merged;
+}
+
+}  // namespace detail
+
+VideoRecord video_record_from_summary(const std::string& video_id, const Json::Value& summary,
+                                      std::int64_t finalized_ms) {
+  VideoRecord out;
+  out.video_id = video_id;
+  if (summary["gps"]["start_utc_us"].isIntegral()) {
+    out.start_utc_us = summary["gps"]["start_utc_us"].asInt64();
+  }
+  out.finalized_ms = finalized_ms;
+  out.frames = summary["frames_decoded"].asInt64();
+  out.plates = static_cast<int>(summary["plates"].size());
+  out.gps_fixes = summary["gps"]["fixes"].asInt64();
+  return out;
+}
+
+std::vector<Sighting> sightings_from_summary(const std::string& video_id,
+                                             const Json::Value& summary,
+                                             const DetectionTable* detections) {
+  std::vector<Sighting> out;
+  std::unordered_map<int, std::size_t> by_track;
+  std::vector<std::int64_t> best_frame;
+  for (const Json::Value& plate : summary["plates"]) {
+    Sighting s;
+    s.video_id = video_id;
+    s.track_id = plate["track_id"].asInt();
+    s.plate = normalize_plate(plate["text"].asString());
+    s.share = plate["share"].asDouble();
+    s.reads = plate["reads"].asInt();
+    s.frame = plate["best_frame"].asInt64();
+    by_track[s.track_id] = out.size();
+    best_frame.push_back(s.frame);
+    out.push_back(std::move(s));
+  }
+  if (detections == nullptr || out.empty()) {
+    return out;
+  }
+
+  const Json::Value& start = summary["gps"]["start_utc_us"];
+  // Per sighting, the detection nearest its best frame, and the nearest one
+  // with a fix.
+  struct Nearest {
+    std::int64_t distance = INT64_MAX;
+    std::size_t row = 0;
+  };
+  std::vector<Nearest> any(out.size()), located(out.size());
+  auto frame = detections->frame();
+  auto track = detections->track();
+  auto lat = detections->lat();
+  for (std::size_t i = 0; i < detections->size(); ++i) {
+    if (track[i] < 0) {
+      continue;
+    }
+    auto it = by_track.find(track[i]);
+    if (it == by_track.end()) {
+      continue;
+    }
+    std::size_t k = it->second;
+    std::int64_t distance = std::llabs(frame[i] - best_frame[k]);
+    if (distance < any[k].distance) {
+      any[k] = {distance, i};
+    }
+    if (!std::isnan(lat[i]) && distance < located[k].distance) {
+      located[k] = {distance, i};
+    }
+  }
+  auto pts = detections->pts_us();
+  auto lon = detections->lon();
+  for (std::size_t k = 0; k < out.size(); ++k) {
+    const Nearest& pick = located[k].distance != INT64_MAX ? located[k] : any[k];
+    if (pick.distance == INT64_MAX) {
+      continue;
+    }
+    out[k].frame = frame[pick.row];
+    if (start.isIntegral()) {
+      out[k].t_us = start.asInt64() + pts[pick.row];
+    }
+    if (&pick == &located[k]) {
+      out[k].lat = lat[pick.row];
+      out[k].lon = lon[pick.row];
+    }
+  }
+  return out;
+}
+
+SightingIndex::SightingIndex(const std::filesystem::path& path) : db_(path) {
+  // Queries from the HTTP threads read while the finalizer writes.
+  db_.exec("PRAGMA journal_mode = WAL");
+  db_.exec("PRAGMA synchronous = NORMAL");
+  migrate();
+}
+
+void SightingIndex::migrate() {
+  std::int64_t current = 0;
+  {
+    Statement version(db_, "PRAGMA user_version");
+    version.step();
+    current = version.column_int(0);
+  }
+  if (current > kSchemaVersion) {
+    throw std::runtime_error("sighting index schema " + std::to_string(current) +
+                             " is newer than this server (" + std::to_string(kSchemaVersion) +
+                             ")");
+  }
+  if (current == kSchemaVersion) {
+    return;
+  }
+  Transaction tx(db_);
+  // Before the schema script, which indexes the new columns.
+  if (current >= 2 && current < 5) {
+    db_.exec("ALTER TABLE plates ADD COLUMN videos INTEGER NOT NULL DEFAULT 0");
+    db_.exec("ALTER TABLE plates ADD COLUMN first_us INTEGER");
+    db_.exec("ALTER TABLE plates ADD COLUMN last_us INTEGER");
+    db_.exec("DROP INDEX IF EXISTS sightings_by_plate");
+  }
+  db_.exec(kSchema);
+  if (current >= 1 && current < 2) {
+    std::vector<std::string> texts;
+    Statement all(db_, "SELECT DISTINCT plate FROM sightings WHERE plate != ''");
+    while (all.step()) {
+      texts.push_back(all.column_text(0));
+    }
+    for (const std::string& plate : texts) {
+      index_grams(db_, plate);
+    }
+  }
+  if (current >= 1 && current < 3) {
+    TileDelta delta;
+    Statement all(db_, "SELECT lat, lon, t_us FROM sighting_cells");
+    while (all.step()) {
+      add_to_tiles(delta, all.column_double(0), all.column_double(1), all.column_int(2), 1);
+    }
+    apply_tiles(db_, delta);
+  }
+  if (current >= 1 && current < 4) {
+    // Only what the sightings tell; finalizing a video again fills in the
+    // rest.
+    db_.exec("INSERT OR IGNORE INTO videos (video_id, recorded_us, start_us, finalized_ms, "
+             "frames, plates, gps_fixes) SELECT video_id, COALESCE(MIN(t_us), 0), NULL, 0, 0, "
+             "COUNT(*), 0 FROM sightings GROUP BY video_id");
+  }
+  if (current >= 1 && current < 5) {
+    // The one full pass; every later video only applies its own delta.
+    db_.exec("DELETE FROM plates");
+    db_.exec("INSERT INTO plates (plate, length, sightings, share_sum, best_share, videos, "
+             "first_us, last_us) SELECT plate, length(plate), COUNT(*), TOTAL(share), "
+             "MAX(share), COUNT(DISTINCT video_id), MIN(t_us), MAX(t_us) FROM sightings "
+             "WHERE plate != '' GROUP BY plate");
+    db_.exec("DELETE FROM counters");
+    db_.exec("INSERT INTO counters (name, value) SELECT 'videos', COUNT(*) FROM videos "
+             "UNION ALL SELECT 'frames', TOTAL(frames) FROM videos "
+             "UNION ALL SELECT 'gps_fixes', TOTAL(gps_fixes) FROM videos "
+             "UNION ALL SELECT 'sightings', COUNT(*) FROM sightings "
+             "UNION ALL SELECT 'located', COUNT(*) FROM sighting_cells "
+             "UNION ALL SELECT 'plates', COUNT(*) FROM plates");
+    db_.exec("DELETE FROM activity_days");
+    db_.exec(("INSERT INTO activity_days (day, videos, sightings) SELECT day, COUNT(*), "
+              "TOTAL(n) FROM (SELECT (v.recorded_us - ((v.recorded_us % " +
+              std::to_string(kDayUs) + ") + " + std::to_string(kDayUs) + ") % " +
+              std::to_string(kDayUs) + ") / " + std::to_string(kDayUs) +
+              " AS day, (SELECT COUNT(*) FROM sightings s WHERE s.video_id = v.video_id) AS n "
+              "FROM videos v) GROUP BY day")
+                 .c_str());
+  }
+  db_.exec(("PRAGMA user_version = " + std::to_string(kSchemaVersion)).c_str());
+  tx.commit();
+}
+
+void SightingIndex::replace_video(const VideoRecord& video, std::span<const Sighting> sightings) {
+  const std::string& video_id = video.video_id;
+  std::lock_guard lock(mutex_);
+  Transaction tx(db_);
+  // What the video counted for before, if it was finalized already.
+  std::optional<VideoRecord> previous;
+  std::int64_t previous_recorded = 0;
+  {
+    Statement old(db_, "SELECT recorded_us, frames, gps_fixes FROM videos WHERE video_id = ?");
+    old.bind(1, std::string_view(video_id));
+    if (old.step()) {
+      previous_recorded = old.column_int(0);
+      previous.emplace();
+      previous->frames = old.column_int(1);
+      previous->gps_fixes = old.column_int(2);
+    }
+  }
+  {
+    Statement record(db_, "INSERT OR REPLACE INTO videos (video_id, recorded_us, start_us, "
+                          "finalized_ms, frames, plates, gps_fixes) VALUES (?, ?, ?, ?, ?, ?, ?)");
+    record.bind(1, std::string_view(video_id)).bind(2, video.recorded_us());
+    if (video.start_utc_us) {
+      record.bind(3, *video.start_utc_us);
+    } else {
+      record.bind_null(3);
+    }
+    record.bind(4, video.finalized_ms)
+        .bind(5, video.frames)
+        .bind(6, static_cast<std::int64_t>(video.plates))
+        .bind(7, video.gps_fixes)
+        .run();
+  }
+  // Every aggregate moves by the video's new contribution minus its old
+  // one, so nothing is rebuilt from the rest of the archive.
+  PlateDelta plates;
+  for (const Sighting& s : sightings) {
+    if (!s.plate.empty()) {
+      PlateChange& change = plates[s.plate];
+      change.sightings += 1;
+      change.share_sum += s.share;
+      change.videos = 1;
+      PlateSpan& span = change.after;
+      if (s.t_us) {
+        span.first_us = std::min(span.first_us.value_or(*s.t_us), *s.t_us);
+        span.last_us = std::max(span.last_us.value_or(*s.t_us), *s.t_us);
+      }
+      span.best_share = std::max(span.best_share, s.share);
+    }
+  }
+  TileDelta tiles;
+  std::int64_t old_sightings = 0;
+  std::int64_t old_located = 0;
+  {
+    Statement old_texts(db_, "SELECT plate, COUNT(*), TOTAL(share), MIN(t_us), MAX(t_us), "
+                             "MAX(share) FROM sightings WHERE video_id = ? GROUP BY plate");
+    old_texts.bind(1, std::string_view(video_id));
+    while (old_texts.step()) {
+      old_sightings += old_texts.column_int(1);
+      if (std::string plate = old_texts.column_text(0); !plate.empty()) {
+        PlateChange& change = plates[plate];
+        change.sightings -= old_texts.column_int(1);
+        change.share_sum -= old_texts.column_double(2);
+        change.videos -= 1;
+        change.before.first_us = old_texts.column_optional_int(3);
+        change.before.last_us = old_texts.column_optional_int(4);
+        change.before.best_share = old_texts.column_double(5);
+      }
+    }
+    // Index rows are found through their key, not by scanning for the id.
+    Statement old(db_, "SELECT sighting_id, t_us, lat, lon FROM sightings "
+                       "WHERE video_id = ? AND t_us IS NOT NULL AND lat IS NOT NULL "
+                       "AND lon IS NOT NULL");
+    Statement unindex(
+        db_, "DELETE FROM sighting_cells WHERE bucket = ? AND cell = ? AND t_us = ? AND "
+             "sighting_id = ?");
+    old.bind(1, std::string_view(video_id));
+    while (old.step()) {
+      std::int64_t t = old.column_int(1);
+      double lat = old.column_double(2);
+      double lon = old.column_double(3);
+      add_to_tiles(tiles, lat, lon, t, -1);
+      ++old_located;
+      unindex.bind(1, bucket_of(t))
+          .bind(2, static_cast<std::int64_t>(detail::cell_of(lat, lon)))
+          .bind(3, t)
+          .bind(4, old.column_int(0))
+          .run();
+      unindex.reset();
+    }
+    Statement remove(db_, "DELETE FROM sightings WHERE video_id = ?");
+    remove.bind(1, std::string_view(video_id)).run();
+  }
+
+  Statement insert(db_, "INSERT INTO sightings (video_id, track_id, plate, share, reads, frame, "
+                        "t_us, lat, lon) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)");
+  Statement index(db_, "INSERT INTO sighting_cells (bucket, cell, t_us, sighting_id, lat, lon) "
+                       "VALUES (?, ?, ?, ?, ?, ?)");
+  std::int64_t located = 0;
+  for (const Sighting& s : sightings) {
+    insert.bind(1, std::string_view(video_id))
+        .bind(2, static_cast<std::int64_t>(s.track_id))
+        .bind(3, std::string_view(s.plate))
+        .bind(4, s.share)
+        .bind(5, static_cast<std::int64_t>(s.reads))
+        .bind(6, s.frame);
+    if (s.t_us) {
+      insert.bind(7, *s.t_us);
+    } else {
+      insert.bind_null(7);
+    }
+    bind_optional(insert, 8, s.lat);
+    bind_optional(insert, 9, s.lon);
+    insert.run();
+    insert.reset();
+    if (s.located()) {
+      index.bind(1, bucket_of(*s.t_us))
+          .bind(2, static_cast<std::int64_t>(detail::cell_of(*s.lat, *s.lon)))
+          .bind(3, *s.t_us)
+          .bind(4, db_.last_insert_id())
+          .bind(5, *s.lat)
+          .bind(6, *s.lon)
+          .run();
+      index.reset();
+      add_to_tiles(tiles, *s.lat, *s.lon, *s.t_us, 1);
+      ++located;
+    }
+  }
+  std::int64_t texts = apply_plates(db_, plates);
+  apply_tiles(db_, tiles);
+
+  const auto count = static_cast<std::int64_t>(sightings.size());
+  add_to_counter(db_, "videos", previous ? 0 : 1);
+  add_to_counter(db_, "frames", video.frames - (previous ? previous->frames : 0));
+  add_to_counter(db_, "gps_fixes", video.gps_fixes - (previous ? previous->gps_fixes : 0));
+  add_to_counter(db_, "sightings", count - old_sightings);
+  add_to_counter(db_, "located", located - old_located);
+  add_to_counter(db_, "plates", texts);
+  if (previous) {
+    add_to_day(db_, previous_recorded, -1, -old_sightings);
+  }
+  add_to_day(db_, video.recorded_us(), 1, count);
+  tx.commit();
+}
+
+SightingResult SightingIndex::query(const SightingQuery& q) {
+  std::lock_guard lock(mutex_);
+  SightingResult result;
+  // Separate queries: SQLite only answers a lone MIN() or MAX() from the
+  // index without scanning.
+  std::int64_t first_bucket = 0;
+  std::int64_t last_bucket = 0;
+  {
+    Statement first(db_, "SELECT MIN(bucket) FROM sighting_cells");
+    Statement last(db_, "SELECT MAX(bucket) FROM sighting_cells");
+    if (!first.step() || first.column_is_null(0) || !last.step()) {
+      return result;
+    }
+    first_bucket = first.column_int(0);
+    last_bucket = last.column_int(0);
+  }
+  if (q.from_us) {
+    first_bucket = std::max(first_bucket, bucket_of(*q.from_us));
+  }
+  if (q.to_us) {
+    last_bucket = std::min(last_bucket, bucket_of(*q.to_us));
+  }
+
+  // A box across the antimeridian is queried as its two halves.
+  bool wraps = q.west > q.east;
+  std::vector<std::pair<double, double>> spans{{q.west, q.east}};
+  if (wraps) {
+    spans = {{q.west, 180.0}, {-180.0, q.east}};
+  }
+  std::vector<std::pair<std::uint64_t, std::uint64_t>> runs;
+  for (const auto& [west, east] : spans) {
+    auto part = detail::cover_box(q.south, west, q.north, east);
+    runs.insert(runs.end(), part.begin(), part.end());
+  }
+  // The halves' coarse covers can share cells; a cell scanned twice would
+  // return its sightings twice.
+  std::sort(runs.begin(), runs.end());
+  std::size_t merged = 0;
+  for (const auto& run : runs) {
+    if (merged > 0 && run.first <= runs[merged - 1].second) {
+      runs[merged - 1].second = std::max(runs[merged - 1].second, run.second);
+    } else {
+      runs[merged++] = run;
+    }
+  }
+  runs.resize(merged);
+
+  std::vector<std::pair<std::int64_t, std::int64_t>> hits;  // (t_us, sighting_id)
+  Statement scan(db_, "SELECT t_us, sighting_id, lat, lon FROM sighting_cells "
+                      "WHERE bucket = ? AND cell >= ? AND cell < ?");
+  for (std::int64_t bucket = first_bucket; bucket <= last_bucket; ++bucket) {
+    for (const auto& [lo, hi] : runs) {
+      scan.bind(1, bucket)
+          .bind(2, static_cast<std::int64_t>(lo))
+          .bind(3, static_cast<std::int64_t>(hi));
+      while (scan.step()) {
+        std::int64_t t = scan.column_int(0);
+        if (in_query(q, scan.column_double(2), scan.column_double(3), t)) {
+          hits.emplace_back(t, scan.column_int(1));
+        }
+      }
+      scan.reset();
+    }
+  }
+  std::sort(hits.begin(), hits.end());
+  if (hits.size() > q.limit) {
+    hits.resize(q.limit);
+    result.truncated = true;
+  }
+
+  Statement get(db_, std::string("SELECT ") + kSightingColumns +
+                         " FROM sightings WHERE sighting_id = ?");
+  for (const auto& hit : hits) {
+    get.bind(1, hit.second);
+    if (get.step()) {
+      result.sightings.push_back(read_sighting(get));
+    }
+    get.reset();
+  }
+  return result;
+}
+
+std::vector<PlateMatch> SightingIndex::match_plates(const PlateQuery& query) {
+  std::string text = normalize_plate(query.text);
+  if (text.empty()) {
+    return {};
+  }
+  std::lock_guard lock(mutex_);
+  // A text within distance k of the query, folded, shares all but at most
+  // 2k of its bigrams; when that leaves none to require, every text of a
+  // possible length is a candidate.
+  auto k = static_cast<std::ptrdiff_t>(std::floor(query.max_distance));
+  std::vector<std::string> grams = plate_grams(fold_confusables(text));
+  std::ptrdiff_t need = static_cast<std::ptrdiff_t>(grams.size()) - 2 * k;
+  std::vector<std::string> candidates;
+  if (need >= 1) {
+    std::string sql = "SELECT plate FROM plate_grams WHERE gram IN (?";
+    for (std::size_t i = 1; i < grams.size(); ++i) {
+      sql += ", ?";
+    }
+    sql += ") GROUP BY plate HAVING COUNT(*) >= ?";
+    Statement s(db_, sql);
+    int index = 1;
+    for (const std::string& gram : grams) {
+      s.bind(index++, std::string_view(gram));
+    }
+    s.bind(index, static_cast<std::int64_t>(need));
+    while (s.step()) {
+      candidates.push_back(s.column_text(0));
+    }
+  } else {
+    Statement s(db_, "SELECT plate FROM plates WHERE length BETWEEN ? AND ?");
+    s.bind(1, static_cast<std::int64_t>(text.size()) - k)
+        .bind(2, static_cast<std::int64_t>(text.size()) + k);
+    while (s.step()) {
+      candidates.push_back(s.column_text(0));
+    }
+  }
+
+  std::vector<PlateMatch> matches;
+  Statement totals(db_, std::string("SELECT ") + kPlateColumns + " FROM plates WHERE plate = ?");
+  for (std::string& plate : candidates) {
+    double distance = plate_distance(text, plate, query.max_distance);
+    if (distance > query.max_distance) {
+      continue;
+    }
+    totals.bind(1, std::string_view(plate));
+    if (totals.step()) {
+      PlateMatch match = read_plate(totals);
+      match.distance = distance;
+      matches.push_back(std::move(match));
+    }
+    totals.reset();
+  }
+  // Closest first; among equals, the text seen most often and most surely.
+  std::sort(matches.begin(), matches.end(), [](const PlateMatch& a, const PlateMatch& b) {
+    if (a.distance != b.distance) {
+      return a.distance < b.distance;
+    }
+    if (a.share_sum != b.share_sum) {
+      return a.share_sum > b.share_sum;
+    }
+    return a.plate < b.plate;
+  });
+  if (matches.size() > query.limit) {
+    matches.resize(query.limit);
+  }
+  return matches;
+}
+
+std::vector<Sighting> SightingIndex::plate_sightings(const std::string& plate,
+                                                     const SightingQuery& filter) {
+  std::lock_guard lock(mutex_);
+  bool unfiltered = whole_world(filter) && !filter.from_us && !filter.to_us;
+  std::vector<Sighting> out;
+  Statement s(db_, std::string("SELECT ") + kSightingColumns +
+                       " FROM sightings WHERE plate = ? ORDER BY t_us, sighting_id");
+  s.bind(1, std::string_view(plate));
+  while (s.step()) {
+    Sighting sighting = read_sighting(s);
+    if (unfiltered ||
+        (sighting.located() && in_query(filter, *sighting.lat, *sighting.lon, *sighting.t_us))) {
+      out.push_back(std::move(sighting));
+    }
+  }
+  return out;
+}
+
+VideoPage SightingIndex::list_videos(const std::optional<VideoCursor>& after,
+                                     std::size_t limit) {
+  std::lock_guard lock(mutex_);
+  std::string sql =
+      "SELECT video_id, start_us, finalized_ms, frames, plates, gps_fixes, recorded_us "
+      "FROM videos";
+  if (after) {
+    sql += " WHERE (recorded_us, video_id) < (?, ?)";
+  }
+  sql += " ORDER BY recorded_us DESC, video_id DESC LIMIT ?";
+  Statement s(db_, sql);
+  int index = 1;
+  if (after) {
+    s.bind(index, after->recorded_us).bind(index + 1, std::string_view(after->video_id));
+    index += 2;
+  }
+  // One extra row says whether there is a next page.
+  s.bind(index, static_cast<std::int64_t>(limit) + 1);
+  VideoPage page;
+  // From the column: rows backfilled by the migration have no start.
+  std::int64_t last_recorded = 0;
+  while (s.step()) {
+    if (page.videos.size() == limit) {
+      page.next = VideoCursor{last_recorded, page.videos.back().video_id};
+      break;
+    }
+    last_recorded = s.column_int(6);
+    VideoRecord v;
+    v.video_id = s.column_text(0);
+    v.start_utc_us = s.column_optional_int(1);
+    v.finalized_ms = s.column_int(2);
+    v.frames = s.column_int(3);
+    v.plates = static_cast<int>(s.column_int(4));
+    v.gps_fixes = s.column_int(5);
+    page.videos.push_back(std::move(v));
+  }
+  return page;
+}
+
+TileCounts SightingIndex::tile(int z, std::uint32_t x, std::uint32_t y,
+                               std::optional<std::int64_t> from_us,
+                               std::optional<std::int64_t> to_us) {
+  if (z < 0 || z > kMaxTileZoom || x >= (1u << z) || y >= (1u << z)) {
+    throw std::invalid_argument("no such tile");
+  }
+  std::lock_guard lock(mutex_);
+  // A tile's bins are one run of codes one level of kTileBinBits below it.
+  constexpr int kBinsPerTile = 1 << (2 * kTileBinBits);
+  std::uint64_t first = morton(x, y) << (2 * kTileBinBits);
+  std::vector<std::uint32_t> counts(kBinsPerTile, 0);
+  Statement s(db_, "SELECT code, count FROM tile_bins WHERE level = ? AND code >= ? AND "
+                   "code < ? AND day BETWEEN ? AND ?");
+  s.bind(1, static_cast<std::int64_t>(z + kTileBinBits))
+      .bind(2, static_cast<std::int64_t>(first))
+      .bind(3, static_cast<std::int64_t>(first + kBinsPerTile))
+      .bind(4, from_us ? floor_div(*from_us, kDayUs) : INT64_MIN)
+      .bind(5, to_us ? floor_div(*to_us, kDayUs) : INT64_MAX);
+  while (s.step()) {
+    auto local = static_cast<std::uint64_t>(s.column_int(0)) - first;
+    std::uint32_t bx = compact(local);
+    std::uint32_t by = compact(local >> 1);
+    counts[by * (1u << kTileBinBits) + bx] += static_cast<std::uint32_t>(s.column_int(1));
+  }
+  TileCounts out{z, x, y, {}};
+  for (std::size_t i = 0; i < counts.size(); ++i) {
+    if (counts[i] != 0) {
+      out.cells.emplace_back(static_cast<std::uint16_t>(i), counts[i]);
+    }
+  }
+  return out;
+}
+
+IndexStats SightingIndex::stats() {
+  std::lock_guard lock(mutex_);
+  IndexStats out;
+  Statement s(db_, "SELECT name, value FROM counters");
+  while (s.step()) {
+    std::string name = s.column_text(0);
+    std::int64_t value = s.column_int(1);
+    if (name == "videos") {
+      out.videos = value;
+    } else if (name == "frames") {
+      out.frames = value;
+    } else if (name == "gps_fixes") {
+      out.gps_fixes = value;
+    } else if (name == "sightings") {
+      out.sightings = value;
+    } else if (name == "located") {
+      out.located = value;
+    } else if (name == "plates") {
+      out.plates = value;
+    }
+  }
+  return out;
+}
+
+std::vector<DayActivity> SightingIndex::activity(std::int64_t from_us, std::int64_t to_us) {
+  std::lock_guard lock(mutex_);
+  Statement s(db_, "SELECT day, videos, sightings FROM activity_days WHERE day BETWEEN ? AND ? "
+                   "ORDER BY day");
+  s.bind(1, floor_div(from_us, kDayUs)).bind(2, floor_div(to_us, kDayUs));
+  std::vector<DayActivity> out;
+  while (s.step()) {
+    out.push_back({s.column_int(0) * kDayUs, s.column_int(1), s.column_int(2)});
+  }
+  return out;
+}
+
+std::vector<PlateMatch> SightingIndex::recent_plates(std::size_t limit) {
+  std::lock_guard lock(mutex_);
+  Statement s(db_, std::string("SELECT ") + kPlateColumns +
+                       " FROM plates WHERE last_us IS NOT NULL ORDER BY last_us DESC LIMIT ?");
+  s.bind(1, static_cast<std::int64_t>(limit));
+  std::vector<PlateMatch> out;
+  while (s.step()) {
+    out.push_back(read_plate(s));
+  }
+  return out;
+}
+
+std::int64_t SightingIndex::count() { return stats().sightings; }
+
+}  // namespace dashcam::server
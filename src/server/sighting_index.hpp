@@ -0,0 +1,226 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <json/value.h>
+
+#include "server/sqlite.hpp"
+
+namespace dashcam {
+class DetectionTable;
+}
+
+namespace dashcam::server {
+
+// One plate track of a finalized video, placed where and when it was best
+// seen (web_ui_overview.md §3.5 Map View, §3.6 Search View).
+struct Sighting {
+  std::int64_t sighting_id = 0;  // assigned by SightingIndex
+  std::string video_id;
+  int track_id = 0;
+  std::string plate;  // voted text; empty when the track was never read
+  double share = 0.0;
+  int reads = 0;
+  std::int64_t frame = 0;            // the frame it was located in
+  std::optional<std::int64_t> t_us;  // UTC microseconds since the epoch
+  std::optional<double> lat, lon;
+
+  bool located() const { return lat && lon && t_us; }
+};
+
+// The sightings of a finalized video: one per plate track in its merged
+// summary, at the located detection of the track closest to its best frame.
+// Times need the video's start (`gps.start_utc_us` in the summary); without
+// `detections` or a start, sightings are kept but not located.
+std::vector<Sighting> sightings_from_summary(const std::string& video_id,
+                                             const Json::Value& summary,
+                                             const DetectionTable* detections);
+
+// A finalized video, as listed for the WebUI Video Browser
+// (web_ui_overview.md §3.2).
+struct VideoRecord {
+  std::string video_id;
+  std::optional<std::int64_t> start_utc_us;
+  std::int64_t finalized_ms = 0;  // Unix milliseconds
+  std::int64_t frames = 0;
+  int plates = 0;
+  std::int64_t gps_fixes = 0;
+
+  // Listing order: the recording start when known, else finalization time.
+  std::int64_t recorded_us() const { return start_utc_us.value_or(finalized_ms * 1000); }
+};
+
+VideoRecord video_record_from_summary(const std::string& video_id, const Json::Value& summary,
+                                      std::int64_t finalized_ms);
+
+// Keyset position in the video list: the last (recorded_us, video_id) seen.
+struct VideoCursor {
+  std::int64_t recorded_us = 0;
+  std::string video_id;
+};
+
+struct VideoPage {
+  std::vector<VideoRecord> videos;  // newest first
+  std::optional<VideoCursor> next;  // set when more follow
+};
+
+struct SightingQuery {
+  // Degrees; west > east crosses the antimeridian.
+  double south = -90.0, west = -180.0, north = 90.0, east = 180.0;
+  // UTC microseconds, inclusive.
+  std::optional<std::int64_t> from_us, to_us;
+  std::size_t limit = 1000;
+};
+
+struct SightingResult {
+  std::vector<Sighting> sightings;  // oldest first
+  bool truncated = false;           // more than `limit` matched
+};
+
+struct PlateQuery {
+  std::string text;  // normalized before matching
+  // Weighted edit distance (common/plate_text.hpp): confusable
+  // substitutions such as 0/O cost kConfusionCost, other edits 1.
+  double max_distance = 1.0;
+  std::size_t limit = 20;
+};
+
+// A distinct plate text in the index and how often, how surely, it was read.
+struct PlateMatch {
+  std::string plate;
+  double distance = 0.0;
+  std::int64_t sightings = 0;
+  double share_sum = 0.0;  // vote shares summed over its sightings
+  double best_share = 0.0;
+  std::int64_t videos = 0;  // trips it was seen on
+  std::optional<std::int64_t> first_us, last_us;  // located sightings only
+};
+
+// Archive-wide totals for the WebUI dashboard (web_ui_overview.md §3.1).
+struct IndexStats {
+  std::int64_t videos = 0;
+  std::int64_t frames = 0;
+  std::int64_t gps_fixes = 0;
+  std::int64_t sightings = 0;
+  std::int64_t located = 0;
+  std::int64_t plates = 0;  // distinct texts
+};
+
+// Videos recorded on one UTC day and their sightings.
+struct DayActivity {
+  std::int64_t day_us = 0;  // midnight, UTC microseconds
+  std::int64_t videos = 0;
+  std::int64_t sightings = 0;
+};
+
+// Heatmap tiles (web_ui_overview.md §5.4): Web Mercator z/x/y tiles, each a
+// 32 x 32 grid of sighting counts (bins kTileBinBits levels below the
+// tile), for zooms 0 to kMaxTileZoom.
+inline constexpr int kTileBinBits = 5;
+inline constexpr int kMaxTileZoom = 15;
+
+struct TileCounts {
+  int z = 0;
+  std::uint32_t x = 0, y = 0;
+  // Non-empty bins as (row-major index in the grid, count), ascending.
+  std::vector<std::pair<std::uint16_t, std::uint32_t>> cells;
+};
+
+// Spatial-temporal index of every finalized sighting, kept in its own
+// SQLite file on the main server (main_server.md §5.4) and updated as each
+// video is finalized; the list of finalized videos lives there too.
+//
+// Located sightings are keyed by (time bucket, cell, time): the cell is the
+// Z-order (Morton) code of the position on a 2^20 x 2^20 lat/lon grid
+// (about 19 m of latitude), the bucket a 30-day slice of time. A bounding
+// box becomes a few runs of consecutive cell codes from a coarse cover of
+// it, so a query is a handful of index range scans per bucket in the date
+// range rather than a scan of every sighting.
+//
+// Plate texts are indexed for fuzzy search (web_ui_overview.md §3.6): each
+// distinct text keeps its sighting totals, and its bigrams after folding OCR
+// confusables (0/O, 8/B, 1/I, ...) point back to it. Both are maintained in
+// the same transaction as the sightings.
+//
+// Heatmap counts are kept as a pyramid, per UTC day: every located sighting
+// adds one to its bin at each of the 16 levels that back tiles, keyed by
+// (level, Z-order bin code, day), so a tile is read by one range scan at any
+// zoom and its size depends on the bins it covers, not on the sightings in
+// them.
+//
+// Every aggregate (text totals, tiles, dashboard counters, daily activity)
+// is moved by the difference between a video's new and old contribution, so
+// finalizing a video costs the same however large the archive has grown.
+// Thread-safe.
+class SightingIndex {
+ public:
+  // ":memory:" gives a throwaway index.
+  explicit SightingIndex(const std::filesystem::path& path);
+
+  // Records the video and replaces its sightings in one transaction, so
+  // finalizing a video again does not duplicate them.
+  void replace_video(const VideoRecord& video, std::span<const Sighting> sightings);
+
+  // Up to `limit` videos after `after`, newest first: a seek on the
+  // (recorded_us, video_id) index, however deep the page.
+  VideoPage list_videos(const std::optional<VideoCursor>& after, std::size_t limit);
+
+  // Located sightings inside the box and date range.
+  SightingResult query(const SightingQuery& query);
+
+  // Indexed texts within the query's distance: closest first, then by
+  // summed vote share (confidence times sightings). Candidates come from
+  // the bigram postings of the folded query (a count filter), so only they
+  // are compared in full.
+  std::vector<PlateMatch> match_plates(const PlateQuery& query);
+
+  // Every sighting of one text, oldest first; with a box or dates in
+  // `filter`, only located sightings inside them. `filter.limit` is ignored.
+  std::vector<Sighting> plate_sightings(const std::string& plate, const SightingQuery& filter);
+
+  // Sighting counts of one tile over the days touching [from_us, to_us]
+  // (UTC microseconds). Throws std::invalid_argument outside the pyramid.
+  TileCounts tile(int z, std::uint32_t x, std::uint32_t y, std::optional<std::int64_t> from_us,
+                  std::optional<std::int64_t> to_us);
+
+  // Kept by delta as videos are finalized; no query scans the archive.
+  IndexStats stats();
+  std::vector<DayActivity> activity(std::int64_t from_us, std::int64_t to_us);
+  // Texts by their latest located sighting, newest first; distance 0.
+  std::vector<PlateMatch> recent_plates(std::size_t limit);
+
+  std::int64_t count();
+
+ private:
+  void migrate();
+
+  std::mutex mutex_;
+  Database db_;
+};
+
+namespace detail {
+
+inline constexpr int kCellBits = 20;  // per axis
+
+// Grid cell of a position, Z-order interleaved (x = lon in the even bits).
+std::uint64_t cell_of(double lat, double lon);
+
+// Half-open runs [first, second) of cell codes covering the box (which must
+// not cross the antimeridian), at most about `max_cells` coarse cells.
+std::vector<std::pair<std::uint64_t, std::uint64_t>> cover_box(double south, double west,
+                                                               double north, double east,
+                                                               int max_cells = 64);
+
+// Web Mercator (x, y) of a position on the 2^level x 2^level grid, y down
+// from the north; latitudes are clamped to the projection's +-85.05.
+std::pair<std::uint32_t, std::uint32_t> mercator_bin(double lat, double lon, int level);
+
+}  // namespace detail
+
+}  // namespace dashcam::server
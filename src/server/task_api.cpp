@@ -0,0 +1,218 @@
+#include "server/task_api.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "common/json_util.hpp"
+#include "common/trace.hpp"
+
+namespace dashcam::server {
+
+namespace {
+
+const Json::Value& require_array(const Json::Value& body, const char* key) {
+  if (!body.isObject() || !body[key].isArray()) {
+    throw std::invalid_argument(std::string("body must have an array '") + key + "'");
+  }
+  return body[key];
+}
+
+std::string require_worker(const Json::Value& body) {
+  if (!body.isObject() || !body["worker_id"].isString() || body["worker_id"].asString().empty()) {
+    throw std::invalid_argument("body must have a non-empty string 'worker_id'");
+  }
+  return body["worker_id"].asString();
+}
+
+std::vector<std::int64_t> require_task_ids(const Json::Value& body) {
+  std::vector<std::int64_t> ids;
+  for (const Json::Value& id : require_array(body, "task_ids")) {
+    if (!id.isIntegral()) {
+      throw std::invalid_argument("task_ids must hold integers");
+    }
+    ids.push_back(id.asInt64());
+  }
+  return ids;
+}
+
+Histogram& request_seconds(const char* route) {
+  return default_metrics().histogram(
+      "dashcam_server_request_seconds",
+      "Time per task request, long-poll wait included for pulls.", {{"route", route}});
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
+
+TaskApi::TaskApi(TaskQueue& queue)
+    : queue_(queue),
+      pull_seconds_(request_seconds("pull")),
+      complete_seconds_(request_seconds("complete")) {}
+
+std::optional<http::Response> TaskApi::handle(const http::Request& request) {
+  std::string_view path = request.path();
+  if (path != "/tasks" && path.substr(0, 7) != "/tasks/") {
+    return std::nullopt;
+  }
+  try {
+    if (request.method == "POST") {
+      if (path == "/tasks") {
+        return create(request);
+      }
+      if (path == "/tasks/pull") {
+        return pull(request);
+      }
+      if (path == "/tasks/heartbeat") {
+        return heartbeat(request);
+      }
+      if (path == "/tasks/fail") {
+        return fail(request);
+      }
+      if (path == "/tasks/complete") {
+        return complete(request);
+      }
+    } else if (request.method == "GET" && path.size() > 7) {
+      return get(path.substr(7));
+    }
+    return http::error_response(404, "no such task route");
+  } catch (const std::invalid_argument& e) {
+    return http::error_response(400, e.what());
+  }
+}
+
+http::Response TaskApi::create(const http::Request& request) {
+  Json::Value body = parse_json(request.body);
+  std::vector<NewTask> tasks;
+  for (const Json::Value& item : require_array(body, "tasks")) {
+    tasks.push_back(new_task_from_json(item));
+  }
+  Json::Value ids(Json::arrayValue);
+  for (std::int64_t id : queue_.create(tasks)) {
+    ids.append(Json::Int64(id));
+  }
+  Json::Value out(Json::objectValue);
+  out["task_ids"] = ids;
+  return http::json_response(200, to_json_string(out));
+}
+
+http::Response TaskApi::pull(const http::Request& request) {
+  Json::Value body = parse_json(request.body);
+  std::string worker = require_worker(body);
+  std::vector<std::string> types;
+  for (const Json::Value& t : require_array(body, "task_types")) {
+    if (!t.isString()) {
+      throw std::invalid_argument("task_types must hold strings");
+    }
+    types.push_back(t.asString());
+  }
+  std::size_t limit = 1;
+  if (body.isMember("limit")) {
+    if (!body["limit"].isIntegral() || body["limit"].asInt64() < 1) {
+      throw std::invalid_argument("limit must be a positive integer");
+    }
+    limit = static_cast<std::size_t>(body["limit"].asUInt64());
+  }
+  std::chrono::milliseconds wait(0);
+  if (body.isMember("wait_ms")) {
+    if (!body["wait_ms"].isIntegral() || body["wait_ms"].asInt64() < 0) {
+      throw std::invalid_argument("wait_ms must be a non-negative integer");
+    }
+    wait = std::chrono::milliseconds(
+        std::min(body["wait_ms"].asInt64(), Json::Int64(TaskQueue::kMaxPullWait.count())));
+  }
+
+  ScopedTrace span("tasks.pull", "api");
+  auto start = std::chrono::steady_clock::now();
+  std::vector<Task> pulled = queue_.pull(worker, types, limit, wait);
+  pull_seconds_.observe(seconds_since(start));
+  span.set_arg(static_cast<std::int64_t>(pulled.size()));
+
+  Json::Value tasks(Json::arrayValue);
+  for (const Task& task : pulled) {
+    default_metrics()
+        .counter("dashcam_server_tasks_leased_total", "Tasks handed out by /tasks/pull.",
+                 {{"task_type", task.task_type}})
+        .add();
+    tasks.append(to_json(task));
+  }
+  Json::Value out(Json::objectValue);
+  out["tasks"] = tasks;
+  out["lease_ttl_ms"] = Json::Int64(
+      std::chrono::duration_cast<std::chrono::milliseconds>(queue_.lease_ttl()).count());
+  return http::json_response(200, to_json_string(out));
+}
+
+http::Response TaskApi::heartbeat(const http::Request& request) {
+  Json::Value body = parse_json(request.body);
+  std::string worker = require_worker(body);
+  std::vector<std::int64_t> ids = require_task_ids(body);
+  Json::Value lost(Json::arrayValue);
+  for (std::int64_t id : queue_.heartbeat(worker, ids)) {
+    lost.append(Json::Int64(id));
+  }
+  Json::Value out(Json::objectValue);
+  out["lost"] = lost;
+  return http::json_response(200, to_json_string(out));
+}
+
+http::Response TaskApi::fail(const http::Request& request) {
+  Json::Value body = parse_json(request.body);
+  std::string worker = require_worker(body);
+  std::vector<std::int64_t> ids = require_task_ids(body);
+  Json::Value deferred(Json::arrayValue);
+  for (const auto& [id, delay] : queue_.fail(worker, ids)) {
+    Json::Value item(Json::objectValue);
+    item["task_id"] = Json::Int64(id);
+    item["retry_ms"] = Json::Int64(std::chrono::milliseconds(delay).count());
+    deferred.append(item);
+  }
+  Json::Value out(Json::objectValue);
+  out["deferred"] = deferred;
+  return http::json_response(200, to_json_string(out));
+}
+
+http::Response TaskApi::complete(const http::Request& request) {
+  Json::Value body = parse_json(request.body);
+  std::vector<TaskCompletion> completions;
+  for (const Json::Value& item : require_array(body, "completions")) {
+    completions.push_back(task_completion_from_json(item));
+  }
+  ScopedTrace span("tasks.complete", "api", static_cast<std::int64_t>(completions.size()));
+  auto start = std::chrono::steady_clock::now();
+  std::vector<CompletionResult> completed = queue_.complete(completions);
+  complete_seconds_.observe(seconds_since(start));
+
+  Json::Value results(Json::arrayValue);
+  for (const CompletionResult& r : completed) {
+    default_metrics()
+        .counter("dashcam_server_completions_total", "Completions by outcome.",
+                 {{"status", to_string(r.status)}})
+        .add();
+    results.append(to_json(r));
+  }
+  Json::Value out(Json::objectValue);
+  out["results"] = results;
+  return http::json_response(200, to_json_string(out));
+}
+
+http::Response TaskApi::get(std::string_view id_text) {
+  std::int64_t id = 0;
+  auto [end, ec] = std::from_chars(id_text.data(), id_text.data() + id_text.size(), id);
+  if (ec != std::errc() || end != id_text.data() + id_text.size()) {
+    return http::error_response(404, "no such task route");
+  }
+  std::optional<Task> task = queue_.get(id);
+  if (!task) {
+    return http::error_response(404, "task not found");
+  }
+  return http::json_response(200, to_json_string(to_json(*task)));
+}
+
+}  // namespace dashcam::server
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <optional>
+
+#include "common/http/http_message.hpp"
+#include "common/metrics.hpp"
+#include "server/task_queue.hpp"
+
+namespace dashcam::server {
+
+// Task endpoints used by every device (main_server.md §3):
+//
+//   POST /tasks            {"tasks": [NewTask...]}       -> {"task_ids": [...]}
+//   POST /tasks/pull       {"worker_id", "task_types": [...], "limit": N}
+//                                                       -> {"tasks": [...], "lease_ttl_ms"}
+//   POST /tasks/heartbeat  {"worker_id", "task_ids": [...]} -> {"lost": [...]}
+//   POST /tasks/fail       {"worker_id", "task_ids": [...]}
+//                                                       -> {"deferred": [{"task_id", "retry_ms"}]}
+//   POST /tasks/complete   {"completions": [TaskCompletion...]} -> {"results": [...]}
+//   GET  /tasks/<id>                                    -> Task
+//
+// Pulls and completions are timed into default_metrics() and traced.
+class TaskApi {
+ public:
+  explicit TaskApi(TaskQueue& queue);
+
+  // Empty when the request is not for a /tasks route.
+  std::optional<http::Response> handle(const http::Request& request);
+
+ private:
+  http::Response create(const http::Request& request);
+  http::Response pull(const http::Request& request);
+  http::Response heartbeat(const http::Request& request);
+  http::Response fail(const http::Request& request);
+  http::Response complete(const http::Request& request);
+  http::Response get(std::string_view id);
+
+  TaskQueue& queue_;
+  Histogram& pull_seconds_;
+  Histogram& complete_seconds_;
+};
+
+}  // namespace dashcam::server
@@ -0,0 +1,161 @@
+#include "server/task_queue.hpp"
+
+#include <algorithm>
+
+#include "common/trace.hpp"
+
+namespace dashcam::server {
+
+TaskQueue::TaskQueue(TaskStore& store, LeaseTable::Clock::duration lease_ttl)
+    : store_(store), leases_(lease_ttl) {}
+
+void TaskQueue::changed() {
+  {
+    std::lock_guard lock(mutex_);
+    ++version_;
+  }
+  wake_.notify_all();
+}
+
+std::vector<std::int64_t> TaskQueue::create(std::span<const NewTask> tasks) {
+  std::vector<std::int64_t> ids = store_.create(tasks);
+  if (!ids.empty()) {
+    changed();
+  }
+  return ids;
+}
+
+IngestRecord TaskQueue::ingest(const std::string& video_id, const VideoContent& content,
+                               std::span<const NewTask> tasks, bool reprocess) {
+  IngestRecord record = store_.ingest(video_id, content, tasks, reprocess);
+  if (!record.task_ids.empty()) {
+    changed();
+  }
+  return record;
+}
+
+std::optional<std::vector<std::int64_t>> TaskQueue::ingest_pair(
+    const std::string& front_id, const VideoContent& front, const std::string& rear_id,
+    const VideoContent& rear, std::span<const NewTask> tasks, bool reprocess) {
+  std::optional<std::vector<std::int64_t>> ids =
+      store_.ingest_pair(front_id, front, rear_id, rear, tasks, reprocess);
+  if (ids && !ids->empty()) {
+    changed();
+  }
+  return ids;
+}
+
+std::vector<Task> TaskQueue::try_pull(const std::string& worker,
+                                      std::span<const std::string> task_types, std::size_t limit,
+                                      LeaseTable::Clock::time_point now) {
+  // Every leased task could sit at the head of the queue, so over-fetch by
+  // the number of live leases; that is bounded by workers x batch size, not
+  // by the queue length.
+  std::size_t leased = leases_.purge(now);
+  std::vector<Task> candidates = store_.pull(task_types, limit + leased);
+
+  std::vector<Task> tasks;
+  for (Task& task : candidates) {
+    if (tasks.size() == limit) {
+      break;
+    }
+    if (leases_.acquire(task.task_id, worker, now)) {
+      tasks.push_back(std::move(task));
+    }
+  }
+  return tasks;
+}
+
+std::vector<Task> TaskQueue::pull(const std::string& worker,
+                                  std::span<const std::string> task_types, std::size_t limit,
+                                  std::chrono::milliseconds wait) {
+  limit = std::min(limit, TaskStore::kMaxPullBatch);
+  if (limit == 0) {
+    return {};
+  }
+  wait = std::clamp(wait, std::chrono::milliseconds(0), kMaxPullWait);
+  auto deadline = LeaseTable::Clock::now() + wait;
+
+  std::unique_lock lock(mutex_);
+  for (;;) {
+    std::uint64_t seen = version_;
+    auto now = LeaseTable::Clock::now();
+    std::vector<Task> tasks = try_pull(worker, task_types, limit, now);
+    if (!tasks.empty() || now >= deadline || stopping_) {
+      return tasks;
+    }
+    // Sleep until something is published or completed, a lease is dropped,
+    // or the next lease lapses on its own (its task may be one of ours).
+    auto until = std::min(deadline, leases_.next_expiry().value_or(deadline));
+    ScopedTrace span("queue.wait", "queue");
+    wake_.wait_until(lock, until, [&] { return version_ != seen || stopping_; });
+  }
+}
+
+std::vector<std::int64_t> TaskQueue::heartbeat(const std::string& worker,
+                                               std::span<const std::int64_t> task_ids) {
+  std::vector<std::int64_t> lost;
+  bool released = false;
+  {
+    std::lock_guard lock(mutex_);
+    std::size_t before = leases_.purge(LeaseTable::Clock::now());
+    lost = leases_.heartbeat(worker, task_ids, LeaseTable::Clock::now());
+    released = leases_.purge(LeaseTable::Clock::now()) < before;
+  }
+  if (released) {
+    changed();
+  }
+  return lost;
+}
+
+std::vector<CompletionResult> TaskQueue::complete(std::span<const TaskCompletion> completions) {
+  std::vector<CompletionResult> results = store_.complete(completions);
+  {
+    std::lock_guard lock(mutex_);
+    for (const TaskCompletion& c : completions) {
+      leases_.release(c.task_id);
+      failures_.erase(c.task_id);
+    }
+  }
+  bool published = std::any_of(results.begin(), results.end(),
+                               [](const CompletionResult& r) { return !r.published.empty(); });
+  if (published) {
+    changed();
+  }
+  return results;
+}
+
+void TaskQueue::defer(std::int64_t task_id, LeaseTable::Clock::duration delay) {
+  std::lock_guard lock(mutex_);
+  leases_.defer(task_id, LeaseTable::Clock::now() + delay);
+}
+
+std::vector<std::pair<std::int64_t, std::chrono::seconds>> TaskQueue::fail(
+    const std::string& worker, std::span<const std::int64_t> task_ids) {
+  std::vector<std::pair<std::int64_t, std::chrono::seconds>> deferred;
+  std::lock_guard lock(mutex_);
+  LeaseTable::Clock::time_point now = LeaseTable::Clock::now();
+  for (std::int64_t id : task_ids) {
+    // A worker whose lease lapsed may be reporting a task another now runs.
+    if (!leases_.held_by(id, worker, now)) {
+      continue;
+    }
+    int failures = failures_[id]++;
+    std::chrono::seconds delay =
+        std::min<std::chrono::seconds>(kRetryDelay * (std::int64_t{1} << std::min(failures, 16)),
+                                       kMaxRetryDelay);
+    leases_.defer(id, now + delay);
+    deferred.emplace_back(id, delay);
+  }
+  return deferred;
+}
+
+void TaskQueue::shutdown() {
+  {
+    std::lock_guard lock(mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+}
+
+}  // namespace dashcam::server
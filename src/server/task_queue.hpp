@@ -0,0 +1,101 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "common/task.hpp"
+#include "server/lease_table.hpp"
+#include "server/task_store.hpp"
+
+namespace dashcam::server {
+
+// What devices talk to: the durable TaskStore plus the in-memory leases that
+// keep two workers of the same class from pulling the same task. Thread-safe.
+class TaskQueue {
+ public:
+  // Longest a pull may block waiting for work.
+  static constexpr std::chrono::milliseconds kMaxPullWait{60000};
+  // Backoff for tasks a worker reports failed: the first failure defers the
+  // task for kRetryDelay, each further one doubles it up to kMaxRetryDelay.
+  static constexpr std::chrono::seconds kRetryDelay{30};
+  static constexpr std::chrono::seconds kMaxRetryDelay{1800};
+
+  TaskQueue(TaskStore& store, LeaseTable::Clock::duration lease_ttl);
+
+  std::vector<std::int64_t> create(std::span<const NewTask> tasks);
+
+  // TaskStore::find_content, ingest and ingest_pair; tasks queued by an
+  // ingestion wake blocked pulls like create().
+  std::optional<std::string> find_content(const VideoContent& content) {
+    return store_.find_content(content);
+  }
+  IngestRecord ingest(const std::string& video_id, const VideoContent& content,
+                      std::span<const NewTask> tasks, bool reprocess = false);
+  std::optional<std::vector<std::int64_t>> ingest_pair(const std::string& front_id,
+                                                       const VideoContent& front,
+                                                       const std::string& rear_id,
+                                                       const VideoContent& rear,
+                                                       std::span<const NewTask> tasks,
+                                                       bool reprocess = false);
+
+  // Oldest pending tasks of `task_types` not leased to another worker, each
+  // leased to `worker` on return. At most TaskStore::kMaxPullBatch.
+  //
+  // With a non-zero `wait` this is a long-poll: when nothing is eligible the
+  // call blocks until a matching task is published (or a lease on one is
+  // dropped) and returns it at once, or returns empty after `wait`.
+  std::vector<Task> pull(const std::string& worker, std::span<const std::string> task_types,
+                         std::size_t limit,
+                         std::chrono::milliseconds wait = std::chrono::milliseconds(0));
+
+  // See LeaseTable::heartbeat. Returns the ids the worker has lost.
+  std::vector<std::int64_t> heartbeat(const std::string& worker,
+                                      std::span<const std::int64_t> task_ids);
+
+  // Completes tasks (TaskStore::complete) and drops their leases.
+  std::vector<CompletionResult> complete(std::span<const TaskCompletion> completions);
+
+  // See LeaseTable::defer: the task stays pending but is not pulled again
+  // for `delay`.
+  void defer(std::int64_t task_id, LeaseTable::Clock::duration delay);
+
+  // Defers each of `task_ids` that `worker` holds, after it failed them, so
+  // a task that fails every time (a corrupt video) is not pulled again at
+  // once. Failure counts live in memory like the leases and are dropped on
+  // completion. Returns the ids deferred with their delays.
+  std::vector<std::pair<std::int64_t, std::chrono::seconds>> fail(
+      const std::string& worker, std::span<const std::int64_t> task_ids);
+
+  std::optional<Task> get(std::int64_t task_id) { return store_.get(task_id); }
+
+  LeaseTable::Clock::duration lease_ttl() const { return leases_.ttl(); }
+
+  // Wakes every blocked pull and makes later ones return immediately
+  // (server shutdown).
+  void shutdown();
+
+ private:
+  std::vector<Task> try_pull(const std::string& worker, std::span<const std::string> task_types,
+                             std::size_t limit, LeaseTable::Clock::time_point now);
+  // Bumps version_ and wakes blocked pulls so they re-query.
+  void changed();
+
+  TaskStore& store_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  LeaseTable leases_;
+  std::unordered_map<std::int64_t, int> failures_;
+  std::uint64_t version_ = 0;
+  bool stopping_ = false;
+};
+
+}  // namespace dashcam::server
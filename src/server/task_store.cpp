@@ -0,0 +1,485 @@
+#include "server/task_store.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+#include "common/json_util.hpp"
+#include "common/metrics.hpp"
+#include "common/trace.hpp"
+
+namespace dashcam::server {
+
+namespace {
+
+// Schema 2: the hot queue holds pending tasks only, indexed per task_type in
+// age order, and completed tasks move to an append-only history table. Both
+// share one id sequence (AUTOINCREMENT never reuses an id, even once the
+// queue has drained).
+// Schema 3 adds shard_parts, published shard tasks waiting for their
+// siblings (see TaskStore::complete).
+// Schema 4 adds video_content and video_links, the ingestion duplicate check
+// (see TaskStore::ingest). Videos ingested before it have no content row.
+// Schema 5 indexes video_links by original, for listing a video's copies.
+constexpr int kSchemaVersion = 5;
+
+// Time in the store per call, waiting for its lock included: contention
+// between pulls and completions shows up here.
+Histogram& store_seconds(const char* op) {
+  return default_metrics().histogram("dashcam_server_store_seconds",
+                                     "Time per task-store call, lock wait included.",
+                                     {{"op", op}});
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+constexpr const char* kSchema = R"sql(
+CREATE TABLE IF NOT EXISTS pending_tasks (
+  task_id      INTEGER PRIMARY KEY AUTOINCREMENT,
+  task_type    TEXT NOT NULL,
+  video_id     TEXT NOT NULL,
+  inputs       TEXT NOT NULL,
+  params       TEXT NOT NULL,
+  created_at   INTEGER NOT NULL
+);
+CREATE INDEX IF NOT EXISTS pending_by_type_age
+  ON pending_tasks (task_type, created_at, task_id);
+
+CREATE TABLE IF NOT EXISTS task_history (
+  task_id      INTEGER PRIMARY KEY,
+  task_type    TEXT NOT NULL,
+  video_id     TEXT NOT NULL,
+  inputs       TEXT NOT NULL,
+  params       TEXT NOT NULL,
+  created_at   INTEGER NOT NULL,
+  completed_at INTEGER NOT NULL
+);
+CREATE TRIGGER IF NOT EXISTS task_history_no_update BEFORE UPDATE ON task_history
+BEGIN SELECT RAISE(ABORT, 'task_history is append-only'); END;
+CREATE TRIGGER IF NOT EXISTS task_history_no_delete BEFORE DELETE ON task_history
+BEGIN SELECT RAISE(ABORT, 'task_history is append-only'); END;
+
+CREATE TABLE IF NOT EXISTS shard_parts (
+  task_type    TEXT NOT NULL,
+  video_id     TEXT NOT NULL,
+  shard_index  INTEGER NOT NULL,
+  shard_count  INTEGER NOT NULL,
+  inputs       TEXT NOT NULL,
+  params       TEXT NOT NULL,
+  PRIMARY KEY (task_type, video_id, shard_index)
+);
+
+CREATE TABLE IF NOT EXISTS video_content (
+  fingerprint  TEXT NOT NULL,
+  size         INTEGER NOT NULL,
+  video_id     TEXT NOT NULL,
+  ingested_at  INTEGER NOT NULL,
+  PRIMARY KEY (fingerprint, size)
+);
+
+CREATE TABLE IF NOT EXISTS video_links (
+  video_id     TEXT PRIMARY KEY,
+  original_id  TEXT NOT NULL,
+  linked_at    INTEGER NOT NULL
+);
+CREATE INDEX IF NOT EXISTS video_links_by_original ON video_links (original_id, linked_at);
+)sql";
+
+// Schema 1 kept every task in one `tasks` table with a state column.
+constexpr const char* kMigrateFromV1 = R"sql(
+INSERT INTO pending_tasks (task_id, task_type, video_id, inputs, params, created_at)
+  SELECT task_id, task_type, video_id, inputs, params, created_at
+  FROM tasks WHERE state = 'pending';
+INSERT INTO task_history
+  SELECT task_id, task_type, video_id, inputs, params, created_at, completed_at
+  FROM tasks WHERE state = 'complete';
+INSERT OR REPLACE INTO sqlite_sequence (name, seq)
+  SELECT 'pending_tasks', MAX(task_id) FROM tasks HAVING MAX(task_id) IS NOT NULL;
+DROP TABLE tasks;
+)sql";
+
+constexpr const char* kPendingColumns =
+    "task_id, task_type, video_id, inputs, params, created_at, NULL";
+constexpr const char* kHistoryColumns =
+    "task_id, task_type, video_id, inputs, params, created_at, completed_at";
+
+Task read_task(const Statement& s, TaskState state) {
+  Task task;
+  task.task_id = s.column_int(0);
+  task.task_type = s.column_text(1);
+  task.video_id = s.column_text(2);
+  task.state = state;
+  for (const Json::Value& item : parse_json(s.column_text(3))) {
+    task.inputs.push_back(task_input_from_json(item));
+  }
+  task.params = parse_json(s.column_text(4));
+  task.created_at = s.column_int(5);
+  task.completed_at = s.column_optional_int(6);
+  return task;
+}
+
+bool table_exists(Database& db, const char* name) {
+  Statement s(db, "SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = ?");
+  s.bind(1, std::string_view(name));
+  bool found = s.step();
+  s.reset();
+  return found;
+}
+
+std::string inputs_json(const std::vector<TaskInput>& inputs) {
+  Json::Value out(Json::arrayValue);
+  for (const TaskInput& input : inputs) {
+    out.append(to_json(input));
+  }
+  return to_json_string(out);
+}
+
+bool same_input(const TaskInput& a, const TaskInput& b) {
+  return a.device == b.device && a.path == b.path && a.type == b.type;
+}
+
+}  // namespace
+
+std::int64_t unix_millis() {
+  using namespace std::chrono;
+  return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+TaskStore::TaskStore(const std::filesystem::path& path) : db_(path) {
+  // WAL keeps pulls from blocking behind a completion's write.
+  db_.exec("PRAGMA journal_mode = WAL");
+  db_.exec("PRAGMA synchronous = NORMAL");
+  migrate();
+}
+
+void TaskStore::migrate() {
+  std::int64_t current = 0;
+  {
+    Statement version(db_, "PRAGMA user_version");
+    version.step();
+    current = version.column_int(0);
+  }
+  if (current > kSchemaVersion) {
+    throw std::runtime_error("task DB schema " + std::to_string(current) +
+                             " is newer than this server (" + std::to_string(kSchemaVersion) +
+                             ")");
+  }
+  if (current == kSchemaVersion) {
+    return;
+  }
+
+  Transaction tx(db_);
+  db_.exec(kSchema);
+  if (table_exists(db_, "tasks")) {
+    db_.exec(kMigrateFromV1);
+  }
+  db_.exec(("PRAGMA user_version = " + std::to_string(kSchemaVersion)).c_str());
+  tx.commit();
+}
+
+std::int64_t TaskStore::insert(const NewTask& task, std::int64_t now) {
+  Statement s(db_,
+              "INSERT INTO pending_tasks (task_type, video_id, inputs, params, created_at) "
+              "VALUES (?, ?, ?, ?, ?)");
+  s.bind(1, task.task_type)
+      .bind(2, task.video_id)
+      .bind(3, inputs_json(task.inputs))
+      .bind(4, to_json_string(task.params))
+      .bind(5, now);
+  s.run();
+  return db_.last_insert_id();
+}
+
+std::optional<std::int64_t> TaskStore::publish(const NewTask& task, std::int64_t now) {
+  std::optional<ShardSpec> shard = find_shard(task.params);
+  if (!shard) {
+    return insert(task, now);
+  }
+  // A re-run shard (e.g. after re-ingestion) replaces its earlier part.
+  Statement park(db_,
+                 "INSERT OR REPLACE INTO shard_parts "
+                 "(task_type, video_id, shard_index, shard_count, inputs, params) "
+                 "VALUES (?, ?, ?, ?, ?, ?)");
+  park.bind(1, task.task_type)
+      .bind(2, task.video_id)
+      .bind(3, static_cast<std::int64_t>(shard->index))
+      .bind(4, static_cast<std::int64_t>(shard->count))
+      .bind(5, inputs_json(task.inputs))
+      .bind(6, to_json_string(task.params))
+      .run();
+
+  Statement parts(db_,
+                  "SELECT inputs, params FROM shard_parts "
+                  "WHERE task_type = ? AND video_id = ? AND shard_count = ? "
+                  "ORDER BY shard_index");
+  parts.bind(1, task.task_type)
+      .bind(2, task.video_id)
+      .bind(3, static_cast<std::int64_t>(shard->count));
+  NewTask joined;
+  joined.task_type = task.task_type;
+  joined.video_id = task.video_id;
+  int found = 0;
+  while (parts.step()) {
+    for (const Json::Value& item : parse_json(parts.column_text(0))) {
+      TaskInput input = task_input_from_json(item);
+      // Shards share inputs such as the source video; keep one of each.
+      if (std::none_of(joined.inputs.begin(), joined.inputs.end(),
+                       [&](const TaskInput& i) { return same_input(i, input); })) {
+        joined.inputs.push_back(std::move(input));
+      }
+    }
+    if (found++ == 0) {
+      joined.params = parse_json(parts.column_text(1));
+    }
+  }
+  parts.reset();
+  if (found < shard->count) {
+    return std::nullopt;  // siblings still running
+  }
+  joined.params.removeMember("shard");
+  joined.params["shards"] = shard->count;
+
+  Statement clear(db_, "DELETE FROM shard_parts WHERE task_type = ? AND video_id = ?");
+  clear.bind(1, task.task_type).bind(2, task.video_id).run();
+  return insert(joined, now);
+}
+
+std::vector<std::int64_t> TaskStore::create(std::span<const NewTask> tasks) {
+  std::lock_guard lock(mutex_);
+  std::int64_t now = unix_millis();
+  Transaction tx(db_);
+  std::vector<std::int64_t> ids;
+  ids.reserve(tasks.size());
+  for (const NewTask& task : tasks) {
+    ids.push_back(insert(task, now));
+  }
+  tx.commit();
+  return ids;
+}
+
+std::vector<Task> TaskStore::pull(std::span<const std::string> task_types, std::size_t limit) {
+  if (task_types.empty() || limit == 0) {
+    return {};
+  }
+  // One index range scan per type, each stopping after `limit` rows, then a
+  // merge of at most types * limit rows. Cost is independent of how many
+  // tasks are queued or have ever completed.
+  std::string sql = "SELECT * FROM (";
+  for (std::size_t i = 0; i < task_types.size(); ++i) {
+    if (i > 0) {
+      sql += " UNION ALL ";
+    }
+    sql += std::string("SELECT * FROM (SELECT ") + kPendingColumns +
+           " FROM pending_tasks WHERE task_type = ? ORDER BY created_at, task_id LIMIT ?)";
+  }
+  sql += ") ORDER BY created_at, task_id LIMIT ?";
+
+  static Histogram& seconds = store_seconds("pull");
+  ScopedTrace span("store.pull", "store", static_cast<std::int64_t>(limit));
+  auto start = std::chrono::steady_clock::now();
+  std::lock_guard lock(mutex_);
+  Statement s(db_, sql);
+  int index = 1;
+  for (const std::string& type : task_types) {
+    s.bind(index++, type);
+    s.bind(index++, static_cast<std::int64_t>(limit));
+  }
+  s.bind(index, static_cast<std::int64_t>(limit));
+  std::vector<Task> tasks;
+  while (s.step()) {
+    tasks.push_back(read_task(s, TaskState::Pending));
+  }
+  seconds.observe(seconds_since(start));
+  return tasks;
+}
+
+std::vector<CompletionResult> TaskStore::complete(std::span<const TaskCompletion> completions) {
+  static Histogram& seconds = store_seconds("complete");
+  ScopedTrace span("store.complete", "store", static_cast<std::int64_t>(completions.size()));
+  auto start = std::chrono::steady_clock::now();
+  std::lock_guard lock(mutex_);
+  std::int64_t now = unix_millis();
+  Transaction tx(db_);
+  Statement archive(db_,
+                    "INSERT INTO task_history "
+                    "SELECT task_id, task_type, video_id, inputs, params, created_at, ? "
+                    "FROM pending_tasks WHERE task_id = ?");
+  Statement remove(db_, "DELETE FROM pending_tasks WHERE task_id = ?");
+  Statement in_history(db_, "SELECT 1 FROM task_history WHERE task_id = ?");
+
+  std::vector<CompletionResult> results;
+  results.reserve(completions.size());
+  for (const TaskCompletion& c : completions) {
+    CompletionResult r;
+    r.task_id = c.task_id;
+    archive.reset();
+    archive.bind(1, now).bind(2, c.task_id).run();
+    if (db_.changes() == 1) {
+      remove.reset();
+      remove.bind(1, c.task_id).run();
+      r.status = CompletionStatus::Completed;
+      for (const NewTask& task : c.publish) {
+        if (auto id = publish(task, now)) {
+          r.published.push_back(*id);
+        }
+      }
+    } else {
+      in_history.reset();
+      in_history.bind(1, c.task_id);
+      r.status = in_history.step() ? CompletionStatus::AlreadyComplete : CompletionStatus::NotFound;
+    }
+    results.push_back(std::move(r));
+  }
+  tx.commit();
+  seconds.observe(seconds_since(start));
+  return results;
+}
+
+std::optional<Task> TaskStore::get(std::int64_t task_id) {
+  std::lock_guard lock(mutex_);
+  Statement pending(db_, std::string("SELECT ") + kPendingColumns +
+                             " FROM pending_tasks WHERE task_id = ?");
+  pending.bind(1, task_id);
+  if (pending.step()) {
+    return read_task(pending, TaskState::Pending);
+  }
+  Statement history(db_, std::string("SELECT ") + kHistoryColumns +
+                             " FROM task_history WHERE task_id = ?");
+  history.bind(1, task_id);
+  if (history.step()) {
+    return read_task(history, TaskState::Complete);
+  }
+  return std::nullopt;
+}
+
+std::optional<std::string> TaskStore::lookup_content(const VideoContent& content) {
+  Statement s(db_, "SELECT video_id FROM video_content WHERE fingerprint = ? AND size = ?");
+  s.bind(1, content.fingerprint).bind(2, content.size);
+  if (s.step()) {
+    return s.column_text(0);
+  }
+  return std::nullopt;
+}
+
+void TaskStore::claim_content(const VideoContent& content, const std::string& video_id,
+                              std::int64_t now) {
+  Statement claim(db_,
+                  "INSERT OR REPLACE INTO video_content (fingerprint, size, video_id, "
+                  "ingested_at) VALUES (?, ?, ?, ?)");
+  claim.bind(1, content.fingerprint).bind(2, content.size).bind(3, video_id).bind(4, now).run();
+}
+
+std::optional<std::string> TaskStore::original_of(const std::string& video_id) {
+  std::lock_guard lock(mutex_);
+  Statement s(db_, "SELECT original_id FROM video_links WHERE video_id = ?");
+  s.bind(1, video_id);
+  if (s.step()) {
+    return s.column_text(0);
+  }
+  return std::nullopt;
+}
+
+std::map<std::string, std::vector<std::string>> TaskStore::copies_of(
+    std::span<const std::string> original_ids) {
+  std::map<std::string, std::vector<std::string>> copies;
+  if (original_ids.empty()) {
+    return copies;
+  }
+  std::string sql = "SELECT original_id, video_id FROM video_links WHERE original_id IN (?";
+  for (std::size_t i = 1; i < original_ids.size(); ++i) {
+    sql += ", ?";
+  }
+  sql += ") ORDER BY linked_at, video_id";
+  std::lock_guard lock(mutex_);
+  Statement s(db_, sql);
+  int index = 1;
+  for (const std::string& id : original_ids) {
+    s.bind(index++, std::string_view(id));
+  }
+  while (s.step()) {
+    copies[s.column_text(0)].push_back(s.column_text(1));
+  }
+  return copies;
+}
+
+std::optional<std::string> TaskStore::find_content(const VideoContent& content) {
+  std::lock_guard lock(mutex_);
+  return lookup_content(content);
+}
+
+IngestRecord TaskStore::ingest(const std::string& video_id, const VideoContent& content,
+                               std::span<const NewTask> tasks, bool reprocess) {
+  static Histogram& seconds = store_seconds("ingest");
+  ScopedTrace span("store.ingest", "store", static_cast<std::int64_t>(tasks.size()));
+  auto start = std::chrono::steady_clock::now();
+  std::lock_guard lock(mutex_);
+  std::int64_t now = unix_millis();
+  Transaction tx(db_);
+  IngestRecord record;
+  if (!reprocess) {
+    record.duplicate_of = lookup_content(content);
+  }
+  if (record.duplicate_of) {
+    // The same file synced again under its own name needs no link.
+    if (*record.duplicate_of != video_id) {
+      Statement link(db_,
+                     "INSERT OR REPLACE INTO video_links (video_id, original_id, linked_at) "
+                     "VALUES (?, ?, ?)");
+      link.bind(1, video_id).bind(2, *record.duplicate_of).bind(3, now).run();
+    }
+  } else {
+    claim_content(content, video_id, now);
+    record.task_ids.reserve(tasks.size());
+    for (const NewTask& task : tasks) {
+      record.task_ids.push_back(insert(task, now));
+    }
+  }
+  tx.commit();
+  seconds.observe(seconds_since(start));
+  return record;
+}
+
+std::optional<std::vector<std::int64_t>> TaskStore::ingest_pair(
+    const std::string& front_id, const VideoContent& front, const std::string& rear_id,
+    const VideoContent& rear, std::span<const NewTask> tasks, bool reprocess) {
+  static Histogram& seconds = store_seconds("ingest");
+  ScopedTrace span("store.ingest", "store", static_cast<std::int64_t>(tasks.size()));
+  auto start = std::chrono::steady_clock::now();
+  // Both claims are on the content key: one file posted as both cameras
+  // would have the rear's claim replace the front's.
+  if (front == rear) {
+    return std::nullopt;
+  }
+  std::lock_guard lock(mutex_);
+  if (!reprocess && (lookup_content(front) || lookup_content(rear))) {
+    return std::nullopt;
+  }
+  std::int64_t now = unix_millis();
+  Transaction tx(db_);
+  claim_content(front, front_id, now);
+  claim_content(rear, rear_id, now);
+  std::vector<std::int64_t> ids;
+  ids.reserve(tasks.size());
+  for (const NewTask& task : tasks) {
+    ids.push_back(insert(task, now));
+  }
+  tx.commit();
+  seconds.observe(seconds_since(start));
+  return ids;
+}
+
+TaskStore::Counts TaskStore::counts() {
+  std::lock_guard lock(mutex_);
+  Counts c;
+  Statement pending(db_, "SELECT COUNT(*) FROM pending_tasks");
+  pending.step();
+  c.pending = pending.column_int(0);
+  Statement complete(db_, "SELECT COUNT(*) FROM task_history");
+  complete.step();
+  c.complete = complete.column_int(0);
+  return c;
+}
+
+}  // namespace dashcam::server
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "common/task.hpp"
+#include "server/sqlite.hpp"
+
+namespace dashcam::server {
+
+// A video's content as ingestion identifies it (main_server.md §5.1): the
+// sampled fingerprint_file() hash and the file size.
+struct VideoContent {
+  std::string fingerprint;  // to_hex(fingerprint_file(...))
+  std::int64_t size = 0;
+
+  bool operator==(const VideoContent&) const = default;
+};
+
+// What registering an ingested video did: queued its tasks, or linked it to
+// the video already ingested with the same content.
+struct IngestRecord {
+  std::vector<std::int64_t> task_ids;
+  std::optional<std::string> duplicate_of;
+};
+
+// The global task database (main_server.md §2), stored in SQLite. Tasks keep
+// the two persistent states; there is no claimed/in-progress column.
+//
+// Pending tasks live in their own table, indexed by (task_type, created_at),
+// so pulling the oldest tasks of a type is an O(log n) index seek however
+// much history exists. Completing a task moves its row to the append-only
+// task_history table. Thread-safe.
+class TaskStore {
+ public:
+  // Largest batch a device may pull at once (enforced by TaskQueue).
+  static constexpr std::size_t kMaxPullBatch = 256;
+
+  // ":memory:" gives a throwaway store.
+  explicit TaskStore(const std::filesystem::path& path);
+
+  // Inserts pending tasks in one transaction; returns their ids in order.
+  std::vector<std::int64_t> create(std::span<const NewTask> tasks);
+
+  // Up to `limit` oldest pending tasks whose type is one of `task_types`, in
+  // one query (task_system_overview.md §9: oldest first). Ignores leases;
+  // devices go through TaskQueue.
+  std::vector<Task> pull(std::span<const std::string> task_types, std::size_t limit);
+
+  // Applies every completion in one transaction. Remote tasks are published
+  // only by the call that actually moves a task to `complete`, so a retried
+  // completion can never publish twice.
+  //
+  // A published task carrying params["shard"] is one part of a sharded
+  // video's follow-up (main_server.md §5.1). Parts are held back until all
+  // `count` parts with the same type and video_id are in; the completion
+  // delivering the last one publishes a single joined task instead, with
+  // every part's inputs in shard order and params["shards"] = count.
+  std::vector<CompletionResult> complete(std::span<const TaskCompletion> completions);
+
+  std::optional<Task> get(std::int64_t task_id);
+
+  // The video first ingested with `content`, if any.
+  std::optional<std::string> find_content(const VideoContent& content);
+
+  // The video `video_id` was linked to at ingestion as a copy of it, if any,
+  // and the reverse: the videos linked to each of `original_ids` that has
+  // any, oldest first, in one query.
+  std::optional<std::string> original_of(const std::string& video_id);
+  std::map<std::string, std::vector<std::string>> copies_of(
+      std::span<const std::string> original_ids);
+
+  // Registers an ingested video in one transaction, so two syncs of the same
+  // file racing each other queue it once. Content seen before links
+  // `video_id` to the video it was first ingested as (video_links) and
+  // queues nothing; new content is recorded as `video_id`'s and `tasks` are
+  // queued. With `reprocess` the tasks are queued regardless and the content
+  // is recorded as `video_id`'s from then on.
+  IngestRecord ingest(const std::string& video_id, const VideoContent& content,
+                      std::span<const NewTask> tasks, bool reprocess = false);
+
+  // ingest() for a front/rear pair queued as one set of `tasks`: when
+  // neither content has been seen (or with `reprocess`), both are recorded
+  // and the tasks queued in one transaction. Otherwise, or when the two
+  // have the same content, nothing is written and the result is empty; the
+  // caller ingests the two videos separately.
+  std::optional<std::vector<std::int64_t>> ingest_pair(const std::string& front_id,
+                                                       const VideoContent& front,
+                                                       const std::string& rear_id,
+                                                       const VideoContent& rear,
+                                                       std::span<const NewTask> tasks,
+                                                       bool reprocess = false);
+
+  struct Counts {
+    std::int64_t pending = 0;
+    std::int64_t complete = 0;
+  };
+  Counts counts();
+
+ private:
+  // Creates or upgrades the schema (PRAGMA user_version) in one transaction.
+  void migrate();
+  std::int64_t insert(const NewTask& task, std::int64_t now);
+  // insert(), or the shard join; empty while sibling parts are outstanding.
+  std::optional<std::int64_t> publish(const NewTask& task, std::int64_t now);
+  // find_content() and recording content as `video_id`'s, with mutex_ held.
+  std::optional<std::string> lookup_content(const VideoContent& content);
+  void claim_content(const VideoContent& content, const std::string& video_id, std::int64_t now);
+
+  std::mutex mutex_;
+  Database db_;
+};
+
+// Milliseconds since the Unix epoch.
+std::int64_t unix_millis();
+
+}  // namespace dashcam::server
@@ -0,0 +1,97 @@
+#include "server/tile_api.hpp"
+
+#include <charconv>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace dashcam::server {
+
+namespace {
+
+void put_varint(std::string& out, std::uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<char>(value));
+}
+
+void put_u32(std::string& out, std::uint32_t value) {
+  for (int i = 0; i < 4; ++i) {
+    out.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+  }
+}
+
+std::optional<std::uint32_t> parse_u32(std::string_view text) {
+  std::uint32_t value = 0;
+  auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+  if (ec != std::errc() || end != text.data() + text.size() || text.empty()) {
+    return std::nullopt;
+  }
+  return value;
+}
+
+}  // namespace
+
+std::string encode_tile(const TileCounts& tile) {
+  std::string out = "DCHT";
+  out.push_back(1);
+  out.push_back(static_cast<char>(tile.z));
+  out.push_back(static_cast<char>(kTileBinBits));
+  out.push_back(0);
+  put_u32(out, tile.x);
+  put_u32(out, tile.y);
+  put_varint(out, tile.cells.size());
+  std::int64_t previous = -1;
+  for (const auto& [index, count] : tile.cells) {
+    put_varint(out, static_cast<std::uint64_t>(index - previous - 1));
+    put_varint(out, count);
+    previous = index;
+  }
+  return out;
+}
+
+std::optional<http::Response> TileApi::handle(const http::Request& request) {
+  std::string_view path = request.path();
+  if (path.substr(0, 7) != "/tiles/") {
+    return std::nullopt;
+  }
+  if (request.method != "GET") {
+    return http::error_response(405, "GET only");
+  }
+  std::vector<std::uint32_t> zxy;
+  std::string_view rest = path.substr(7);
+  while (zxy.size() < 4) {
+    std::size_t slash = rest.find('/');
+    std::optional<std::uint32_t> value = parse_u32(rest.substr(0, slash));
+    if (!value) {
+      return http::error_response(404, "tiles are /tiles/<z>/<x>/<y>");
+    }
+    zxy.push_back(*value);
+    if (slash == std::string_view::npos) {
+      break;
+    }
+    rest.remove_prefix(slash + 1);
+  }
+  if (zxy.size() != 3) {
+    return http::error_response(404, "tiles are /tiles/<z>/<x>/<y>");
+  }
+  try {
+    std::optional<std::int64_t> from = request.query_seconds_us("from");
+    std::optional<std::int64_t> to = request.query_seconds_us("to");
+    if (zxy[0] > static_cast<std::uint32_t>(kMaxTileZoom) || zxy[1] >> zxy[0] != 0 ||
+        zxy[2] >> zxy[0] != 0) {
+      return http::error_response(404, "no such tile");
+    }
+    TileCounts tile = sightings_.tile(static_cast<int>(zxy[0]), zxy[1], zxy[2], from, to);
+    http::Response response;
+    response.content_type = "application/octet-stream";
+    response.body = encode_tile(tile);
+    return response;
+  } catch (const std::invalid_argument& e) {
+    return http::error_response(400, e.what());
+  }
+}
+
+}  // namespace dashcam::server
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <optional>
+#include <string>
+
+#include "common/http/http_message.hpp"
+#include "server/sighting_index.hpp"
+
+namespace dashcam::server {
+
+// Heatmap tiles for the WebUI map (web_ui_overview.md §3.5, §5.4):
+//
+//   GET /tiles/<z>/<x>/<y>?from=T&to=T   -> application/octet-stream
+//
+// z is 0-15 (Web Mercator, y down from the north); from and to are UTC
+// seconds, inclusive, rounded out to whole UTC days. The body is the tile
+// as encode_tile() writes it.
+class TileApi {
+ public:
+  explicit TileApi(SightingIndex& sightings) : sightings_(sightings) {}
+
+  // Empty when the request is not for a tile route.
+  std::optional<http::Response> handle(const http::Request& request);
+
+ private:
+  SightingIndex& sightings_;
+};
+
+// Binary tile, little-endian:
+//   magic "DCHT", u8 version (1), u8 z, u8 grid bits (5: 32 x 32), u8 0,
+//   u32 x, u32 y, varint n, then n pairs of varints (index gap, count)
+// where the bins are in ascending row-major index order and each gap is
+// the index minus the previous one (minus -1 for the first). Varints are
+// LEB128. An empty tile is 17 bytes; a full one at most about 5 KB.
+std::string encode_tile(const TileCounts& tile);
+
+}  // namespace dashcam::server
@@ -0,0 +1,248 @@
+#include "server/video_index.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace dashcam::server {
+
+namespace {
+
+using Bytes = std::span<const std::uint8_t>;
+
+std::runtime_error malformed(const std::filesystem::path& path, const std::string& why) {
+  return std::runtime_error("malformed video " + path.string() + ": " + why);
+}
+
+std::uint32_t be32(const std::uint8_t* p) {
+  return static_cast<std::uint32_t>(p[0]) << 24 | static_cast<std::uint32_t>(p[1]) << 16 |
+         static_cast<std::uint32_t>(p[2]) << 8 | static_cast<std::uint32_t>(p[3]);
+}
+
+std::uint64_t be64(const std::uint8_t* p) {
+  return static_cast<std::uint64_t>(be32(p)) << 32 | be32(p + 4);
+}
+
+// Payload of the first child box of `parent` with the given type. ISO BMFF
+// boxes are a 32-bit size and a four-character type, with a 64-bit size
+// following when the 32-bit one is 1, and 0 meaning "to the end".
+std::optional<Bytes> child(Bytes parent, const char* type, const std::filesystem::path& path) {
+  std::size_t pos = 0;
+  while (parent.size() - pos >= 8) {
+    std::uint64_t size = be32(parent.data() + pos);
+    std::size_t header = 8;
+    if (size == 1) {
+      if (parent.size() - pos < 16) {
+        throw malformed(path, "truncated box header");
+      }
+      size = be64(parent.data() + pos + 8);
+      header = 16;
+    } else if (size == 0) {
+      size = parent.size() - pos;
+    }
+    if (size < header || size > parent.size() - pos) {
+      throw malformed(path, "box overruns its parent");
+    }
+    if (std::memcmp(parent.data() + pos + 4, type, 4) == 0) {
+      return parent.subspan(pos + header, size - header);
+    }
+    pos += size;
+  }
+  return std::nullopt;
+}
+
+// Every child box of `parent` with the given type, in order.
+std::vector<Bytes> children(Bytes parent, const char* type, const std::filesystem::path& path) {
+  std::vector<Bytes> out;
+  while (auto box = child(parent, type, path)) {
+    out.push_back(*box);
+    // Continue after this box; its payload ends inside `parent`.
+    std::size_t end = static_cast<std::size_t>(box->data() + box->size() - parent.data());
+    parent = parent.subspan(end);
+  }
+  return out;
+}
+
+Bytes require_size(Bytes box, std::size_t size, const char* what,
+                   const std::filesystem::path& path) {
+  if (box.size() < size) {
+    throw malformed(path, std::string("truncated ") + what);
+  }
+  return box;
+}
+
+// The whole `moov` box, or empty if the file has none.
+std::vector<std::uint8_t> read_moov(const std::filesystem::path& path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    throw std::runtime_error("cannot open " + path.string());
+  }
+  auto file_size = std::filesystem::file_size(path);
+  std::uint64_t pos = 0;
+  while (file_size - pos >= 8) {
+    std::uint8_t header[16];
+    in.seekg(static_cast<std::streamoff>(pos));
+    if (!in.read(reinterpret_cast<char*>(header), 8)) {
+      throw std::runtime_error("read failed: " + path.string());
+    }
+    std::uint64_t size = be32(header);
+    std::uint64_t header_size = 8;
+    if (size == 1) {
+      if (!in.read(reinterpret_cast<char*>(header + 8), 8)) {
+        throw malformed(path, "truncated box header");
+      }
+      size = be64(header + 8);
+      header_size = 16;
+    } else if (size == 0) {
+      size = file_size - pos;
+    }
+    if (size < header_size || size > file_size - pos) {
+      throw malformed(path, "top-level box overruns the file");
+    }
+    if (std::memcmp(header + 4, "moov", 4) == 0) {
+      std::vector<std::uint8_t> moov(static_cast<std::size_t>(size - header_size));
+      if (!in.read(reinterpret_cast<char*>(moov.data()),
+                   static_cast<std::streamsize>(moov.size()))) {
+        throw std::runtime_error("read failed: " + path.string());
+      }
+      return moov;
+    }
+    pos += size;  // mdat and friends are skipped, never read
+  }
+  return {};
+}
+
+std::optional<VideoIndex> read_mp4_index(const std::filesystem::path& path) {
+  std::vector<std::uint8_t> moov_bytes = read_moov(path);
+  if (moov_bytes.empty()) {
+    throw malformed(path, "no moov box");
+  }
+  Bytes moov(moov_bytes);
+  for (Bytes trak : children(moov, "trak", path)) {
+    auto mdia = child(trak, "mdia", path);
+    if (!mdia) {
+      continue;
+    }
+    // hdlr: version/flags, pre_defined, handler_type.
+    auto hdlr = child(*mdia, "hdlr", path);
+    if (!hdlr || hdlr->size() < 12 || std::memcmp(hdlr->data() + 8, "vide", 4) != 0) {
+      continue;
+    }
+    auto minf = child(*mdia, "minf", path);
+    auto stbl = minf ? child(*minf, "stbl", path) : std::nullopt;
+    if (!stbl) {
+      throw malformed(path, "video track without a sample table");
+    }
+
+    VideoIndex index;
+    if (auto stsz = child(*stbl, "stsz", path)) {
+      // version/flags, sample_size, sample_count
+      index.frame_count = be32(require_size(*stsz, 12, "stsz", path).data() + 8);
+    } else if (auto stz2 = child(*stbl, "stz2", path)) {
+      // version/flags, reserved + field_size, sample_count
+      index.frame_count = be32(require_size(*stz2, 12, "stz2", path).data() + 8);
+    }
+    if (index.frame_count == 0) {
+      return std::nullopt;  // fragmented: samples live in moof boxes
+    }
+
+    if (auto stss = child(*stbl, "stss", path)) {
+      // version/flags, entry_count, 1-based sync sample numbers
+      std::uint32_t count = be32(require_size(*stss, 8, "stss", path).data() + 4);
+      require_size(*stss, 8 + static_cast<std::size_t>(count) * 4, "stss", path);
+      index.keyframes.reserve(count + 1);
+      for (std::uint32_t i = 0; i < count; ++i) {
+        std::int64_t sample = be32(stss->data() + 8 + i * 4);
+        if (sample >= 1 && sample <= index.frame_count) {
+          index.keyframes.push_back(sample - 1);
+        }
+      }
+      std::sort(index.keyframes.begin(), index.keyframes.end());
+      index.keyframes.erase(std::unique(index.keyframes.begin(), index.keyframes.end()),
+                            index.keyframes.end());
+    } else {
+      // No sync sample table: every sample is a sync sample.
+      index.keyframes.resize(static_cast<std::size_t>(index.frame_count));
+      std::iota(index.keyframes.begin(), index.keyframes.end(), std::int64_t(0));
+    }
+    if (index.keyframes.empty() || index.keyframes.front() != 0) {
+      // Decoding always starts at frame 0 for the first range.
+      index.keyframes.insert(index.keyframes.begin(), 0);
+    }
+
+    // mdhd timescale (offset 12, or 20 in version 1) over the first stts delta.
+    auto mdhd = child(*mdia, "mdhd", path);
+    auto stts = child(*stbl, "stts", path);
+    if (mdhd && stts && mdhd->size() >= 24 && stts->size() >= 16 && be32(stts->data() + 4) > 0) {
+      std::uint32_t timescale = be32(mdhd->data() + ((*mdhd)[0] == 1 ? 20 : 12));
+      std::uint32_t delta = be32(stts->data() + 12);
+      index.fps = delta > 0 ? static_cast<double>(timescale) / delta : 0.0;
+    }
+    return index;
+  }
+  throw malformed(path, "no video track");
+}
+
+// Matches the worker's Y4mDecoder: 4:2:0 frames behind bare "FRAME\n" headers.
+VideoIndex read_y4m_index(const std::filesystem::path& path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    throw std::runtime_error("cannot open " + path.string());
+  }
+  std::string header;
+  std::getline(in, header);
+  std::istringstream fields(header);
+  std::string token;
+  fields >> token;
+  if (token != "YUV4MPEG2") {
+    throw malformed(path, "missing YUV4MPEG2 signature");
+  }
+  std::int64_t width = 0;
+  std::int64_t height = 0;
+  VideoIndex index;
+  while (fields >> token) {
+    if (token[0] == 'W') {
+      width = std::stoll(token.substr(1));
+    } else if (token[0] == 'H') {
+      height = std::stoll(token.substr(1));
+    } else if (token[0] == 'F') {
+      auto colon = token.find(':');
+      double num = std::stod(token.substr(1, colon - 1));
+      double den = colon == std::string::npos ? 1.0 : std::stod(token.substr(colon + 1));
+      index.fps = den > 0 ? num / den : 0.0;
+    }
+  }
+  if (width <= 0 || height <= 0) {
+    throw malformed(path, "missing frame size");
+  }
+  auto body = static_cast<std::uintmax_t>(in.tellg());
+  auto frame_bytes = static_cast<std::uintmax_t>(width * height * 3 / 2 + 6);
+  index.frame_count =
+      static_cast<std::int64_t>((std::filesystem::file_size(path) - body) / frame_bytes);
+  index.keyframes.resize(static_cast<std::size_t>(std::max<std::int64_t>(index.frame_count, 1)));
+  std::iota(index.keyframes.begin(), index.keyframes.end(), std::int64_t(0));
+  return index;
+}
+
+}  // namespace
+
+std::optional<VideoIndex> read_video_index(const std::filesystem::path& path) {
+  std::string ext = path.extension().string();
+  std::transform(ext.begin(), ext.end(), ext.begin(),
+                 [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+  if (ext == ".y4m") {
+    return read_y4m_index(path);
+  }
+  if (ext == ".mp4" || ext == ".mov") {
+    return read_mp4_index(path);
+  }
+  return std::nullopt;
+}
+
+}  // namespace dashcam::server
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+namespace dashcam::server {
+
+// Frame layout of a video, read from its container without decoding
+// anything. Frame numbers are sample numbers in stream order, the same
+// numbering the worker's decoder uses.
+struct VideoIndex {
+  std::int64_t frame_count = 0;
+  std::vector<std::int64_t> keyframes;  // ascending; always starts with 0
+  double fps = 0.0;                     // 0 when unknown
+};
+
+// Reads the sample tables of an MP4's first video track (stsz, stss, stts)
+// or the header of a .y4m clip, where every frame is a keyframe. Returns
+// std::nullopt for containers it cannot index (e.g. fragmented MP4); throws
+// std::runtime_error when the file cannot be read or is malformed
+// (main_server.md §5.1 validation).
+std::optional<VideoIndex> read_video_index(const std::filesystem::path& path);
+
+}  // namespace dashcam::server
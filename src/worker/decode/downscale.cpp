@@ -0,0 +1,58 @@
+#include "worker/decode/downscale.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace dashcam::worker {
+
+namespace {
+
+// CPU reference used when the tree is built without CUDA. Mirrors
+// downscale.cu exactly so CPU and GPU builds produce identical low-res planes.
+// `channels` interleaved samples per pixel are averaged independently.
+void downscale(const PlaneView& src, const PlaneView& dst, int channels) {
+  std::vector<int> x_begin(static_cast<std::size_t>(dst.width) + 1);
+  for (int dx = 0; dx <= dst.width; ++dx) {
+    x_begin[static_cast<std::size_t>(dx)] =
+        static_cast<int>(static_cast<std::int64_t>(dx) * src.width / dst.width);
+  }
+
+  for (int dy = 0; dy < dst.height; ++dy) {
+    int y0 = static_cast<int>(static_cast<std::int64_t>(dy) * src.height / dst.height);
+    int y1 = static_cast<int>(static_cast<std::int64_t>(dy + 1) * src.height / dst.height);
+    if (y1 <= y0) {
+      y1 = y0 + 1;
+    }
+    std::uint8_t* out = dst.row(dy);
+    for (int dx = 0; dx < dst.width; ++dx) {
+      int x0 = x_begin[static_cast<std::size_t>(dx)];
+      int x1 = x_begin[static_cast<std::size_t>(dx) + 1];
+      if (x1 <= x0) {
+        x1 = x0 + 1;
+      }
+      auto area = static_cast<std::uint32_t>((x1 - x0) * (y1 - y0));
+      for (int c = 0; c < channels; ++c) {
+        std::uint32_t sum = 0;
+        for (int y = y0; y < y1; ++y) {
+          const std::uint8_t* in = src.row(y);
+          for (int x = x0; x < x1; ++x) {
+            sum += in[x * channels + c];
+          }
+        }
+        out[dx * channels + c] = static_cast<std::uint8_t>((sum + area / 2) / area);
+      }
+    }
+  }
+}
+
+}  // namespace
+
+void downscale_plane(const PlaneView& src, const PlaneView& dst, GpuStream /*stream*/) {
+  downscale(src, dst, 1);
+}
+
+void downscale_chroma(const PlaneView& src, const PlaneView& dst, GpuStream /*stream*/) {
+  downscale(src, dst, 2);
+}
+
+}  // namespace dashcam::worker
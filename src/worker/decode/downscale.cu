@@ -0,0 +1,57 @@
+#include "worker/decode/downscale.hpp"
+
+#include <cstdint>
+
+namespace dashcam::worker {
+
+namespace {
+
+__global__ void downscale_kernel(const std::uint8_t* src, int src_w, int src_h,
+                                 std::size_t src_pitch, std::uint8_t* dst, int dst_w, int dst_h,
+                                 std::size_t dst_pitch, int channels) {
+  int dx = blockIdx.x * blockDim.x + threadIdx.x;
+  int dy = blockIdx.y * blockDim.y + threadIdx.y;
+  if (dx >= dst_w || dy >= dst_h) {
+    return;
+  }
+  int x0 = static_cast<int>(static_cast<long long>(dx) * src_w / dst_w);
+  int x1 = static_cast<int>(static_cast<long long>(dx + 1) * src_w / dst_w);
+  int y0 = static_cast<int>(static_cast<long long>(dy) * src_h / dst_h);
+  int y1 = static_cast<int>(static_cast<long long>(dy + 1) * src_h / dst_h);
+  x1 = max(x1, x0 + 1);
+  y1 = max(y1, y0 + 1);
+
+  unsigned area = static_cast<unsigned>((x1 - x0) * (y1 - y0));
+  for (int c = 0; c < channels; ++c) {
+    unsigned sum = 0;
+    for (int y = y0; y < y1; ++y) {
+      const std::uint8_t* in = src + static_cast<std::size_t>(y) * src_pitch;
+      for (int x = x0; x < x1; ++x) {
+        sum += in[x * channels + c];
+      }
+    }
+    dst[static_cast<std::size_t>(dy) * dst_pitch + dx * channels + c] =
+        static_cast<std::uint8_t>((sum + area / 2) / area);
+  }
+}
+
+void launch(const PlaneView& src, const PlaneView& dst, int channels, GpuStream stream) {
+  dim3 block(32, 8);
+  dim3 grid((dst.width + block.x - 1) / block.x, (dst.height + block.y - 1) / block.y);
+  downscale_kernel<<<grid, block, 0, stream>>>(src.data, src.width, src.height, src.pitch,
+                                                dst.data, dst.width, dst.height, dst.pitch,
+                                                channels);
+  DASHCAM_CUDA_CHECK(cudaGetLastError());
+}
+
+}  // namespace
+
+void downscale_plane(const PlaneView& src, const PlaneView& dst, GpuStream stream) {
+  launch(src, dst, 1, stream);
+}
+
+void downscale_chroma(const PlaneView& src, const PlaneView& dst, GpuStream stream) {
+  launch(src, dst, 2, stream);
+}
+
+}  // namespace dashcam::worker
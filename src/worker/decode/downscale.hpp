@@ -0,0 +1,17 @@
+#pragma once
+
+#include "worker/decode/frame_surface.hpp"
+#include "worker/gpu/gpu.hpp"
+
+namespace dashcam::worker {
+
+// Area-averaging downscale of an 8-bit plane. Both views are kernel-side
+// pointers (FrameSurface::luma() / lowres_device()); on CUDA builds the work is
+// queued on `stream` and the caller synchronizes before reading the result.
+void downscale_plane(const PlaneView& src, const PlaneView& dst, GpuStream stream);
+
+// Same for an NV12 chroma plane: widths count interleaved UV pairs, and U and
+// V are averaged separately.
+void downscale_chroma(const PlaneView& src, const PlaneView& dst, GpuStream stream);
+
+}  // namespace dashcam::worker
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "worker/gpu/gpu_buffer.hpp"
+
+namespace dashcam::worker {
+
+// Non-owning view of one 8-bit image plane.
+struct PlaneView {
+  std::uint8_t* data = nullptr;
+  int width = 0;
+  int height = 0;
+  std::size_t pitch = 0;  // bytes between row starts
+
+  std::uint8_t* row(int y) const { return data + static_cast<std::size_t>(y) * pitch; }
+};
+
+// Dimensions shared by every surface decoded from one video.
+struct FrameGeometry {
+  int width = 0;
+  int height = 0;
+  int lowres_width = 0;
+  int lowres_height = 0;
+
+  bool operator==(const FrameGeometry&) const = default;
+};
+
+// One decoded frame, resident on the GPU for its whole life:
+//  - full-resolution NV12 (luma + interleaved chroma) in device memory, read by
+//    the full-res detector and the crop extractor;
+//  - a downscaled luma plane produced on the GPU from that same surface and
+//    placed in mapped pinned memory, read in place by the CPU motion filter.
+// The full-res pixels never travel to the host; only the small derived plane is
+// visible to the CPU, and it is written there by the kernel, not by a memcpy.
+class FrameSurface {
+ public:
+  explicit FrameSurface(const FrameGeometry& geometry);
+
+  const FrameGeometry& geometry() const { return geometry_; }
+
+  // Kernel-side views of the full-resolution planes.
+  PlaneView luma() const;
+  PlaneView chroma() const;  // width/2 interleaved UV pairs, height/2 rows
+
+  // Kernel-side (device alias) and CPU-side views of the low-res luma plane.
+  PlaneView lowres_device() const;
+  PlaneView lowres_host() const;
+
+  // Decode order position within the video, and presentation time.
+  std::int64_t frame_index = -1;
+  std::int64_t pts_us = 0;
+
+ private:
+  FrameGeometry geometry_;
+  std::size_t pitch_ = 0;
+  std::size_t lowres_pitch_ = 0;
+  GpuBuffer nv12_;
+  GpuBuffer lowres_;
+};
+
+// Frames are handed between stages by shared ownership; the last holder
+// returns the surface to its pool (see SurfacePool).
+using FramePtr = std::shared_ptr<FrameSurface>;
+
+}  // namespace dashcam::worker
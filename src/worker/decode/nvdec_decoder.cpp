@@ -0,0 +1,402 @@
+#include "worker/decode/nvdec_decoder.hpp"
+
+#include <cuda.h>
+#include <cuviddec.h>
+#include <nvcuvid.h>
+
+extern "C" {
+#include <libavcodec/bsf.h>
+#include <libavformat/avformat.h>
+#include <libavformat/avio.h>
+#include <libavutil/mem.h>
+}
+
+#include <cstdio>
+#include <deque>
+#include <exception>
+#include <string>
+#include <utility>
+
+#include "worker/decode/downscale.hpp"
+#include "worker/decode/surface_pool.hpp"
+#include "worker/gpu/device_info.hpp"
+#include "worker/gpu/gpu.hpp"
+#include "worker/gpu/gpu_stream.hpp"
+
+namespace dashcam::worker {
+
+namespace {
+
+void check_cu(CUresult status, const char* what) {
+  if (status != CUDA_SUCCESS) {
+    const char* name = nullptr;
+    cuGetErrorName(status, &name);
+    throw GpuError(std::string(what) + ": " + (name != nullptr ? name : "unknown CUDA error"));
+  }
+}
+
+void check_av(int status, const std::string& what) {
+  if (status < 0) {
+    char buffer[AV_ERROR_MAX_STRING_SIZE] = {};
+    av_strerror(status, buffer, sizeof(buffer));
+    throw std::runtime_error(what + ": " + buffer);
+  }
+}
+
+cudaVideoCodec to_nvdec_codec(AVCodecID id) {
+  switch (id) {
+    case AV_CODEC_ID_H264:
+      return cudaVideoCodec_H264;
+    case AV_CODEC_ID_HEVC:
+      return cudaVideoCodec_HEVC;
+    default:
+      throw std::runtime_error(std::string("unsupported codec ") + avcodec_get_name(id));
+  }
+}
+
+// Demuxer reads are small; the PrefetchReader turns them into large ones.
+constexpr int kAvioBufferBytes = 256 << 10;
+
+int avio_read(void* opaque, std::uint8_t* buffer, int size) {
+  auto* source = static_cast<PrefetchReader*>(opaque);
+  try {
+    std::size_t got = source->read(buffer, static_cast<std::size_t>(size));
+    return got == 0 ? AVERROR_EOF : static_cast<int>(got);
+  } catch (const std::exception& e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    return AVERROR(EIO);
+  }
+}
+
+std::int64_t avio_seek(void* opaque, std::int64_t offset, int whence) {
+  auto* source = static_cast<PrefetchReader*>(opaque);
+  switch (whence & ~AVSEEK_FORCE) {
+    case AVSEEK_SIZE:
+      return source->size();
+    case SEEK_SET:
+      break;
+    case SEEK_CUR:
+      offset += source->tell();
+      break;
+    case SEEK_END:
+      offset += source->size();
+      break;
+    default:
+      return AVERROR(EINVAL);
+  }
+  source->seek(offset);
+  return source->tell();
+}
+
+// MP4 stores parameter sets out of band; NVDEC's parser wants Annex-B.
+const char* annexb_filter(AVCodecID id) {
+  return id == AV_CODEC_ID_HEVC ? "hevc_mp4toannexb" : "h264_mp4toannexb";
+}
+
+}  // namespace
+
+struct NvdecDecoder::Impl {
+  DecoderConfig config;
+  VideoInfo info;
+  FrameGeometry geometry;
+
+  std::shared_ptr<PrefetchReader> source;
+  AVIOContext* avio = nullptr;
+  AVFormatContext* format = nullptr;
+  AVBSFContext* bsf = nullptr;
+  AVPacket* packet = nullptr;
+  int stream_index = -1;
+  AVRational time_base{1, 1};
+
+  CUdevice device = 0;
+  CUcontext context = nullptr;
+  CUvideoctxlock lock = nullptr;
+  CUvideoparser parser = nullptr;
+  CUvideodecoder decoder = nullptr;
+  unsigned surface_height = 0;
+
+  std::unique_ptr<SurfacePool> pool;
+  std::unique_ptr<OwnedStream> stream;
+  std::deque<CUVIDPARSERDISPINFO> ready;
+  std::int64_t next_index = 0;
+  std::int64_t end_index = -1;
+  bool flushed = false;
+  // Parser callbacks run inside C code; errors are parked here and rethrown
+  // once cuvidParseVideoData returns.
+  std::exception_ptr callback_error;
+
+  ~Impl() {
+    if (parser != nullptr) {
+      cuvidDestroyVideoParser(parser);
+    }
+    if (decoder != nullptr) {
+      cuvidDestroyDecoder(decoder);
+    }
+    if (lock != nullptr) {
+      cuvidCtxLockDestroy(lock);
+    }
+    stream.reset();
+    pool.reset();
+    if (context != nullptr) {
+      cuDevicePrimaryCtxRelease(device);
+    }
+    av_packet_free(&packet);
+    av_bsf_free(&bsf);
+    avformat_close_input(&format);
+    if (avio != nullptr) {
+      av_freep(&avio->buffer);
+      avio_context_free(&avio);
+    }
+  }
+
+  // Parser callback: creates the decoder for the stream's format. The return
+  // value tells the parser how many decode surfaces to cycle through.
+  static int CUDAAPI on_sequence(void* user, CUVIDEOFORMAT* format) {
+    auto* self = static_cast<Impl*>(user);
+    try {
+      return self->create_decoder(format);
+    } catch (...) {
+      self->callback_error = std::current_exception();
+      return 0;
+    }
+  }
+
+  int create_decoder(CUVIDEOFORMAT* format) {
+    if (decoder != nullptr) {
+      return 1;  // dashcam segments never change resolution mid-stream
+    }
+    CUVIDDECODECAPS caps{};
+    caps.eCodecType = format->codec;
+    caps.eChromaFormat = format->chroma_format;
+    caps.nBitDepthMinus8 = format->bit_depth_luma_minus8;
+    check_cu(cuvidGetDecoderCaps(&caps), "cuvidGetDecoderCaps");
+    if (!caps.bIsSupported || format->coded_width > caps.nMaxWidth ||
+        format->coded_height > caps.nMaxHeight) {
+      throw GpuError("NVDEC cannot decode this stream on the selected GPU");
+    }
+
+    CUVIDDECODECREATEINFO create{};
+    create.CodecType = format->codec;
+    create.ChromaFormat = format->chroma_format;
+    create.OutputFormat = cudaVideoSurfaceFormat_NV12;
+    create.bitDepthMinus8 = format->bit_depth_luma_minus8;
+    create.DeinterlaceMode = cudaVideoDeinterlaceMode_Weave;
+    create.ulWidth = format->coded_width;
+    create.ulHeight = format->coded_height;
+    create.ulMaxWidth = format->coded_width;
+    create.ulMaxHeight = format->coded_height;
+    create.display_area.left = static_cast<short>(format->display_area.left);
+    create.display_area.top = static_cast<short>(format->display_area.top);
+    create.display_area.right = static_cast<short>(format->display_area.right);
+    create.display_area.bottom = static_cast<short>(format->display_area.bottom);
+    create.ulTargetWidth = static_cast<unsigned long>(geometry.width);
+    create.ulTargetHeight = static_cast<unsigned long>(geometry.height);
+    create.ulNumDecodeSurfaces = format->min_num_decode_surfaces + 4;
+    create.ulNumOutputSurfaces = 2;
+    create.ulCreationFlags = cudaVideoCreate_PreferCUVID;
+    create.vidLock = lock;
+    check_cu(cuvidCreateDecoder(&decoder, &create), "cuvidCreateDecoder");
+    surface_height = static_cast<unsigned>(create.ulTargetHeight);
+    return static_cast<int>(create.ulNumDecodeSurfaces);
+  }
+
+  static int CUDAAPI on_decode(void* user, CUVIDPICPARAMS* picture) {
+    auto* self = static_cast<Impl*>(user);
+    CUresult status = cuvidDecodePicture(self->decoder, picture);
+    if (status != CUDA_SUCCESS) {
+      try {
+        check_cu(status, "cuvidDecodePicture");
+      } catch (...) {
+        self->callback_error = std::current_exception();
+      }
+      return 0;
+    }
+    return 1;
+  }
+
+  static int CUDAAPI on_display(void* user, CUVIDPARSERDISPINFO* display) {
+    auto* self = static_cast<Impl*>(user);
+    if (display != nullptr) {
+      self->ready.push_back(*display);
+    }
+    return 1;
+  }
+
+  // Pushes one demuxed packet through the parser. Returns false once the
+  // stream is exhausted and the parser has been flushed.
+  void parse(CUVIDSOURCEDATAPACKET* data) {
+    check_cu(cuvidParseVideoData(parser, data), "cuvidParseVideoData");
+    if (callback_error) {
+      std::rethrow_exception(std::exchange(callback_error, nullptr));
+    }
+  }
+
+  bool feed() {
+    if (flushed) {
+      return false;
+    }
+    while (true) {
+      int status = av_read_frame(format, packet);
+      if (status == AVERROR_EOF) {
+        CUVIDSOURCEDATAPACKET end{};
+        end.flags = CUVID_PKT_ENDOFSTREAM;
+        parse(&end);
+        flushed = true;
+        return !ready.empty();
+      }
+      check_av(status, "av_read_frame");
+      if (packet->stream_index != stream_index) {
+        av_packet_unref(packet);
+        continue;
+      }
+      check_av(av_bsf_send_packet(bsf, packet), "av_bsf_send_packet");
+      while (av_bsf_receive_packet(bsf, packet) == 0) {
+        CUVIDSOURCEDATAPACKET data{};
+        data.flags = CUVID_PKT_TIMESTAMP;
+        data.payload = packet->data;
+        data.payload_size = static_cast<unsigned long>(packet->size);
+        data.timestamp = av_rescale_q(packet->pts, time_base, AVRational{1, 1000000});
+        parse(&data);
+        av_packet_unref(packet);
+      }
+      return true;
+    }
+  }
+};
+
+NvdecDecoder::NvdecDecoder(std::shared_ptr<PrefetchReader> source, const DecoderConfig& config,
+                           const FrameRange& range)
+    : impl_(std::make_unique<Impl>()) {
+  Impl& d = *impl_;
+  d.config = config;
+  d.end_index = range.end;
+  d.source = std::move(source);
+  const std::filesystem::path& path = d.source->path();
+
+  auto* buffer = static_cast<std::uint8_t*>(av_malloc(kAvioBufferBytes));
+  d.avio = avio_alloc_context(buffer, kAvioBufferBytes, 0, d.source.get(), &avio_read, nullptr,
+                              &avio_seek);
+  if (d.avio == nullptr) {
+    av_free(buffer);
+    throw std::runtime_error("avio_alloc_context failed");
+  }
+  d.format = avformat_alloc_context();
+  d.format->pb = d.avio;
+  d.format->flags |= AVFMT_FLAG_CUSTOM_IO;
+  // avformat_open_input frees the context on failure.
+  check_av(avformat_open_input(&d.format, path.string().c_str(), nullptr, nullptr),
+           "open " + path.string());
+  check_av(avformat_find_stream_info(d.format, nullptr), "probe " + path.string());
+  d.stream_index = av_find_best_stream(d.format, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+  check_av(d.stream_index, "no video stream in " + path.string());
+  AVStream* stream = d.format->streams[d.stream_index];
+  AVCodecParameters* params = stream->codecpar;
+  d.time_base = stream->time_base;
+  d.info.width = params->width;
+  d.info.height = params->height;
+  d.info.fps = av_q2d(stream->avg_frame_rate);
+  d.info.frame_count = stream->nb_frames > 0 ? stream->nb_frames : -1;
+  d.geometry = make_geometry(params->width, params->height, config.lowres_width);
+
+  const AVBitStreamFilter* filter = av_bsf_get_by_name(annexb_filter(params->codec_id));
+  check_av(av_bsf_alloc(filter, &d.bsf), "av_bsf_alloc");
+  check_av(avcodec_parameters_copy(d.bsf->par_in, params), "avcodec_parameters_copy");
+  d.bsf->time_base_in = stream->time_base;
+  check_av(av_bsf_init(d.bsf), "av_bsf_init");
+  d.packet = av_packet_alloc();
+
+  if (range.first > 0) {
+    // MP4 index entries are samples in stream order, the numbering the
+    // server's video index used to place shard boundaries on keyframes.
+    // Dashcam encoders write closed GOPs, so nothing before the keyframe is
+    // needed and frame `first` is the first one displayed.
+    std::int64_t timestamp = 0;
+    const AVIndexEntry* entry = avformat_index_get_entry(stream, static_cast<int>(range.first));
+    if (entry != nullptr) {
+      timestamp = entry->timestamp;
+    } else {
+      timestamp = av_rescale_q(range.first, av_inv_q(stream->avg_frame_rate), stream->time_base) +
+                  (stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0);
+    }
+    check_av(av_seek_frame(d.format, d.stream_index, timestamp, AVSEEK_FLAG_BACKWARD),
+             "seek " + path.string());
+    d.next_index = range.first;
+  }
+
+  check_cu(cuInit(0), "cuInit");
+  check_cu(cuDeviceGet(&d.device, config.gpu_device), "cuDeviceGet");
+  check_cu(cuDevicePrimaryCtxRetain(&d.context, d.device), "cuDevicePrimaryCtxRetain");
+  use_device(config.gpu_device);
+  check_cu(cuvidCtxLockCreate(&d.lock, d.context), "cuvidCtxLockCreate");
+
+  CUVIDPARSERPARAMS parser{};
+  parser.CodecType = to_nvdec_codec(params->codec_id);
+  parser.ulMaxNumDecodeSurfaces = 1;  // raised by on_sequence's return value
+  parser.ulMaxDisplayDelay = 2;       // lets decode run ahead of mapping
+  parser.pUserData = &d;
+  parser.pfnSequenceCallback = &Impl::on_sequence;
+  parser.pfnDecodePicture = &Impl::on_decode;
+  parser.pfnDisplayPicture = &Impl::on_display;
+  check_cu(cuvidCreateVideoParser(&d.parser, &parser), "cuvidCreateVideoParser");
+
+  d.pool = std::make_unique<SurfacePool>(d.geometry, config.surface_count);
+  d.stream = std::make_unique<OwnedStream>();
+}
+
+NvdecDecoder::~NvdecDecoder() = default;
+
+const VideoInfo& NvdecDecoder::info() const { return impl_->info; }
+
+const FrameGeometry& NvdecDecoder::geometry() const { return impl_->geometry; }
+
+FramePtr NvdecDecoder::next() {
+  Impl& d = *impl_;
+  if (d.end_index >= 0 && d.next_index >= d.end_index) {
+    return nullptr;
+  }
+  use_device(d.config.gpu_device);
+  while (d.ready.empty()) {
+    if (!d.feed()) {
+      return nullptr;
+    }
+  }
+  CUVIDPARSERDISPINFO display = d.ready.front();
+  d.ready.pop_front();
+
+  // Acquire first: waiting on the pool while a decode surface is mapped would
+  // starve NVDEC of output surfaces.
+  FramePtr frame = d.pool->acquire();
+
+  CUVIDPROCPARAMS proc{};
+  proc.progressive_frame = display.progressive_frame;
+  proc.second_field = display.repeat_first_field + 1;
+  proc.top_field_first = display.top_field_first;
+  proc.unpaired_field = display.repeat_first_field < 0;
+  proc.output_stream = d.stream->get();
+
+  CUdeviceptr mapped = 0;
+  unsigned pitch = 0;
+  check_cu(cuvidMapVideoFrame(d.decoder, display.picture_index, &mapped, &pitch, &proc),
+           "cuvidMapVideoFrame");
+
+  // Device-to-device only: NVDEC's output surfaces are a small ring we must
+  // hand back quickly, so the frame is moved into a pool surface on-GPU.
+  auto* src = reinterpret_cast<const std::uint8_t*>(mapped);
+  auto row_bytes = static_cast<std::size_t>(d.geometry.width);
+  auto rows = static_cast<std::size_t>(d.geometry.height);
+  PlaneView luma = frame->luma();
+  PlaneView chroma = frame->chroma();
+  copy_2d_device(luma.data, luma.pitch, src, pitch, row_bytes, rows, d.stream->get());
+  copy_2d_device(chroma.data, chroma.pitch,
+                 src + static_cast<std::size_t>(pitch) * d.surface_height, pitch, row_bytes,
+                 rows / 2, d.stream->get());
+  downscale_plane(luma, frame->lowres_device(), d.stream->get());
+  d.stream->synchronize();
+  check_cu(cuvidUnmapVideoFrame(d.decoder, mapped), "cuvidUnmapVideoFrame");
+
+  frame->frame_index = d.next_index++;
+  frame->pts_us = display.timestamp;
+  return frame;
+}
+
+}  // namespace dashcam::worker
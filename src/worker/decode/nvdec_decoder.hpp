@@ -0,0 +1,35 @@
+#pragma once
+
+#include <memory>
+
+#include "worker/decode/video_decoder.hpp"
+
+namespace dashcam::worker {
+
+// Hardware decoder for the dashcam's H.264/HEVC MP4 segments. FFmpeg only
+// demuxes; NVDEC decodes into its own surfaces, which are copied device-to-device
+// into pool surfaces and downscaled on the GPU before the frame is handed out.
+// Only compiled with DASHCAM_WITH_NVDEC.
+//
+// A range starting past frame 0 seeks the demuxer straight to that keyframe
+// through the container's sample index, so a shard reads only its own part
+// of the file.
+//
+// The demuxer reads through `source` (custom AVIO), not the file itself, so
+// it is served from read-ahead blocks and the in-memory moov.
+class NvdecDecoder : public VideoDecoder {
+ public:
+  NvdecDecoder(std::shared_ptr<PrefetchReader> source, const DecoderConfig& config,
+               const FrameRange& range = {});
+  ~NvdecDecoder() override;
+
+  const VideoInfo& info() const override;
+  const FrameGeometry& geometry() const override;
+  FramePtr next() override;
+
+ private:
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace dashcam::worker
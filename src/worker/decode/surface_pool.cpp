@@ -0,0 +1,95 @@
+#include "worker/decode/surface_pool.hpp"
+
+#include <stdexcept>
+
+namespace dashcam::worker {
+
+namespace {
+
+// Row pitch used for every plane; matches the alignment cudaMallocPitch would
+// pick on current NVIDIA parts and keeps CPU rows SIMD-aligned.
+constexpr std::size_t kPitchAlignment = 256;
+
+std::size_t aligned_pitch(int width) {
+  auto w = static_cast<std::size_t>(width);
+  return (w + kPitchAlignment - 1) / kPitchAlignment * kPitchAlignment;
+}
+
+const FrameGeometry& validated(const FrameGeometry& geometry) {
+  bool even = geometry.width % 2 == 0 && geometry.height % 2 == 0;
+  if (geometry.width <= 0 || geometry.height <= 0 || !even || geometry.lowres_width <= 0 ||
+      geometry.lowres_height <= 0) {
+    throw std::invalid_argument("frame dimensions must be positive and even");
+  }
+  return geometry;
+}
+
+}  // namespace
+
+FrameSurface::FrameSurface(const FrameGeometry& geometry)
+    : geometry_(validated(geometry)),
+      pitch_(aligned_pitch(geometry.width)),
+      lowres_pitch_(aligned_pitch(geometry.lowres_width)),
+      nv12_(pitch_ * static_cast<std::size_t>(geometry.height) * 3 / 2, MemoryKind::Device),
+      lowres_(lowres_pitch_ * static_cast<std::size_t>(geometry.lowres_height),
+              MemoryKind::MappedHost) {}
+
+PlaneView FrameSurface::luma() const {
+  return {nv12_.device_ptr(), geometry_.width, geometry_.height, pitch_};
+}
+
+PlaneView FrameSurface::chroma() const {
+  return {nv12_.device_ptr() + pitch_ * static_cast<std::size_t>(geometry_.height),
+          geometry_.width / 2, geometry_.height / 2, pitch_};
+}
+
+PlaneView FrameSurface::lowres_device() const {
+  return {lowres_.device_ptr(), geometry_.lowres_width, geometry_.lowres_height, lowres_pitch_};
+}
+
+PlaneView FrameSurface::lowres_host() const {
+  return {lowres_.host_ptr(), geometry_.lowres_width, geometry_.lowres_height, lowres_pitch_};
+}
+
+SurfacePool::SurfacePool(const FrameGeometry& geometry, std::size_t count)
+    : geometry_(geometry), capacity_(count), state_(std::make_shared<State>()) {
+  if (count == 0) {
+    throw std::invalid_argument("surface pool needs at least one surface");
+  }
+  state_->free.reserve(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    state_->free.push_back(std::make_unique<FrameSurface>(geometry));
+  }
+}
+
+SurfacePool::~SurfacePool() = default;
+
+FramePtr SurfacePool::acquire() {
+  std::unique_lock lock(state_->mutex);
+  state_->returned.wait(lock, [&] { return !state_->free.empty(); });
+  FrameSurface* surface = state_->free.back().release();
+  state_->free.pop_back();
+  lock.unlock();
+
+  surface->frame_index = -1;
+  surface->pts_us = 0;
+  std::weak_ptr<State> weak = state_;
+  return FramePtr(surface, [weak](FrameSurface* s) {
+    if (auto state = weak.lock()) {
+      {
+        std::lock_guard guard(state->mutex);
+        state->free.emplace_back(s);
+      }
+      state->returned.notify_one();
+    } else {
+      delete s;
+    }
+  });
+}
+
+std::size_t SurfacePool::available() const {
+  std::lock_guard lock(state_->mutex);
+  return state_->free.size();
+}
+
+}  // namespace dashcam::worker
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "worker/decode/frame_surface.hpp"
+
+namespace dashcam::worker {
+
+// Fixed set of preallocated frame surfaces. Decoders draw from it and every
+// consumer releases by dropping its FramePtr, so allocation happens once per
+// video and the pool size bounds how far decode can run ahead of the stages
+// that still hold frames.
+class SurfacePool {
+ public:
+  SurfacePool(const FrameGeometry& geometry, std::size_t count);
+  ~SurfacePool();
+
+  SurfacePool(const SurfacePool&) = delete;
+  SurfacePool& operator=(const SurfacePool&) = delete;
+
+  const FrameGeometry& geometry() const { return geometry_; }
+  std::size_t capacity() const { return capacity_; }
+
+  // Blocks until a surface is free.
+  FramePtr acquire();
+
+  std::size_t available() const;
+
+ private:
+  struct State {
+    std::mutex mutex;
+    std::condition_variable returned;
+    std::vector<std::unique_ptr<FrameSurface>> free;
+  };
+
+  FrameGeometry geometry_;
+  std::size_t capacity_;
+  // Outstanding FramePtr deleters hold this weakly; frames released after the
+  // pool is destroyed are freed instead of returned.
+  std::shared_ptr<State> state_;
+};
+
+}  // namespace dashcam::worker
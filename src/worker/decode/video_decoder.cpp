@@ -0,0 +1,47 @@
+#include "worker/decode/video_decoder.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "worker/decode/y4m_decoder.hpp"
+
+#if DASHCAM_WITH_NVDEC
+#include "worker/decode/nvdec_decoder.hpp"
+#endif
+
+namespace dashcam::worker {
+
+FrameGeometry make_geometry(int width, int height, int lowres_width) {
+  FrameGeometry geometry;
+  geometry.width = width;
+  geometry.height = height;
+  int lw = std::min(lowres_width, width) & ~1;
+  int lh = static_cast<int>(static_cast<long long>(height) * lw / width) & ~1;
+  geometry.lowres_width = std::max(lw, 2);
+  geometry.lowres_height = std::max(lh, 2);
+  return geometry;
+}
+
+std::unique_ptr<VideoDecoder> open_decoder(std::shared_ptr<PrefetchReader> source,
+                                           const DecoderConfig& config,
+                                           const FrameRange& range) {
+  if (source->path().extension() == ".y4m") {
+    return std::make_unique<Y4mDecoder>(std::move(source), config, range);
+  }
+#if DASHCAM_WITH_NVDEC
+  return std::make_unique<NvdecDecoder>(std::move(source), config, range);
+#else
+  throw std::runtime_error("cannot decode " + source->path().string() +
+                           ": built without DASHCAM_WITH_NVDEC");
+#endif
+}
+
+std::unique_ptr<VideoDecoder> open_decoder(const std::filesystem::path& path,
+                                           const DecoderConfig& config,
+                                           const FrameRange& range) {
+  return open_decoder(std::make_shared<PrefetchReader>(path, config.io), config, range);
+}
+
+}  // namespace dashcam::worker
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+
+#include "worker/decode/frame_surface.hpp"
+#include "worker/io/prefetch_reader.hpp"
+
+namespace dashcam::worker {
+
+struct DecoderConfig {
+  // Width of the motion-filter plane; height follows the video aspect ratio.
+  int lowres_width = 480;
+  // Surfaces in the decoder's pool. Bounds decode run-ahead and VRAM use:
+  // a 4K NV12 surface is ~12 MiB.
+  std::size_t surface_count = 16;
+  int gpu_device = 0;
+  // How the file is read: large blocks with read-ahead (workhorse.md §4).
+  PrefetchConfig io;
+};
+
+struct VideoInfo {
+  int width = 0;
+  int height = 0;
+  double fps = 0.0;
+  std::int64_t frame_count = -1;  // -1 when the container does not say
+};
+
+// Frames [first, end) of a video, numbered as in the whole video. `first`
+// must be a keyframe so decoding can start there; end < 0 runs to the end of
+// the stream. Used by shards of a long video (main_server.md §5.1).
+struct FrameRange {
+  std::int64_t first = 0;
+  std::int64_t end = -1;
+
+  bool contains(std::int64_t frame) const { return frame >= first && (end < 0 || frame < end); }
+};
+
+// Produces decoded frames as GPU-resident FrameSurfaces (see frame_surface.hpp).
+class VideoDecoder {
+ public:
+  virtual ~VideoDecoder() = default;
+
+  virtual const VideoInfo& info() const = 0;
+  virtual const FrameGeometry& geometry() const = 0;
+
+  // Next frame in presentation order, or nullptr at the end of the stream or
+  // of the requested range. Blocks while every pool surface is still held
+  // downstream.
+  virtual FramePtr next() = 0;
+};
+
+// Low-res plane size for a video: `lowres_width` wide (never wider than the
+// source), aspect preserved, both sides even.
+FrameGeometry make_geometry(int width, int height, int lowres_width);
+
+// Picks a decoder for the source's file: .y4m clips use the software
+// reader, everything else goes to NVDEC. The decoder reads only through
+// `source`, which may have been opened (and warmed) ahead of time. Throws if
+// the build has no decoder for the file.
+std::unique_ptr<VideoDecoder> open_decoder(std::shared_ptr<PrefetchReader> source,
+                                           const DecoderConfig& config,
+                                           const FrameRange& range = {});
+
+// Same, opening `path` with config.io.
+std::unique_ptr<VideoDecoder> open_decoder(const std::filesystem::path& path,
+                                           const DecoderConfig& config,
+                                           const FrameRange& range = {});
+
+}  // namespace dashcam::worker
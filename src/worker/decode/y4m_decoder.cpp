@@ -0,0 +1,138 @@
+#include "worker/decode/y4m_decoder.hpp"
+
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "worker/decode/downscale.hpp"
+
+namespace dashcam::worker {
+
+namespace {
+
+constexpr const char* kMagic = "YUV4MPEG2";
+constexpr std::size_t kBareFrameHeader = 6;  // "FRAME\n"
+
+std::runtime_error bad_clip(const std::filesystem::path& path, const std::string& why) {
+  return std::runtime_error("invalid y4m clip " + path.string() + ": " + why);
+}
+
+}  // namespace
+
+Y4mDecoder::Y4mDecoder(std::shared_ptr<PrefetchReader> source, const DecoderConfig& config,
+                       const FrameRange& range)
+    : source_(std::move(source)), buffer_(source_), in_(&buffer_), end_index_(range.end) {
+  const std::filesystem::path& path = source_->path();
+  std::string header;
+  std::getline(in_, header);
+  std::istringstream fields(header);
+  std::string token;
+  fields >> token;
+  if (token != kMagic) {
+    throw bad_clip(path, "missing YUV4MPEG2 signature");
+  }
+  while (fields >> token) {
+    switch (token[0]) {
+      case 'W':
+        info_.width = std::stoi(token.substr(1));
+        break;
+      case 'H':
+        info_.height = std::stoi(token.substr(1));
+        break;
+      case 'F': {
+        auto colon = token.find(':');
+        double num = std::stod(token.substr(1, colon - 1));
+        double den = colon == std::string::npos ? 1.0 : std::stod(token.substr(colon + 1));
+        info_.fps = den > 0 ? num / den : 0.0;
+        break;
+      }
+      case 'C':
+        if (token.rfind("C420", 0) != 0) {
+          throw bad_clip(path, "only 4:2:0 chroma is supported, got " + token);
+        }
+        break;
+      default:
+        break;  // interlacing, aspect and comments do not matter here
+    }
+  }
+  if (info_.width <= 0 || info_.height <= 0) {
+    throw bad_clip(path, "missing frame size");
+  }
+
+  geometry_ = make_geometry(info_.width, info_.height, config.lowres_width);
+  pool_ = std::make_unique<SurfacePool>(geometry_, config.surface_count);
+  auto luma_bytes = static_cast<std::size_t>(info_.width) * static_cast<std::size_t>(info_.height);
+  planar_.resize(luma_bytes * 3 / 2);
+  chroma_.resize(luma_bytes / 2);
+
+  // Exact when every frame header is a bare "FRAME\n", which is what our
+  // clip tooling writes; anything else just leaves the count approximate.
+  auto file_bytes = static_cast<std::uintmax_t>(source_->size());
+  auto body = static_cast<std::uintmax_t>(in_.tellg());
+  if (file_bytes > body) {
+    info_.frame_count =
+        static_cast<std::int64_t>((file_bytes - body) / (planar_.size() + kBareFrameHeader));
+  }
+
+  // Every y4m frame is a keyframe. Jump straight to the first one when frame
+  // headers are bare, otherwise skip frames one by one.
+  if (range.first > 0) {
+    auto stride = static_cast<std::streamoff>(planar_.size() + kBareFrameHeader);
+    in_.seekg(static_cast<std::streamoff>(body) + stride * range.first);
+    std::string frame_header;
+    auto start = in_.tellg();
+    if (std::getline(in_, frame_header) && frame_header == "FRAME") {
+      in_.seekg(start);
+    } else {
+      in_.clear();
+      in_.seekg(static_cast<std::streamoff>(body));
+      for (std::int64_t i = 0; i < range.first; ++i) {
+        if (!std::getline(in_, frame_header) ||
+            !in_.ignore(static_cast<std::streamsize>(planar_.size()))) {
+          break;
+        }
+      }
+    }
+    next_index_ = range.first;
+  }
+}
+
+FramePtr Y4mDecoder::next() {
+  if (end_index_ >= 0 && next_index_ >= end_index_) {
+    return nullptr;
+  }
+  std::string frame_header;
+  if (!std::getline(in_, frame_header) || frame_header.rfind("FRAME", 0) != 0) {
+    return nullptr;
+  }
+  if (!in_.read(reinterpret_cast<char*>(planar_.data()),
+                static_cast<std::streamsize>(planar_.size()))) {
+    return nullptr;  // truncated final frame, as left by an interrupted copy
+  }
+
+  auto width = static_cast<std::size_t>(info_.width);
+  auto height = static_cast<std::size_t>(info_.height);
+  const std::uint8_t* u = planar_.data() + width * height;
+  const std::uint8_t* v = u + width * height / 4;
+  for (std::size_t i = 0; i < width * height / 4; ++i) {
+    chroma_[2 * i] = u[i];
+    chroma_[2 * i + 1] = v[i];
+  }
+
+  FramePtr frame = pool_->acquire();
+  PlaneView luma = frame->luma();
+  PlaneView chroma = frame->chroma();
+  upload_2d(luma.data, luma.pitch, planar_.data(), width, width, height, stream_.get());
+  upload_2d(chroma.data, chroma.pitch, chroma_.data(), width, width, height / 2, stream_.get());
+  downscale_plane(luma, frame->lowres_device(), stream_.get());
+  stream_.synchronize();
+
+  frame->frame_index = next_index_++;
+  frame->pts_us = info_.fps > 0 ? static_cast<std::int64_t>(
+                                      static_cast<double>(frame->frame_index) * 1e6 / info_.fps)
+                                : 0;
+  return frame;
+}
+
+}  // namespace dashcam::worker
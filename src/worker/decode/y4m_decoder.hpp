@@ -0,0 +1,40 @@
+#pragma once
+
+#include <istream>
+#include <memory>
+#include <vector>
+
+#include "worker/decode/surface_pool.hpp"
+#include "worker/decode/video_decoder.hpp"
+#include "worker/gpu/gpu_stream.hpp"
+#include "worker/io/prefetch_reader.hpp"
+
+namespace dashcam::worker {
+
+// Software reader for uncompressed YUV4MPEG2 (4:2:0) clips. Used for golden
+// clips and on machines without NVDEC; frames are uploaded into the same
+// surfaces NVDEC fills, so everything downstream is decoder-agnostic.
+class Y4mDecoder : public VideoDecoder {
+ public:
+  Y4mDecoder(std::shared_ptr<PrefetchReader> source, const DecoderConfig& config,
+             const FrameRange& range = {});
+
+  const VideoInfo& info() const override { return info_; }
+  const FrameGeometry& geometry() const override { return geometry_; }
+  FramePtr next() override;
+
+ private:
+  std::shared_ptr<PrefetchReader> source_;
+  PrefetchStreambuf buffer_;
+  std::istream in_;
+  VideoInfo info_;
+  FrameGeometry geometry_;
+  std::unique_ptr<SurfacePool> pool_;
+  OwnedStream stream_;
+  std::vector<std::uint8_t> planar_;  // one I420 frame as read from disk
+  std::vector<std::uint8_t> chroma_;  // U/V interleaved into NV12 order
+  std::int64_t next_index_ = 0;
+  std::int64_t end_index_ = -1;
+};
+
+}  // namespace dashcam::worker
@@ -0,0 +1,140 @@
+#include "worker/encode/lowres_encoder.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "worker/decode/downscale.hpp"
+#include "worker/gpu/gpu_buffer.hpp"
+#include "worker/gpu/gpu_stream.hpp"
+
+#if DASHCAM_WITH_NVENC
+#include "worker/encode/nvenc_encoder.hpp"
+#endif
+
+namespace dashcam::worker {
+
+namespace {
+
+// Uncompressed 4:2:0 output for Y4M test clips; lets CPU-only builds run
+// the transcode branch end to end.
+class Y4mLowresWriter : public LowresEncoder {
+ public:
+  Y4mLowresWriter(std::filesystem::path path, const VideoInfo& info, int width, int height)
+      : LowresEncoder(std::move(path), "y4m", width, height),
+        luma_bytes_(static_cast<std::size_t>(width) * static_cast<std::size_t>(height)),
+        scaled_(luma_bytes_ * 3 / 2, MemoryKind::Device),
+        host_(luma_bytes_ * 3 / 2),
+        planar_(luma_bytes_ * 3 / 2),
+        out_(path_, std::ios::binary | std::ios::trunc) {
+    if (!out_) {
+      throw std::runtime_error("cannot create " + path_.string());
+    }
+    long long fps_num = info.fps > 0 ? std::llround(info.fps * 1000.0) : 30000;
+    out_ << "YUV4MPEG2 W" << width << " H" << height << " F" << fps_num
+         << ":1000 Ip A1:1 C420jpeg\n";
+  }
+
+ protected:
+  void write_frame(const FrameSurface& frame) override {
+    auto width = static_cast<std::size_t>(stats_.width);
+    auto height = static_cast<std::size_t>(stats_.height);
+    PlaneView luma{scaled_.device_ptr(), stats_.width, stats_.height, width};
+    PlaneView chroma{scaled_.device_ptr() + luma_bytes_, stats_.width / 2, stats_.height / 2,
+                     width};
+    scale_nv12(frame, luma, chroma, stream_.get());
+    download_2d(host_.data(), width, scaled_.device_ptr(), width, width, height * 3 / 2,
+                stream_.get());
+    stream_.synchronize();
+
+    std::copy_n(host_.data(), luma_bytes_, planar_.data());
+    std::uint8_t* u = planar_.data() + luma_bytes_;
+    std::uint8_t* v = u + luma_bytes_ / 4;
+    const std::uint8_t* uv = host_.data() + luma_bytes_;
+    for (std::size_t i = 0; i < luma_bytes_ / 4; ++i) {
+      u[i] = uv[2 * i];
+      v[i] = uv[2 * i + 1];
+    }
+    out_ << "FRAME\n";
+    out_.write(reinterpret_cast<const char*>(planar_.data()),
+               static_cast<std::streamsize>(planar_.size()));
+  }
+
+  void close() override {
+    out_.close();
+    if (!out_) {
+      throw std::runtime_error("cannot write " + path_.string());
+    }
+  }
+
+ private:
+  std::size_t luma_bytes_;
+  GpuBuffer scaled_;  // NV12, pitch == width
+  std::vector<std::uint8_t> host_;
+  std::vector<std::uint8_t> planar_;
+  OwnedStream stream_;
+  std::ofstream out_;
+};
+
+}  // namespace
+
+std::pair<int, int> lowres_video_size(int width, int height, int target_height) {
+  int h = std::min(target_height, height) & ~1;
+  int w = static_cast<int>(std::lround(static_cast<double>(width) * h / height)) & ~1;
+  return {std::max(w, 2), std::max(h, 2)};
+}
+
+void scale_nv12(const FrameSurface& frame, const PlaneView& luma, const PlaneView& chroma,
+                GpuStream stream) {
+  downscale_plane(frame.luma(), luma, stream);
+  downscale_chroma(frame.chroma(), chroma, stream);
+}
+
+LowresEncoder::LowresEncoder(std::filesystem::path path, std::string encoder, int width,
+                             int height)
+    : path_(std::move(path)) {
+  stats_.encoder = std::move(encoder);
+  stats_.width = width;
+  stats_.height = height;
+}
+
+void LowresEncoder::encode(const FrameSurface& frame) {
+  auto start = std::chrono::steady_clock::now();
+  write_frame(frame);
+  ++stats_.frames;
+  stats_.encode_s += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void LowresEncoder::finish() {
+  auto start = std::chrono::steady_clock::now();
+  close();
+  stats_.encode_s += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  stats_.bytes = std::filesystem::file_size(path_);
+}
+
+std::unique_ptr<LowresEncoder> open_lowres_encoder(const std::filesystem::path& source,
+                                                   const std::filesystem::path& out_stem,
+                                                   const VideoInfo& info,
+                                                   const TranscodeConfig& config, int gpu_device) {
+  auto [width, height] = lowres_video_size(info.width, info.height, config.height);
+  std::filesystem::create_directories(out_stem.parent_path());
+  std::filesystem::path path = out_stem;
+#if DASHCAM_WITH_NVENC
+  (void)source;
+  path += ".mp4";
+  return std::make_unique<NvencEncoder>(path, info, width, height, config, gpu_device);
+#else
+  (void)gpu_device;
+  if (source.extension() != ".y4m") {
+    return nullptr;
+  }
+  path += ".y4m";
+  return std::make_unique<Y4mLowresWriter>(path, info, width, height);
+#endif
+}
+
+}  // namespace dashcam::worker
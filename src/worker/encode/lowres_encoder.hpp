@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "worker/decode/frame_surface.hpp"
+#include "worker/decode/video_decoder.hpp"
+#include "worker/gpu/gpu.hpp"
+
+namespace dashcam::worker {
+
+struct TranscodeConfig {
+  // Height of video_lowres (shed_NAS.md §2: 720 or 540); 0 turns the branch
+  // off. Never upscales; the width follows the video's aspect ratio.
+  int height = 720;
+  int bitrate_kbps = 2500;
+  bool hevc = true;  // H.264 otherwise
+  // Local SSD; the file moves into heavy_output once the run is done.
+  std::filesystem::path scratch_dir = "cache/lowres";
+};
+
+struct TranscodeStats {
+  std::string encoder;  // "hevc_nvenc", "h264_nvenc", "y4m"
+  int width = 0;
+  int height = 0;
+  std::int64_t frames = 0;
+  std::uint64_t bytes = 0;
+  double encode_s = 0.0;  // scaling included
+};
+
+// Even-sized low-res frame size for a `width` x `height` video.
+std::pair<int, int> lowres_video_size(int width, int height, int target_height);
+
+// Scales an NV12 frame into the two planes of a smaller NV12 image
+// (kernel-side views). Queued on `stream`; the caller synchronizes.
+void scale_nv12(const FrameSurface& frame, const PlaneView& luma, const PlaneView& chroma,
+                GpuStream stream);
+
+// Writes the low-res archive video (workhorse.md §3, shed_NAS.md
+// video_lowres.mp4) from the surfaces heavy processing already decoded, so
+// archiving needs no second decode. Frames must come in presentation order;
+// timestamps restart at 0 with the first one, so the parts of a sharded
+// video can be joined by stream copy.
+class LowresEncoder {
+ public:
+  virtual ~LowresEncoder() = default;
+
+  void encode(const FrameSurface& frame);
+  // Flushes the encoder and closes the file; path() is then complete.
+  void finish();
+
+  const std::filesystem::path& path() const { return path_; }
+  const TranscodeStats& stats() const { return stats_; }
+
+ protected:
+  LowresEncoder(std::filesystem::path path, std::string encoder, int width, int height);
+
+  virtual void write_frame(const FrameSurface& frame) = 0;
+  virtual void close() = 0;
+
+  std::filesystem::path path_;
+  TranscodeStats stats_;
+};
+
+// NVENC (into `out_stem`.mp4) on builds with DASHCAM_WITH_NVENC. Otherwise
+// Y4M clips get an uncompressed `out_stem`.y4m, as our test tooling reads,
+// and anything else nullptr: that video's low-res copy is left to archiving.
+std::unique_ptr<LowresEncoder> open_lowres_encoder(const std::filesystem::path& source,
+                                                   const std::filesystem::path& out_stem,
+                                                   const VideoInfo& info,
+                                                   const TranscodeConfig& config, int gpu_device);
+
+}  // namespace dashcam::worker
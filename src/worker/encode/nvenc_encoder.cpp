@@ -0,0 +1,172 @@
+#include "worker/encode/nvenc_encoder.hpp"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/hwcontext.h>
+#include <libavutil/opt.h>
+}
+
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "worker/gpu/gpu_stream.hpp"
+
+namespace dashcam::worker {
+
+namespace {
+
+void check_av(int status, const std::string& what) {
+  if (status < 0) {
+    char buffer[AV_ERROR_MAX_STRING_SIZE] = {};
+    av_strerror(status, buffer, sizeof(buffer));
+    throw std::runtime_error(what + ": " + buffer);
+  }
+}
+
+}  // namespace
+
+struct NvencEncoder::Impl {
+  AVBufferRef* device = nullptr;
+  AVBufferRef* frames = nullptr;
+  AVCodecContext* codec = nullptr;
+  AVFormatContext* format = nullptr;
+  AVStream* stream = nullptr;
+  AVPacket* packet = nullptr;
+  OwnedStream cuda_stream;
+  std::int64_t first_pts = -1;
+
+  ~Impl() {
+    if (format != nullptr) {
+      if (format->pb != nullptr) {
+        avio_closep(&format->pb);
+      }
+      avformat_free_context(format);
+    }
+    av_packet_free(&packet);
+    avcodec_free_context(&codec);
+    av_buffer_unref(&frames);
+    av_buffer_unref(&device);
+  }
+
+  // Sends a frame (nullptr flushes) and muxes every packet that is ready.
+  void send(AVFrame* frame) {
+    check_av(avcodec_send_frame(codec, frame), "avcodec_send_frame");
+    while (true) {
+      int status = avcodec_receive_packet(codec, packet);
+      if (status == AVERROR(EAGAIN) || status == AVERROR_EOF) {
+        return;
+      }
+      check_av(status, "avcodec_receive_packet");
+      packet->stream_index = stream->index;
+      av_packet_rescale_ts(packet, codec->time_base, stream->time_base);
+      check_av(av_interleaved_write_frame(format, packet), "av_interleaved_write_frame");
+    }
+  }
+};
+
+NvencEncoder::NvencEncoder(std::filesystem::path path, const VideoInfo& info, int width,
+                           int height, const TranscodeConfig& config, int gpu_device)
+    : LowresEncoder(std::move(path), config.hevc ? "hevc_nvenc" : "h264_nvenc", width, height),
+      impl_(std::make_unique<Impl>()) {
+  Impl& d = *impl_;
+  // The decoder retains the primary context; encoding in the same one lets
+  // the scale kernel write encoder surfaces directly.
+  AVDictionary* device_options = nullptr;
+  av_dict_set(&device_options, "primary_ctx", "1", 0);
+  int status = av_hwdevice_ctx_create(&d.device, AV_HWDEVICE_TYPE_CUDA,
+                                      std::to_string(gpu_device).c_str(), device_options, 0);
+  av_dict_free(&device_options);
+  check_av(status, "av_hwdevice_ctx_create");
+
+  d.frames = av_hwframe_ctx_alloc(d.device);
+  if (d.frames == nullptr) {
+    throw std::runtime_error("av_hwframe_ctx_alloc failed");
+  }
+  auto* frames = reinterpret_cast<AVHWFramesContext*>(d.frames->data);
+  frames->format = AV_PIX_FMT_CUDA;
+  frames->sw_format = AV_PIX_FMT_NV12;
+  frames->width = width;
+  frames->height = height;
+  frames->initial_pool_size = 4;
+  check_av(av_hwframe_ctx_init(d.frames), "av_hwframe_ctx_init");
+
+  const AVCodec* encoder = avcodec_find_encoder_by_name(stats_.encoder.c_str());
+  if (encoder == nullptr) {
+    throw std::runtime_error("FFmpeg has no " + stats_.encoder + " encoder");
+  }
+  d.codec = avcodec_alloc_context3(encoder);
+  double fps = info.fps > 0 ? info.fps : 30.0;
+  d.codec->width = width;
+  d.codec->height = height;
+  d.codec->pix_fmt = AV_PIX_FMT_CUDA;
+  d.codec->hw_frames_ctx = av_buffer_ref(d.frames);
+  d.codec->time_base = {1, 1000000};  // FrameSurface::pts_us
+  d.codec->framerate = av_d2q(fps, 100000);
+  d.codec->bit_rate = static_cast<std::int64_t>(config.bitrate_kbps) * 1000;
+  // Two-second GOPs keep seeking in the WebUI cheap; no B-frames, so
+  // packets come out in presentation order.
+  d.codec->gop_size = static_cast<int>(std::lround(fps * 2));
+  d.codec->max_b_frames = 0;
+  av_opt_set(d.codec->priv_data, "preset", "p4", 0);
+
+  check_av(avformat_alloc_output_context2(&d.format, nullptr, "mp4", path_.c_str()),
+           "avformat_alloc_output_context2");
+  if (d.format->oformat->flags & AVFMT_GLOBALHEADER) {
+    d.codec->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+  }
+  check_av(avcodec_open2(d.codec, encoder, nullptr), "avcodec_open2 " + stats_.encoder);
+
+  d.stream = avformat_new_stream(d.format, nullptr);
+  if (d.stream == nullptr) {
+    throw std::runtime_error("avformat_new_stream failed");
+  }
+  check_av(avcodec_parameters_from_context(d.stream->codecpar, d.codec),
+           "avcodec_parameters_from_context");
+  d.stream->time_base = d.codec->time_base;
+  check_av(avio_open(&d.format->pb, path_.c_str(), AVIO_FLAG_WRITE), "avio_open " + path_.string());
+  AVDictionary* mux_options = nullptr;
+  av_dict_set(&mux_options, "movflags", "+faststart", 0);
+  status = avformat_write_header(d.format, &mux_options);
+  av_dict_free(&mux_options);
+  check_av(status, "avformat_write_header");
+
+  d.packet = av_packet_alloc();
+}
+
+NvencEncoder::~NvencEncoder() = default;
+
+void NvencEncoder::write_frame(const FrameSurface& frame) {
+  Impl& d = *impl_;
+  AVFrame* out = av_frame_alloc();
+  try {
+    check_av(av_hwframe_get_buffer(d.frames, out, 0), "av_hwframe_get_buffer");
+    PlaneView luma{out->data[0], stats_.width, stats_.height,
+                   static_cast<std::size_t>(out->linesize[0])};
+    PlaneView chroma{out->data[1], stats_.width / 2, stats_.height / 2,
+                     static_cast<std::size_t>(out->linesize[1])};
+    scale_nv12(frame, luma, chroma, d.cuda_stream.get());
+    // NVENC reads the surface on its own stream.
+    d.cuda_stream.synchronize();
+    if (d.first_pts < 0) {
+      d.first_pts = frame.pts_us;
+    }
+    out->pts = frame.pts_us - d.first_pts;
+    d.send(out);
+  } catch (...) {
+    av_frame_free(&out);
+    throw;
+  }
+  av_frame_free(&out);
+}
+
+void NvencEncoder::close() {
+  Impl& d = *impl_;
+  d.send(nullptr);
+  check_av(av_write_trailer(d.format), "av_write_trailer");
+  check_av(avio_closep(&d.format->pb), "avio_close " + path_.string());
+}
+
+}  // namespace dashcam::worker
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+
+#include "worker/encode/lowres_encoder.hpp"
+
+namespace dashcam::worker {
+
+// Low-res archive encoder on NVENC, through FFmpeg's hevc_nvenc/h264_nvenc
+// with CUDA frames: each decoded surface is scaled by a kernel straight into
+// an encoder input surface, so frames never leave the GPU, and the
+// bitstream is muxed into MP4 (moov up front, for streaming from the Shed
+// NAS). Shares the decoder's CUDA primary context.
+class NvencEncoder : public LowresEncoder {
+ public:
+  NvencEncoder(std::filesystem::path path, const VideoInfo& info, int width, int height,
+               const TranscodeConfig& config, int gpu_device);
+  ~NvencEncoder() override;
+
+ protected:
+  void write_frame(const FrameSurface& frame) override;
+  void close() override;
+
+ private:
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace dashcam::worker
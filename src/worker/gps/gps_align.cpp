@@ -0,0 +1,92 @@
+#include "worker/gps/gps_align.hpp"
+
+#include <cstdlib>
+#include <string_view>
+
+#include "common/cpu_features.hpp"
+
+namespace dashcam::worker {
+
+void GpsFixes::resize(std::size_t n) {
+  for (auto* column : {&lat, &lon, &speed, &bearing, &accuracy}) {
+    column->resize(n);
+  }
+}
+
+void plan_gps_segments(const GpsTrack& track, std::span<const std::int64_t> t_us,
+                       const GpsAlignConfig& config, GpsSegments& out) {
+  std::size_t n = t_us.size();
+  out.a.assign(n, -1);
+  out.b.assign(n, -1);
+  out.w.assign(n, 0.0);
+  std::size_t m = track.size();
+  if (m == 0) {
+    return;
+  }
+  const std::vector<std::int64_t>& t = track.t_us;
+  auto hold = [&](std::size_t i, std::size_t row) {
+    out.a[i] = out.b[i] = static_cast<std::int32_t>(row);
+  };
+
+  // j is the last fix at or before the current timestamp; it only moves
+  // forward because the timestamps do.
+  std::size_t j = 0;
+  for (std::size_t i = 0; i < n; ++i) {
+    std::int64_t f = t_us[i];
+    while (j + 1 < m && t[j + 1] <= f) {
+      ++j;
+    }
+    if (f < t[0]) {
+      if (t[0] - f <= config.hold_us) {
+        hold(i, 0);
+      }
+    } else if (j + 1 == m) {
+      if (f - t[j] <= config.hold_us) {
+        hold(i, j);
+      }
+    } else if (t[j + 1] - t[j] > config.max_gap_us) {
+      if (f - t[j] <= config.hold_us) {
+        hold(i, j);
+      } else if (t[j + 1] - f <= config.hold_us) {
+        hold(i, j + 1);
+      }
+    } else {
+      out.a[i] = static_cast<std::int32_t>(j);
+      out.b[i] = static_cast<std::int32_t>(j + 1);
+      out.w[i] = static_cast<double>(f - t[j]) / static_cast<double>(t[j + 1] - t[j]);
+    }
+  }
+}
+
+void gps_interp_scalar(const GpsTrack& track, const GpsSegments& segments, GpsFixes& out) {
+  for (std::size_t i = 0; i < segments.a.size(); ++i) {
+    detail::gps_row(track, segments, i, out);
+  }
+}
+
+GpsKernel select_gps_kernel() {
+  std::string_view forced;
+  if (const char* env = std::getenv("DASHCAM_SIMD")) {
+    forced = env;
+  }
+#if DASHCAM_HAVE_X86_SIMD
+  // Gathers are the bottleneck; AVX-512 would not add much on 4 doubles.
+  if (cpu_features().avx2 && (forced.empty() || forced == "avx512" || forced == "avx2")) {
+    return {"avx2", &gps_interp_avx2};
+  }
+#endif
+  return {"scalar", &gps_interp_scalar};
+}
+
+GpsFixes interpolate_gps(const GpsTrack& track, std::span<const std::int64_t> t_us,
+                         const GpsAlignConfig& config) {
+  static const GpsKernel kernel = select_gps_kernel();
+  GpsSegments segments;
+  plan_gps_segments(track, t_us, config, segments);
+  GpsFixes fixes;
+  fixes.resize(t_us.size());
+  kernel.fn(track, segments, fixes);
+  return fixes;
+}
+
+}  // namespace dashcam::worker
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "common/gps_track.hpp"
+
+namespace dashcam::worker {
+
+struct GpsAlignConfig {
+  // Fixes further apart than this are a gap (tunnel, lost lock): timestamps
+  // inside it get no fix rather than a straight line across.
+  std::int64_t max_gap_us = 5'000'000;
+  // Timestamps this close to the first or last fix, or to either edge of a
+  // gap, take that fix as it is.
+  std::int64_t hold_us = 1'000'000;
+};
+
+// Per-timestamp GPS (workhorse.md §3.5), struct-of-arrays; NaN where there
+// is no fix.
+struct GpsFixes {
+  std::vector<double> lat, lon, speed, bearing, accuracy;
+
+  std::size_t size() const { return lat.size(); }
+  void resize(std::size_t n);
+};
+
+// Output of the merge pass: timestamp i interpolates track rows a[i] and
+// b[i] with weight w[i] (b == a holds a fix as is); a[i] < 0 means no fix.
+struct GpsSegments {
+  std::vector<std::int32_t> a, b;
+  std::vector<double> w;
+};
+
+// One linear merge of `t_us` (non-decreasing, e.g. frame pts in decode
+// order) against the track: O(frames + fixes), no per-frame search.
+void plan_gps_segments(const GpsTrack& track, std::span<const std::int64_t> t_us,
+                       const GpsAlignConfig& config, GpsSegments& out);
+
+// Fills `out` (already sized) from the planned segments. lat and speed
+// interpolate linearly; lon and bearing take the short way round (across the
+// antimeridian, through north) and are wrapped back into range. Every
+// variant produces bit-identical results.
+using GpsInterpFn = void (*)(const GpsTrack& track, const GpsSegments& segments, GpsFixes& out);
+
+void gps_interp_scalar(const GpsTrack& track, const GpsSegments& segments, GpsFixes& out);
+#if DASHCAM_HAVE_X86_SIMD
+void gps_interp_avx2(const GpsTrack& track, const GpsSegments& segments, GpsFixes& out);
+#endif
+
+struct GpsKernel {
+  const char* name;
+  GpsInterpFn fn;
+};
+
+// Widest variant this CPU supports; DASHCAM_SIMD forces a narrower one, as
+// for select_motion_kernel().
+GpsKernel select_gps_kernel();
+
+// plan_gps_segments followed by the selected kernel.
+GpsFixes interpolate_gps(const GpsTrack& track, std::span<const std::int64_t> t_us,
+                         const GpsAlignConfig& config = {});
+
+namespace detail {
+
+inline double lerp(double a, double b, double w) { return a + w * (b - a); }
+
+// `a + w * (b - a)` the short way round a circle of `period`, wrapped into
+// [base, base + period).
+inline double lerp_circular(double a, double b, double w, double period, double base) {
+  double d = b - a;
+  d = d - period * std::nearbyint(d / period);
+  double v = a + w * d;
+  return v - period * std::floor((v - base) / period);
+}
+
+// One timestamp; the scalar kernel and the vector kernels' tails.
+inline void gps_row(const GpsTrack& t, const GpsSegments& s, std::size_t i, GpsFixes& out) {
+  std::int32_t a = s.a[i];
+  if (a < 0) {
+    out.lat[i] = out.lon[i] = out.speed[i] = out.bearing[i] = out.accuracy[i] = kNoValue;
+    return;
+  }
+  auto ia = static_cast<std::size_t>(a);
+  auto ib = static_cast<std::size_t>(s.b[i]);
+  double w = s.w[i];
+  out.lat[i] = lerp(t.lat[ia], t.lat[ib], w);
+  out.lon[i] = lerp_circular(t.lon[ia], t.lon[ib], w, 360.0, -180.0);
+  out.speed[i] = lerp(t.speed[ia], t.speed[ib], w);
+  out.bearing[i] = lerp_circular(t.bearing[ia], t.bearing[ib], w, 360.0, 0.0);
+  out.accuracy[i] = lerp(t.accuracy[ia], t.accuracy[ib], w);
+}
+
+}  // namespace detail
+
+}  // namespace dashcam::worker
@@ -0,0 +1,73 @@
+// Compiled with AVX2 enabled; only called after select_gps_kernel() has
+// checked the CPU. Same operations in the same order as detail::gps_row,
+// and no FMA, so results match the scalar kernel bit for bit.
+
+#include <immintrin.h>
+
+#include "worker/gps/gps_align.hpp"
+
+namespace dashcam::worker {
+
+namespace {
+
+inline __m256d lerp(__m256d a, __m256d b, __m256d w) {
+  return _mm256_add_pd(a, _mm256_mul_pd(w, _mm256_sub_pd(b, a)));
+}
+
+inline __m256d lerp_circular(__m256d a, __m256d b, __m256d w, double period, double base) {
+  const __m256d p = _mm256_set1_pd(period);
+  __m256d d = _mm256_sub_pd(b, a);
+  __m256d turns =
+      _mm256_round_pd(_mm256_div_pd(d, p), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  d = _mm256_sub_pd(d, _mm256_mul_pd(p, turns));
+  __m256d v = _mm256_add_pd(a, _mm256_mul_pd(w, d));
+  __m256d wraps = _mm256_floor_pd(_mm256_div_pd(_mm256_sub_pd(v, _mm256_set1_pd(base)), p));
+  return _mm256_sub_pd(v, _mm256_mul_pd(p, wraps));
+}
+
+}  // namespace
+
+void gps_interp_avx2(const GpsTrack& track, const GpsSegments& segments, GpsFixes& out) {
+  constexpr std::size_t kLanes = 4;
+  const std::size_t n = segments.a.size();
+  const __m128i zero = _mm_setzero_si128();
+  const __m256d nan = _mm256_set1_pd(kNoValue);
+
+  std::size_t i = 0;
+  for (; i + kLanes <= n; i += kLanes) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(segments.a.data() + i));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(segments.b.data() + i));
+    __m256d w = _mm256_loadu_pd(segments.w.data() + i);
+    // Rows without a fix gather row 0 and are overwritten with NaN.
+    __m256d none = _mm256_castsi256_pd(_mm256_cvtepi32_epi64(_mm_cmplt_epi32(a, zero)));
+    a = _mm_max_epi32(a, zero);
+    b = _mm_max_epi32(b, zero);
+
+    // Frames outnumber fixes many times over, so most groups of four sit
+    // inside one segment: broadcast its two ends instead of gathering.
+    __m128i a0 = _mm_shuffle_epi32(a, 0);
+    __m128i b0 = _mm_shuffle_epi32(b, 0);
+    bool uniform = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi32(a, a0),
+                                                   _mm_cmpeq_epi32(b, b0))) == 0xffff;
+    auto gather = [&](const std::vector<double>& column, __m128i rows) {
+      if (uniform) {
+        return _mm256_set1_pd(column[static_cast<std::size_t>(_mm_cvtsi128_si32(rows))]);
+      }
+      return _mm256_i32gather_pd(column.data(), rows, 8);
+    };
+    auto store = [&](std::vector<double>& column, __m256d v) {
+      _mm256_storeu_pd(column.data() + i, _mm256_blendv_pd(v, nan, none));
+    };
+    store(out.lat, lerp(gather(track.lat, a), gather(track.lat, b), w));
+    store(out.lon, lerp_circular(gather(track.lon, a), gather(track.lon, b), w, 360.0, -180.0));
+    store(out.speed, lerp(gather(track.speed, a), gather(track.speed, b), w));
+    store(out.bearing,
+          lerp_circular(gather(track.bearing, a), gather(track.bearing, b), w, 360.0, 0.0));
+    store(out.accuracy, lerp(gather(track.accuracy, a), gather(track.accuracy, b), w));
+  }
+  for (; i < n; ++i) {
+    detail::gps_row(track, segments, i, out);
+  }
+}
+
+}  // namespace dashcam::worker
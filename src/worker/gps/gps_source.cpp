@@ -0,0 +1,336 @@
+#include "worker/gps/gps_source.hpp"
+
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <map>
+#include <regex>
+#include <string_view>
+
+namespace dashcam::worker {
+
+namespace {
+
+constexpr double kKnotsToMps = 1852.0 / 3600.0;
+// Typical GPS user-equivalent range error; HDOP times this approximates the
+// horizontal accuracy.
+constexpr double kUereMetres = 5.0;
+// A sidecar's first fix is expected at most this long after the start in
+// the video's file name, and at most the slack before it.
+constexpr std::int64_t kColdStartUs = 10LL * 60 * 1000000;
+constexpr std::int64_t kAnchorSlackUs = 2 * 1000000;
+
+std::int64_t utc_us(int year, int month, int day, int hour, int minute, double second) {
+  using namespace std::chrono;
+  sys_days date = year_month_day{std::chrono::year{year},
+                                 std::chrono::month{static_cast<unsigned>(month)},
+                                 std::chrono::day{static_cast<unsigned>(day)}};
+  auto midnight = duration_cast<microseconds>(date.time_since_epoch()).count();
+  return midnight + (static_cast<std::int64_t>(hour) * 3600 + minute * 60) * 1000000 +
+         static_cast<std::int64_t>(std::llround(second * 1e6));
+}
+
+// NMEA ddmm.mmmm (or dddmm.mmmm) plus hemisphere to signed degrees.
+double nmea_degrees(double value, char hemisphere) {
+  double degrees = std::floor(value / 100.0);
+  double result = degrees + (value - degrees * 100.0) / 60.0;
+  return hemisphere == 'S' || hemisphere == 'W' ? -result : result;
+}
+
+std::vector<std::string_view> split_fields(std::string_view body) {
+  std::vector<std::string_view> fields;
+  std::size_t start = 0;
+  while (true) {
+    std::size_t comma = body.find(',', start);
+    fields.push_back(body.substr(start, comma - start));
+    if (comma == std::string_view::npos) {
+      return fields;
+    }
+    start = comma + 1;
+  }
+}
+
+double to_double(std::string_view field) {
+  if (field.empty()) {
+    return kNoValue;
+  }
+  return std::strtod(std::string(field).c_str(), nullptr);
+}
+
+// "$...*hh" with a valid checksum; returns the part between $ and *.
+std::optional<std::string_view> sentence_body(std::string_view line) {
+  while (!line.empty() && (line.back() == '\r' || line.back() == '\n' || line.back() == ' ')) {
+    line.remove_suffix(1);
+  }
+  std::size_t dollar = line.find('$');
+  std::size_t star = line.rfind('*');
+  if (dollar == std::string_view::npos || star == std::string_view::npos || star < dollar ||
+      star + 3 > line.size()) {
+    return std::nullopt;
+  }
+  std::string_view body = line.substr(dollar + 1, star - dollar - 1);
+  unsigned checksum = 0;
+  for (char c : body) {
+    checksum ^= static_cast<unsigned char>(c);
+  }
+  auto expected = static_cast<unsigned>(
+      std::strtoul(std::string(line.substr(star + 1, 2)).c_str(), nullptr, 16));
+  if (checksum != expected) {
+    return std::nullopt;
+  }
+  return body;
+}
+
+std::uint32_t be32(const unsigned char* p) {
+  return (std::uint32_t{p[0]} << 24) | (std::uint32_t{p[1]} << 16) | (std::uint32_t{p[2]} << 8) |
+         std::uint32_t{p[3]};
+}
+
+std::uint32_t le32(const unsigned char* p) {
+  return std::uint32_t{p[0]} | (std::uint32_t{p[1]} << 8) | (std::uint32_t{p[2]} << 16) |
+         (std::uint32_t{p[3]} << 24);
+}
+
+float le_float(const unsigned char* p) {
+  std::uint32_t bits = le32(p);
+  float value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+// One freeGPS block. Layouts differ between firmwares in the header size,
+// so the fix is located by its status/hemisphere bytes ("A" + N|S + E|W):
+// six little-endian u32 (hour, minute, second, year, month, day) precede it
+// and four floats (lat, lon as ddmm.mmmm, speed in knots, bearing) follow.
+bool decode_free_gps(const std::vector<unsigned char>& block, GpsTrack& out) {
+  if (block.size() < 12 || std::memcmp(block.data() + 4, "freeGPS ", 8) != 0) {
+    return false;
+  }
+  for (std::size_t p = 24; p + 20 <= block.size(); ++p) {
+    if (block[p] != 'A' || (block[p + 1] != 'N' && block[p + 1] != 'S') ||
+        (block[p + 2] != 'E' && block[p + 2] != 'W')) {
+      continue;
+    }
+    const unsigned char* t = block.data() + p - 24;
+    auto hour = static_cast<int>(le32(t));
+    auto minute = static_cast<int>(le32(t + 4));
+    auto second = static_cast<int>(le32(t + 8));
+    auto year = static_cast<int>(le32(t + 12));
+    auto month = static_cast<int>(le32(t + 16));
+    auto day = static_cast<int>(le32(t + 20));
+    if (year < 100) {
+      year += 2000;
+    }
+    if (hour > 23 || minute > 59 || second > 60 || month < 1 || month > 12 || day < 1 ||
+        day > 31 || year < 2000 || year > 2100) {
+      continue;
+    }
+    double lat = nmea_degrees(le_float(block.data() + p + 4), static_cast<char>(block[p + 1]));
+    double lon = nmea_degrees(le_float(block.data() + p + 8), static_cast<char>(block[p + 2]));
+    double speed = le_float(block.data() + p + 12) * kKnotsToMps;
+    double bearing = le_float(block.data() + p + 16);
+    if (!(std::abs(lat) <= 90.0 && std::abs(lon) <= 180.0)) {
+      continue;
+    }
+    out.append(utc_us(year, month, day, hour, minute, second), lat, lon, speed,
+               std::isfinite(bearing) ? std::fmod(bearing + 360.0, 360.0) : kNoValue);
+    return true;
+  }
+  return false;
+}
+
+void rebase(GpsTrack& track, std::int64_t start_us) {
+  for (std::int64_t& t : track.t_us) {
+    t -= start_us;
+  }
+}
+
+}  // namespace
+
+std::optional<std::int64_t> video_start_from_name(const std::filesystem::path& video,
+                                                  const GpsSourceConfig& config) {
+  static const std::regex kStamp(R"((\d{4})_(\d{2})(\d{2})_(\d{2})(\d{2})(\d{2}))");
+  std::string stem = video.stem().string();
+  std::smatch m;
+  if (!std::regex_search(stem, m, kStamp)) {
+    return std::nullopt;
+  }
+  auto field = [&](int i) { return std::stoi(m[i].str()); };
+  int month = field(2);
+  int day = field(3);
+  if (month < 1 || month > 12 || day < 1 || day > 31 || field(4) > 23 || field(5) > 59 ||
+      field(6) > 59) {
+    return std::nullopt;
+  }
+  std::int64_t local = utc_us(field(1), month, day, field(4), field(5), field(6));
+  return local - static_cast<std::int64_t>(config.filename_utc_offset_minutes) * 60 * 1000000;
+}
+
+GpsTrack parse_nmea(std::istream& in) {
+  GpsTrack track;
+  std::map<std::string, double> hdop_by_time;  // GGA time field -> HDOP
+  std::vector<std::string> rmc_times;
+  std::string line;
+  while (std::getline(in, line)) {
+    std::optional<std::string_view> body = sentence_body(line);
+    if (!body || body->size() < 6) {
+      continue;
+    }
+    std::vector<std::string_view> f = split_fields(*body);
+    std::string_view type = f[0].substr(2);  // drop the talker (GP, GN, GL, ...)
+    if (type == "GGA" && f.size() > 8 && !f[1].empty() && !f[8].empty()) {
+      hdop_by_time[std::string(f[1])] = to_double(f[8]);
+    } else if (type == "RMC" && f.size() > 9 && f[2] == "A" && f[1].size() >= 6 &&
+               f[9].size() == 6 && f[3].size() >= 4 && f[5].size() >= 4) {
+      std::string time(f[1]);
+      std::string date(f[9]);
+      int hour = std::stoi(time.substr(0, 2));
+      int minute = std::stoi(time.substr(2, 2));
+      double second = std::strtod(time.c_str() + 4, nullptr);
+      int day = std::stoi(date.substr(0, 2));
+      int month = std::stoi(date.substr(2, 2));
+      int year = 2000 + std::stoi(date.substr(4, 2));
+      if (month < 1 || month > 12 || day < 1 || day > 31) {
+        continue;
+      }
+      char ns = f[4].empty() ? 'N' : f[4][0];
+      char ew = f[6].empty() ? 'E' : f[6][0];
+      double speed = to_double(f[7]);
+      double bearing = to_double(f[8]);
+      track.append(utc_us(year, month, day, hour, minute, second),
+                   nmea_degrees(to_double(f[3]), ns), nmea_degrees(to_double(f[5]), ew),
+                   std::isfinite(speed) ? speed * kKnotsToMps : kNoValue,
+                   std::isfinite(bearing) ? std::fmod(bearing + 360.0, 360.0) : kNoValue);
+      rmc_times.push_back(std::move(time));
+    }
+  }
+  // GGA usually follows its RMC, so accuracy is filled in once all are read.
+  for (std::size_t i = 0; i < rmc_times.size(); ++i) {
+    auto it = hdop_by_time.find(rmc_times[i]);
+    if (it != hdop_by_time.end() && std::isfinite(it->second)) {
+      track.accuracy[i] = it->second * kUereMetres;
+    }
+  }
+  track.sort();
+  return track;
+}
+
+GpsLog read_embedded_gps(const std::filesystem::path& video) {
+  GpsLog log;
+  GpsTrack& track = log.track;
+  std::ifstream in(video, std::ios::binary);
+  if (!in) {
+    return log;
+  }
+  in.seekg(0, std::ios::end);
+  auto file_size = static_cast<std::uint64_t>(in.tellg());
+
+  // Walk the top-level atoms for `gps `: u32 version, u32 entry count, then
+  // (u32 offset, u32 size) per block, all big-endian.
+  std::uint64_t pos = 0;
+  std::vector<unsigned char> list;
+  while (pos + 8 <= file_size) {
+    std::array<unsigned char, 16> header{};
+    in.seekg(static_cast<std::streamoff>(pos));
+    in.read(reinterpret_cast<char*>(header.data()), 8);
+    if (!in) {
+      break;
+    }
+    std::uint64_t size = be32(header.data());
+    std::uint64_t body = 8;
+    if (size == 1) {
+      in.read(reinterpret_cast<char*>(header.data() + 8), 8);
+      size = (std::uint64_t{be32(header.data() + 8)} << 32) | be32(header.data() + 12);
+      body = 16;
+    } else if (size == 0) {
+      size = file_size - pos;
+    }
+    if (size < body || pos + size > file_size) {
+      break;
+    }
+    if (std::memcmp(header.data() + 4, "gps ", 4) == 0 && size - body <= (16u << 20)) {
+      list.resize(static_cast<std::size_t>(size - body));
+      in.seekg(static_cast<std::streamoff>(pos + body));
+      in.read(reinterpret_cast<char*>(list.data()), static_cast<std::streamsize>(list.size()));
+      break;
+    }
+    pos += size;
+  }
+  if (list.size() < 8) {
+    return log;
+  }
+
+  // Blocks are written once per second from the start of the recording;
+  // the first one with a fix anchors the UTC times to the video clock.
+  std::uint32_t count = be32(list.data() + 4);
+  std::optional<std::int64_t> start;
+  std::vector<unsigned char> block;
+  for (std::uint32_t i = 0; i < count && 8 + (i + 1) * 8 <= list.size(); ++i) {
+    std::uint64_t offset = be32(list.data() + 8 + i * 8);
+    std::uint64_t size = be32(list.data() + 12 + i * 8);
+    if (size < 12 || size > (64u << 10) || offset + size > file_size) {
+      continue;
+    }
+    block.resize(static_cast<std::size_t>(size));
+    in.clear();
+    in.seekg(static_cast<std::streamoff>(offset));
+    if (in.read(reinterpret_cast<char*>(block.data()), static_cast<std::streamsize>(size)) &&
+        decode_free_gps(block, track) && !start) {
+      start = track.t_us.back() - static_cast<std::int64_t>(i) * 1000000;
+    }
+  }
+  if (start) {
+    rebase(track, *start);
+    log.source = "embedded";
+    log.start_utc_us = start;
+  }
+  track.sort();
+  return log;
+}
+
+GpsLog load_gps(const std::filesystem::path& video, const GpsSourceConfig& config) {
+  GpsLog log;
+  try {
+    for (const std::string& extension : config.sidecar_extensions) {
+      std::filesystem::path sidecar = video;
+      sidecar.replace_extension(extension);
+      std::ifstream in(sidecar, std::ios::binary);
+      if (!in) {
+        continue;
+      }
+      log.track = parse_nmea(in);
+      if (!log.track.empty()) {
+        // The first fix can come well after the recording started (cold
+        // start), so the file name is the better anchor when it has one and
+        // agrees with the log (a wrong clock or UTC offset does not).
+        std::int64_t first = log.track.t_us.front();
+        std::optional<std::int64_t> start = video_start_from_name(video, config);
+        bool agrees = start && first >= *start - kAnchorSlackUs && first <= *start + kColdStartUs;
+        log.start_utc_us = agrees ? *start : first;
+        rebase(log.track, *log.start_utc_us);
+        log.source = "sidecar:" + sidecar.filename().string();
+        return log;
+      }
+    }
+    if (config.embedded) {
+      log = read_embedded_gps(video);
+      if (!log.track.empty()) {
+        return log;
+      }
+    }
+    log = GpsLog{};
+    log.start_utc_us = video_start_from_name(video, config);
+  } catch (const std::exception& e) {
+    std::fprintf(stderr, "%s: GPS log unreadable: %s\n", video.filename().string().c_str(),
+                 e.what());
+    log = GpsLog{};
+  }
+  return log;
+}
+
+}  // namespace dashcam::worker
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <istream>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "common/gps_track.hpp"
+
+namespace dashcam::worker {
+
+struct GpsSourceConfig {
+  // Sidecar logs looked for next to the video (same stem), in this order.
+  std::vector<std::string> sidecar_extensions{".nmea", ".NMEA", ".gps", ".GPS"};
+  // Read the GPS blocks dashcams embed in the MP4 when there is no sidecar.
+  bool embedded = true;
+  // Dashcams name files by local time ("2024_0611_183012_0042F.MP4") while
+  // GPS time is UTC: local = UTC + this offset.
+  int filename_utc_offset_minutes = 0;
+};
+
+// A parsed GPS log; `source` says where it came from ("sidecar:<file>",
+// "embedded", or empty when the video has none). `start_utc_us` is the UTC
+// time of the video's first frame (microseconds since the epoch) when the
+// log or the file name gives one; t_us + start_utc_us is wall-clock time.
+struct GpsLog {
+  GpsTrack track;
+  std::string source;
+  std::optional<std::int64_t> start_utc_us;
+};
+
+// UTC microseconds since the epoch when the video started, from its file
+// name, if the name carries a timestamp.
+std::optional<std::int64_t> video_start_from_name(const std::filesystem::path& video,
+                                                  const GpsSourceConfig& config);
+
+// NMEA 0183 RMC sentences, with GGA HDOP as accuracy; sentences with a bad
+// checksum or no fix are skipped. Times are UTC microseconds since the
+// epoch; the caller rebases them onto the video.
+GpsTrack parse_nmea(std::istream& in);
+
+// The Novatek "freeGPS" blocks found through the MP4's top-level `gps `
+// atom (Viofo and similar), already on the video clock. Empty if the file
+// has none.
+GpsLog read_embedded_gps(const std::filesystem::path& video);
+
+// Loads the video's GPS once: the sidecar if there is one, else the embedded
+// blocks, rebased so t_us is on the frames' clock. Never throws for a
+// missing or unreadable log; a video without GPS just gets an empty track.
+GpsLog load_gps(const std::filesystem::path& video, const GpsSourceConfig& config);
+
+}  // namespace dashcam::worker
@@ -0,0 +1,61 @@
+#include "worker/gpu/device_info.hpp"
+
+#include "worker/gpu/gpu.hpp"
+
+namespace dashcam::worker {
+
+std::string GpuDeviceInfo::cache_tag() const {
+  return name + "-sm" + std::to_string(sm_major) + std::to_string(sm_minor);
+}
+
+GpuDeviceInfo query_device(int index) {
+  GpuDeviceInfo info;
+  info.index = index;
+#if DASHCAM_WITH_CUDA
+  cudaDeviceProp props{};
+  DASHCAM_CUDA_CHECK(cudaGetDeviceProperties(&props, index));
+  info.name = props.name;
+  info.sm_major = props.major;
+  info.sm_minor = props.minor;
+  info.total_memory = props.totalGlobalMem;
+#else
+  info.name = "cpu";
+#endif
+  return info;
+}
+
+int device_count() {
+#if DASHCAM_WITH_CUDA
+  int count = 0;
+  DASHCAM_CUDA_CHECK(cudaGetDeviceCount(&count));
+  return count;
+#else
+  return 1;
+#endif
+}
+
+std::size_t free_device_memory(int index) {
+#if DASHCAM_WITH_CUDA
+  use_device(index);
+  std::size_t free = 0, total = 0;
+  DASHCAM_CUDA_CHECK(cudaMemGetInfo(&free, &total));
+  return free;
+#else
+  (void)index;
+  return 0;
+#endif
+}
+
+void use_device(int index) {
+#if DASHCAM_WITH_CUDA
+  thread_local int current = -1;
+  if (current != index) {
+    DASHCAM_CUDA_CHECK(cudaSetDevice(index));
+    current = index;
+  }
+#else
+  (void)index;
+#endif
+}
+
+}  // namespace dashcam::worker
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace dashcam::worker {
+
+struct GpuDeviceInfo {
+  int index = 0;
+  std::string name;
+  int sm_major = 0;
+  int sm_minor = 0;
+  std::size_t total_memory = 0;
+
+  // Stable identifier for caches keyed by hardware, e.g. "NVIDIA GeForce RTX 4090-sm89".
+  std::string cache_tag() const;
+};
+
+// On CPU-only builds this describes the host as a pseudo-device named "cpu".
+GpuDeviceInfo query_device(int index);
+
+// Visible CUDA devices; 1 (the host) on CPU-only builds.
+int device_count();
+
+// Free memory on the device right now, 0 on CPU-only builds.
+std::size_t free_device_memory(int index);
+
+// Makes `index` the calling thread's current device, as every CUDA call and
+// kernel launch on that thread expects; a no-op when it already is and on
+// CPU-only builds.
+void use_device(int index);
+
+}  // namespace dashcam::worker
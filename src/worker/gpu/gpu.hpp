@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdexcept>
+#include <string>
+
+// Forward declaration matching the CUDA runtime's cudaStream_t, so headers can
+// pass streams around without pulling CUDA into CPU-only builds.
+struct CUstream_st;
+
+namespace dashcam::worker {
+
+using GpuStream = CUstream_st*;
+
+// Raised for any CUDA / NVDEC failure. GPU errors are not recoverable inside a
+// task; the task is abandoned and re-pulled, per task_system_overview.md §6.
+class GpuError : public std::runtime_error {
+ public:
+  using std::runtime_error::runtime_error;
+};
+
+}  // namespace dashcam::worker
+
+#if DASHCAM_WITH_CUDA
+#include <cuda_runtime_api.h>
+
+#define DASHCAM_CUDA_CHECK(expr)                                                  \
+  do {                                                                            \
+    cudaError_t dashcam_cuda_status_ = (expr);                                    \
+    if (dashcam_cuda_status_ != cudaSuccess) {                                    \
+      throw ::dashcam::worker::GpuError(std::string(#expr) + ": " +               \
+                                        cudaGetErrorString(dashcam_cuda_status_)); \
+    }                                                                             \
+  } while (0)
+#endif
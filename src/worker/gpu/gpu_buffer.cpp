@@ -0,0 +1,85 @@
+#include "worker/gpu/gpu_buffer.hpp"
+
+#include <cstdlib>
+#include <new>
+#include <utility>
+
+#include "worker/gpu/gpu.hpp"
+
+namespace dashcam::worker {
+
+namespace {
+
+// Row starts of every plane are aligned to this, which also suits the SIMD
+// kernels that read mapped planes on the CPU.
+constexpr std::size_t kHostAlignment = 64;
+
+}  // namespace
+
+GpuBuffer::GpuBuffer(std::size_t bytes, MemoryKind kind) : kind_(kind), bytes_(bytes) {
+  if (bytes == 0) {
+    return;
+  }
+#if DASHCAM_WITH_CUDA
+  if (kind == MemoryKind::Device) {
+    void* ptr = nullptr;
+    DASHCAM_CUDA_CHECK(cudaMalloc(&ptr, bytes));
+    device_ = static_cast<std::uint8_t*>(ptr);
+  } else {
+    void* host = nullptr;
+    DASHCAM_CUDA_CHECK(cudaHostAlloc(&host, bytes, cudaHostAllocMapped));
+    void* device = nullptr;
+    cudaError_t status = cudaHostGetDevicePointer(&device, host, 0);
+    if (status != cudaSuccess) {
+      cudaFreeHost(host);
+      DASHCAM_CUDA_CHECK(status);
+    }
+    host_ = static_cast<std::uint8_t*>(host);
+    device_ = static_cast<std::uint8_t*>(device);
+  }
+#else
+  std::size_t rounded = (bytes + kHostAlignment - 1) / kHostAlignment * kHostAlignment;
+  void* ptr = std::aligned_alloc(kHostAlignment, rounded);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  host_ = static_cast<std::uint8_t*>(ptr);
+  device_ = host_;
+#endif
+}
+
+GpuBuffer::~GpuBuffer() { release(); }
+
+GpuBuffer::GpuBuffer(GpuBuffer&& other) noexcept
+    : kind_(other.kind_),
+      bytes_(std::exchange(other.bytes_, 0)),
+      device_(std::exchange(other.device_, nullptr)),
+      host_(std::exchange(other.host_, nullptr)) {}
+
+GpuBuffer& GpuBuffer::operator=(GpuBuffer&& other) noexcept {
+  if (this != &other) {
+    release();
+    kind_ = other.kind_;
+    bytes_ = std::exchange(other.bytes_, 0);
+    device_ = std::exchange(other.device_, nullptr);
+    host_ = std::exchange(other.host_, nullptr);
+  }
+  return *this;
+}
+
+void GpuBuffer::release() noexcept {
+#if DASHCAM_WITH_CUDA
+  if (kind_ == MemoryKind::Device && device_ != nullptr) {
+    cudaFree(device_);
+  } else if (host_ != nullptr) {
+    cudaFreeHost(host_);
+  }
+#else
+  std::free(host_);
+#endif
+  device_ = nullptr;
+  host_ = nullptr;
+  bytes_ = 0;
+}
+
+}  // namespace dashcam::worker
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace dashcam::worker {
+
+// Where a GpuBuffer lives.
+//  - Device:      VRAM, only dereferenceable from kernels.
+//  - MappedHost:  pinned host memory mapped into the device address space, so
+//                 kernels write it directly and the CPU reads it without a
+//                 cudaMemcpy. Used for small planes the CPU consumes.
+// Without DASHCAM_WITH_CUDA both kinds are plain aligned host allocations.
+enum class MemoryKind { Device, MappedHost };
+
+class GpuBuffer {
+ public:
+  GpuBuffer() = default;
+  GpuBuffer(std::size_t bytes, MemoryKind kind);
+  ~GpuBuffer();
+
+  GpuBuffer(GpuBuffer&& other) noexcept;
+  GpuBuffer& operator=(GpuBuffer&& other) noexcept;
+  GpuBuffer(const GpuBuffer&) = delete;
+  GpuBuffer& operator=(const GpuBuffer&) = delete;
+
+  MemoryKind kind() const { return kind_; }
+  std::size_t size() const { return bytes_; }
+
+  // Pointer usable from kernels (for MappedHost: the device alias).
+  std::uint8_t* device_ptr() const { return device_; }
+  // Pointer usable from host code; nullptr for Device memory in CUDA builds.
+  std::uint8_t* host_ptr() const { return host_; }
+
+ private:
+  void release() noexcept;
+
+  MemoryKind kind_ = MemoryKind::Device;
+  std::size_t bytes_ = 0;
+  std::uint8_t* device_ = nullptr;
+  std::uint8_t* host_ = nullptr;
+};
+
+}  // namespace dashcam::worker
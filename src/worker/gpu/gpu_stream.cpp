@@ -0,0 +1,77 @@
+#include "worker/gpu/gpu_stream.hpp"
+
+#include <cstring>
+
+namespace dashcam::worker {
+
+namespace {
+
+#if !DASHCAM_WITH_CUDA
+void copy_rows(std::uint8_t* dst, std::size_t dst_pitch, const std::uint8_t* src,
+               std::size_t src_pitch, std::size_t row_bytes, std::size_t rows) {
+  for (std::size_t y = 0; y < rows; ++y) {
+    std::memcpy(dst + y * dst_pitch, src + y * src_pitch, row_bytes);
+  }
+}
+#endif
+
+}  // namespace
+
+OwnedStream::OwnedStream() {
+#if DASHCAM_WITH_CUDA
+  cudaStream_t stream = nullptr;
+  DASHCAM_CUDA_CHECK(cudaStreamCreateWithFlags(&stream, cudaStreamNonBlocking));
+  stream_ = stream;
+#endif
+}
+
+OwnedStream::~OwnedStream() {
+#if DASHCAM_WITH_CUDA
+  if (stream_ != nullptr) {
+    cudaStreamDestroy(stream_);
+  }
+#endif
+}
+
+void OwnedStream::synchronize() const {
+#if DASHCAM_WITH_CUDA
+  DASHCAM_CUDA_CHECK(cudaStreamSynchronize(stream_));
+#endif
+}
+
+void upload_2d(std::uint8_t* dst, std::size_t dst_pitch, const std::uint8_t* src,
+               std::size_t src_pitch, std::size_t row_bytes, std::size_t rows, GpuStream stream) {
+#if DASHCAM_WITH_CUDA
+  DASHCAM_CUDA_CHECK(cudaMemcpy2DAsync(dst, dst_pitch, src, src_pitch, row_bytes, rows,
+                                       cudaMemcpyHostToDevice, stream));
+#else
+  (void)stream;
+  copy_rows(dst, dst_pitch, src, src_pitch, row_bytes, rows);
+#endif
+}
+
+void download_2d(std::uint8_t* dst, std::size_t dst_pitch, const std::uint8_t* src,
+                 std::size_t src_pitch, std::size_t row_bytes, std::size_t rows,
+                 GpuStream stream) {
+#if DASHCAM_WITH_CUDA
+  DASHCAM_CUDA_CHECK(cudaMemcpy2DAsync(dst, dst_pitch, src, src_pitch, row_bytes, rows,
+                                       cudaMemcpyDeviceToHost, stream));
+#else
+  (void)stream;
+  copy_rows(dst, dst_pitch, src, src_pitch, row_bytes, rows);
+#endif
+}
+
+void copy_2d_device(std::uint8_t* dst, std::size_t dst_pitch, const std::uint8_t* src,
+                    std::size_t src_pitch, std::size_t row_bytes, std::size_t rows,
+                    GpuStream stream) {
+#if DASHCAM_WITH_CUDA
+  DASHCAM_CUDA_CHECK(cudaMemcpy2DAsync(dst, dst_pitch, src, src_pitch, row_bytes, rows,
+                                       cudaMemcpyDeviceToDevice, stream));
+#else
+  (void)stream;
+  copy_rows(dst, dst_pitch, src, src_pitch, row_bytes, rows);
+#endif
+}
+
+}  // namespace dashcam::worker
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "worker/gpu/gpu.hpp"
+
+namespace dashcam::worker {
+
+// Owns one CUDA stream (a null handle on CPU-only builds, where every
+// operation below runs synchronously on the calling thread).
+class OwnedStream {
+ public:
+  OwnedStream();
+  ~OwnedStream();
+
+  OwnedStream(const OwnedStream&) = delete;
+  OwnedStream& operator=(const OwnedStream&) = delete;
+
+  GpuStream get() const { return stream_; }
+  void synchronize() const;
+
+ private:
+  GpuStream stream_ = nullptr;
+};
+
+// Host -> kernel-side 2D copy. Only used by ingest paths that have no
+// hardware decoder (e.g. Y4M test clips); NVDEC output never takes this route.
+void upload_2d(std::uint8_t* dst, std::size_t dst_pitch, const std::uint8_t* src,
+               std::size_t src_pitch, std::size_t row_bytes, std::size_t rows, GpuStream stream);
+
+// Kernel-side -> host 2D copy, for small regions such as plate crops.
+void download_2d(std::uint8_t* dst, std::size_t dst_pitch, const std::uint8_t* src,
+                 std::size_t src_pitch, std::size_t row_bytes, std::size_t rows,
+                 GpuStream stream);
+
+// Kernel-side -> kernel-side 2D copy.
+void copy_2d_device(std::uint8_t* dst, std::size_t dst_pitch, const std::uint8_t* src,
+                    std::size_t src_pitch, std::size_t row_bytes, std::size_t rows,
+                    GpuStream stream);
+
+}  // namespace dashcam::worker
@@ -0,0 +1,254 @@
+#include "worker/heavy/checkpoint.hpp"
+
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include "common/hash.hpp"
+#include "worker/heavy/heavy_processor.hpp"
+#include "worker/inference/detector.hpp"
+
+namespace dashcam::worker {
+
+namespace {
+
+// Segment file layout: magic, XXH64 of the payload, payload. The payload
+// starts with segment_frames and the segment's first frame, then one entry
+// per kept frame: frame index, detection count, detections.
+constexpr char kMagic[8] = {'D', 'C', 'C', 'K', 'P', '0', '0', '1'};
+
+std::string sanitize(const std::string& text) {
+  std::string out;
+  for (char c : text) {
+    auto u = static_cast<unsigned char>(c);
+    out += std::isalnum(u) || c == '.' ? c : '_';
+  }
+  return out;
+}
+
+std::string segment_name(std::int64_t segment) {
+  char name[32];
+  std::snprintf(name, sizeof(name), "seg-%06lld.ckpt", static_cast<long long>(segment));
+  return name;
+}
+
+template <typename T>
+void put(std::vector<char>& out, T value) {
+  const char* bytes = reinterpret_cast<const char*>(&value);
+  out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+// Sequential reader over a payload; every get() is bounds-checked.
+struct Reader {
+  const char* data;
+  std::size_t size;
+  std::size_t pos = 0;
+
+  template <typename T>
+  bool get(T& value) {
+    if (size - pos < sizeof(T)) {
+      return false;
+    }
+    std::memcpy(&value, data + pos, sizeof(T));
+    pos += sizeof(T);
+    return true;
+  }
+};
+
+std::uint64_t hash_model(const std::filesystem::path& model) {
+  std::error_code ec;
+  if (std::filesystem::is_regular_file(model, ec)) {
+    return hash_file(model);
+  }
+  std::string name = model.generic_string();
+  return xxh64(name.data(), name.size());
+}
+
+// Parses the segment starting at `first` into `resume`; false when it is
+// damaged or was written with a different layout.
+bool read_segment(const std::filesystem::path& path, std::int64_t segment_frames,
+                  std::int64_t first, CheckpointResume& resume) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    return false;
+  }
+  char magic[sizeof(kMagic)];
+  std::uint64_t checksum = 0;
+  if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0 ||
+      !in.read(reinterpret_cast<char*>(&checksum), sizeof(checksum))) {
+    return false;
+  }
+  std::vector<char> payload((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  if (xxh64(payload.data(), payload.size()) != checksum) {
+    return false;
+  }
+
+  Reader reader{payload.data(), payload.size()};
+  std::int64_t stored_frames = 0;
+  std::int64_t stored_first = 0;
+  if (!reader.get(stored_frames) || !reader.get(stored_first) ||
+      stored_frames != segment_frames || stored_first != first) {
+    return false;
+  }
+  std::unordered_map<std::int64_t, std::vector<Detection>> frames;
+  while (reader.pos < reader.size) {
+    std::int64_t frame_index = 0;
+    std::uint32_t count = 0;
+    if (!reader.get(frame_index) || !reader.get(count)) {
+      return false;
+    }
+    std::vector<Detection>& detections = frames[frame_index];
+    for (std::uint32_t i = 0; i < count; ++i) {
+      Detection d;
+      std::int32_t cls = 0;
+      std::int32_t model_class = 0;
+      if (!reader.get(d.box.x0) || !reader.get(d.box.y0) || !reader.get(d.box.x1) ||
+          !reader.get(d.box.y1) || !reader.get(d.score) || !reader.get(cls) ||
+          !reader.get(model_class)) {
+        return false;
+      }
+      d.cls = static_cast<ObjectClass>(cls);
+      d.model_class = model_class;
+      detections.push_back(d);
+    }
+  }
+  resume.detections.merge(frames);
+  resume.end_frame = first + segment_frames;
+  return true;
+}
+
+}  // namespace
+
+std::string CheckpointKey::dir_name() const {
+  return sanitize(video_name) + "-" + to_hex(video_hash) + "-" + to_hex(model_hash) + "-" +
+         to_hex(params_hash);
+}
+
+CheckpointKey make_checkpoint_key(const std::filesystem::path& video, const FrameRange& range,
+                                  const HeavyProcessConfig& config,
+                                  const DetectorConfig& detector) {
+  CheckpointKey key;
+  key.video_name = video.stem().string();
+  key.video_hash = fingerprint_file(video);
+
+  Xxh64 models;
+  for (const auto& model : {detector.vehicle_model, detector.plate_model}) {
+    std::uint64_t h = hash_model(model);
+    models.update(&h, sizeof(h));
+  }
+  key.model_hash = models.digest();
+
+  // Settings that change which frames are kept or what is detected on them.
+  // Thread counts and queue sizes do not, so they are left out.
+  const MotionConfig& m = config.motion;
+  const TilePlanOptions& t = detector.plate_tiles;
+  std::ostringstream params;
+  params << "v1 range=" << range.first << "-" << range.end
+         << " seg=" << config.checkpoint.segment_frames
+         << " lowres=" << config.decoder.lowres_width << " diff=" << m.thresholds.diff
+         << " dark=" << m.thresholds.dark << " bright=" << m.thresholds.bright
+         << " changed=" << m.min_changed_fraction << " gap=" << m.max_gap_frames
+         << " minluma=" << m.min_brightness << " precision=" << to_string(detector.precision)
+         << " input=" << detector.input_size << " batch=" << detector.max_batch
+         << " search=" << static_cast<int>(detector.plate_search) << " tile=" << t.tile_size
+         << "/" << t.grid_overlap << "/" << t.margin << "/" << t.max_tiles
+         << " plate_batch=" << detector.plate_max_batch
+         << " vdec=" << detector.vehicle_decode.score_threshold << "/"
+         << detector.vehicle_decode.nms_iou << " pdec=" << detector.plate_decode.score_threshold
+         << "/" << detector.plate_decode.nms_iou;
+  std::string text = params.str();
+  key.params_hash = xxh64(text.data(), text.size());
+  return key;
+}
+
+CheckpointStore::CheckpointStore(CheckpointConfig config) : config_(std::move(config)) {
+  if (config_.segment_frames < 1) {
+    throw std::invalid_argument("checkpoint segment_frames must be positive");
+  }
+  std::filesystem::create_directories(config_.dir);
+  auto cutoff = std::filesystem::file_time_type::clock::now() - config_.max_age;
+  for (const auto& entry : std::filesystem::directory_iterator(config_.dir)) {
+    std::error_code ec;
+    if (entry.is_directory(ec) && entry.last_write_time(ec) < cutoff && !ec) {
+      std::filesystem::remove_all(entry.path(), ec);
+    }
+  }
+}
+
+std::filesystem::path CheckpointStore::entry_dir(const CheckpointKey& key) const {
+  return config_.dir / key.dir_name();
+}
+
+CheckpointResume CheckpointStore::load(const CheckpointKey& key, std::int64_t first_frame) const {
+  CheckpointResume resume;
+  resume.end_frame = first_frame;
+  auto dir = entry_dir(key);
+  for (std::int64_t segment = 0;; ++segment) {
+    if (!read_segment(dir / segment_name(segment), config_.segment_frames,
+                      first_frame + segment * config_.segment_frames, resume)) {
+      break;
+    }
+  }
+  return resume;
+}
+
+void CheckpointStore::discard(const CheckpointKey& key) const {
+  std::error_code ec;
+  std::filesystem::remove_all(entry_dir(key), ec);
+}
+
+CheckpointWriter::CheckpointWriter(std::filesystem::path entry_dir, std::int64_t segment_frames,
+                                   std::int64_t first_frame, std::int64_t resume_end)
+    : dir_(std::move(entry_dir)), segment_frames_(segment_frames), first_frame_(first_frame) {
+  std::filesystem::create_directories(dir_);
+  segment_ = (resume_end - first_frame_) / segment_frames_;
+}
+
+void CheckpointWriter::flush_until(std::int64_t frame_index) {
+  while (first_frame_ + (segment_ + 1) * segment_frames_ <= frame_index) {
+    std::vector<char> payload;
+    put(payload, segment_frames_);
+    put(payload, first_frame_ + segment_ * segment_frames_);
+    payload.insert(payload.end(), payload_.begin(), payload_.end());
+
+    auto final_path = dir_ / segment_name(segment_);
+    auto temp_path = final_path;
+    temp_path += ".tmp";
+    {
+      std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+      std::uint64_t checksum = xxh64(payload.data(), payload.size());
+      out.write(kMagic, sizeof(kMagic));
+      out.write(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+      out.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+      if (!out) {
+        throw std::runtime_error("cannot write checkpoint " + temp_path.string());
+      }
+    }
+    std::filesystem::rename(temp_path, final_path);
+    payload_.clear();
+    ++segment_;
+  }
+}
+
+void CheckpointWriter::record(std::int64_t frame_index, std::span<const Detection> detections) {
+  if (frame_index < first_frame_ + segment_ * segment_frames_) {
+    return;  // already checkpointed by the run being resumed
+  }
+  flush_until(frame_index);
+  put(payload_, frame_index);
+  put(payload_, static_cast<std::uint32_t>(detections.size()));
+  for (const Detection& d : detections) {
+    put(payload_, d.box.x0);
+    put(payload_, d.box.y0);
+    put(payload_, d.box.x1);
+    put(payload_, d.box.y1);
+    put(payload_, d.score);
+    put(payload_, static_cast<std::int32_t>(d.cls));
+    put(payload_, static_cast<std::int32_t>(d.model_class));
+  }
+}
+
+}  // namespace dashcam::worker
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "worker/decode/video_decoder.hpp"
+#include "worker/inference/detection.hpp"
+
+namespace dashcam::worker {
+
+struct HeavyProcessConfig;
+struct DetectorConfig;
+
+struct CheckpointConfig {
+  // Local SSD directory; empty disables checkpointing.
+  std::filesystem::path dir;
+  // Frames per checkpoint segment: the most decoded video an interruption
+  // can cost.
+  std::int64_t segment_frames = 1800;
+  // Checkpoints of videos that never finished are removed after this long.
+  std::chrono::hours max_age{24 * 14};
+};
+
+// Everything a checkpoint's contents depend on. Any change gives a new
+// entry, so a resumed task produces exactly what an uninterrupted one would.
+struct CheckpointKey {
+  std::string video_name;         // file stem, for humans browsing the cache
+  std::uint64_t video_hash = 0;   // fingerprint_file of the video
+  std::uint64_t model_hash = 0;   // detector model files
+  std::uint64_t params_hash = 0;  // every setting that changes the detections
+
+  std::string dir_name() const;
+};
+
+// `range` is part of the key: each shard of a video has its own entry.
+CheckpointKey make_checkpoint_key(const std::filesystem::path& video, const FrameRange& range,
+                                  const HeavyProcessConfig& config,
+                                  const DetectorConfig& detector);
+
+// What a previous, interrupted run left behind: frames from the start of
+// the range up to `end_frame` are covered, with the §3.2 detections of each
+// kept frame among them. Kept frames with nothing detected are present with
+// an empty list.
+struct CheckpointResume {
+  std::int64_t end_frame = 0;
+  std::unordered_map<std::int64_t, std::vector<Detection>> detections;
+};
+
+// Per-video checkpoints on the workhorse SSD (workhorse.md §4). Local only:
+// nothing here is visible to other devices, and an entry is discarded once
+// its task is complete.
+class CheckpointStore {
+ public:
+  // Creates the directory and removes entries older than config.max_age.
+  explicit CheckpointStore(CheckpointConfig config);
+
+  const CheckpointConfig& config() const { return config_; }
+  std::filesystem::path entry_dir(const CheckpointKey& key) const;
+
+  // Valid segments from `first_frame` (the start of the run's range) on;
+  // stops at the first missing or damaged one.
+  CheckpointResume load(const CheckpointKey& key, std::int64_t first_frame) const;
+
+  void discard(const CheckpointKey& key) const;
+
+ private:
+  CheckpointConfig config_;
+};
+
+// Collects the detections of kept frames, in frame order, and writes each
+// segment once a frame past its end arrives. Segments are written to a
+// temporary file and renamed, so a crash never leaves a truncated one.
+class CheckpointWriter {
+ public:
+  // Segments start at `first_frame`, every `segment_frames`. Those below
+  // `resume_end` are already on disk and not rewritten.
+  CheckpointWriter(std::filesystem::path entry_dir, std::int64_t segment_frames,
+                   std::int64_t first_frame, std::int64_t resume_end);
+
+  void record(std::int64_t frame_index, std::span<const Detection> detections);
+
+ private:
+  void flush_until(std::int64_t frame_index);
+
+  std::filesystem::path dir_;
+  std::int64_t segment_frames_;
+  std::int64_t first_frame_;
+  std::int64_t segment_ = 0;  // index of the segment being collected
+  std::vector<char> payload_;  // entries of the current segment
+};
+
+}  // namespace dashcam::worker
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <memory_resource>
+#include <vector>
+
+#include "worker/decode/frame_surface.hpp"
+#include "worker/inference/detection.hpp"
+#include "worker/motion/motion_filter.hpp"
+
+namespace dashcam::worker {
+
+// One frame's worth of work in a HEAVY_PROCESS_VIDEO pipeline. The decoder
+// creates it around a GPU surface and each stage fills in its own results;
+// releasing the job returns the surface to the decoder's pool. Its lists are
+// allocated from the task's arena (TaskArena::frames()).
+struct FrameJob {
+  FramePtr frame;
+  MotionResult motion;                     // §3.1 keep/drop and frame quality
+  std::pmr::vector<Box> proposals;         // §3.1 coarse changed regions
+  std::pmr::vector<Detection> detections;  // §3.2
+  bool resumed = false;               // detections restored from a checkpoint
+  int camera = 0;                     // stream of a paired run (0: front, 1: rear)
+};
+
+}  // namespace dashcam::worker
@@ -0,0 +1,179 @@
+#include "worker/heavy/heavy_output.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+#include "common/json_util.hpp"
+
+namespace dashcam::worker {
+
+namespace {
+
+Json::Value box_json(const Box& b) {
+  Json::Value box(Json::arrayValue);
+  for (float v : {b.x0, b.y0, b.x1, b.y1}) {
+    box.append(v);
+  }
+  return box;
+}
+
+// The scratch file is usually on another filesystem than heavy_output.
+void move_file(const std::filesystem::path& from, const std::filesystem::path& to) {
+  std::error_code ec;
+  std::filesystem::rename(from, to, ec);
+  if (!ec) {
+    return;
+  }
+  auto tmp = to;
+  tmp += ".tmp";
+  std::filesystem::copy_file(from, tmp, std::filesystem::copy_options::overwrite_existing);
+  std::filesystem::rename(tmp, to);
+  std::filesystem::remove(from);
+}
+
+std::string lowres_file_name(const HeavyResult& result) {
+  return "video_lowres" + result.lowres_file.extension().string();
+}
+
+}  // namespace
+
+Json::Value to_json(const HeavyResult& result) {
+  Json::Value out(Json::objectValue);
+  if (result.shard) {
+    out["shard"] = dashcam::to_json(*result.shard);
+  }
+  out["frames_decoded"] = Json::Int64(result.frames_decoded);
+  out["frames_kept"] = Json::Int64(result.frames_kept);
+  if (!result.camera.empty()) {
+    Json::Value pair(Json::objectValue);
+    pair["camera"] = result.camera;
+    pair["video_id"] = result.paired_video_id;
+    out["pair"] = pair;
+  }
+
+  Json::Value plates(Json::arrayValue);
+  for (const PlateRead& p : result.plates) {
+    Json::Value plate(Json::objectValue);
+    plate["track_id"] = p.track_id;
+    plate["text"] = p.text;
+    plate["share"] = p.share;
+    plate["converged"] = p.converged;
+    plate["reads"] = p.reads;
+    plate["first_frame"] = Json::Int64(p.first_frame);
+    plate["last_frame"] = Json::Int64(p.last_frame);
+    plate["crops_seen"] = Json::Int64(p.crops_seen);
+    plate["best_frame"] = Json::Int64(p.best_frame);
+    plate["best_quality"] = p.best_quality;
+    plate["best_box"] = box_json(p.best_box);
+    plate["first_box"] = box_json(p.first_box);
+    plate["last_box"] = box_json(p.last_box);
+    if (p.fused_track >= 0) {
+      plate["fused_track"] = p.fused_track;
+    }
+    plates.append(plate);
+  }
+  out["plates"] = plates;
+
+  Json::Value ocr(Json::objectValue);
+  ocr["tracks"] = Json::UInt64(result.ocr.tracks);
+  ocr["crops_seen"] = Json::UInt64(result.ocr.crops_seen);
+  ocr["ocr_calls"] = Json::UInt64(result.ocr.ocr_calls);
+  ocr["fused_tracks"] = Json::UInt64(result.ocr.fused_tracks);
+  out["ocr"] = ocr;
+
+  Json::Value io(Json::objectValue);
+  io["bytes_read"] = Json::UInt64(result.io.bytes_read);
+  io["reads"] = Json::UInt64(result.io.reads);
+  io["read_s"] = result.io.read_s;
+  io["stall_s"] = result.io.stall_s;
+  io["index_cached"] = result.io.index_cached;
+  out["io"] = io;
+
+  Json::Value crops(Json::objectValue);
+  crops["crops"] = Json::UInt64(result.crops.crops);
+  crops["bytes"] = Json::UInt64(result.crops.bytes);
+  crops["encode_s"] = result.crops.encode_s;
+  out["crops"] = crops;
+
+  // Allocations per item show a stage that went back to the heap per frame.
+  Json::Value stages(Json::arrayValue);
+  for (const StageSnapshot& s : result.stages) {
+    Json::Value stage(Json::objectValue);
+    stage["name"] = s.name;
+    stage["threads"] = Json::UInt64(s.threads);
+    stage["items_in"] = Json::UInt64(s.items_in);
+    stage["items_out"] = Json::UInt64(s.items_out);
+    stage["busy_s"] = s.busy_s;
+    stage["allocations"] = Json::UInt64(s.allocations);
+    stages.append(stage);
+  }
+  out["stages"] = stages;
+
+  Json::Value memory(Json::objectValue);
+  memory["frame_bytes"] = Json::UInt64(result.memory.frame_bytes);
+  memory["crop_bytes"] = Json::UInt64(result.memory.crop_bytes);
+  out["memory"] = memory;
+
+  Json::Value gps(Json::objectValue);
+  gps["source"] = result.gps.source;
+  gps["fixes"] = Json::UInt64(result.gps.track.size());
+  std::uint64_t located = 0;
+  for (double lat : result.detections.lat) {
+    located += std::isnan(lat) ? 0 : 1;
+  }
+  gps["detections_located"] = Json::UInt64(located);
+  if (result.gps.start_utc_us) {
+    gps["start_utc_us"] = Json::Int64(*result.gps.start_utc_us);
+  }
+  out["gps"] = gps;
+
+  if (!result.lowres_file.empty()) {
+    Json::Value lowres(Json::objectValue);
+    lowres["file"] = lowres_file_name(result);
+    lowres["encoder"] = result.lowres.encoder;
+    lowres["width"] = result.lowres.width;
+    lowres["height"] = result.lowres.height;
+    lowres["frames"] = Json::Int64(result.lowres.frames);
+    lowres["bytes"] = Json::UInt64(result.lowres.bytes);
+    lowres["encode_s"] = result.lowres.encode_s;
+    out["lowres"] = lowres;
+  }
+  return out;
+}
+
+std::filesystem::path write_heavy_output(const std::filesystem::path& root,
+                                         const std::string& video_id, const HeavyResult& result) {
+  std::filesystem::path dir = root / video_id;
+  if (result.shard) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "shard-%03d", result.shard->index);
+    dir /= name;
+  }
+  std::filesystem::create_directories(dir);
+  // Written first: summary.json appearing marks the directory complete.
+  result.detections.write(dir / kDetectionFile);
+  if (!result.gps.track.empty()) {
+    result.gps.track.write(dir / kGpsFile);
+  }
+  if (!result.crop_pack.empty()) {
+    result.crop_pack.write(dir);
+  }
+  if (!result.lowres_file.empty()) {
+    move_file(result.lowres_file, dir / lowres_file_name(result));
+  }
+  std::filesystem::path file = dir / "summary.json";
+  std::filesystem::path tmp = dir / "summary.json.tmp";
+  {
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    out << to_json_string(to_json(result));
+    if (!out) {
+      throw std::runtime_error("cannot write " + tmp.string());
+    }
+  }
+  std::filesystem::rename(tmp, file);
+  return dir;
+}
+
+}  // namespace dashcam::worker
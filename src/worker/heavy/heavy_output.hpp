@@ -0,0 +1,26 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+
+#include <json/value.h>
+
+#include "worker/heavy/heavy_processor.hpp"
+
+namespace dashcam::worker {
+
+Json::Value to_json(const HeavyResult& result);
+
+// Writes the task's output under `root/<video_id>/` (the Indoor NAS
+// /videos/heavy_output tree), or `root/<video_id>/shard-NNN/` for one shard
+// of a video, and returns that directory: summary.json (to_json) plus the
+// per-detection columns in detections.dcol (common/detection_columns.hpp),
+// the GPS log in gps.dcol (common/gps_track.hpp),
+// the crop pack (common/crop_pack.hpp) and video_lowres.mp4, moved in from
+// the scratch dir.
+// Files are written to a temporary name and renamed, so a crash never
+// leaves a partial file that finalization could pick up.
+std::filesystem::path write_heavy_output(const std::filesystem::path& root,
+                                         const std::string& video_id, const HeavyResult& result);
+
+}  // namespace dashcam::worker
@@ -0,0 +1,498 @@
+#include "worker/heavy/heavy_processor.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <exception>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include "common/metrics.hpp"
+#include "worker/gpu/device_info.hpp"
+
+namespace dashcam::worker {
+
+namespace {
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+Histogram& gps_seconds(const char* step) {
+  return default_metrics().histogram("dashcam_worker_gps_seconds",
+                                     "Time per video loading its GPS log or aligning detections "
+                                     "to it (§3.5).",
+                                     {{"step", step}});
+}
+
+// Fusion records the link on the track that joined the vote; mirror it
+// onto the track it joined, in the other camera's list (sorted by id).
+void link_fused_tracks(std::vector<PlateRead>& front, std::vector<PlateRead>& rear) {
+  auto mirror = [](const std::vector<PlateRead>& from, std::vector<PlateRead>& to) {
+    for (const PlateRead& read : from) {
+      if (read.fused_track < 0) {
+        continue;
+      }
+      auto it = std::lower_bound(
+          to.begin(), to.end(), read.fused_track,
+          [](const PlateRead& r, int track_id) { return r.track_id < track_id; });
+      if (it != to.end() && it->track_id == read.fused_track) {
+        it->fused_track = read.track_id;
+      }
+    }
+  };
+  mirror(front, rear);
+  mirror(rear, front);
+}
+
+}  // namespace
+
+HeavyProcessor::HeavyProcessor(HeavyProcessConfig config, std::shared_ptr<Detector> detector,
+                               std::shared_ptr<OcrEngine> ocr)
+    : config_(std::move(config)), detector_(std::move(detector)), ocr_(std::move(ocr)) {
+  // Decode-only runs have nothing worth checkpointing.
+  if (detector_ && !config_.checkpoint.dir.empty()) {
+    checkpoints_.emplace(config_.checkpoint);
+  }
+  prune_index_cache(config_.decoder.io);
+  if (detector_ && config_.crops.enabled) {
+    use_device(config_.decoder.gpu_device);
+    jpeg_.push_back(make_jpeg_encoder(config_.crops.quality));
+    if (!jpeg_.front()) {
+      std::fprintf(stderr, "no JPEG encoder in this build; plate crops are not archived\n");
+    }
+  }
+}
+
+void HeavyProcessor::prefetch(const std::filesystem::path& video,
+                              const std::optional<ShardSpec>& shard) {
+  // A later shard starts wherever the demuxer's seek lands, so only its
+  // index is loaded ahead of time.
+  std::optional<std::int64_t> warm_from;
+  if (!shard || shard->first_frame == 0) {
+    warm_from = 0;
+  }
+  PrefetchConfig io = config_.decoder.io;
+  prefetch_.reset();  // waits for an unused earlier prefetch to finish opening
+  prefetch_.emplace(Prefetch{video, std::async(std::launch::async, [video, io, warm_from] {
+                               return std::make_shared<PrefetchReader>(video, io, warm_from);
+                             })});
+}
+
+std::shared_ptr<PrefetchReader> HeavyProcessor::open_source(const std::filesystem::path& video) {
+  if (prefetch_ && prefetch_->video == video) {
+    Prefetch prefetched = std::move(*prefetch_);
+    prefetch_.reset();
+    try {
+      return prefetched.source.get();
+    } catch (const std::exception& e) {
+      // Opening again below reports the error, or succeeds if it was transient.
+      std::fprintf(stderr, "%s: prefetch failed: %s\n", video.filename().string().c_str(),
+                   e.what());
+    }
+  }
+  return std::make_shared<PrefetchReader>(video, config_.decoder.io);
+}
+
+// One camera's video within a run: its decoder and the per-video state of
+// every stage. A run has one, or two for a front/rear pair.
+struct HeavyProcessor::Stream {
+  int camera = 0;
+  std::filesystem::path video;
+  HeavyResult* result = nullptr;
+  std::shared_ptr<PrefetchReader> source;
+  std::unique_ptr<VideoDecoder> decoder;
+  std::unique_ptr<LowresEncoder> lowres;
+  std::optional<MotionFilter> motion;
+  std::optional<CropWriter> crops;
+  std::optional<PlateReader> plates;
+  std::optional<CheckpointResume> resume;
+  std::optional<CheckpointWriter> writer;
+  FramePtr next;  // decoded, not yet handed to the pipeline
+  bool ended = false;
+};
+
+void HeavyProcessor::add_stages(Pipeline<FrameJob>& pipeline,
+                                std::vector<std::unique_ptr<Stream>>& streams) {
+  // The archive video needs every frame, so it is encoded before the motion
+  // filter drops any; in order, on one thread.
+  if (std::any_of(streams.begin(), streams.end(), [](const auto& s) { return s->lowres != nullptr; })) {
+    pipeline.add_stage({"lowres", 1, config_.queue_capacity, true, true},
+                       [&streams](FrameJob& job) {
+                         if (LowresEncoder* lowres = streams[job.camera]->lowres.get()) {
+                           lowres->encode(*job.frame);
+                         }
+                         return true;
+                       });
+  }
+
+  // The filter compares each frame with the one decoded before it, so it
+  // needs every frame, in order, on one thread. Dropped frames release their
+  // surface here, before they reach the GPU stages.
+  pipeline.add_stage({"motion", 1, config_.queue_capacity, true}, [&streams](FrameJob& job) {
+    Stream& stream = *streams[job.camera];
+    job.motion = stream.motion->evaluate(job.frame, &job.proposals);
+    const std::optional<CheckpointResume>& resume = stream.resume;
+    if (job.motion.keep && resume && job.frame->frame_index < resume->end_frame) {
+      // Filtering is deterministic, so a frame kept now was kept before;
+      // one missing from the checkpoint is simply detected again.
+      auto it = resume->detections.find(job.frame->frame_index);
+      if (it != resume->detections.end()) {
+        job.detections.assign(it->second.begin(), it->second.end());
+        job.resumed = true;
+      }
+    }
+    return job.motion.keep;
+  });
+
+  if (detector_) {
+    // Batches mix the frames of both cameras of a pair, so two half-busy
+    // streams still fill the detector's batches.
+    const DetectorConfig& dc = detector_->config();
+    BatchOptions batch{static_cast<std::size_t>(dc.max_batch), dc.max_latency};
+    StageOptions detect{"detect", config_.detect_threads, config_.queue_capacity};
+    detect.throttled = true;
+    pipeline.add_batch_stage(detect, batch,
+                             [this](std::span<FrameJob*> jobs) {
+                               std::vector<DetectRequest> requests;
+                               requests.reserve(jobs.size());
+                               for (FrameJob* job : jobs) {
+                                 if (!job->resumed) {
+                                   requests.push_back(
+                                       {job->frame.get(), job->proposals, &job->detections});
+                                 }
+                               }
+                               if (!requests.empty()) {
+                                 detector_->detect(requests);
+                               }
+                             });
+
+    // Tracking carries state across frames, like the motion filter. OCR runs
+    // inline here because each read decides whether the track needs more.
+    // Frames arrive in order, so this is also where segments are checkpointed
+    // (before tracking assigns track ids). Both cameras' readers run on this
+    // one thread, which is what lets them fuse tracks without locking.
+    pipeline.add_stage({"track_ocr", 1, config_.queue_capacity, true},
+                       [&streams](FrameJob& job) {
+                         Stream& stream = *streams[job.camera];
+                         if (stream.writer) {
+                           stream.writer->record(job.frame->frame_index, job.detections);
+                         }
+                         stream.plates->observe(job);
+                         for (const Detection& d : job.detections) {
+                           stream.result->detections.append(
+                               job.frame->frame_index, job.frame->pts_us, d.box.x0, d.box.y0,
+                               d.box.x1, d.box.y1, d.score, static_cast<std::uint8_t>(d.cls),
+                               d.track_id);
+                         }
+                         return true;
+                       });
+  }
+}
+
+HeavyResult HeavyProcessor::run(const std::filesystem::path& video,
+                                const std::optional<ShardSpec>& shard) {
+  return std::move(run_streams({&video, 1}, shard).front());
+}
+
+PairedResult HeavyProcessor::run_pair(const std::filesystem::path& front,
+                                      const std::filesystem::path& rear) {
+  const std::filesystem::path videos[] = {front, rear};
+  std::vector<HeavyResult> results = run_streams(videos, std::nullopt);
+  results[0].camera = "front";
+  results[1].camera = "rear";
+  return {std::move(results[0]), std::move(results[1])};
+}
+
+std::vector<HeavyResult> HeavyProcessor::run_streams(
+    std::span<const std::filesystem::path> videos, const std::optional<ShardSpec>& shard) {
+  std::vector<HeavyResult> results;
+  try {
+    results = run_pass(videos, shard);
+  } catch (...) {
+    arena_.reset();
+    throw;
+  }
+  // Every frame job and crop of the pass is gone by now.
+  arena_.reset();
+  return results;
+}
+
+std::vector<HeavyResult> HeavyProcessor::run_pass(std::span<const std::filesystem::path> videos,
+                                                  const std::optional<ShardSpec>& shard) {
+  static Histogram& load_seconds = gps_seconds("load");
+  static Histogram& align_seconds = gps_seconds("align");
+  static Counter& frames_decoded = default_metrics().counter(
+      "dashcam_worker_frames_decoded_total", "Frames decoded by heavy-processing runs.");
+  static Counter& frames_kept = default_metrics().counter(
+      "dashcam_worker_frames_kept_total", "Frames kept by the motion filter and detected on.");
+
+  std::vector<HeavyResult> results(videos.size());
+  std::shared_ptr<TraceBuffer> trace;
+  if (config_.trace_events > 0) {
+    trace = std::make_shared<TraceBuffer>(config_.trace_events);
+    trace->name_thread("task");
+  }
+  // Everything below on this thread, and every thread started for the run,
+  // records into the run's buffer.
+  TraceBinding bind(trace.get());
+
+  use_device(config_.decoder.gpu_device);
+  FrameRange range;
+  if (shard) {
+    range = {shard->first_frame, shard->end_frame};
+  }
+  // A pair shares the surfaces of one task between its two decoders, so it
+  // fits the VRAM the scheduler reserved for one.
+  DecoderConfig decoding = config_.decoder;
+  if (videos.size() > 1) {
+    decoding.surface_count = std::max<std::size_t>(4, decoding.surface_count / videos.size());
+  }
+  std::optional<TrackFusion> fusion;
+  if (videos.size() > 1 && detector_) {
+    fusion.emplace(config_.fusion);
+  }
+
+  std::vector<std::unique_ptr<Stream>> streams;
+  for (std::size_t i = 0; i < videos.size(); ++i) {
+    auto stream = std::make_unique<Stream>();
+    Stream& s = *stream;
+    s.camera = static_cast<int>(i);
+    s.video = videos[i];
+    s.result = &results[i];
+    s.result->trace = trace;
+    s.result->shard = shard;
+    {
+      ScopedTrace span("open", "io");
+      s.source = open_source(s.video);
+      s.source->set_trace(trace);
+      s.decoder = open_decoder(s.source, decoding, range);
+    }
+    if (config_.transcode.height > 0) {
+      std::filesystem::path stem = config_.transcode.scratch_dir /
+                                   (s.video.stem().string() + "-" + std::to_string(range.first));
+      s.lowres = open_lowres_encoder(s.video, stem, s.decoder->info(), config_.transcode,
+                                     config_.decoder.gpu_device);
+    }
+    s.motion.emplace(config_.motion);
+    // Each crop writer encodes on its own thread, so a pair's second camera
+    // needs an encoder of its own; it is kept for later pairs.
+    if (!jpeg_.empty() && jpeg_.front()) {
+      if (jpeg_.size() <= i) {
+        jpeg_.push_back(make_jpeg_encoder(config_.crops.quality));
+      }
+      if (jpeg_[i]) {
+        s.crops.emplace(config_.crops, *jpeg_[i], config_.decoder.gpu_device);
+      }
+    }
+    s.plates.emplace(config_.plates, ocr_, s.crops ? &*s.crops : nullptr, arena_.crops());
+    if (fusion) {
+      s.plates->set_fusion(&*fusion, s.camera);
+    }
+    s.result->motion_kernel = s.motion->kernel_name();
+    if (checkpoints_) {
+      CheckpointKey key = make_checkpoint_key(s.video, range, config_, detector_->config());
+      s.resume = checkpoints_->load(key, range.first);
+      s.writer.emplace(checkpoints_->entry_dir(key), config_.checkpoint.segment_frames,
+                       range.first, s.resume->end_frame);
+      if (s.resume->end_frame > range.first) {
+        std::fprintf(stderr, "%s: resuming, detections up to frame %lld checkpointed\n",
+                     s.video.filename().string().c_str(),
+                     static_cast<long long>(s.resume->end_frame));
+      }
+    }
+    streams.push_back(std::move(stream));
+  }
+  // One log serves a pair: both cameras record the same trip, and the rear
+  // file's log is only read when the front has none.
+  if (detector_) {
+    ScopedTrace span("gps_load", "gps");
+    auto start = std::chrono::steady_clock::now();
+    GpsLog gps;
+    for (const auto& s : streams) {
+      gps = load_gps(s->video, config_.gps);
+      if (!gps.track.empty()) {
+        break;
+      }
+    }
+    for (HeavyResult& result : results) {
+      result.gps = gps;
+    }
+    load_seconds.observe(seconds_since(start));
+  }
+
+  Pipeline<FrameJob> pipeline("decode", config_.queue_capacity);
+  // Every stage may touch the frame surfaces, which live on the task's GPU.
+  int device = config_.decoder.gpu_device;
+  pipeline.set_thread_init([device] { use_device(device); });
+  pipeline.set_gate(config_.gate);
+  pipeline.set_trace(trace.get());
+  pipeline.set_metrics(&default_metrics(), "dashcam_worker_stage_seconds");
+  add_stages(pipeline, streams);
+
+  pipeline.run(
+      [&]() -> std::optional<FrameJob> {
+        // The streams of a pair are decoded in lockstep, by presentation
+        // time, so neither runs ahead and the frames of one moment reach the
+        // detector together.
+        Stream* pick = nullptr;
+        for (const auto& s : streams) {
+          if (!s->next && !s->ended) {
+            s->next = s->decoder->next();
+            s->ended = !s->next;
+          }
+          if (s->next && (pick == nullptr || s->next->pts_us < pick->next->pts_us)) {
+            pick = s.get();
+          }
+        }
+        if (pick == nullptr) {
+          return std::nullopt;
+        }
+        ++pick->result->frames_decoded;
+        FrameJob job{std::move(pick->next), {}, std::pmr::vector<Box>(arena_.frames()),
+                     std::pmr::vector<Detection>(arena_.frames())};
+        job.camera = pick->camera;
+        return job;
+      },
+      [&](FrameJob&& job) {
+        HeavyResult& result = results[job.camera];
+        ++result.frames_kept;
+        result.frames_resumed += job.resumed ? 1 : 0;
+      });
+
+  std::vector<StageSnapshot> stages = pipeline.snapshot();
+  // Detections are in frame order, so their timestamps are sorted and one
+  // merge pass places all of them on the track. A pair's two lists are
+  // merged by time first, so both still take a single pass.
+  if (!results.front().gps.track.empty()) {
+    std::size_t rows = 0;
+    for (const HeavyResult& result : results) {
+      rows += result.detections.size();
+    }
+    ScopedTrace span("gps_align", "gps", static_cast<std::int64_t>(rows));
+    auto start = std::chrono::steady_clock::now();
+    if (results.size() == 1) {
+      DetectionColumns& detections = results.front().detections;
+      GpsFixes fixes = interpolate_gps(results.front().gps.track, detections.pts_us,
+                                       config_.gps_align);
+      detections.lat = std::move(fixes.lat);
+      detections.lon = std::move(fixes.lon);
+    } else {
+      // (stream, row) of each merged timestamp.
+      std::vector<std::int64_t> t_us;
+      std::vector<std::pair<std::size_t, std::size_t>> origin;
+      t_us.reserve(rows);
+      origin.reserve(rows);
+      std::vector<std::size_t> next(results.size(), 0);
+      while (t_us.size() < rows) {
+        std::size_t pick = results.size();
+        for (std::size_t i = 0; i < results.size(); ++i) {
+          const std::vector<std::int64_t>& pts = results[i].detections.pts_us;
+          if (next[i] < pts.size() &&
+              (pick == results.size() ||
+               pts[next[i]] < results[pick].detections.pts_us[next[pick]])) {
+            pick = i;
+          }
+        }
+        t_us.push_back(results[pick].detections.pts_us[next[pick]]);
+        origin.emplace_back(pick, next[pick]++);
+      }
+      GpsFixes fixes = interpolate_gps(results.front().gps.track, t_us, config_.gps_align);
+      for (HeavyResult& result : results) {
+        result.detections.lat.assign(result.detections.size(), 0.0);
+        result.detections.lon.assign(result.detections.size(), 0.0);
+      }
+      for (std::size_t k = 0; k < rows; ++k) {
+        DetectionColumns& detections = results[origin[k].first].detections;
+        detections.lat[origin[k].second] = fixes.lat[k];
+        detections.lon[origin[k].second] = fixes.lon[k];
+      }
+    }
+    align_seconds.observe(seconds_since(start));
+  }
+  for (const auto& s : streams) {
+    HeavyResult& result = *s->result;
+    result.stages = stages;
+    frames_decoded.add(static_cast<std::uint64_t>(result.frames_decoded));
+    frames_kept.add(static_cast<std::uint64_t>(result.frames_kept));
+    if (s->lowres) {
+      ScopedTrace span("lowres_finish", "encode");
+      s->lowres->finish();
+      result.lowres_file = s->lowres->path();
+      result.lowres = s->lowres->stats();
+    }
+  }
+  // Fused tracks take their text from a vote both readers fed, so neither
+  // finishes until both have stopped reading.
+  for (const auto& s : streams) {
+    ScopedTrace span("plates_finish", "ocr");
+    s->result->plates = s->plates->finish();
+    s->result->ocr = s->plates->stats();
+  }
+  if (results.size() > 1) {
+    link_fused_tracks(results[0].plates, results[1].plates);
+  }
+  for (const auto& s : streams) {
+    HeavyResult& result = *s->result;
+    if (s->crops) {
+      ScopedTrace span("crops_finish", "encode");
+      result.crop_pack = s->crops->finish();
+      result.crops = s->crops->stats();
+    }
+    result.io = s->source->stats();
+    result.memory = arena_.stats();
+    log_result(s->video, result);
+  }
+  if (fusion) {
+    std::fprintf(stderr, "%s + %s: %llu plate tracks fused across cameras\n",
+                 videos[0].filename().string().c_str(), videos[1].filename().string().c_str(),
+                 static_cast<unsigned long long>(fusion->fused()));
+  }
+  return results;
+}
+
+void HeavyProcessor::log_result(const std::filesystem::path& video,
+                                const HeavyResult& result) const {
+  const IoStats& io = result.io;
+  std::fprintf(stderr, "%s: read %.1f MiB in %llu reads (%.1f MiB/s%s), decode stalled %.2f s\n",
+               video.filename().string().c_str(), static_cast<double>(io.bytes_read) / (1 << 20),
+               static_cast<unsigned long long>(io.reads),
+               io.read_s > 0 ? static_cast<double>(io.bytes_read) / (1 << 20) / io.read_s : 0.0,
+               io.index_cached ? ", index cached" : "", io.stall_s);
+  if (result.ocr.tracks > 0) {
+    std::fprintf(stderr, "%s: %llu plate tracks, %llu crops, %llu OCR calls (%llu saved)\n",
+                 video.filename().string().c_str(),
+                 static_cast<unsigned long long>(result.ocr.tracks),
+                 static_cast<unsigned long long>(result.ocr.crops_seen),
+                 static_cast<unsigned long long>(result.ocr.ocr_calls),
+                 static_cast<unsigned long long>(result.ocr.saved()));
+  }
+  if (!result.lowres_file.empty()) {
+    const TranscodeStats& t = result.lowres;
+    std::fprintf(stderr, "%s: low-res %dx%d, %lld frames, %.1f MiB (%s, %.2f s)\n",
+                 video.filename().string().c_str(), t.width, t.height,
+                 static_cast<long long>(t.frames), static_cast<double>(t.bytes) / (1 << 20),
+                 t.encoder.c_str(), t.encode_s);
+  }
+  if (result.crops.crops > 0) {
+    std::fprintf(stderr, "%s: %llu crops encoded (%s, %llu batches, %.1f KiB, %.2f s)\n",
+                 video.filename().string().c_str(),
+                 static_cast<unsigned long long>(result.crops.crops), jpeg_.front()->name(),
+                 static_cast<unsigned long long>(result.crops.batches),
+                 static_cast<double>(result.crops.bytes) / 1024, result.crops.encode_s);
+  }
+}
+
+void HeavyProcessor::discard_checkpoint(const std::filesystem::path& video,
+                                        const std::optional<ShardSpec>& shard) {
+  if (checkpoints_) {
+    FrameRange range;
+    if (shard) {
+      range = {shard->first_frame, shard->end_frame};
+    }
+    checkpoints_->discard(make_checkpoint_key(video, range, config_, detector_->config()));
+  }
+}
+
+}  // namespace dashcam::worker
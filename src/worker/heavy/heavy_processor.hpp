@@ -0,0 +1,177 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "common/detection_columns.hpp"
+#include "common/task.hpp"
+#include "common/trace.hpp"
+#include "worker/decode/video_decoder.hpp"
+#include "worker/encode/lowres_encoder.hpp"
+#include "worker/gps/gps_align.hpp"
+#include "worker/gps/gps_source.hpp"
+#include "worker/heavy/checkpoint.hpp"
+#include "worker/heavy/frame_job.hpp"
+#include "worker/inference/detector.hpp"
+#include "worker/io/prefetch_reader.hpp"
+#include "worker/memory/task_arena.hpp"
+#include "worker/motion/motion_filter.hpp"
+#include "worker/ocr/crop_writer.hpp"
+#include "worker/ocr/jpeg_encoder.hpp"
+#include "worker/ocr/ocr_engine.hpp"
+#include "worker/ocr/plate_reader.hpp"
+#include "worker/ocr/track_fusion.hpp"
+#include "worker/pipeline/pipeline.hpp"
+#include "worker/pipeline/pipeline_gate.hpp"
+#include "worker/pipeline/stage_stats.hpp"
+
+namespace dashcam::worker {
+
+struct HeavyProcessConfig {
+  DecoderConfig decoder;
+  MotionConfig motion;
+  PlateReaderConfig plates;
+  // JPEG-encodes the crops §3.3 picks into the per-video crop pack.
+  CropWriterConfig crops;
+  // De-res branch writing the archive's low-res video in the same pass.
+  TranscodeConfig transcode;
+  // §3.5: where the GPS log comes from and how fixes are interpolated.
+  GpsSourceConfig gps;
+  GpsAlignConfig gps_align;
+  // Survives interruptions without redoing §3.2 on frames already detected.
+  CheckpointConfig checkpoint;
+  // Input queue size of every stage. Frames in flight are bounded by the sum
+  // of queue capacities and stage threads, and in any case by
+  // decoder.surface_count since each frame pins a pool surface.
+  std::size_t queue_capacity = 8;
+  // Threads feeding the detector; each holds one detector lane while its
+  // batch runs, so more than DetectorConfig::lanes threads only adds waiting.
+  std::size_t detect_threads = 2;
+  // Lets the worker's activity governor pause or slow every run at stage
+  // boundaries (workhorse.md §7); none runs flat out.
+  std::shared_ptr<PipelineGate> gate;
+  // Matching a pair's plate tracks across its two cameras (run_pair).
+  FusionConfig fusion;
+  // Spans kept per run for its trace dump (the most recent ones when a run
+  // records more); 0 turns tracing off.
+  std::size_t trace_events = std::size_t{1} << 16;
+};
+
+struct HeavyResult {
+  std::optional<ShardSpec> shard;  // set when only part of the video ran
+  std::int64_t frames_decoded = 0;
+  std::int64_t frames_kept = 0;  // frames that reached consolidation
+  std::int64_t frames_resumed = 0;  // kept frames whose detections came from a checkpoint
+  std::string motion_kernel;     // SIMD variant the motion filter ran
+  // Paired runs only: "front" or "rear", and the video_id of the other
+  // camera's video (set by the caller, which knows the ids).
+  std::string camera;
+  std::string paired_video_id;
+  std::vector<PlateRead> plates; // one per plate track
+  DetectionColumns detections;   // every detection of every kept frame, with GPS
+  GpsLog gps;                    // the video's whole log, also for shards
+  CropPackWriter crop_pack;      // archived plate crops; empty without an encoder
+  CropStats crops;
+  // Low-res video of the frames run, in the scratch dir; empty when the
+  // branch is off or the build has no encoder for the source.
+  std::filesystem::path lowres_file;
+  TranscodeStats lowres;
+  OcrStats ocr;
+  IoStats io;  // reading the video, including any prefetch before run()
+  ArenaStats memory;  // the task arena's peak footprint
+  std::vector<StageSnapshot> stages;
+  // Spans of the run, still open for the caller to add its own (publishing)
+  // before dumping; null with tracing off.
+  std::shared_ptr<TraceBuffer> trace;
+};
+
+// The two cameras of a front/rear pair processed together (run_pair). They
+// share one trace, stage report and arena; each has its own detections,
+// plates, crops and low-res video.
+struct PairedResult {
+  HeavyResult front;
+  HeavyResult rear;
+};
+
+// Runs the workhorse.md §3 steps for one video as a streaming pipeline:
+// decode feeds the stages in §3 order, all running concurrently, so the GPU
+// and CPU stages overlap instead of taking turns. Ahead of them, the de-res
+// branch encodes every decoded frame into the low-res archive video.
+//
+// The detector and OCR engine are shared: loaded once per GPU and reused
+// across tasks. A null detector skips §3.2 onwards (decode-only runs); a null
+// OCR engine still tracks plates but skips §3.4.
+//
+// With config.checkpoint.dir set, the detections of kept frames are
+// checkpointed per segment of the video. A run over a video that was
+// interrupted earlier (same video, models and parameters) decodes and
+// filters it again but takes §3.2 results for the covered frames from the
+// checkpoint; tracking and OCR are replayed over them, so the result is the
+// same as an uninterrupted run.
+class HeavyProcessor {
+ public:
+  HeavyProcessor(HeavyProcessConfig config, std::shared_ptr<Detector> detector,
+                 std::shared_ptr<OcrEngine> ocr = nullptr);
+
+  // Processes the whole video, or only the frames of `shard`. Frame numbers
+  // in the result are always those of the whole video.
+  HeavyResult run(const std::filesystem::path& video,
+                  const std::optional<ShardSpec>& shard = std::nullopt);
+
+  // Processes the front and rear videos of one recording together: both are
+  // decoded in lockstep by presentation time and share the pipeline, so the
+  // detector's batches mix their frames; one GPS log (the front's, else the
+  // rear's) is loaded and aligned for both in a single pass; and a plate
+  // track passing from one camera to the other is fused into one vote
+  // (TrackFusion), so the vehicle is read once. The two decoders split
+  // decoder.surface_count between them. Pairs are never sharded.
+  PairedResult run_pair(const std::filesystem::path& front, const std::filesystem::path& rear);
+
+  // Starts opening the video of a later run() in the background: its moov
+  // index is loaded and the first read-ahead window filled while the current
+  // video is still being processed, so the next decode starts warm. Only the
+  // latest call is kept.
+  void prefetch(const std::filesystem::path& video,
+                const std::optional<ShardSpec>& shard = std::nullopt);
+
+  // Drops the checkpoint of a run; call once its task is complete.
+  void discard_checkpoint(const std::filesystem::path& video,
+                          const std::optional<ShardSpec>& shard = std::nullopt);
+
+ private:
+  struct Prefetch {
+    std::filesystem::path video;
+    std::future<std::shared_ptr<PrefetchReader>> source;
+  };
+
+  struct Stream;
+
+  void add_stages(Pipeline<FrameJob>& pipeline, std::vector<std::unique_ptr<Stream>>& streams);
+  std::shared_ptr<PrefetchReader> open_source(const std::filesystem::path& video);
+  // One result per video, in order; the arena is reset after.
+  std::vector<HeavyResult> run_streams(std::span<const std::filesystem::path> videos,
+                                       const std::optional<ShardSpec>& shard);
+  std::vector<HeavyResult> run_pass(std::span<const std::filesystem::path> videos,
+                                    const std::optional<ShardSpec>& shard);
+  void log_result(const std::filesystem::path& video, const HeavyResult& result) const;
+
+  HeavyProcessConfig config_;
+  std::shared_ptr<Detector> detector_;
+  std::shared_ptr<OcrEngine> ocr_;
+  // One per camera of a run (JpegEncoder is not thread-safe); empty or a
+  // null first one when crops are not archived.
+  std::vector<std::unique_ptr<JpegEncoder>> jpeg_;
+  std::optional<CheckpointStore> checkpoints_;
+  std::optional<Prefetch> prefetch_;
+  // Per-frame lists and crops of the current run; reset after each.
+  TaskArena arena_;
+};
+
+}  // namespace dashcam::worker
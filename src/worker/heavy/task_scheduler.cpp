@@ -0,0 +1,264 @@
+#include "worker/heavy/task_scheduler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <new>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#include "worker/gpu/device_info.hpp"
+#include "worker/gpu/gpu.hpp"
+
+namespace dashcam::worker {
+
+namespace {
+
+// A 4K dashcam writes roughly 60 Mbit/s at 30 fps.
+constexpr double kDefaultBytesPerFrame = 256.0 * 1024;
+
+// NV12: full-size luma plus half-size interleaved chroma.
+std::size_t surface_bytes(int width, int height) {
+  return static_cast<std::size_t>(width) * static_cast<std::size_t>(height) * 3 / 2;
+}
+
+// Seconds per frame of the run's bottleneck: the stage with the most busy
+// time per thread bounds how fast frames get through.
+std::optional<double> bottleneck_cost(const HeavyResult& result) {
+  if (result.frames_decoded <= 0) {
+    return std::nullopt;
+  }
+  double busiest = 0.0;
+  for (const StageSnapshot& stage : result.stages) {
+    if (stage.threads > 0) {
+      busiest = std::max(busiest, stage.busy_s / static_cast<double>(stage.threads));
+    }
+  }
+  if (busiest <= 0.0) {
+    return std::nullopt;
+  }
+  return busiest / static_cast<double>(result.frames_decoded);
+}
+
+}  // namespace
+
+TaskScheduler::TaskScheduler(SchedulerConfig config, const HeavyProcessConfig& base,
+                             std::optional<DetectorConfig> detector, OcrFactory ocr)
+    : config_(std::move(config)), bytes_per_frame_(kDefaultBytesPerFrame) {
+  if (config_.tasks_per_device == 0) {
+    throw std::invalid_argument("the scheduler needs at least one task per device");
+  }
+  std::vector<int> indices = config_.devices;
+  if (indices.empty()) {
+    for (int i = 0, n = device_count(); i < n; ++i) {
+      indices.push_back(i);
+    }
+  }
+  if (indices.empty()) {
+    throw std::runtime_error("no GPU to run tasks on");
+  }
+
+  std::size_t frame_surface = surface_bytes(config_.frame_width, config_.frame_height);
+  for (int index : indices) {
+    auto device = std::make_unique<Device>();
+    GpuDeviceInfo info = query_device(index);
+    DeviceLoad& load = device->load;
+    load.device = index;
+    load.name = info.name;
+    load.slots = config_.tasks_per_device;
+
+    if (detector) {
+      DetectorConfig dc = *detector;
+      dc.gpu_device = index;
+      device->detector = std::make_shared<Detector>(std::move(dc));
+    }
+    if (ocr) {
+      device->ocr = ocr(index);
+    }
+
+    // The budget is measured after the models are in, so it covers exactly
+    // what the tasks can still use.
+    std::size_t surfaces = base.decoder.surface_count;
+    if (info.total_memory > 0) {
+      load.vram_budget = static_cast<std::size_t>(
+          static_cast<double>(free_device_memory(index)) * config_.vram_fraction);
+      std::size_t cap = config_.task_vram_cap > 0 ? config_.task_vram_cap
+                                                  : load.vram_budget / config_.tasks_per_device;
+      std::size_t room = cap > config_.task_vram_overhead ? cap - config_.task_vram_overhead : 0;
+      surfaces = std::clamp(room / frame_surface, std::min(config_.min_surfaces, surfaces),
+                            surfaces);
+      load.task_vram = surfaces * frame_surface + config_.task_vram_overhead;
+    }
+    load.surfaces = surfaces;
+
+    HeavyProcessConfig seat = base;
+    seat.decoder.gpu_device = index;
+    seat.decoder.surface_count = surfaces;
+    for (std::size_t s = 0; s < config_.tasks_per_device; ++s) {
+      device->processors.push_back(
+          std::make_unique<HeavyProcessor>(seat, device->detector, device->ocr));
+      device->busy.push_back(false);
+    }
+    if (load.vram_budget > 0) {
+      std::fprintf(stderr, "gpu %d (%s): %zu tasks, %zu surfaces each, %.0f of %.0f MiB budgeted\n",
+                   index, load.name.c_str(), load.slots, surfaces,
+                   static_cast<double>(load.task_vram * load.slots) / (1 << 20),
+                   static_cast<double>(load.vram_budget) / (1 << 20));
+    }
+    devices_.push_back(std::move(device));
+  }
+}
+
+std::size_t TaskScheduler::capacity() const {
+  std::size_t seats = 0;
+  for (const auto& device : devices_) {
+    seats += device->load.slots;
+  }
+  return seats;
+}
+
+double TaskScheduler::estimate_frames(const std::filesystem::path& video,
+                                      const std::optional<ShardSpec>& shard) const {
+  std::int64_t first = shard ? shard->first_frame : 0;
+  if (shard && shard->end_frame >= 0) {
+    return static_cast<double>(std::max<std::int64_t>(1, shard->end_frame - first));
+  }
+  std::error_code ec;
+  auto size = std::filesystem::file_size(video, ec);
+  double per_frame;
+  {
+    std::lock_guard lock(mutex_);
+    per_frame = bytes_per_frame_;
+  }
+  double frames = ec ? 1.0 : static_cast<double>(size) / per_frame;
+  return std::max(1.0, frames - static_cast<double>(first));
+}
+
+bool TaskScheduler::admits(const Device& device) const {
+  const DeviceLoad& load = device.load;
+  if (load.running >= load.slots) {
+    return false;
+  }
+  // An idle device always takes a task, even one reserving more than the
+  // whole budget after repeated OOMs: it then runs alone.
+  return load.vram_budget == 0 || load.running == 0 ||
+         load.vram_reserved + load.task_vram <= load.vram_budget;
+}
+
+double TaskScheduler::finish_estimate(const Device& device, double frames) const {
+  double cost = device.load.seconds_per_frame;
+  if (cost <= 0.0) {
+    // Unmeasured: assume the average of the measured devices, so a new one
+    // is neither shunned nor flooded.
+    double sum = 0.0;
+    int measured = 0;
+    for (const auto& other : devices_) {
+      if (other->load.seconds_per_frame > 0.0) {
+        sum += other->load.seconds_per_frame;
+        ++measured;
+      }
+    }
+    cost = measured > 0 ? sum / measured : 1.0;
+  }
+  // Tasks sharing a device run side by side, each at the per-task cost it
+  // was measured with.
+  return (device.load.pending_frames + frames) * cost / static_cast<double>(device.load.slots);
+}
+
+std::optional<TaskPlacement> TaskScheduler::acquire(double frames, const std::atomic<bool>& stop) {
+  std::unique_lock lock(mutex_);
+  while (!stop) {
+    Device* best = nullptr;
+    double best_finish = 0.0;
+    for (const auto& device : devices_) {
+      if (!admits(*device)) {
+        continue;
+      }
+      double finish = finish_estimate(*device, frames);
+      if (best == nullptr || finish < best_finish ||
+          (finish == best_finish && device->load.running < best->load.running)) {
+        best = device.get();
+        best_finish = finish;
+      }
+    }
+    if (best != nullptr) {
+      auto seat = std::find(best->busy.begin(), best->busy.end(), false);
+      std::size_t slot = static_cast<std::size_t>(seat - best->busy.begin());
+      *seat = true;
+      ++best->load.running;
+      best->load.vram_reserved += best->load.task_vram;
+      best->load.pending_frames += frames;
+      return TaskPlacement{best->load.device, slot, best->processors[slot].get(), frames,
+                           best->load.task_vram};
+    }
+    // Woken by a release; the timeout only bounds how late a stop is seen.
+    released_.wait_for(lock, std::chrono::milliseconds(200));
+  }
+  return std::nullopt;
+}
+
+void TaskScheduler::release(const TaskPlacement& placement, const TaskOutcome& outcome) {
+  {
+    std::lock_guard lock(mutex_);
+    auto it = std::find_if(devices_.begin(), devices_.end(), [&](const auto& device) {
+      return device->load.device == placement.device;
+    });
+    if (it == devices_.end() || placement.slot >= (*it)->busy.size()) {
+      return;
+    }
+    Device& device = **it;
+    DeviceLoad& load = device.load;
+    device.busy[placement.slot] = false;
+    --load.running;
+    load.vram_reserved -= placement.vram;
+    load.pending_frames = std::max(0.0, load.pending_frames - placement.frames);
+
+    double alpha = config_.cost_smoothing;
+    if (outcome.result != nullptr) {
+      ++load.tasks_run;
+      if (auto cost = bottleneck_cost(*outcome.result)) {
+        load.seconds_per_frame = load.seconds_per_frame > 0.0
+                                     ? alpha * *cost + (1 - alpha) * load.seconds_per_frame
+                                     : *cost;
+      }
+      const HeavyResult& result = *outcome.result;
+      if (result.frames_decoded > 0 && result.io.bytes_read > 0) {
+        double per_frame =
+            static_cast<double>(result.io.bytes_read) / static_cast<double>(result.frames_decoded);
+        bytes_per_frame_ = alpha * per_frame + (1 - alpha) * bytes_per_frame_;
+      }
+    }
+    if (outcome.out_of_memory) {
+      ++load.out_of_memory;
+      if (load.vram_budget > 0) {
+        // The estimate was short; half as much again per task is one seat
+        // fewer at two tasks per device.
+        load.task_vram += load.task_vram / 2;
+        std::fprintf(stderr, "gpu %d: out of memory, now reserving %.0f MiB per task\n",
+                     load.device, static_cast<double>(load.task_vram) / (1 << 20));
+      }
+    }
+  }
+  released_.notify_all();
+}
+
+std::vector<DeviceLoad> TaskScheduler::loads() const {
+  std::lock_guard lock(mutex_);
+  std::vector<DeviceLoad> out;
+  for (const auto& device : devices_) {
+    out.push_back(device->load);
+  }
+  return out;
+}
+
+bool is_out_of_memory(const std::exception& error) {
+  if (dynamic_cast<const std::bad_alloc*>(&error) != nullptr) {
+    return true;
+  }
+  return dynamic_cast<const GpuError*>(&error) != nullptr &&
+         std::string_view(error.what()).find("out of memory") != std::string_view::npos;
+}
+
+}  // namespace dashcam::worker
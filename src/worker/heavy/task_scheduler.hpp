@@ -0,0 +1,143 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "common/task.hpp"
+#include "worker/heavy/heavy_processor.hpp"
+#include "worker/inference/detector.hpp"
+#include "worker/ocr/ocr_engine.hpp"
+
+namespace dashcam::worker {
+
+struct SchedulerConfig {
+  // CUDA devices to run on; empty uses every visible one.
+  std::vector<int> devices;
+  // Tasks in flight per device. Two let one task's decode and CPU stages
+  // overlap another's detection on the same GPU.
+  std::size_t tasks_per_device = 2;
+  // Share of the memory still free once a device's models are loaded that
+  // its tasks may reserve; the rest is headroom for the driver and NVENC.
+  double vram_fraction = 0.85;
+  // Most VRAM one task may reserve; 0 splits the budget evenly between
+  // tasks_per_device. A task over it gets fewer decode surfaces, down to
+  // min_surfaces.
+  std::size_t task_vram_cap = 0;
+  std::size_t min_surfaces = 4;
+  // Decode surfaces are sized for this frame before any video is opened.
+  int frame_width = 3840;
+  int frame_height = 2160;
+  // A task's VRAM besides its surfaces: encoder, staging and crop buffers.
+  std::size_t task_vram_overhead = std::size_t{256} << 20;
+  // Weight of the newest run in each device's cost per frame.
+  double cost_smoothing = 0.3;
+};
+
+// One device and what runs on it, for logs.
+struct DeviceLoad {
+  int device = 0;
+  std::string name;
+  std::size_t running = 0;
+  std::size_t slots = 0;
+  std::size_t surfaces = 0;       // decode surfaces per task
+  std::size_t task_vram = 0;      // reserved per task
+  std::size_t vram_budget = 0;    // 0 without a GPU: no VRAM accounting
+  std::size_t vram_reserved = 0;
+  double pending_frames = 0.0;    // estimated, of the tasks running
+  double seconds_per_frame = 0.0; // measured; 0 until a task has run here
+  std::uint64_t tasks_run = 0;
+  std::uint64_t out_of_memory = 0;
+};
+
+// A task's seat: the device it runs on and the processor to run it with.
+struct TaskPlacement {
+  int device = 0;
+  std::size_t slot = 0;
+  HeavyProcessor* processor = nullptr;
+  double frames = 0.0;    // the estimate it was placed with
+  std::size_t vram = 0;   // reserved for it
+};
+
+// How a placed task ended. A run that left no result (it threw) only frees
+// its seat; one that ran out of device memory also makes the device reserve
+// more per task from then on, so fewer share it.
+struct TaskOutcome {
+  const HeavyResult* result = nullptr;
+  bool out_of_memory = false;
+};
+
+// Runs several heavy-processing tasks at once on one worker (workhorse.md
+// §7): each GPU gets its own detector (and OCR engine), loaded once and
+// shared by tasks_per_device processors pinned to that GPU.
+//
+// A task goes to the device expected to finish it first: the frames
+// already placed there plus its own, at the device's measured cost per
+// frame (the busiest pipeline stage of its recent runs, per thread), spread
+// over its seats. A device only takes a task while its reserved VRAM stays
+// within budget, so concurrent tasks cannot together run it out of memory;
+// one that still does fails alone and is handed back to the server, and
+// the device reserves more per task from then on.
+//
+// CPU-only builds schedule tasks_per_device tasks on a single host device
+// with no VRAM accounting. Thread-safe.
+class TaskScheduler {
+ public:
+  using OcrFactory = std::function<std::shared_ptr<OcrEngine>(int device)>;
+
+  // `base` is copied per seat with the device and surface count set. With
+  // no detector config the processors are decode-only.
+  TaskScheduler(SchedulerConfig config, const HeavyProcessConfig& base,
+                std::optional<DetectorConfig> detector, OcrFactory ocr = nullptr);
+
+  TaskScheduler(const TaskScheduler&) = delete;
+  TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+  // Seats over all devices.
+  std::size_t capacity() const;
+
+  // Work in a task, in frames: exact for a bounded shard, else guessed from
+  // the file size at the bytes per frame of the videos run so far.
+  double estimate_frames(const std::filesystem::path& video,
+                         const std::optional<ShardSpec>& shard) const;
+
+  // Waits for a seat that can take a task of `frames` frames and takes the
+  // best one; std::nullopt once `stop` is set.
+  std::optional<TaskPlacement> acquire(double frames, const std::atomic<bool>& stop);
+  void release(const TaskPlacement& placement, const TaskOutcome& outcome);
+
+  std::vector<DeviceLoad> loads() const;
+
+ private:
+  struct Device {
+    DeviceLoad load;
+    std::shared_ptr<Detector> detector;
+    std::shared_ptr<OcrEngine> ocr;
+    std::vector<std::unique_ptr<HeavyProcessor>> processors;
+    std::vector<bool> busy;
+  };
+
+  bool admits(const Device& device) const;
+  double finish_estimate(const Device& device, double frames) const;
+
+  SchedulerConfig config_;
+  std::vector<std::unique_ptr<Device>> devices_;
+  mutable std::mutex mutex_;
+  std::condition_variable released_;
+  double bytes_per_frame_;
+};
+
+// Whether a task failed on device memory: a failed allocation or a CUDA
+// out-of-memory error.
+bool is_out_of_memory(const std::exception& error);
+
+}  // namespace dashcam::worker
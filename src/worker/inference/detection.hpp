@@ -0,0 +1,40 @@
+#pragma once
+
+#include <algorithm>
+
+namespace dashcam::worker {
+
+// Axis-aligned box in full-resolution frame pixels.
+struct Box {
+  float x0 = 0.0f;
+  float y0 = 0.0f;
+  float x1 = 0.0f;
+  float y1 = 0.0f;
+
+  float width() const { return x1 - x0; }
+  float height() const { return y1 - y0; }
+  float area() const { return std::max(0.0f, width()) * std::max(0.0f, height()); }
+};
+
+inline float iou(const Box& a, const Box& b) {
+  float w = std::min(a.x1, b.x1) - std::max(a.x0, b.x0);
+  float h = std::min(a.y1, b.y1) - std::max(a.y0, b.y0);
+  if (w <= 0.0f || h <= 0.0f) {
+    return 0.0f;
+  }
+  float inter = w * h;
+  return inter / (a.area() + b.area() - inter);
+}
+
+// workhorse.md §3.2 output categories.
+enum class ObjectClass { Vehicle, Plate, Pedestrian };
+
+struct Detection {
+  Box box;
+  float score = 0.0f;
+  ObjectClass cls = ObjectClass::Vehicle;
+  int model_class = 0;  // raw class index of the model that produced it
+  int track_id = -1;    // plates only, assigned by PlateTracker
+};
+
+}  // namespace dashcam::worker
@@ -0,0 +1,249 @@
+#include "worker/inference/detector.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+#include "common/metrics.hpp"
+#include "common/trace.hpp"
+#include "worker/gpu/device_info.hpp"
+
+namespace dashcam::worker {
+
+struct Detector::Lane {
+  OwnedStream stream;
+  std::unique_ptr<InferenceContext> vehicle;
+  std::unique_ptr<InferenceContext> plate;
+  GpuBuffer input;   // [batch, 3, S, S] float, device; sized for the larger model
+  GpuBuffer output;  // [batch, C, A] float, mapped host: TensorRT writes it in place
+  // Per-batch working lists, cleared rather than freed between batches.
+  std::vector<Image> images;
+  std::vector<std::vector<Detection>> vehicles;
+  std::vector<std::vector<Detection>> plates;
+};
+
+namespace {
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::size_t input_bytes(const InferenceEngine& engine) {
+  auto s = static_cast<std::size_t>(engine.input_size());
+  return static_cast<std::size_t>(engine.max_batch()) * 3 * s * s * sizeof(float);
+}
+
+std::size_t output_bytes(const InferenceEngine& engine) {
+  OutputShape shape = engine.output_shape();
+  return static_cast<std::size_t>(engine.max_batch()) * static_cast<std::size_t>(shape.channels) *
+         static_cast<std::size_t>(shape.anchors) * sizeof(float);
+}
+
+}  // namespace
+
+bool classify_coco(int coco_class, ObjectClass& out) {
+  switch (coco_class) {
+    case 0:  // person
+      out = ObjectClass::Pedestrian;
+      return true;
+    case 2:  // car
+    case 3:  // motorcycle
+    case 5:  // bus
+    case 7:  // truck
+      out = ObjectClass::Vehicle;
+      return true;
+    default:
+      return false;
+  }
+}
+
+Detector::Detector(DetectorConfig config)
+    : config_(std::move(config)), cache_(config_.engine_cache_dir) {
+  if (config_.lanes <= 0 || config_.max_batch <= 0 || config_.plate_max_batch <= 0) {
+    throw std::invalid_argument("detector needs at least one lane and positive batch sizes");
+  }
+  // Lane streams and buffers are created on the detector's GPU.
+  use_device(config_.gpu_device);
+  EngineSpec spec;
+  spec.precision = config_.precision;
+  spec.gpu_device = config_.gpu_device;
+
+  spec.model = config_.vehicle_model;
+  spec.input_size = config_.input_size;
+  spec.max_batch = config_.max_batch;
+  vehicle_engine_ = load_engine(spec, cache_);
+
+  spec.model = config_.plate_model;
+  spec.input_size = config_.plate_tiles.tile_size;
+  spec.max_batch = config_.plate_max_batch;
+  plate_engine_ = load_engine(spec, cache_);
+
+  std::size_t in_bytes = std::max(input_bytes(*vehicle_engine_), input_bytes(*plate_engine_));
+  std::size_t out_bytes = std::max(output_bytes(*vehicle_engine_), output_bytes(*plate_engine_));
+  for (int i = 0; i < config_.lanes; ++i) {
+    auto lane = std::make_unique<Lane>();
+    lane->vehicle = vehicle_engine_->create_context();
+    lane->plate = plate_engine_->create_context();
+    lane->input = GpuBuffer(in_bytes, MemoryKind::Device);
+    lane->output = GpuBuffer(out_bytes, MemoryKind::MappedHost);
+    idle_.push_back(lane.get());
+    lanes_.push_back(std::move(lane));
+  }
+}
+
+Detector::~Detector() = default;
+
+DetectorStats Detector::stats() const {
+  DetectorStats s;
+  s.frames = frames_.load(std::memory_order_relaxed);
+  s.plate_tiles = plate_tiles_.load(std::memory_order_relaxed);
+  s.grid_tiles = grid_tiles_.load(std::memory_order_relaxed);
+  return s;
+}
+
+Detector::Lane& Detector::acquire_lane() {
+  std::unique_lock lock(lanes_mutex_);
+  lane_free_.wait(lock, [&] { return !idle_.empty(); });
+  Lane* lane = idle_.back();
+  idle_.pop_back();
+  return *lane;
+}
+
+void Detector::release_lane(Lane& lane) {
+  {
+    std::lock_guard lock(lanes_mutex_);
+    idle_.push_back(&lane);
+  }
+  lane_free_.notify_one();
+}
+
+std::vector<Roi> Detector::plate_tiles(const DetectRequest& request,
+                                       const std::vector<Detection>& vehicles) const {
+  const FrameGeometry& g = request.frame->geometry();
+  if (config_.plate_search == PlateSearchMode::FullFrame) {
+    return plan_grid_tiles(g.width, g.height, config_.plate_tiles);
+  }
+  std::vector<Box> regions(request.proposals.begin(), request.proposals.end());
+  for (const Detection& d : vehicles) {
+    if (d.cls == ObjectClass::Vehicle) {
+      regions.push_back(d.box);
+    }
+  }
+  return plan_proposal_tiles(g.width, g.height, regions, config_.plate_tiles);
+}
+
+void Detector::run_images(Lane& lane, InferenceContext& context, const InferenceEngine& engine,
+                          std::span<const Image> images, const DecodeOptions& decode,
+                          std::vector<std::vector<Detection>>& out) {
+  auto size = static_cast<std::size_t>(engine.input_size());
+  std::size_t image_floats = 3 * size * size;
+  OutputShape shape = engine.output_shape();
+  auto per_image = static_cast<std::size_t>(shape.channels) * static_cast<std::size_t>(shape.anchors);
+  auto* input = reinterpret_cast<float*>(lane.input.device_ptr());
+  auto* output = reinterpret_cast<float*>(lane.output.device_ptr());
+  const auto* host = reinterpret_cast<const float*>(lane.output.host_ptr());
+  auto chunk = static_cast<std::size_t>(engine.max_batch());
+
+  for (std::size_t begin = 0; begin < images.size(); begin += chunk) {
+    std::size_t count = std::min(chunk, images.size() - begin);
+    for (std::size_t i = 0; i < count; ++i) {
+      const Image& image = images[begin + i];
+      letterbox_nv12(image.frame->luma(), image.frame->chroma(), image.box,
+                     input + i * image_floats, lane.stream.get());
+    }
+    context.enqueue(input, output, static_cast<int>(count), lane.stream.get());
+    lane.stream.synchronize();
+    for (std::size_t i = 0; i < count; ++i) {
+      const Image& image = images[begin + i];
+      decode_yolo(host + i * per_image, shape, image.box, decode, out[image.owner]);
+    }
+  }
+}
+
+void Detector::detect(std::span<const DetectRequest> requests) {
+  if (requests.size() > static_cast<std::size_t>(config_.max_batch)) {
+    throw std::invalid_argument("batch larger than detector max_batch");
+  }
+  std::size_t n = requests.size();
+  if (n == 0) {
+    return;
+  }
+
+  static Histogram& vehicle_seconds = default_metrics().histogram(
+      "dashcam_worker_model_seconds", "Time per detector model pass over a batch (§3.2).",
+      {{"model", "vehicle"}});
+  static Histogram& plate_seconds = default_metrics().histogram(
+      "dashcam_worker_model_seconds", "Time per detector model pass over a batch (§3.2).",
+      {{"model", "plate"}});
+
+  Lane& lane = [this]() -> Lane& {
+    ScopedTrace span("lane_wait", "detect");
+    return acquire_lane();
+  }();
+  std::vector<Image>& images = lane.images;
+  std::vector<std::vector<Detection>>& vehicles = lane.vehicles;
+  std::vector<std::vector<Detection>>& plates = lane.plates;
+  images.clear();
+  if (vehicles.size() < n) {
+    vehicles.resize(n);
+    plates.resize(n);
+  }
+  for (std::size_t i = 0; i < n; ++i) {
+    vehicles[i].clear();
+    plates[i].clear();
+  }
+  try {
+    for (std::size_t i = 0; i < n; ++i) {
+      const FrameGeometry& g = requests[i].frame->geometry();
+      images.push_back({requests[i].frame, make_letterbox({0, 0, g.width, g.height},
+                                                          vehicle_engine_->input_size()), i});
+    }
+    {
+      ScopedTrace span("vehicle_model", "detect", static_cast<std::int64_t>(images.size()));
+      auto start = std::chrono::steady_clock::now();
+      run_images(lane, *lane.vehicle, *vehicle_engine_, images, config_.vehicle_decode, vehicles);
+      vehicle_seconds.observe(seconds_since(start));
+    }
+    for (auto& frame_vehicles : vehicles) {
+      non_max_suppression(frame_vehicles, config_.vehicle_decode.nms_iou);
+      std::erase_if(frame_vehicles, [](Detection& d) { return !classify_coco(d.model_class, d.cls); });
+    }
+
+    // Every tile of every frame in the batch goes into one packed tensor.
+    images.clear();
+    std::uint64_t grid = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+      const FrameGeometry& g = requests[i].frame->geometry();
+      grid += count_grid_tiles(g.width, g.height, config_.plate_tiles);
+      for (const Roi& tile : plate_tiles(requests[i], vehicles[i])) {
+        images.push_back({requests[i].frame, make_letterbox(tile, plate_engine_->input_size()), i});
+      }
+    }
+    {
+      ScopedTrace span("plate_model", "detect", static_cast<std::int64_t>(images.size()));
+      auto start = std::chrono::steady_clock::now();
+      run_images(lane, *lane.plate, *plate_engine_, images, config_.plate_decode, plates);
+      plate_seconds.observe(seconds_since(start));
+    }
+    frames_.fetch_add(n, std::memory_order_relaxed);
+    plate_tiles_.fetch_add(images.size(), std::memory_order_relaxed);
+    grid_tiles_.fetch_add(grid, std::memory_order_relaxed);
+
+    for (std::size_t i = 0; i < n; ++i) {
+      // Overlapping tiles see the same plate twice; NMS across tiles merges them.
+      non_max_suppression(plates[i], config_.plate_decode.nms_iou);
+      for (Detection& d : plates[i]) {
+        d.cls = ObjectClass::Plate;
+      }
+      std::pmr::vector<Detection>& out = *requests[i].out;
+      out.assign(vehicles[i].begin(), vehicles[i].end());
+      out.insert(out.end(), plates[i].begin(), plates[i].end());
+    }
+  } catch (...) {
+    release_lane(lane);
+    throw;
+  }
+  release_lane(lane);
+}
+
+}  // namespace dashcam::worker
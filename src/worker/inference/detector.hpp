@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <span>
+#include <vector>
+
+#include "worker/decode/frame_surface.hpp"
+#include "worker/gpu/gpu_buffer.hpp"
+#include "worker/gpu/gpu_stream.hpp"
+#include "worker/inference/detection.hpp"
+#include "worker/inference/engine_cache.hpp"
+#include "worker/inference/inference_engine.hpp"
+#include "worker/inference/letterbox.hpp"
+#include "worker/inference/tile_planner.hpp"
+#include "worker/inference/yolo_decode.hpp"
+
+namespace dashcam::worker {
+
+struct DetectorConfig {
+  std::filesystem::path vehicle_model = "models/yolov8n.pt";
+  std::filesystem::path plate_model = "models/plate.pt";
+  // Local SSD; engines here survive reboots (see EngineCache).
+  std::filesystem::path engine_cache_dir = "cache/engines";
+  Precision precision = Precision::FP16;
+  // Vehicle model: whole frame letterboxed to this size.
+  int input_size = 640;
+  // Frames per enqueue. Bursts are batched up to this size; a partial batch is
+  // flushed once its oldest frame has waited max_latency.
+  int max_batch = 16;
+  std::chrono::microseconds max_latency{8000};
+  // Plate model: native-resolution tiles (see tile_planner.hpp). Tiles of a
+  // whole frame batch are packed together, up to plate_max_batch per enqueue.
+  PlateSearchMode plate_search = PlateSearchMode::Proposals;
+  TilePlanOptions plate_tiles;
+  int plate_max_batch = 64;
+  // Batches that may be in flight on the GPU at once, each with its own
+  // stream, execution contexts and buffers.
+  int lanes = 2;
+  DecodeOptions vehicle_decode;
+  DecodeOptions plate_decode;
+  int gpu_device = 0;
+};
+
+// One frame to detect on, with the §3.1 coarse proposals that guide the
+// plate search in Proposals mode. Its detections replace the contents of
+// `out`, which keeps its own allocator (the task arena in a pipeline).
+struct DetectRequest {
+  const FrameSurface* frame = nullptr;
+  std::span<const Box> proposals;
+  std::pmr::vector<Detection>* out = nullptr;
+};
+
+// Cumulative plate-model workload. grid_tiles is what FullFrame mode would
+// have run for the same frames, so plate_tiles / grid_tiles is the fraction of
+// plate-model FLOPs actually spent.
+struct DetectorStats {
+  std::uint64_t frames = 0;
+  std::uint64_t plate_tiles = 0;
+  std::uint64_t grid_tiles = 0;
+};
+
+// Full-resolution detection (workhorse.md §3.2) with the vehicle and plate
+// models, each loaded once and then shared by every batch. Frames are read
+// straight from their GPU surfaces; only the small detection heads come back
+// to the host. Thread-safe: concurrent callers get separate lanes.
+class Detector {
+ public:
+  explicit Detector(DetectorConfig config);
+  ~Detector();
+
+  const DetectorConfig& config() const { return config_; }
+  DetectorStats stats() const;
+
+  // Fills each request's `out`. requests.size() <= max_batch. Working lists
+  // belong to the lane and are reused, so a batch allocates little beyond
+  // its tile plans.
+  void detect(std::span<const DetectRequest> requests);
+
+ private:
+  struct Lane;
+
+  // One model input: an ROI of a frame, letterboxed.
+  struct Image {
+    const FrameSurface* frame = nullptr;
+    Letterbox box;
+    std::size_t owner = 0;  // index of the request it belongs to
+  };
+
+  Lane& acquire_lane();
+  void release_lane(Lane& lane);
+  std::vector<Roi> plate_tiles(const DetectRequest& request,
+                               const std::vector<Detection>& vehicles) const;
+  void run_images(Lane& lane, InferenceContext& context, const InferenceEngine& engine,
+                  std::span<const Image> images, const DecodeOptions& decode,
+                  std::vector<std::vector<Detection>>& out);
+
+  DetectorConfig config_;
+  EngineCache cache_;
+  std::shared_ptr<InferenceEngine> vehicle_engine_;
+  std::shared_ptr<InferenceEngine> plate_engine_;
+
+  std::mutex lanes_mutex_;
+  std::condition_variable lane_free_;
+  std::vector<std::unique_ptr<Lane>> lanes_;
+  std::vector<Lane*> idle_;
+
+  std::atomic<std::uint64_t> frames_{0};
+  std::atomic<std::uint64_t> plate_tiles_{0};
+  std::atomic<std::uint64_t> grid_tiles_{0};
+};
+
+// COCO classes from yolov8n we keep, mapped to our categories.
+bool classify_coco(int coco_class, ObjectClass& out);
+
+}  // namespace dashcam::worker
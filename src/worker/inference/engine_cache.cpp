@@ -0,0 +1,78 @@
+#include "worker/inference/engine_cache.hpp"
+
+#include <cctype>
+#include <cstring>
+#include <cstdint>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+
+#include "common/hash.hpp"
+
+namespace dashcam::worker {
+
+namespace {
+
+// File layout: magic, XXH64 of the payload, payload.
+constexpr char kMagic[8] = {'D', 'C', 'E', 'N', 'G', '0', '0', '1'};
+
+std::string sanitize(const std::string& text) {
+  std::string out;
+  for (char c : text) {
+    auto u = static_cast<unsigned char>(c);
+    out += std::isalnum(u) || c == '.' ? c : '_';
+  }
+  return out;
+}
+
+}  // namespace
+
+std::string EngineKey::file_name() const {
+  return sanitize(model_name) + "-" + to_hex(model_hash) + "-" + sanitize(gpu) + "-" +
+         sanitize(runtime) + "-" + precision + "-b" + std::to_string(max_batch) + "-s" +
+         std::to_string(input_size) + ".engine";
+}
+
+EngineCache::EngineCache(std::filesystem::path dir) : dir_(std::move(dir)) {
+  std::filesystem::create_directories(dir_);
+}
+
+std::optional<std::vector<char>> EngineCache::load(const EngineKey& key) const {
+  std::ifstream in(dir_ / key.file_name(), std::ios::binary);
+  if (!in) {
+    return std::nullopt;
+  }
+  char magic[sizeof(kMagic)];
+  std::uint64_t checksum = 0;
+  if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0 ||
+      !in.read(reinterpret_cast<char*>(&checksum), sizeof(checksum))) {
+    return std::nullopt;
+  }
+  std::vector<char> payload((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  if (xxh64(payload.data(), payload.size()) != checksum) {
+    return std::nullopt;
+  }
+  return payload;
+}
+
+void EngineCache::store(const EngineKey& key, const void* data, std::size_t size) const {
+  auto final_path = dir_ / key.file_name();
+  // A name of its own per call: two workers, or two GPUs of the same model,
+  // may build the same key at once. The last rename wins; both are valid.
+  std::random_device random;
+  auto temp_path = final_path;
+  temp_path += "." + to_hex((std::uint64_t{random()} << 32) | random()) + ".tmp";
+  {
+    std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+    std::uint64_t checksum = xxh64(data, size);
+    out.write(kMagic, sizeof(kMagic));
+    out.write(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+    out.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+    if (!out) {
+      throw std::runtime_error("cannot write engine cache entry " + temp_path.string());
+    }
+  }
+  std::filesystem::rename(temp_path, final_path);
+}
+
+}  // namespace dashcam::worker
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace dashcam::worker {
+
+// Everything a compiled engine depends on. Any change produces a new file,
+// so stale engines are never loaded; old ones are simply left behind.
+struct EngineKey {
+  std::string model_name;     // file stem, for humans browsing the cache
+  std::uint64_t model_hash = 0;  // XXH64 of the network definition
+  std::string gpu;            // device name + compute capability
+  std::string runtime;        // inference runtime version
+  std::string precision;
+  int max_batch = 0;
+  int input_size = 0;
+
+  std::string file_name() const;
+};
+
+// Directory of serialized engines on the workhorse's local SSD. Unlike task
+// scratch, it survives reboots and interruptions: an engine depends only on
+// its key, never on task state.
+class EngineCache {
+ public:
+  explicit EngineCache(std::filesystem::path dir);
+
+  const std::filesystem::path& dir() const { return dir_; }
+
+  // The stored engine, or std::nullopt if missing or damaged.
+  std::optional<std::vector<char>> load(const EngineKey& key) const;
+
+  // Written to a temporary file and renamed into place, so a crash mid-write
+  // never leaves a truncated engine under the real name.
+  void store(const EngineKey& key, const void* data, std::size_t size) const;
+
+ private:
+  std::filesystem::path dir_;
+};
+
+}  // namespace dashcam::worker
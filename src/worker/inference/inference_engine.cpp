@@ -0,0 +1,33 @@
+#include "worker/inference/inference_engine.hpp"
+
+#include <stdexcept>
+
+#if DASHCAM_WITH_TENSORRT
+#include "worker/inference/tensorrt_engine.hpp"
+#endif
+
+namespace dashcam::worker {
+
+const char* to_string(Precision precision) {
+  switch (precision) {
+    case Precision::FP32:
+      return "fp32";
+    case Precision::FP16:
+      return "fp16";
+    case Precision::INT8:
+      return "int8";
+  }
+  return "unknown";
+}
+
+std::shared_ptr<InferenceEngine> load_engine(const EngineSpec& spec, EngineCache& cache) {
+#if DASHCAM_WITH_TENSORRT
+  return load_tensorrt_engine(spec, cache);
+#else
+  (void)cache;
+  throw std::runtime_error("cannot load " + spec.model.string() +
+                           ": built without DASHCAM_WITH_TENSORRT");
+#endif
+}
+
+}  // namespace dashcam::worker
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <string>
+
+#include "worker/gpu/gpu.hpp"
+
+namespace dashcam::worker {
+
+class EngineCache;
+
+enum class Precision { FP32, FP16, INT8 };
+
+const char* to_string(Precision precision);
+
+struct EngineSpec {
+  // The PyTorch checkpoint under models/. The engine is built from the ONNX
+  // export next to it (same stem, .onnx), produced with
+  //   yolo export model=<model>.pt format=onnx dynamic=True
+  std::filesystem::path model;
+  int input_size = 640;
+  int max_batch = 16;
+  Precision precision = Precision::FP16;
+  int gpu_device = 0;
+};
+
+// Per-image output of a YOLOv8 head: `channels` = 4 box terms + one score per
+// class, laid out channel-major over `anchors` candidate boxes.
+struct OutputShape {
+  int channels = 0;
+  int anchors = 0;
+};
+
+// One thread's handle for running a loaded engine. Not thread-safe; create
+// one per concurrent batch in flight.
+class InferenceContext {
+ public:
+  virtual ~InferenceContext() = default;
+
+  // `input`: kernel-side [batch, 3, S, S] float. `output`: kernel-side
+  // [batch, channels, anchors] float. Queued on `stream`.
+  virtual void enqueue(const float* input, float* output, int batch, GpuStream stream) = 0;
+};
+
+// A model compiled for this GPU, shared by every context that runs it.
+class InferenceEngine {
+ public:
+  virtual ~InferenceEngine() = default;
+
+  virtual int input_size() const = 0;
+  virtual int max_batch() const = 0;
+  virtual OutputShape output_shape() const = 0;
+  virtual std::unique_ptr<InferenceContext> create_context() = 0;
+};
+
+// Returns the engine for `spec`, from `cache` when a matching engine was
+// built before, otherwise building it (slow: minutes for INT8/FP16) and
+// storing it. Throws if the build has no inference backend.
+std::shared_ptr<InferenceEngine> load_engine(const EngineSpec& spec, EngineCache& cache);
+
+}  // namespace dashcam::worker
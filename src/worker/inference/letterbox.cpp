@@ -0,0 +1,33 @@
+#include "worker/inference/letterbox.hpp"
+
+#include <algorithm>
+
+#include "worker/inference/letterbox_common.hpp"
+
+namespace dashcam::worker {
+
+Letterbox make_letterbox(const Roi& roi, int size) {
+  Letterbox box;
+  box.roi = roi;
+  box.size = size;
+  box.scale = std::min(static_cast<float>(size) / static_cast<float>(roi.width),
+                       static_cast<float>(size) / static_cast<float>(roi.height));
+  box.pad_x = (static_cast<float>(size) - static_cast<float>(roi.width) * box.scale) * 0.5f;
+  box.pad_y = (static_cast<float>(size) - static_cast<float>(roi.height) * box.scale) * 0.5f;
+  return box;
+}
+
+#if !DASHCAM_WITH_CUDA
+void letterbox_nv12(const PlaneView& luma, const PlaneView& chroma, const Letterbox& box,
+                    float* dst, GpuStream /*stream*/) {
+  for (int oy = 0; oy < box.size; ++oy) {
+    for (int ox = 0; ox < box.size; ++ox) {
+      detail::letterbox_pixel(luma.data, luma.pitch, luma.width, luma.height, chroma.data,
+                              chroma.pitch, box.roi.x, box.roi.y, box.roi.width, box.roi.height,
+                              box.scale, box.pad_x, box.pad_y, box.size, ox, oy, dst);
+    }
+  }
+}
+#endif
+
+}  // namespace dashcam::worker
@@ -0,0 +1,32 @@
+#include "worker/inference/letterbox.hpp"
+#include "worker/inference/letterbox_common.hpp"
+
+namespace dashcam::worker {
+
+namespace {
+
+__global__ void letterbox_kernel(const std::uint8_t* luma, std::size_t luma_pitch, int frame_w,
+                                 int frame_h, const std::uint8_t* chroma,
+                                 std::size_t chroma_pitch, Letterbox box, float* dst) {
+  int ox = blockIdx.x * blockDim.x + threadIdx.x;
+  int oy = blockIdx.y * blockDim.y + threadIdx.y;
+  if (ox >= box.size || oy >= box.size) {
+    return;
+  }
+  detail::letterbox_pixel(luma, luma_pitch, frame_w, frame_h, chroma, chroma_pitch, box.roi.x,
+                          box.roi.y, box.roi.width, box.roi.height, box.scale, box.pad_x,
+                          box.pad_y, box.size, ox, oy, dst);
+}
+
+}  // namespace
+
+void letterbox_nv12(const PlaneView& luma, const PlaneView& chroma, const Letterbox& box,
+                    float* dst, GpuStream stream) {
+  dim3 block(32, 8);
+  dim3 grid((box.size + block.x - 1) / block.x, (box.size + block.y - 1) / block.y);
+  letterbox_kernel<<<grid, block, 0, stream>>>(luma.data, luma.pitch, luma.width, luma.height,
+                                                chroma.data, chroma.pitch, box, dst);
+  DASHCAM_CUDA_CHECK(cudaGetLastError());
+}
+
+}  // namespace dashcam::worker
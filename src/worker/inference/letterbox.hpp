@@ -0,0 +1,34 @@
+#pragma once
+
+#include "worker/decode/frame_surface.hpp"
+#include "worker/gpu/gpu.hpp"
+
+namespace dashcam::worker {
+
+// Source rectangle of a model input, in full-resolution frame pixels.
+struct Roi {
+  int x = 0;
+  int y = 0;
+  int width = 0;
+  int height = 0;
+};
+
+// Maps an ROI into a square model input: model = (frame - roi origin) * scale
+// + pad. Aspect ratio is preserved; the borders are filled with YOLO's grey.
+struct Letterbox {
+  Roi roi;
+  int size = 0;
+  float scale = 1.0f;
+  float pad_x = 0.0f;
+  float pad_y = 0.0f;
+};
+
+Letterbox make_letterbox(const Roi& roi, int size);
+
+// Converts the ROI of an NV12 surface to a planar RGB float image in [0, 1]
+// ([3, size, size] at `dst`), bilinear-resampled, BT.601 limited range.
+// `luma`/`chroma` are kernel-side views; queued on `stream`.
+void letterbox_nv12(const PlaneView& luma, const PlaneView& chroma, const Letterbox& box,
+                    float* dst, GpuStream stream);
+
+}  // namespace dashcam::worker
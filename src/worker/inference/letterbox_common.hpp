@@ -0,0 +1,77 @@
+#pragma once
+
+// Per-pixel math shared by letterbox.cpp and letterbox.cu so the CPU
+// reference and the kernel agree bit for bit.
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__CUDACC__)
+#define DASHCAM_HOST_DEVICE __host__ __device__
+#else
+#define DASHCAM_HOST_DEVICE
+#endif
+
+namespace dashcam::worker::detail {
+
+constexpr float kPadValue = 114.0f / 255.0f;
+
+DASHCAM_HOST_DEVICE inline float clampf(float v, float lo, float hi) {
+  return v < lo ? lo : (v > hi ? hi : v);
+}
+
+DASHCAM_HOST_DEVICE inline float sample_bilinear(const std::uint8_t* plane, std::size_t pitch,
+                                                 int stride, int offset, int width, int height,
+                                                 float x, float y) {
+  x = clampf(x, 0.0f, static_cast<float>(width - 1));
+  y = clampf(y, 0.0f, static_cast<float>(height - 1));
+  int x0 = static_cast<int>(x);
+  int y0 = static_cast<int>(y);
+  int x1 = x0 + 1 < width ? x0 + 1 : x0;
+  int y1 = y0 + 1 < height ? y0 + 1 : y0;
+  float fx = x - static_cast<float>(x0);
+  float fy = y - static_cast<float>(y0);
+  const std::uint8_t* r0 = plane + static_cast<std::size_t>(y0) * pitch;
+  const std::uint8_t* r1 = plane + static_cast<std::size_t>(y1) * pitch;
+  float a = r0[x0 * stride + offset] * (1.0f - fx) + r0[x1 * stride + offset] * fx;
+  float b = r1[x0 * stride + offset] * (1.0f - fx) + r1[x1 * stride + offset] * fx;
+  return a * (1.0f - fy) + b * fy;
+}
+
+// Writes the three channel values of output pixel (ox, oy).
+DASHCAM_HOST_DEVICE inline void letterbox_pixel(const std::uint8_t* luma, std::size_t luma_pitch,
+                                                int frame_w, int frame_h,
+                                                const std::uint8_t* chroma,
+                                                std::size_t chroma_pitch, int roi_x, int roi_y,
+                                                int roi_w, int roi_h, float scale, float pad_x,
+                                                float pad_y, int size, int ox, int oy,
+                                                float* dst) {
+  std::size_t plane = static_cast<std::size_t>(size) * static_cast<std::size_t>(size);
+  std::size_t at = static_cast<std::size_t>(oy) * static_cast<std::size_t>(size) +
+                   static_cast<std::size_t>(ox);
+  float lx = (static_cast<float>(ox) + 0.5f - pad_x) / scale - 0.5f;
+  float ly = (static_cast<float>(oy) + 0.5f - pad_y) / scale - 0.5f;
+  if (lx < -0.5f || ly < -0.5f || lx > static_cast<float>(roi_w) - 0.5f ||
+      ly > static_cast<float>(roi_h) - 0.5f) {
+    dst[at] = kPadValue;
+    dst[plane + at] = kPadValue;
+    dst[2 * plane + at] = kPadValue;
+    return;
+  }
+  float fx = lx + static_cast<float>(roi_x);
+  float fy = ly + static_cast<float>(roi_y);
+  float yv = sample_bilinear(luma, luma_pitch, 1, 0, frame_w, frame_h, fx, fy);
+  float cx = (fx + 0.5f) * 0.5f - 0.5f;
+  float cy = (fy + 0.5f) * 0.5f - 0.5f;
+  float u = sample_bilinear(chroma, chroma_pitch, 2, 0, frame_w / 2, frame_h / 2, cx, cy);
+  float v = sample_bilinear(chroma, chroma_pitch, 2, 1, frame_w / 2, frame_h / 2, cx, cy);
+
+  float c = 1.164f * (yv - 16.0f);
+  float d = u - 128.0f;
+  float e = v - 128.0f;
+  dst[at] = clampf((c + 1.596f * e) / 255.0f, 0.0f, 1.0f);
+  dst[plane + at] = clampf((c - 0.392f * d - 0.813f * e) / 255.0f, 0.0f, 1.0f);
+  dst[2 * plane + at] = clampf((c + 2.017f * d) / 255.0f, 0.0f, 1.0f);
+}
+
+}  // namespace dashcam::worker::detail
@@ -0,0 +1,209 @@
+#include "worker/inference/tensorrt_engine.hpp"
+
+#include <NvInfer.h>
+#include <NvOnnxParser.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "common/hash.hpp"
+#include "worker/gpu/device_info.hpp"
+#include "worker/gpu/gpu.hpp"
+
+namespace dashcam::worker {
+
+namespace {
+
+class Logger : public nvinfer1::ILogger {
+ public:
+  void log(Severity severity, const char* message) noexcept override {
+    if (severity <= Severity::kWARNING) {
+      std::fprintf(stderr, "[tensorrt] %s\n", message);
+    }
+  }
+};
+
+Logger& logger() {
+  static Logger instance;
+  return instance;
+}
+
+// INT8 engines are built from a calibration table produced offline (one per
+// model, next to the ONNX file as <stem>.int8cache). The workhorse never
+// calibrates at runtime, so this calibrator only replays the table.
+class CachedCalibrator : public nvinfer1::IInt8EntropyCalibrator2 {
+ public:
+  explicit CachedCalibrator(const std::filesystem::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+      throw std::runtime_error("INT8 requested but no calibration table at " + path.string());
+    }
+    table_.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  }
+
+  int32_t getBatchSize() const noexcept override { return 1; }
+  bool getBatch(void* /*bindings*/[], const char* /*names*/[], int32_t /*count*/) noexcept override {
+    return false;
+  }
+  const void* readCalibrationCache(std::size_t& length) noexcept override {
+    length = table_.size();
+    return table_.data();
+  }
+  void writeCalibrationCache(const void* /*data*/, std::size_t /*length*/) noexcept override {}
+
+ private:
+  std::vector<char> table_;
+};
+
+template <typename T>
+struct TrtDelete {
+  void operator()(T* p) const { delete p; }
+};
+template <typename T>
+using TrtPtr = std::unique_ptr<T, TrtDelete<T>>;
+
+std::string runtime_version() {
+  return "trt" + std::to_string(NV_TENSORRT_MAJOR) + "." + std::to_string(NV_TENSORRT_MINOR) +
+         "." + std::to_string(NV_TENSORRT_PATCH);
+}
+
+std::vector<char> build_engine(const EngineSpec& spec, const std::filesystem::path& onnx) {
+  TrtPtr<nvinfer1::IBuilder> builder(nvinfer1::createInferBuilder(logger()));
+  // TensorRT 8.x defaults to implicit batch, which the ONNX parser rejects;
+  // from 10 on explicit batch is the only mode and the flag is deprecated.
+#if NV_TENSORRT_MAJOR < 10
+  const auto flags = 1U << static_cast<std::uint32_t>(
+                         nvinfer1::NetworkDefinitionCreationFlag::kEXPLICIT_BATCH);
+#else
+  const std::uint32_t flags = 0;
+#endif
+  TrtPtr<nvinfer1::INetworkDefinition> network(builder->createNetworkV2(flags));
+  TrtPtr<nvonnxparser::IParser> parser(nvonnxparser::createParser(*network, logger()));
+  if (!parser->parseFromFile(onnx.string().c_str(),
+                             static_cast<int>(nvinfer1::ILogger::Severity::kWARNING))) {
+    throw std::runtime_error("cannot parse " + onnx.string());
+  }
+
+  TrtPtr<nvinfer1::IBuilderConfig> config(builder->createBuilderConfig());
+  config->setMemoryPoolLimit(nvinfer1::MemoryPoolType::kWORKSPACE, std::size_t{1} << 30);
+  std::unique_ptr<CachedCalibrator> calibrator;
+  if (spec.precision == Precision::FP16 || spec.precision == Precision::INT8) {
+    config->setFlag(nvinfer1::BuilderFlag::kFP16);
+  }
+  if (spec.precision == Precision::INT8) {
+    auto table = onnx;
+    table.replace_extension(".int8cache");
+    calibrator = std::make_unique<CachedCalibrator>(table);
+    config->setFlag(nvinfer1::BuilderFlag::kINT8);
+    config->setInt8Calibrator(calibrator.get());
+  }
+
+  const char* input = network->getInput(0)->getName();
+  int s = spec.input_size;
+  nvinfer1::IOptimizationProfile* profile = builder->createOptimizationProfile();
+  profile->setDimensions(input, nvinfer1::OptProfileSelector::kMIN, nvinfer1::Dims4{1, 3, s, s});
+  profile->setDimensions(input, nvinfer1::OptProfileSelector::kOPT,
+                         nvinfer1::Dims4{std::max(1, spec.max_batch / 2), 3, s, s});
+  profile->setDimensions(input, nvinfer1::OptProfileSelector::kMAX,
+                         nvinfer1::Dims4{spec.max_batch, 3, s, s});
+  config->addOptimizationProfile(profile);
+
+  TrtPtr<nvinfer1::IHostMemory> plan(builder->buildSerializedNetwork(*network, *config));
+  if (!plan) {
+    throw std::runtime_error("TensorRT build failed for " + onnx.string());
+  }
+  const auto* bytes = static_cast<const char*>(plan->data());
+  return std::vector<char>(bytes, bytes + plan->size());
+}
+
+class TensorRtContext : public InferenceContext {
+ public:
+  TensorRtContext(nvinfer1::ICudaEngine& engine, int input_size)
+      : context_(engine.createExecutionContext()), input_size_(input_size) {
+    if (!context_) {
+      throw GpuError("createExecutionContext failed");
+    }
+    input_ = engine.getIOTensorName(0);
+    output_ = engine.getIOTensorName(1);
+  }
+
+  void enqueue(const float* input, float* output, int batch, GpuStream stream) override {
+    context_->setInputShape(input_, nvinfer1::Dims4{batch, 3, input_size_, input_size_});
+    context_->setTensorAddress(input_, const_cast<float*>(input));
+    context_->setTensorAddress(output_, output);
+    if (!context_->enqueueV3(stream)) {
+      throw GpuError("TensorRT enqueue failed");
+    }
+  }
+
+ private:
+  TrtPtr<nvinfer1::IExecutionContext> context_;
+  int input_size_;
+  const char* input_ = nullptr;
+  const char* output_ = nullptr;
+};
+
+class TensorRtEngine : public InferenceEngine {
+ public:
+  TensorRtEngine(const EngineSpec& spec, const std::vector<char>& plan)
+      : runtime_(nvinfer1::createInferRuntime(logger())), spec_(spec) {
+    engine_.reset(runtime_->deserializeCudaEngine(plan.data(), plan.size()));
+    if (!engine_) {
+      throw GpuError("cannot deserialize engine for " + spec.model.string());
+    }
+    nvinfer1::Dims out = engine_->getTensorShape(engine_->getIOTensorName(1));
+    shape_.channels = static_cast<int>(out.d[1]);
+    shape_.anchors = static_cast<int>(out.d[2]);
+  }
+
+  int input_size() const override { return spec_.input_size; }
+  int max_batch() const override { return spec_.max_batch; }
+  OutputShape output_shape() const override { return shape_; }
+  std::unique_ptr<InferenceContext> create_context() override {
+    return std::make_unique<TensorRtContext>(*engine_, spec_.input_size);
+  }
+
+ private:
+  // Destruction order matters: the engine must go before its runtime.
+  TrtPtr<nvinfer1::IRuntime> runtime_;
+  TrtPtr<nvinfer1::ICudaEngine> engine_;
+  EngineSpec spec_;
+  OutputShape shape_;
+};
+
+}  // namespace
+
+std::shared_ptr<InferenceEngine> load_tensorrt_engine(const EngineSpec& spec, EngineCache& cache) {
+  auto onnx = spec.model;
+  onnx.replace_extension(".onnx");
+  if (!std::filesystem::exists(onnx)) {
+    throw std::runtime_error("missing " + onnx.string() + "; export it with `yolo export model=" +
+                             spec.model.string() + " format=onnx dynamic=True`");
+  }
+  use_device(spec.gpu_device);
+
+  EngineKey key;
+  key.model_name = spec.model.stem().string();
+  key.model_hash = hash_file(onnx);
+  key.gpu = query_device(spec.gpu_device).cache_tag();
+  key.runtime = runtime_version();
+  key.precision = to_string(spec.precision);
+  key.max_batch = spec.max_batch;
+  key.input_size = spec.input_size;
+
+  if (auto plan = cache.load(key)) {
+    return std::make_shared<TensorRtEngine>(spec, *plan);
+  }
+  std::fprintf(stderr, "building %s engine for %s (first run on this GPU)\n", key.precision.c_str(),
+               spec.model.string().c_str());
+  std::vector<char> plan = build_engine(spec, onnx);
+  cache.store(key, plan.data(), plan.size());
+  return std::make_shared<TensorRtEngine>(spec, plan);
+}
+
+}  // namespace dashcam::worker
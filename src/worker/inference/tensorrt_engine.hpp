@@ -0,0 +1,16 @@
+#pragma once
+
+#include <memory>
+
+#include "worker/inference/engine_cache.hpp"
+#include "worker/inference/inference_engine.hpp"
+
+namespace dashcam::worker {
+
+// TensorRT backend for load_engine(). Engines have a dynamic batch dimension
+// (optimization profile 1..max_batch) and a fixed square input, so any burst
+// size up to max_batch runs as a single enqueue. Only compiled with
+// DASHCAM_WITH_TENSORRT.
+std::shared_ptr<InferenceEngine> load_tensorrt_engine(const EngineSpec& spec, EngineCache& cache);
+
+}  // namespace dashcam::worker
@@ -0,0 +1,136 @@
+#include "worker/inference/tile_planner.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace dashcam::worker {
+
+namespace {
+
+// Tiles of `tile` pixels needed to cover `extent` with `overlap`.
+int spread_count(int extent, int tile, int overlap) {
+  if (extent <= tile) {
+    return 1;
+  }
+  int step = std::max(1, tile - overlap);
+  return std::max((extent - overlap + step - 1) / step, 2);
+}
+
+// Starts of `count` tiles of `tile` pixels spread evenly over `extent`.
+std::vector<int> spread(int extent, int tile, int overlap) {
+  if (extent <= tile) {
+    return {0};
+  }
+  int count = spread_count(extent, tile, overlap);
+  std::vector<int> starts;
+  for (int i = 0; i < count; ++i) {
+    starts.push_back(static_cast<int>(static_cast<long long>(extent - tile) * i / (count - 1)));
+  }
+  return starts;
+}
+
+bool touches(const Box& a, const Box& b) {
+  return a.x0 <= b.x1 && b.x0 <= a.x1 && a.y0 <= b.y1 && b.y0 <= a.y1;
+}
+
+bool contains(const Roi& outer, const Roi& inner) {
+  return inner.x >= outer.x && inner.y >= outer.y &&
+         inner.x + inner.width <= outer.x + outer.width &&
+         inner.y + inner.height <= outer.y + outer.height;
+}
+
+// Square ROI of side max(tile, region size) centred on `region`, shifted to
+// stay inside the frame.
+Roi square_around(const Box& region, int frame_width, int frame_height, int tile) {
+  int side = std::max(tile, static_cast<int>(std::ceil(std::max(region.width(), region.height()))));
+  int w = std::min(side, frame_width);
+  int h = std::min(side, frame_height);
+  int cx = static_cast<int>((region.x0 + region.x1) * 0.5f);
+  int cy = static_cast<int>((region.y0 + region.y1) * 0.5f);
+  Roi roi;
+  roi.width = w;
+  roi.height = h;
+  roi.x = std::clamp(cx - w / 2, 0, frame_width - w);
+  roi.y = std::clamp(cy - h / 2, 0, frame_height - h);
+  return roi;
+}
+
+}  // namespace
+
+std::size_t count_grid_tiles(int frame_width, int frame_height, const TilePlanOptions& options) {
+  int tw = std::min(options.tile_size, frame_width);
+  int th = std::min(options.tile_size, frame_height);
+  return static_cast<std::size_t>(spread_count(frame_height, th, options.grid_overlap)) *
+         static_cast<std::size_t>(spread_count(frame_width, tw, options.grid_overlap));
+}
+
+std::vector<Roi> plan_grid_tiles(int frame_width, int frame_height, const TilePlanOptions& options) {
+  int tw = std::min(options.tile_size, frame_width);
+  int th = std::min(options.tile_size, frame_height);
+  std::vector<Roi> tiles;
+  for (int y : spread(frame_height, th, options.grid_overlap)) {
+    for (int x : spread(frame_width, tw, options.grid_overlap)) {
+      tiles.push_back({x, y, tw, th});
+    }
+  }
+  return tiles;
+}
+
+std::vector<Roi> plan_proposal_tiles(int frame_width, int frame_height,
+                                     std::span<const Box> regions, const TilePlanOptions& options) {
+  std::vector<Box> merged;
+  merged.reserve(regions.size());
+  for (const Box& r : regions) {
+    float mx = r.width() * options.margin;
+    float my = r.height() * options.margin;
+    Box grown{std::max(0.0f, r.x0 - mx), std::max(0.0f, r.y0 - my),
+              std::min(static_cast<float>(frame_width), r.x1 + mx),
+              std::min(static_cast<float>(frame_height), r.y1 + my)};
+    if (grown.area() > 0.0f) {
+      merged.push_back(grown);
+    }
+  }
+
+  // Merge until no two regions touch. Region counts per frame are small
+  // (tens), so the quadratic pass is cheaper than anything clever.
+  for (bool changed = true; changed;) {
+    changed = false;
+    for (std::size_t i = 0; i < merged.size() && !changed; ++i) {
+      for (std::size_t j = i + 1; j < merged.size(); ++j) {
+        if (touches(merged[i], merged[j])) {
+          merged[i] = {std::min(merged[i].x0, merged[j].x0), std::min(merged[i].y0, merged[j].y0),
+                       std::max(merged[i].x1, merged[j].x1), std::max(merged[i].y1, merged[j].y1)};
+          merged.erase(merged.begin() + static_cast<std::ptrdiff_t>(j));
+          changed = true;
+          break;
+        }
+      }
+    }
+  }
+
+  std::vector<Roi> tiles;
+  for (const Box& region : merged) {
+    tiles.push_back(square_around(region, frame_width, frame_height, options.tile_size));
+  }
+  std::vector<Roi> kept;
+  for (std::size_t i = 0; i < tiles.size(); ++i) {
+    bool redundant = false;
+    for (std::size_t j = 0; j < tiles.size() && !redundant; ++j) {
+      // Ties (identical tiles) keep the lower index.
+      redundant = j != i && contains(tiles[j], tiles[i]) && (!contains(tiles[i], tiles[j]) || j < i);
+    }
+    if (!redundant) {
+      kept.push_back(tiles[i]);
+    }
+  }
+
+  if (static_cast<int>(kept.size()) > options.max_tiles) {
+    auto grid = plan_grid_tiles(frame_width, frame_height, options);
+    if (grid.size() < kept.size()) {
+      return grid;
+    }
+  }
+  return kept;
+}
+
+}  // namespace dashcam::worker
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include "worker/inference/detection.hpp"
+#include "worker/inference/letterbox.hpp"
+
+namespace dashcam::worker {
+
+// How the plate model covers a frame.
+//  - FullFrame: native-resolution grid over the whole frame. The accuracy
+//    baseline, and the cost every frame would pay without proposals.
+//  - Proposals: tiles only around vehicle boxes and coarse motion proposals
+//    (workhorse.md §3.2 "limit search space"); road and sky are never run.
+enum class PlateSearchMode { FullFrame, Proposals };
+
+struct TilePlanOptions {
+  // Source pixels per tile side; equal to the plate engine input so tiles run
+  // at native resolution. Regions larger than this are downscaled into one
+  // tile: plates on near vehicles are large enough to survive it.
+  int tile_size = 640;
+  int grid_overlap = 64;  // FullFrame grid only, so edge plates are seen whole
+  // Regions are grown by this fraction of their size before tiling; plates
+  // sit at the edge of a tight vehicle box.
+  float margin = 0.15f;
+  // Past this many proposal tiles a frame switches to the grid if the grid
+  // is smaller (crowded scenes).
+  int max_tiles = 24;
+};
+
+std::vector<Roi> plan_grid_tiles(int frame_width, int frame_height, const TilePlanOptions& options);
+// plan_grid_tiles(...).size(), without building the plan.
+std::size_t count_grid_tiles(int frame_width, int frame_height, const TilePlanOptions& options);
+
+// Tiles covering `regions` (frame pixels). Overlapping regions are merged
+// first so a cluster of cars becomes one tile, and tiles contained in others
+// are dropped. Returns an empty plan when there is nothing to search.
+std::vector<Roi> plan_proposal_tiles(int frame_width, int frame_height,
+                                     std::span<const Box> regions, const TilePlanOptions& options);
+
+}  // namespace dashcam::worker
@@ -0,0 +1,63 @@
+#include "worker/inference/yolo_decode.hpp"
+
+#include <algorithm>
+#include <cstddef>
+
+namespace dashcam::worker {
+
+void decode_yolo(const float* output, const OutputShape& shape, const Letterbox& box,
+                 const DecodeOptions& options, std::vector<Detection>& out) {
+  auto anchors = static_cast<std::size_t>(shape.anchors);
+  auto channel = [&](int c) { return output + static_cast<std::size_t>(c) * anchors; };
+  const float* cx = channel(0);
+  const float* cy = channel(1);
+  const float* w = channel(2);
+  const float* h = channel(3);
+
+  for (std::size_t a = 0; a < anchors; ++a) {
+    int best_class = -1;
+    float best = options.score_threshold;
+    for (int c = 4; c < shape.channels; ++c) {
+      float score = channel(c)[a];
+      if (score >= best) {
+        best = score;
+        best_class = c - 4;
+      }
+    }
+    if (best_class < 0) {
+      continue;
+    }
+    auto to_frame_x = [&](float v) {
+      return (v - box.pad_x) / box.scale + static_cast<float>(box.roi.x);
+    };
+    auto to_frame_y = [&](float v) {
+      return (v - box.pad_y) / box.scale + static_cast<float>(box.roi.y);
+    };
+    Detection d;
+    d.box.x0 = to_frame_x(cx[a] - 0.5f * w[a]);
+    d.box.y0 = to_frame_y(cy[a] - 0.5f * h[a]);
+    d.box.x1 = to_frame_x(cx[a] + 0.5f * w[a]);
+    d.box.y1 = to_frame_y(cy[a] + 0.5f * h[a]);
+    d.score = best;
+    d.model_class = best_class;
+    out.push_back(d);
+  }
+}
+
+void non_max_suppression(std::vector<Detection>& detections, float iou_threshold) {
+  std::sort(detections.begin(), detections.end(),
+            [](const Detection& a, const Detection& b) { return a.score > b.score; });
+  std::vector<Detection> kept;
+  kept.reserve(detections.size());
+  for (const auto& candidate : detections) {
+    bool suppressed = std::any_of(kept.begin(), kept.end(), [&](const Detection& k) {
+      return k.model_class == candidate.model_class && iou(k.box, candidate.box) > iou_threshold;
+    });
+    if (!suppressed) {
+      kept.push_back(candidate);
+    }
+  }
+  detections = std::move(kept);
+}
+
+}  // namespace dashcam::worker
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <vector>
+
+#include "worker/inference/detection.hpp"
+#include "worker/inference/inference_engine.hpp"
+#include "worker/inference/letterbox.hpp"
+
+namespace dashcam::worker {
+
+struct DecodeOptions {
+  float score_threshold = 0.25f;
+  float nms_iou = 0.45f;
+};
+
+// Raw per-anchor candidates of one image's YOLOv8 head, mapped back to frame
+// pixels through `box`. `cls` is left for the caller to assign from
+// model_class. Not yet suppressed.
+void decode_yolo(const float* output, const OutputShape& shape, const Letterbox& box,
+                 const DecodeOptions& options, std::vector<Detection>& out);
+
+// Greedy per-class non-maximum suppression, in place. Result is sorted by
+// descending score.
+void non_max_suppression(std::vector<Detection>& detections, float iou_threshold);
+
+}  // namespace dashcam::worker
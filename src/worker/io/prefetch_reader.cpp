@@ -0,0 +1,426 @@
+#include "worker/io/prefetch_reader.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#include "common/hash.hpp"
+#include "common/metrics.hpp"
+
+namespace dashcam::worker {
+
+namespace {
+
+// Larger moov atoms are read through the window like everything else.
+constexpr std::uint64_t kMaxIndexBytes = 256u << 20;
+
+std::uint64_t elapsed_ns(std::chrono::steady_clock::time_point start) {
+  return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                        std::chrono::steady_clock::now() - start)
+                                        .count());
+}
+
+Histogram& read_seconds() {
+  static Histogram& h = default_metrics().histogram(
+      "dashcam_worker_nas_read_seconds", "Time per block read from the video file (NAS).");
+  return h;
+}
+
+Counter& read_bytes() {
+  static Counter& c = default_metrics().counter("dashcam_worker_nas_read_bytes_total",
+                                                "Bytes read from video files (NAS).");
+  return c;
+}
+
+std::uint32_t be32(const unsigned char* p) {
+  return (std::uint32_t{p[0]} << 24) | (std::uint32_t{p[1]} << 16) | (std::uint32_t{p[2]} << 8) |
+         std::uint32_t{p[3]};
+}
+
+bool is_mp4(const std::filesystem::path& path) {
+  std::string ext = path.extension().string();
+  std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) {
+    return static_cast<char>(std::tolower(c));
+  });
+  return ext == ".mp4" || ext == ".mov";
+}
+
+}  // namespace
+
+PrefetchReader::PrefetchReader(const std::filesystem::path& path, const PrefetchConfig& config,
+                               std::optional<std::int64_t> warm_from)
+    : path_(path), config_(config) {
+  if (config_.block_bytes == 0 || config_.read_ahead_blocks == 0) {
+    throw std::invalid_argument("prefetch block_bytes and read_ahead_blocks must be positive");
+  }
+  fd_ = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd_ < 0) {
+    throw std::runtime_error("cannot open " + path.string() + ": " + std::strerror(errno));
+  }
+  struct stat st {};
+  if (::fstat(fd_, &st) != 0) {
+    ::close(fd_);
+    throw std::runtime_error("cannot stat " + path.string() + ": " + std::strerror(errno));
+  }
+  size_ = static_cast<std::int64_t>(st.st_size);
+  auto block = static_cast<std::int64_t>(config_.block_bytes);
+  block_count_ = (size_ + block - 1) / block;
+#ifdef POSIX_FADV_SEQUENTIAL
+  ::posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+  if (warm_from) {
+    window_ = std::clamp<std::int64_t>(*warm_from, 0, size_) / block;
+  }
+  // Read-ahead of the start overlaps the trip to the moov at the end.
+  thread_ = std::thread([this] { fetch_loop(); });
+  if (is_mp4(path_)) {
+    try {
+      load_index();
+    } catch (...) {
+      stop();
+      throw;
+    }
+  }
+}
+
+PrefetchReader::~PrefetchReader() { stop(); }
+
+void PrefetchReader::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  cv_.notify_all();
+  thread_.join();
+  ::close(fd_);
+}
+
+std::size_t PrefetchReader::pread_full(std::int64_t offset, void* dst, std::size_t bytes) {
+  auto* out = static_cast<char*>(dst);
+  auto start = std::chrono::steady_clock::now();
+  std::size_t done = 0;
+  while (done < bytes) {
+    ssize_t got = ::pread(fd_, out + done, bytes - done, static_cast<off_t>(offset) + done);
+    if (got < 0 && errno == EINTR) {
+      continue;
+    }
+    reads_.fetch_add(1, std::memory_order_relaxed);
+    if (got <= 0) {
+      break;
+    }
+    done += static_cast<std::size_t>(got);
+  }
+  std::uint64_t ns = elapsed_ns(start);
+  bytes_read_.fetch_add(done, std::memory_order_relaxed);
+  read_ns_.fetch_add(ns, std::memory_order_relaxed);
+  read_bytes().add(done);
+  read_seconds().observe(static_cast<double>(ns) * 1e-9);
+  return done;
+}
+
+// Walks the top-level atoms (a few header reads) to find the moov, then
+// takes it from the cache or reads it once and caches it.
+void PrefetchReader::load_index() {
+  std::int64_t offset = 0;
+  std::uint64_t length = 0;
+  while (offset + 8 <= size_) {
+    unsigned char header[16];
+    std::size_t want = static_cast<std::size_t>(std::min<std::int64_t>(16, size_ - offset));
+    if (pread_full(offset, header, want) != want) {
+      return;
+    }
+    std::uint64_t box = be32(header);
+    if (box == 1 && want == 16) {
+      box = (std::uint64_t{be32(header + 8)} << 32) | be32(header + 12);
+    } else if (box == 0) {
+      box = static_cast<std::uint64_t>(size_ - offset);
+    }
+    if (box < 8 || box > static_cast<std::uint64_t>(size_ - offset)) {
+      return;  // not an MP4 after all, or truncated; the demuxer will say so
+    }
+    if (std::memcmp(header + 4, "moov", 4) == 0) {
+      length = box;
+      break;
+    }
+    offset += static_cast<std::int64_t>(box);
+  }
+  if (length == 0 || length > kMaxIndexBytes) {
+    return;
+  }
+
+  std::filesystem::path cached;
+  if (!config_.index_cache_dir.empty()) {
+    std::error_code ec;
+    auto mtime = std::filesystem::last_write_time(path_, ec).time_since_epoch().count();
+    std::string key = std::filesystem::absolute(path_, ec).generic_string();
+    Xxh64 state;
+    state.update(key.data(), key.size());
+    state.update(&size_, sizeof(size_));
+    state.update(&mtime, sizeof(mtime));
+    cached = config_.index_cache_dir / (to_hex(state.digest()) + ".moov");
+
+    std::ifstream in(cached, std::ios::binary);
+    if (in) {
+      std::vector<char> bytes((std::istreambuf_iterator<char>(in)),
+                              std::istreambuf_iterator<char>());
+      if (bytes.size() == length && std::memcmp(bytes.data() + 4, "moov", 4) == 0) {
+        index_ = std::move(bytes);
+        index_offset_ = offset;
+        index_cached_ = true;
+        std::filesystem::last_write_time(cached, std::filesystem::file_time_type::clock::now(),
+                                         ec);
+        return;
+      }
+    }
+  }
+
+  std::vector<char> bytes(length);
+  if (pread_full(offset, bytes.data(), bytes.size()) != bytes.size()) {
+    return;
+  }
+  index_ = std::move(bytes);
+  index_offset_ = offset;
+  if (!cached.empty()) {
+    // Best effort: a failed write only costs the next open a round trip.
+    std::error_code ec;
+    std::filesystem::create_directories(config_.index_cache_dir, ec);
+    auto tmp = cached;
+    tmp += ".tmp";
+    {
+      std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+      out.write(index_.data(), static_cast<std::streamsize>(index_.size()));
+      if (!out) {
+        std::filesystem::remove(tmp, ec);
+        return;
+      }
+    }
+    std::filesystem::rename(tmp, cached, ec);
+  }
+}
+
+void PrefetchReader::fetch_loop() {
+  const TraceBuffer* named = nullptr;  // the buffer this thread is labelled in
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    cv_.wait(lock, [&] {
+      return stopping_ ||
+             (window_ >= 0 && error_.empty() && blocks_.size() < config_.read_ahead_blocks &&
+              window_ + static_cast<std::int64_t>(blocks_.size()) < block_count_);
+    });
+    if (stopping_) {
+      return;
+    }
+    std::int64_t index = window_ + static_cast<std::int64_t>(blocks_.size());
+    std::vector<char> data;
+    if (!spare_.empty()) {
+      data = std::move(spare_.back());
+      spare_.pop_back();
+    }
+    std::shared_ptr<TraceBuffer> trace = trace_;
+    lock.unlock();
+    if (trace && trace.get() != named) {
+      trace->name_thread("prefetch");
+      named = trace.get();
+    }
+
+    auto block = static_cast<std::int64_t>(config_.block_bytes);
+    std::int64_t offset = index * block;
+    data.resize(static_cast<std::size_t>(std::min(block, size_ - offset)));
+    errno = 0;
+    std::size_t got = 0;
+    int error = 0;
+    {
+      ScopedTrace span(trace.get(), "nas_read", "io", static_cast<std::int64_t>(data.size()));
+      got = pread_full(offset, data.data(), data.size());
+      error = errno;
+    }
+
+    lock.lock();
+    if (got < data.size() && error != 0) {
+      error_ = "read " + path_.string() + ": " + std::strerror(error);
+    } else if (index == window_ + static_cast<std::int64_t>(blocks_.size())) {
+      // A short block means the file shrank under us; the consumer sees EOF
+      // at its end.
+      data.resize(got);
+      blocks_.push_back({index, std::move(data)});
+    } else {
+      spare_.push_back(std::move(data));  // the consumer seeked away meanwhile
+    }
+    cv_.notify_all();
+  }
+}
+
+void PrefetchReader::seek(std::int64_t offset) { pos_ = std::clamp<std::int64_t>(offset, 0, size_); }
+
+std::size_t PrefetchReader::read(void* dst, std::size_t bytes) {
+  auto* out = static_cast<char*>(dst);
+  auto block = static_cast<std::int64_t>(config_.block_bytes);
+  auto ahead = static_cast<std::int64_t>(config_.read_ahead_blocks);
+  std::size_t done = 0;
+  while (done < bytes && pos_ < size_) {
+    auto index_end = index_offset_ + static_cast<std::int64_t>(index_.size());
+    if (index_offset_ >= 0 && pos_ >= index_offset_ && pos_ < index_end) {
+      auto n = static_cast<std::size_t>(
+          std::min<std::int64_t>(index_end - pos_, static_cast<std::int64_t>(bytes - done)));
+      std::memcpy(out + done, index_.data() + (pos_ - index_offset_), n);
+      index_bytes_.fetch_add(n, std::memory_order_relaxed);
+      pos_ += static_cast<std::int64_t>(n);
+      done += n;
+      continue;
+    }
+
+    std::int64_t index = pos_ / block;
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (window_ < 0 || index < window_ || index >= window_ + ahead) {
+      if (window_ >= 0) {
+        window_resets_.fetch_add(1, std::memory_order_relaxed);
+      }
+      for (Block& b : blocks_) {
+        spare_.push_back(std::move(b.data));
+      }
+      blocks_.clear();
+      window_ = index;
+      cv_.notify_all();
+    }
+    while (window_ < index) {
+      // Blocks behind the consumer are done with; dropping them lets the
+      // I/O thread read further ahead.
+      if (!blocks_.empty()) {
+        spare_.push_back(std::move(blocks_.front().data));
+        blocks_.pop_front();
+      }
+      ++window_;
+      cv_.notify_all();
+    }
+    if (blocks_.empty() && error_.empty()) {
+      ScopedTrace span("nas_stall", "io");
+      auto start = std::chrono::steady_clock::now();
+      cv_.wait(lock, [&] { return !blocks_.empty() || !error_.empty(); });
+      stall_ns_.fetch_add(elapsed_ns(start), std::memory_order_relaxed);
+    }
+    if (blocks_.empty()) {
+      throw std::runtime_error(error_);
+    }
+    const std::vector<char>& data = blocks_.front().data;
+    auto in_block = static_cast<std::size_t>(pos_ - index * block);
+    if (in_block >= data.size()) {
+      break;
+    }
+    std::size_t n = std::min(data.size() - in_block, bytes - done);
+    std::memcpy(out + done, data.data() + in_block, n);
+    pos_ += static_cast<std::int64_t>(n);
+    done += n;
+  }
+  return done;
+}
+
+void PrefetchReader::set_trace(std::shared_ptr<TraceBuffer> trace) {
+  std::lock_guard lock(mutex_);
+  trace_ = std::move(trace);
+}
+
+IoStats PrefetchReader::stats() const {
+  IoStats stats;
+  stats.bytes_read = bytes_read_.load(std::memory_order_relaxed);
+  stats.reads = reads_.load(std::memory_order_relaxed);
+  stats.window_resets = window_resets_.load(std::memory_order_relaxed);
+  stats.index_bytes = index_bytes_.load(std::memory_order_relaxed);
+  stats.index_cached = index_cached_;
+  stats.read_s = static_cast<double>(read_ns_.load(std::memory_order_relaxed)) * 1e-9;
+  stats.stall_s = static_cast<double>(stall_ns_.load(std::memory_order_relaxed)) * 1e-9;
+  return stats;
+}
+
+PrefetchStreambuf::PrefetchStreambuf(std::shared_ptr<PrefetchReader> reader,
+                                     std::size_t buffer_bytes)
+    : reader_(std::move(reader)), buffer_(std::max<std::size_t>(buffer_bytes, 1)) {
+  setg(buffer_.data(), buffer_.data(), buffer_.data());
+}
+
+PrefetchStreambuf::int_type PrefetchStreambuf::underflow() {
+  if (gptr() < egptr()) {
+    return traits_type::to_int_type(*gptr());
+  }
+  std::size_t got = reader_->read(buffer_.data(), buffer_.size());
+  setg(buffer_.data(), buffer_.data(), buffer_.data() + got);
+  return got == 0 ? traits_type::eof() : traits_type::to_int_type(*gptr());
+}
+
+std::streamsize PrefetchStreambuf::xsgetn(char* s, std::streamsize n) {
+  std::streamsize got = 0;
+  while (got < n) {
+    std::streamsize buffered = egptr() - gptr();
+    if (buffered > 0) {
+      std::streamsize k = std::min(buffered, n - got);
+      std::memcpy(s + got, gptr(), static_cast<std::size_t>(k));
+      gbump(static_cast<int>(k));
+      got += k;
+    } else if (n - got >= static_cast<std::streamsize>(buffer_.size())) {
+      auto want = static_cast<std::size_t>(n - got);
+      std::size_t k = reader_->read(s + got, want);
+      got += static_cast<std::streamsize>(k);
+      if (k < want) {
+        break;
+      }
+    } else if (underflow() == traits_type::eof()) {
+      break;
+    }
+  }
+  return got;
+}
+
+PrefetchStreambuf::pos_type PrefetchStreambuf::seekoff(off_type off, std::ios_base::seekdir dir,
+                                                       std::ios_base::openmode which) {
+  if ((which & std::ios_base::in) == 0) {
+    return pos_type(off_type(-1));
+  }
+  // The reader sits at the end of the get area.
+  std::int64_t buffer_start = reader_->tell() - (egptr() - eback());
+  std::int64_t current = reader_->tell() - (egptr() - gptr());
+  std::int64_t target = off;
+  if (dir == std::ios_base::cur) {
+    target += current;
+  } else if (dir == std::ios_base::end) {
+    target += reader_->size();
+  }
+  if (target < 0 || target > reader_->size()) {
+    return pos_type(off_type(-1));
+  }
+  if (target >= buffer_start && target <= reader_->tell()) {
+    // tellg() and short seeks stay inside the buffer.
+    setg(eback(), eback() + (target - buffer_start), egptr());
+  } else {
+    reader_->seek(target);
+    setg(buffer_.data(), buffer_.data(), buffer_.data());
+  }
+  return pos_type(off_type(target));
+}
+
+PrefetchStreambuf::pos_type PrefetchStreambuf::seekpos(pos_type pos,
+                                                       std::ios_base::openmode which) {
+  return seekoff(off_type(pos), std::ios_base::beg, which);
+}
+
+void prune_index_cache(const PrefetchConfig& config) {
+  std::error_code ec;
+  if (config.index_cache_dir.empty() || !std::filesystem::is_directory(config.index_cache_dir, ec)) {
+    return;
+  }
+  auto cutoff = std::filesystem::file_time_type::clock::now() - config.index_max_age;
+  for (const auto& entry : std::filesystem::directory_iterator(config.index_cache_dir, ec)) {
+    if (entry.is_regular_file(ec) && entry.last_write_time(ec) < cutoff && !ec) {
+      std::filesystem::remove(entry.path(), ec);
+    }
+  }
+}
+
+}  // namespace dashcam::worker
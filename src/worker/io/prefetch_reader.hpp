@@ -0,0 +1,152 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/trace.hpp"
+
+namespace dashcam::worker {
+
+struct PrefetchConfig {
+  // Reads go to the file in blocks of this size at block-aligned offsets, so
+  // the SMB/NFS client sees a few large sequential requests instead of the
+  // demuxer's many small ones.
+  std::size_t block_bytes = 4 << 20;
+  // Blocks kept read ahead of the decoder: 32 MiB, several seconds of 4K.
+  std::size_t read_ahead_blocks = 8;
+  // Local copies of MP4 moov atoms (the sample index), keyed by path, size
+  // and mtime. The moov sits at the end of dashcam files; with a copy on the
+  // SSD, opening a video needs no round trip to the end of it. Empty keeps
+  // the index in memory only.
+  std::filesystem::path index_cache_dir;
+  std::chrono::hours index_max_age{24 * 30};
+};
+
+// Where the time went reading one file. `stall_s` against the decode
+// stage's busy time (stage_stats.hpp) tells whether the NAS link is the
+// bottleneck; bytes_read / read_s is the throughput the link delivered.
+struct IoStats {
+  std::uint64_t bytes_read = 0;     // read from the file itself
+  std::uint64_t reads = 0;          // read calls on the file
+  std::uint64_t window_resets = 0;  // seeks outside the read-ahead window
+  std::uint64_t index_bytes = 0;    // served from the in-memory moov
+  bool index_cached = false;        // the moov came from index_cache_dir
+  double read_s = 0.0;              // in read calls, on the I/O thread
+  double stall_s = 0.0;             // consumer waiting for a block
+};
+
+// Sequential reader for raw video on the Indoor NAS (workhorse.md §4). A
+// background thread keeps the next read_ahead_blocks blocks in memory, so
+// decoding only waits on the network when the link is slower than the
+// decoder. Seeking inside the window is free; seeking outside it restarts
+// read-ahead at the new position. MP4/MOV moov atoms are loaded once and
+// served from memory.
+//
+// One consumer thread; read(), seek() and tell() are not thread-safe with
+// each other.
+class PrefetchReader {
+ public:
+  // Opens `path` and loads its moov atom, if any. Read-ahead starts at
+  // `warm_from` right away, or at the first read when it is empty (a shard
+  // whose start is only known once the demuxer has seeked). Throws
+  // std::runtime_error if the file cannot be opened.
+  PrefetchReader(const std::filesystem::path& path, const PrefetchConfig& config,
+                 std::optional<std::int64_t> warm_from = 0);
+  ~PrefetchReader();
+
+  PrefetchReader(const PrefetchReader&) = delete;
+  PrefetchReader& operator=(const PrefetchReader&) = delete;
+
+  const std::filesystem::path& path() const { return path_; }
+  std::int64_t size() const { return size_; }
+  std::int64_t tell() const { return pos_; }
+
+  // Clamped to [0, size()].
+  void seek(std::int64_t offset);
+
+  // Copies up to `bytes` from the current position and advances it; fewer
+  // only at the end of the file. Throws std::runtime_error on a read error.
+  std::size_t read(void* dst, std::size_t bytes);
+
+  IoStats stats() const;
+
+  // Records each NAS read as a span into `trace` from now on (null stops);
+  // a prefetched reader only learns its task's buffer once the task runs.
+  void set_trace(std::shared_ptr<TraceBuffer> trace);
+
+ private:
+  struct Block {
+    std::int64_t index = 0;
+    std::vector<char> data;
+  };
+
+  void stop();
+  void load_index();
+  // Bytes read; short only at end of file or on error (errno set).
+  std::size_t pread_full(std::int64_t offset, void* dst, std::size_t bytes);
+  void fetch_loop();
+
+  std::filesystem::path path_;
+  PrefetchConfig config_;
+  int fd_ = -1;
+  std::int64_t size_ = 0;
+  std::int64_t block_count_ = 0;
+  std::int64_t pos_ = 0;  // consumer side only
+
+  std::vector<char> index_;  // moov atom
+  std::int64_t index_offset_ = -1;
+  bool index_cached_ = false;
+
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<Block> blocks_;  // consecutive, starting at window_
+  std::int64_t window_ = -1;  // first block of the window; -1 before any read
+  std::vector<std::vector<char>> spare_;
+  std::string error_;
+  bool stopping_ = false;
+  std::shared_ptr<TraceBuffer> trace_;
+
+  std::atomic<std::uint64_t> bytes_read_{0};
+  std::atomic<std::uint64_t> reads_{0};
+  std::atomic<std::uint64_t> window_resets_{0};
+  std::atomic<std::uint64_t> index_bytes_{0};
+  std::atomic<std::uint64_t> read_ns_{0};
+  std::atomic<std::uint64_t> stall_ns_{0};
+  std::thread thread_;
+};
+
+// std::streambuf over a PrefetchReader, for parsers written against
+// iostreams. Reads at least a buffer's worth bypass the buffer.
+class PrefetchStreambuf : public std::streambuf {
+ public:
+  explicit PrefetchStreambuf(std::shared_ptr<PrefetchReader> reader,
+                             std::size_t buffer_bytes = 64 << 10);
+
+ protected:
+  int_type underflow() override;
+  std::streamsize xsgetn(char* s, std::streamsize n) override;
+  pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                   std::ios_base::openmode which) override;
+  pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+
+ private:
+  std::shared_ptr<PrefetchReader> reader_;
+  std::vector<char> buffer_;
+};
+
+// Deletes cached moov atoms not used for config.index_max_age.
+void prune_index_cache(const PrefetchConfig& config);
+
+}  // namespace dashcam::worker
@@ -0,0 +1,519 @@
+// dashcam-worker: pulls HEAVY_PROCESS_VIDEO tasks from the main server and
+// runs them (docs/devices/workhorse.md).
+//
+//   dashcam-worker --server host:port [--worker-id name] [--batch 4]
+//                  [--output /videos/heavy_output] [--poll-seconds 30]
+//                  [--checkpoints cache/checkpoints | --no-checkpoints]
+//                  [--index-cache cache/index] [--lowres-height 720] [--decode-only]
+//                  [--gpus 0,1] [--tasks-per-gpu 2] [--task-vram-mb 0]
+//                  [--pause-for game.exe,...] [--pause-file path] [--no-governor]
+//                  [--trace-dir cache/traces | --no-trace] [--metrics-listen 0.0.0.0:9108]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/http/http_client.hpp"
+#include "common/http/http_server.hpp"
+#include "common/metrics.hpp"
+#include "common/task.hpp"
+#include "common/trace.hpp"
+#include "worker/heavy/heavy_output.hpp"
+#include "worker/heavy/heavy_processor.hpp"
+#include "worker/heavy/task_scheduler.hpp"
+#include "worker/task/lease_keeper.hpp"
+#include "worker/task/task_client.hpp"
+#include "worker/throttle/activity_governor.hpp"
+
+using namespace dashcam;
+using namespace dashcam::worker;
+
+namespace {
+
+std::atomic<bool> g_stop{false};
+
+void on_signal(int) { g_stop = true; }
+
+struct Options {
+  std::string server;
+  std::string worker_id;
+  std::size_t batch = 4;
+  std::string output = "/videos/heavy_output";
+  int poll_seconds = 30;
+  std::string checkpoints = "cache/checkpoints";  // local SSD; empty disables
+  std::string index_cache = "cache/index";        // MP4 moov copies, local SSD
+  int lowres_height = 720;                          // archive video; 0 disables
+  bool decode_only = false;
+  std::vector<int> gpus;  // empty: every GPU
+  std::size_t tasks_per_gpu = 2;
+  std::size_t task_vram_mb = 0;  // 0: the GPU's budget split between its tasks
+  std::vector<std::string> pause_for;  // process names, e.g. games
+  std::string pause_file;
+  bool governor = true;
+  std::string trace_dir = "cache/traces";  // one Chrome trace per task; empty disables
+  std::string metrics_listen;              // Prometheus endpoint; empty disables
+};
+
+// Trace dumps kept in trace_dir; older ones are deleted as new ones land.
+constexpr std::size_t kKeptTraces = 200;
+
+// Each idle pull is a long-poll held this long by the server; short enough
+// that a stop request is noticed promptly.
+constexpr std::chrono::seconds kPullWait{10};
+
+void sleep_unless_stopped(std::chrono::seconds duration) {
+  auto until = std::chrono::steady_clock::now() + duration;
+  while (!g_stop && std::chrono::steady_clock::now() < until) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  }
+}
+
+std::vector<std::string> split_list(const std::string& text) {
+  std::vector<std::string> items;
+  std::stringstream in(text);
+  std::string item;
+  while (std::getline(in, item, ',')) {
+    if (!item.empty()) {
+      items.push_back(item);
+    }
+  }
+  return items;
+}
+
+// "0,1" -> {0, 1}; throws std::invalid_argument on anything else.
+std::vector<int> parse_devices(const std::string& text) {
+  std::vector<int> devices;
+  for (const std::string& item : split_list(text)) {
+    std::size_t used = 0;
+    int device = std::stoi(item, &used);
+    if (used != item.size() || device < 0) {
+      throw std::invalid_argument("bad GPU index: " + item);
+    }
+    devices.push_back(device);
+  }
+  return devices;
+}
+
+// GET /metrics from default_metrics(), served on its own thread for the
+// worker's lifetime.
+class MetricsEndpoint {
+ public:
+  explicit MetricsEndpoint(const std::string& listen)
+      : server_(server_options(listen), handle), thread_([this] { server_.run(); }) {
+    std::fprintf(stderr, "metrics on port %u\n", static_cast<unsigned>(server_.port()));
+  }
+  ~MetricsEndpoint() {
+    server_.stop();
+    thread_.join();
+  }
+
+  MetricsEndpoint(const MetricsEndpoint&) = delete;
+  MetricsEndpoint& operator=(const MetricsEndpoint&) = delete;
+
+ private:
+  static http::ServerOptions server_options(const std::string& listen) {
+    auto [address, port] = http::parse_endpoint(listen);
+    http::ServerOptions options;
+    options.address = address;
+    options.port = port;
+    return options;
+  }
+
+  static http::Response handle(const http::Request& request) {
+    if (request.method != "GET" || request.path() != "/metrics") {
+      return http::error_response(404, "not found");
+    }
+    http::Response response;
+    response.content_type = std::string(kPrometheusContentType);
+    response.body = default_metrics().render_prometheus();
+    return response;
+  }
+
+  http::HttpServer server_;
+  std::thread thread_;
+};
+
+// Writes the task's spans as <task id>-<video id>.json and drops the oldest
+// dumps past kKeptTraces. Failures only cost the trace.
+void dump_trace(const std::string& dir, const Task& task, const TraceBuffer& trace) {
+  try {
+    std::filesystem::create_directories(dir);
+    std::string name = std::to_string(task.task_id) + "-" + task.video_id;
+    trace.write_chrome_trace(std::filesystem::path(dir) / (name + ".json"),
+                             "dashcam-worker task " + name);
+
+    std::vector<std::pair<std::filesystem::file_time_type, std::filesystem::path>> dumps;
+    for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+      if (entry.is_regular_file() && entry.path().extension() == ".json") {
+        dumps.emplace_back(entry.last_write_time(), entry.path());
+      }
+    }
+    if (dumps.size() > kKeptTraces) {
+      std::sort(dumps.begin(), dumps.end());
+      for (std::size_t i = 0; i + kKeptTraces < dumps.size(); ++i) {
+        std::filesystem::remove(dumps[i].second);
+      }
+    }
+  } catch (const std::exception& e) {
+    std::fprintf(stderr, "task %lld: trace not written: %s\n",
+                 static_cast<long long>(task.task_id), e.what());
+  }
+}
+
+const TaskInput* video_input(const Task& task) {
+  const TaskInput* video = find_input(task.inputs, "video");
+  if (video == nullptr && !task.inputs.empty()) {
+    video = &task.inputs.front();
+  }
+  return video;
+}
+
+// Runs one task; true when it was completed. Throws when the task failed;
+// the caller reports that, and the server holds the task back for a while
+// before some worker pulls it again.
+bool run_task(const Options& options, HeavyProcessor& processor, TaskClient& client,
+              const Task& task, HeavyResult& result) {
+  const TaskInput* video = video_input(task);
+  if (video == nullptr) {
+    throw std::invalid_argument("no video input");
+  }
+  const TaskInput* rear = find_input(task.inputs, kRearVideoInput);
+  std::string rear_id;
+  if (rear != nullptr) {
+    rear_id = task.params["pair"]["rear_video_id"].asString();
+    if (rear_id.empty()) {
+      throw std::invalid_argument("rear video without params.pair.rear_video_id");
+    }
+  }
+
+  // Shards of a long video each run their own frame range (main_server.md
+  // §5.1); the server joins their FINALIZE_VIDEO parts once all are done. A
+  // front/rear pair runs as one and publishes a FINALIZE_VIDEO per camera.
+  static Histogram& publish_seconds = default_metrics().histogram(
+      "dashcam_worker_publish_seconds",
+      "Time per task writing heavy_output and completing it on the server.");
+  std::optional<ShardSpec> shard = find_shard(task.params);
+  std::optional<HeavyResult> rear_result;
+  if (rear != nullptr) {
+    PairedResult pair = processor.run_pair(video->path, rear->path);
+    result = std::move(pair.front);
+    result.paired_video_id = rear_id;
+    rear_result = std::move(pair.rear);
+    rear_result->paired_video_id = task.video_id;
+  } else {
+    result = processor.run(video->path, shard);
+  }
+  struct Camera {
+    const std::string& video_id;
+    const TaskInput& video;
+    const HeavyResult& result;
+  };
+  std::vector<Camera> cameras{{task.video_id, *video, result}};
+  if (rear_result) {
+    cameras.push_back({rear_id, *rear, *rear_result});
+  }
+
+  // Publishing is part of the task's trace as well.
+  TraceBinding bind(result.trace.get());
+  auto publish_start = std::chrono::steady_clock::now();
+  TaskCompletion completion;
+  completion.task_id = task.task_id;
+  for (const Camera& camera : cameras) {
+    std::filesystem::path out;
+    {
+      ScopedTrace span("write_output", "publish");
+      out = write_heavy_output(options.output, camera.video_id, camera.result);
+    }
+    NewTask finalize;
+    finalize.task_type = std::string(kFinalizeVideo);
+    finalize.video_id = camera.video_id;
+    finalize.inputs.push_back({"indoor_nas", out.generic_string(), "heavy_output"});
+    finalize.inputs.push_back(camera.video);
+    finalize.inputs.back().type = "video";
+    if (shard) {
+      finalize.params["shard"] = to_json(*shard);
+    }
+    completion.publish.push_back(std::move(finalize));
+  }
+
+  std::vector<CompletionResult> results;
+  {
+    ScopedTrace span("complete", "publish");
+    results = client.complete({&completion, 1});
+  }
+  publish_seconds.observe(
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - publish_start).count());
+  for (const Camera& camera : cameras) {
+    std::fprintf(stderr, "task %lld (%s): %lld/%lld frames kept (%lld from checkpoint), %s\n",
+                 static_cast<long long>(task.task_id), camera.video_id.c_str(),
+                 static_cast<long long>(camera.result.frames_kept),
+                 static_cast<long long>(camera.result.frames_decoded),
+                 static_cast<long long>(camera.result.frames_resumed),
+                 results.empty() ? "no completion result" : to_string(results.front().status));
+  }
+  if (results.empty()) {
+    return false;
+  }
+  // The task is done either way; its checkpoints will not be needed again.
+  if (results.front().status != CompletionStatus::NotFound) {
+    for (const Camera& camera : cameras) {
+      processor.discard_checkpoint(camera.video.path, shard);
+    }
+  }
+  // The scheduler learns from the task as one run: a pair decoded both
+  // cameras' frames through the stages they shared.
+  if (rear_result) {
+    result.frames_decoded += rear_result->frames_decoded;
+    result.io.bytes_read += rear_result->io.bytes_read;
+  }
+  return results.front().status == CompletionStatus::Completed;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (arg == "--server" && has_value) {
+      options.server = argv[++i];
+    } else if (arg == "--worker-id" && has_value) {
+      options.worker_id = argv[++i];
+    } else if (arg == "--batch" && has_value) {
+      options.batch = static_cast<std::size_t>(std::max(1, std::atoi(argv[++i])));
+    } else if (arg == "--output" && has_value) {
+      options.output = argv[++i];
+    } else if (arg == "--poll-seconds" && has_value) {
+      options.poll_seconds = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "--checkpoints" && has_value) {
+      options.checkpoints = argv[++i];
+    } else if (arg == "--no-checkpoints") {
+      options.checkpoints.clear();
+    } else if (arg == "--index-cache" && has_value) {
+      options.index_cache = argv[++i];
+    } else if (arg == "--lowres-height" && has_value) {
+      options.lowres_height = std::max(0, std::atoi(argv[++i]));
+    } else if (arg == "--decode-only") {
+      options.decode_only = true;
+    } else if (arg == "--gpus" && has_value) {
+      try {
+        options.gpus = parse_devices(argv[++i]);
+      } catch (const std::exception&) {
+        options.server.clear();
+        break;
+      }
+    } else if (arg == "--tasks-per-gpu" && has_value) {
+      options.tasks_per_gpu = static_cast<std::size_t>(std::max(1, std::atoi(argv[++i])));
+    } else if (arg == "--task-vram-mb" && has_value) {
+      options.task_vram_mb = static_cast<std::size_t>(std::max(0, std::atoi(argv[++i])));
+    } else if (arg == "--pause-for" && has_value) {
+      for (std::string& name : split_list(argv[++i])) {
+        options.pause_for.push_back(std::move(name));
+      }
+    } else if (arg == "--pause-file" && has_value) {
+      options.pause_file = argv[++i];
+    } else if (arg == "--no-governor") {
+      options.governor = false;
+    } else if (arg == "--trace-dir" && has_value) {
+      options.trace_dir = argv[++i];
+    } else if (arg == "--no-trace") {
+      options.trace_dir.clear();
+    } else if (arg == "--metrics-listen" && has_value) {
+      options.metrics_listen = argv[++i];
+    } else {
+      options.server.clear();
+      break;
+    }
+  }
+  if (options.server.empty()) {
+    std::fprintf(stderr,
+                 "usage: %s --server host:port [--worker-id name] [--batch 4] [--output dir] "
+                 "[--poll-seconds 30] [--checkpoints dir | --no-checkpoints] "
+                 "[--index-cache dir] [--lowres-height 720] [--decode-only] [--gpus 0,1] "
+                 "[--tasks-per-gpu 2] [--task-vram-mb 0] [--pause-for name,...] "
+                 "[--pause-file path] [--no-governor] [--trace-dir dir | --no-trace] "
+                 "[--metrics-listen host:port]\n",
+                 argv[0]);
+    return 2;
+  }
+
+  std::signal(SIGINT, on_signal);
+  std::signal(SIGTERM, on_signal);
+
+  try {
+    auto [host, port] = http::parse_endpoint(options.server);
+    if (options.worker_id.empty()) {
+      options.worker_id = default_worker_id();
+    }
+    TaskClient client(host, port, options.worker_id);
+    LeaseKeeper leases(host, port, options.worker_id);
+    std::optional<DetectorConfig> detector;
+    if (!options.decode_only) {
+      detector.emplace();
+    }
+    HeavyProcessConfig config;
+    config.checkpoint.dir = options.checkpoints;
+    config.decoder.io.index_cache_dir = options.index_cache;
+    config.transcode.height = options.lowres_height;
+    config.gate = std::make_shared<PipelineGate>();
+    if (options.trace_dir.empty()) {
+      config.trace_events = 0;
+    }
+    std::optional<MetricsEndpoint> metrics;
+    if (!options.metrics_listen.empty()) {
+      metrics.emplace(options.metrics_listen);
+    }
+    SchedulerConfig scheduling;
+    scheduling.devices = options.gpus;
+    scheduling.tasks_per_device = options.tasks_per_gpu;
+    scheduling.task_vram_cap = options.task_vram_mb << 20;
+    TaskScheduler scheduler(scheduling, config, detector);
+    std::optional<ActivityGovernor> governor;
+    if (options.governor) {
+      GovernorConfig governing;
+      governing.probe.watch = options.pause_for;
+      governing.probe.pause_file = options.pause_file;
+      for (const DeviceLoad& load : scheduler.loads()) {
+        governing.probe.gpus.push_back(load.device);
+      }
+      governor.emplace(governing, config.gate);
+    }
+    // A batch keeps every seat busy, with the rest queued behind them.
+    std::size_t batch = std::max(options.batch, scheduler.capacity());
+    const std::vector<std::string> types{std::string(kHeavyProcessVideo)};
+
+    while (!g_stop) {
+      // Nothing new is taken on while the machine is in use.
+      if (!config.gate->wait_running(std::chrono::milliseconds(200))) {
+        continue;
+      }
+      std::vector<Task> tasks;
+      try {
+        tasks = client.pull(types, batch, kPullWait);
+      } catch (const std::runtime_error& e) {
+        // Only a failed pull backs off; an empty one already waited.
+        std::fprintf(stderr, "pull failed: %s\n", e.what());
+        sleep_unless_stopped(std::chrono::seconds(options.poll_seconds));
+        continue;
+      }
+      if (tasks.empty()) {
+        continue;
+      }
+      leases.set_lease_ttl(client.lease_ttl());
+      for (const Task& task : tasks) {
+        leases.hold(task.task_id);
+      }
+
+      // Longest first, so the short ones fill in around them at the end of
+      // the batch instead of one long video running on after the rest.
+      std::vector<std::pair<double, const Task*>> order;
+      for (const Task& task : tasks) {
+        const TaskInput* video = video_input(task);
+        double frames = video != nullptr
+                            ? scheduler.estimate_frames(video->path, find_shard(task.params))
+                            : 0.0;
+        if (const TaskInput* rear = find_input(task.inputs, kRearVideoInput)) {
+          frames += scheduler.estimate_frames(rear->path, std::nullopt);
+        }
+        order.emplace_back(frames, &task);
+      }
+      std::stable_sort(order.begin(), order.end(),
+                       [](const auto& a, const auto& b) { return a.first > b.first; });
+
+      std::vector<std::thread> running;
+      for (std::size_t i = 0; i < order.size(); ++i) {
+        const Task& task = *order[i].second;
+        // On shutdown, tasks not started yet are handed back as their
+        // leases are released.
+        std::optional<TaskPlacement> placement;
+        if (!g_stop) {
+          placement = scheduler.acquire(std::max(1.0, order[i].first), g_stop);
+        }
+        if (!placement) {
+          leases.release(task.task_id);
+          continue;
+        }
+        // With a single seat, the next video in the batch is opened and read
+        // ahead while this one runs, so its decode does not start by waiting
+        // on the NAS. With several, other tasks' reads already overlap.
+        const Task* next = nullptr;
+        if (scheduler.capacity() == 1 && i + 1 < order.size()) {
+          next = order[i + 1].second;
+        }
+        running.emplace_back([&, placement = *placement, next] {
+          static Gauge& tasks_running = default_metrics().gauge(
+              "dashcam_worker_tasks_running", "Heavy-processing tasks running now.");
+          static Histogram& task_seconds = default_metrics().histogram(
+              "dashcam_worker_task_seconds", "Time per heavy-processing task, end to end.");
+          TaskOutcome outcome;
+          HeavyResult result;
+          const char* status = "failed";
+          bool failed = false;
+          tasks_running.add(1);
+          auto start = std::chrono::steady_clock::now();
+          try {
+            if (next != nullptr) {
+              if (const TaskInput* video = video_input(*next)) {
+                placement.processor->prefetch(video->path, find_shard(next->params));
+              }
+            }
+            // TaskClient is single-threaded; completions get their own.
+            TaskClient completer(host, port, options.worker_id);
+            status = run_task(options, *placement.processor, completer, task, result)
+                         ? "completed"
+                         : "not_completed";
+            outcome.result = &result;
+          } catch (const std::exception& e) {
+            outcome.out_of_memory = is_out_of_memory(e);
+            failed = true;
+            std::fprintf(stderr, "task %lld failed on gpu %d: %s\n",
+                         static_cast<long long>(task.task_id), placement.device, e.what());
+          }
+          // Running out of memory says more about the seat than the video,
+          // and the scheduler adapts; a task cut short by shutdown did not
+          // fail. Either may be pulled again at once.
+          if (failed && !outcome.out_of_memory && !g_stop) {
+            try {
+              TaskClient(host, port, options.worker_id).fail({&task.task_id, 1});
+            } catch (const std::exception& e) {
+              std::fprintf(stderr, "reporting task %lld failed: %s\n",
+                           static_cast<long long>(task.task_id), e.what());
+            }
+          }
+          tasks_running.add(-1);
+          task_seconds.observe(
+              std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+          default_metrics()
+              .counter("dashcam_worker_tasks_total", "Heavy-processing tasks run, by outcome.",
+                       {{"status", status}})
+              .add();
+          if (result.trace && !options.trace_dir.empty()) {
+            dump_trace(options.trace_dir, task, *result.trace);
+          }
+          scheduler.release(placement, outcome);
+          leases.release(task.task_id);
+        });
+      }
+      for (std::thread& thread : running) {
+        thread.join();
+      }
+    }
+  } catch (const std::exception& e) {
+    std::fprintf(stderr, "dashcam-worker: %s\n", e.what());
+    return 1;
+  }
+  return 0;
+}
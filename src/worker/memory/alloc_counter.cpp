@@ -0,0 +1,70 @@
+#include "worker/memory/alloc_counter.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+// Replaces the global allocation functions for the whole process. Only the
+// counting is added; the memory still comes from malloc, and the library's
+// nothrow forms forward to these.
+
+namespace dashcam::worker {
+
+namespace {
+
+thread_local std::uint64_t g_allocations = 0;
+
+void* allocate(std::size_t bytes) {
+  ++g_allocations;
+  for (;;) {
+    if (void* p = std::malloc(bytes == 0 ? 1 : bytes)) {
+      return p;
+    }
+    std::new_handler handler = std::get_new_handler();
+    if (handler == nullptr) {
+      throw std::bad_alloc();
+    }
+    handler();
+  }
+}
+
+void* allocate_aligned(std::size_t bytes, std::align_val_t alignment) {
+  ++g_allocations;
+  auto align = static_cast<std::size_t>(alignment);
+  // aligned_alloc wants a multiple of the alignment.
+  std::size_t rounded = (std::max<std::size_t>(bytes, 1) + align - 1) / align * align;
+  for (;;) {
+    if (void* p = std::aligned_alloc(align, rounded)) {
+      return p;
+    }
+    std::new_handler handler = std::get_new_handler();
+    if (handler == nullptr) {
+      throw std::bad_alloc();
+    }
+    handler();
+  }
+}
+
+}  // namespace
+
+std::uint64_t thread_allocations() { return g_allocations; }
+
+}  // namespace dashcam::worker
+
+void* operator new(std::size_t bytes) { return dashcam::worker::allocate(bytes); }
+void* operator new[](std::size_t bytes) { return dashcam::worker::allocate(bytes); }
+void* operator new(std::size_t bytes, std::align_val_t alignment) {
+  return dashcam::worker::allocate_aligned(bytes, alignment);
+}
+void* operator new[](std::size_t bytes, std::align_val_t alignment) {
+  return dashcam::worker::allocate_aligned(bytes, alignment);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
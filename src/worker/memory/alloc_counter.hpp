@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstdint>
+
+namespace dashcam::worker {
+
+// Heap allocations made by the calling thread so far: every global
+// operator new in the process is counted per thread (a thread-local add,
+// no locking). Pipeline stages take the difference around each call, so a
+// change that puts the allocator back on a per-frame path shows up in
+// their allocation counts.
+std::uint64_t thread_allocations();
+
+}  // namespace dashcam::worker
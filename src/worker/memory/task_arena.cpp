@@ -0,0 +1,100 @@
+#include "worker/memory/task_arena.hpp"
+
+#include <algorithm>
+#include <new>
+#include <utility>
+
+namespace dashcam::worker {
+
+namespace {
+
+// First arena chunk of each kind; later ones grow geometrically.
+constexpr std::size_t kFrameChunk = std::size_t{1} << 20;
+constexpr std::size_t kCropChunk = std::size_t{4} << 20;
+
+// Mapped host chunks are page aligned with CUDA and 64-byte aligned without.
+constexpr std::size_t kPinnedAlignment = 64;
+
+std::pmr::pool_options pool_options(std::size_t largest_block) {
+  std::pmr::pool_options options;
+  options.largest_required_pool_block = largest_block;
+  return options;
+}
+
+}  // namespace
+
+std::size_t PinnedChunkResource::held_bytes() const {
+  std::lock_guard lock(mutex_);
+  return held_;
+}
+
+void* PinnedChunkResource::do_allocate(std::size_t bytes, std::size_t alignment) {
+  if (alignment > kPinnedAlignment) {
+    throw std::bad_alloc();
+  }
+  std::lock_guard lock(mutex_);
+  // A cached chunk is reused when it is not more than twice the size asked.
+  auto fit = free_.lower_bound(bytes);
+  GpuBuffer chunk;
+  if (fit != free_.end() && fit->first <= 2 * std::max<std::size_t>(bytes, 1)) {
+    chunk = std::move(fit->second);
+    free_.erase(fit);
+  } else {
+    chunk = GpuBuffer(std::max<std::size_t>(bytes, 1), MemoryKind::MappedHost);
+    held_ += chunk.size();
+  }
+  void* p = chunk.host_ptr();
+  in_use_.emplace(p, std::move(chunk));
+  return p;
+}
+
+void PinnedChunkResource::do_deallocate(void* p, std::size_t, std::size_t) {
+  std::lock_guard lock(mutex_);
+  auto it = in_use_.find(p);
+  if (it != in_use_.end()) {
+    std::size_t size = it->second.size();
+    free_.emplace(size, std::move(it->second));
+    in_use_.erase(it);
+  }
+}
+
+void* CountingResource::do_allocate(std::size_t bytes, std::size_t alignment) {
+  void* p = upstream_->allocate(bytes, alignment);
+  bytes_ += bytes;
+  peak_ = std::max(peak_, bytes_);
+  return p;
+}
+
+void CountingResource::do_deallocate(void* p, std::size_t bytes, std::size_t alignment) {
+  upstream_->deallocate(p, bytes, alignment);
+  bytes_ -= std::min(bytes_, bytes);
+}
+
+TaskArena::TaskArena()
+    : frame_heap_(std::pmr::new_delete_resource()),
+      frame_arena_(kFrameChunk, &frame_heap_),
+      // Detection and proposal lists stay well under this; larger blocks go
+      // to the arena directly and stay there until reset.
+      frame_pool_(pool_options(std::size_t{64} << 10), &frame_arena_),
+      crop_arena_(kCropChunk, &crop_pinned_),
+      // A 4K plate crop with padding is under 256 KiB.
+      crop_pool_(pool_options(std::size_t{256} << 10), &crop_arena_) {}
+
+ArenaStats TaskArena::stats() const {
+  ArenaStats stats;
+  stats.frame_bytes = frame_heap_.peak_bytes();
+  stats.crop_bytes = crop_pinned_.held_bytes();
+  return stats;
+}
+
+void TaskArena::reset() {
+  // Pools first: their chunks came from the arenas, which only then give
+  // theirs back upstream.
+  frame_pool_.release();
+  frame_arena_.release();
+  frame_heap_.reset_peak();
+  crop_pool_.release();
+  crop_arena_.release();
+}
+
+}  // namespace dashcam::worker
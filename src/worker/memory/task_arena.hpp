@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <memory_resource>
+#include <mutex>
+
+#include "worker/gpu/gpu_buffer.hpp"
+
+namespace dashcam::worker {
+
+// Mapped pinned host memory handed out in whole GpuBuffer chunks. Freed
+// chunks are kept and handed out again for requests they fit, so a
+// resource reused across tasks pins its memory once; all of it is
+// released when the resource is destroyed. Thread-safe.
+class PinnedChunkResource : public std::pmr::memory_resource {
+ public:
+  std::size_t held_bytes() const;
+
+ private:
+  void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+  void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override;
+  bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+    return this == &other;
+  }
+
+  mutable std::mutex mutex_;
+  std::map<void*, GpuBuffer> in_use_;
+  std::multimap<std::size_t, GpuBuffer> free_;  // by size
+  std::size_t held_ = 0;
+};
+
+// Counts the bytes held from `upstream`, for ArenaStats. Not thread-safe;
+// used below a synchronized pool, which serializes its upstream calls.
+class CountingResource : public std::pmr::memory_resource {
+ public:
+  explicit CountingResource(std::pmr::memory_resource* upstream) : upstream_(upstream) {}
+
+  std::size_t bytes() const { return bytes_; }
+  std::size_t peak_bytes() const { return peak_; }
+  void reset_peak() { peak_ = bytes_; }
+
+ private:
+  void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+  void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override;
+  bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+    return this == &other;
+  }
+
+  std::pmr::memory_resource* upstream_;
+  std::size_t bytes_ = 0;
+  std::size_t peak_ = 0;
+};
+
+struct ArenaStats {
+  std::size_t frame_bytes = 0;  // heap reserved for per-frame objects, at the most
+  std::size_t crop_bytes = 0;   // pinned host memory held for crops
+};
+
+// Memory for the short-lived objects of one heavy-processing task: the
+// proposals and detections every frame carries (§3.1 to §3.2) and the
+// plate crops cut for OCR and archiving (§3.3).
+//
+// Each kind is a pool over a monotonic arena: the arena takes large chunks
+// from upstream and never frees them piecemeal, the pool recycles blocks
+// as frames retire, so the stage threads share a few chunks rather than
+// going to the general heap per detection; the pool keeps per-thread free
+// lists, so they rarely contend either. Crop chunks are mapped pinned
+// memory, so the GPU copies crops into them directly.
+//
+// reset() hands everything back in one step once the task is done; no
+// object allocated from the arena may outlive it.
+class TaskArena {
+ public:
+  TaskArena();
+
+  TaskArena(const TaskArena&) = delete;
+  TaskArena& operator=(const TaskArena&) = delete;
+
+  std::pmr::memory_resource* frames() { return &frame_pool_; }
+  std::pmr::memory_resource* crops() { return &crop_pool_; }
+
+  // Stats of the task since the last reset.
+  ArenaStats stats() const;
+
+  void reset();
+
+ private:
+  CountingResource frame_heap_;
+  std::pmr::monotonic_buffer_resource frame_arena_;
+  std::pmr::synchronized_pool_resource frame_pool_;
+  PinnedChunkResource crop_pinned_;
+  std::pmr::monotonic_buffer_resource crop_arena_;
+  std::pmr::synchronized_pool_resource crop_pool_;
+};
+
+}  // namespace dashcam::worker
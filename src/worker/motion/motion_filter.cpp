@@ -0,0 +1,157 @@
+#include "worker/motion/motion_filter.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace dashcam::worker {
+
+MotionMetrics to_metrics(const MotionSums& sums, bool has_prev) {
+  MotionMetrics m;
+  if (sums.pixels == 0) {
+    return m;
+  }
+  double pixels = static_cast<double>(sums.pixels);
+  if (has_prev) {
+    m.mean_abs_diff = static_cast<double>(sums.abs_diff) / pixels;
+    m.changed_fraction = static_cast<double>(sums.changed) / pixels;
+  }
+  m.brightness = static_cast<double>(sums.luma) / pixels;
+  m.dark_fraction = static_cast<double>(sums.dark) / pixels;
+  m.bright_fraction = static_cast<double>(sums.bright) / pixels;
+  if (sums.gradient_terms > 0) {
+    m.sharpness = static_cast<double>(sums.gradient) / static_cast<double>(sums.gradient_terms);
+  }
+  return m;
+}
+
+MotionFilter::MotionFilter(MotionConfig config)
+    : config_(config), kernel_(select_motion_kernel()) {
+  if (config_.min_changed_fraction <= 0.0 || config_.max_gap_frames < 1) {
+    throw std::invalid_argument("MotionConfig: thresholds must be positive");
+  }
+}
+
+MotionResult MotionFilter::evaluate(const FramePtr& frame, std::pmr::vector<Box>* proposals) {
+  PlaneView cur = frame->lowres_host();
+  PlaneView prev;
+  if (prev_) {
+    prev = prev_->lowres_host();
+    if (prev.width != cur.width || prev.height != cur.height) {
+      throw std::runtime_error("MotionFilter: low-res plane size changed mid-video");
+    }
+  }
+
+  MotionSums sums;
+  kernel_.fn(cur, prev_ ? &prev : nullptr, config_.thresholds, sums);
+
+  MotionResult result;
+  result.metrics = to_metrics(sums, prev_ != nullptr);
+  result.score = result.metrics.changed_fraction / config_.min_changed_fraction;
+
+  ++since_kept_;
+  if (result.metrics.brightness < config_.min_brightness) {
+    result.keep = false;
+  } else if (!prev_ || result.score >= 1.0 || since_kept_ >= config_.max_gap_frames) {
+    result.keep = true;
+  }
+  if (result.keep) {
+    since_kept_ = 0;
+  }
+  if (proposals != nullptr) {
+    proposals->clear();
+    if (result.keep && prev_ && config_.proposal_cell > 0) {
+      propose(*frame, cur, prev, *proposals);
+    }
+  }
+
+  prev_ = frame;
+  return result;
+}
+
+void MotionFilter::propose(const FrameSurface& frame, const PlaneView& cur,
+                           const PlaneView& prev, std::pmr::vector<Box>& out) {
+  const int cell = config_.proposal_cell;
+  const int cols = (cur.width + cell - 1) / cell;
+  const int rows = (cur.height + cell - 1) / cell;
+  const auto cells = static_cast<std::size_t>(cols) * static_cast<std::size_t>(rows);
+  cell_changed_.assign(cells, 0);
+  for (int y = 0; y < cur.height; ++y) {
+    const std::uint8_t* a = cur.row(y);
+    const std::uint8_t* b = prev.row(y);
+    std::uint32_t* counts = cell_changed_.data() + static_cast<std::size_t>(y / cell) * cols;
+    for (int x = 0; x < cur.width; ++x) {
+      int d = a[x] > b[x] ? a[x] - b[x] : b[x] - a[x];
+      counts[x / cell] += d > config_.thresholds.diff ? 1 : 0;
+    }
+  }
+
+  // A cell is active when enough of its pixels (edge cells are smaller)
+  // changed.
+  std::size_t active = 0;
+  cell_label_.assign(cells, -1);
+  for (int r = 0; r < rows; ++r) {
+    int h = std::min(cell, cur.height - r * cell);
+    for (int c = 0; c < cols; ++c) {
+      int w = std::min(cell, cur.width - c * cell);
+      std::size_t i = static_cast<std::size_t>(r) * cols + c;
+      if (cell_changed_[i] >= config_.proposal_cell_fraction * w * h) {
+        cell_label_[i] = 0;
+        ++active;
+      }
+    }
+  }
+  if (active == 0 ||
+      static_cast<double>(active) > config_.max_proposal_cells * static_cast<double>(cells)) {
+    return;
+  }
+
+  // Each 4-connected group of active cells is one region.
+  const FrameGeometry& g = frame.geometry();
+  const float sx = static_cast<float>(g.width) / static_cast<float>(cur.width);
+  const float sy = static_cast<float>(g.height) / static_cast<float>(cur.height);
+  regions_.clear();
+  int label = 0;
+  for (std::size_t seed = 0; seed < cells; ++seed) {
+    if (cell_label_[seed] != 0) {
+      continue;
+    }
+    ++label;
+    int c0 = cols, r0 = rows, c1 = -1, r1 = -1;
+    stack_.assign(1, static_cast<int>(seed));
+    cell_label_[seed] = label;
+    while (!stack_.empty()) {
+      int i = stack_.back();
+      stack_.pop_back();
+      int r = i / cols;
+      int c = i % cols;
+      c0 = std::min(c0, c);
+      c1 = std::max(c1, c);
+      r0 = std::min(r0, r);
+      r1 = std::max(r1, r);
+      const int neighbours[4][2] = {{r - 1, c}, {r + 1, c}, {r, c - 1}, {r, c + 1}};
+      for (const auto& [nr, nc] : neighbours) {
+        if (nr < 0 || nr >= rows || nc < 0 || nc >= cols) {
+          continue;
+        }
+        int n = nr * cols + nc;
+        if (cell_label_[static_cast<std::size_t>(n)] == 0) {
+          cell_label_[static_cast<std::size_t>(n)] = label;
+          stack_.push_back(n);
+        }
+      }
+    }
+    regions_.push_back({static_cast<float>(c0 * cell) * sx, static_cast<float>(r0 * cell) * sy,
+                        static_cast<float>(std::min((c1 + 1) * cell, cur.width)) * sx,
+                        static_cast<float>(std::min((r1 + 1) * cell, cur.height)) * sy});
+  }
+
+  if (regions_.size() > static_cast<std::size_t>(config_.max_proposals)) {
+    std::partial_sort(regions_.begin(), regions_.begin() + config_.max_proposals, regions_.end(),
+                      [](const Box& a, const Box& b) { return a.area() > b.area(); });
+    regions_.resize(static_cast<std::size_t>(config_.max_proposals));
+  }
+  out.assign(regions_.begin(), regions_.end());
+}
+
+}  // namespace dashcam::worker
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+#include "worker/decode/frame_surface.hpp"
+#include "worker/inference/detection.hpp"
+#include "worker/motion/motion_kernel.hpp"
+
+namespace dashcam::worker {
+
+struct MotionConfig {
+  MotionThresholds thresholds;
+  // Keep a frame when at least this fraction of its pixels changed.
+  double min_changed_fraction = 0.01;
+  // Keep one frame every this many even in a static scene, so parked-car
+  // footage still gets sampled.
+  int max_gap_frames = 15;
+  // Frames darker than this mean luma (lens cap, tunnel blackout) are
+  // dropped regardless of motion.
+  double min_brightness = 4.0;
+
+  // Coarse region proposals for §3.2: kept frames are split into cells of
+  // this many low-res pixels a side, and connected cells where at least
+  // `proposal_cell_fraction` of the pixels changed become one box each.
+  // 0 disables proposals.
+  int proposal_cell = 32;
+  double proposal_cell_fraction = 0.05;
+  // Ego-motion changes most of the frame; past this fraction of changed
+  // cells the proposals would cover everything, so none are made and the
+  // vehicle boxes alone guide the plate search.
+  double max_proposal_cells = 0.4;
+  int max_proposals = 8;  // the largest regions, when there are more
+};
+
+// Per-frame heuristics from workhorse.md §3.1, also used by §3.6 best-crop
+// selection. All derived from the low-res luma plane.
+struct MotionMetrics {
+  double mean_abs_diff = 0;     // vs. the previous decoded frame
+  double changed_fraction = 0;
+  double brightness = 0;        // mean luma, 0..255
+  double dark_fraction = 0;
+  double bright_fraction = 0;
+  double sharpness = 0;         // mean |gradient|; low means blurred
+};
+
+struct MotionResult {
+  bool keep = false;
+  double score = 0;  // changed_fraction relative to the keep threshold
+  MotionMetrics metrics;
+};
+
+MotionMetrics to_metrics(const MotionSums& sums, bool has_prev);
+
+// Stateful filter over one video's frames, fed in decode order. Holds on to
+// the previous frame's surface rather than copying its plane.
+class MotionFilter {
+ public:
+  explicit MotionFilter(MotionConfig config = {});
+
+  // With `proposals`, the coarse regions of a kept frame that changed
+  // (MotionConfig::proposal_cell), in full-resolution pixels, replace its
+  // contents.
+  MotionResult evaluate(const FramePtr& frame, std::pmr::vector<Box>* proposals = nullptr);
+
+  const char* kernel_name() const { return kernel_.name; }
+
+ private:
+  MotionConfig config_;
+  MotionKernel kernel_;
+  void propose(const FrameSurface& frame, const PlaneView& cur, const PlaneView& prev,
+               std::pmr::vector<Box>& out);
+
+  FramePtr prev_;
+  std::int64_t since_kept_ = 0;
+  // propose() scratch, reused across frames.
+  std::vector<std::uint32_t> cell_changed_;
+  std::vector<int> cell_label_;
+  std::vector<int> stack_;
+  std::vector<Box> regions_;
+};
+
+}  // namespace dashcam::worker
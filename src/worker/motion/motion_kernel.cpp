@@ -0,0 +1,40 @@
+#include "worker/motion/motion_kernel.hpp"
+
+#include <cstdlib>
+#include <string_view>
+
+#include "common/cpu_features.hpp"
+
+namespace dashcam::worker {
+
+void motion_kernel_scalar(const PlaneView& cur, const PlaneView* prev,
+                          const MotionThresholds& thresholds, MotionSums& out) {
+  for (int y = 0; y < cur.height; ++y) {
+    const std::uint8_t* row = cur.row(y);
+    const std::uint8_t* below = y + 1 < cur.height ? cur.row(y + 1) : nullptr;
+    const std::uint8_t* before = prev != nullptr ? prev->row(y) : nullptr;
+    for (int x = 0; x < cur.width; ++x) {
+      detail::motion_pixel(row, below, before, x, cur.width, thresholds, out);
+    }
+  }
+  out.pixels += static_cast<std::uint64_t>(cur.width) * static_cast<std::uint64_t>(cur.height);
+}
+
+MotionKernel select_motion_kernel() {
+  std::string_view forced;
+  if (const char* env = std::getenv("DASHCAM_SIMD")) {
+    forced = env;
+  }
+#if DASHCAM_HAVE_X86_SIMD
+  const CpuFeatures& cpu = cpu_features();
+  if (cpu.avx512bw && (forced.empty() || forced == "avx512")) {
+    return {"avx512", &motion_kernel_avx512};
+  }
+  if (cpu.avx2 && (forced.empty() || forced == "avx512" || forced == "avx2")) {
+    return {"avx2", &motion_kernel_avx2};
+  }
+#endif
+  return {"scalar", &motion_kernel_scalar};
+}
+
+}  // namespace dashcam::worker
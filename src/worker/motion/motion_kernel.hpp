@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+
+#include "worker/decode/frame_surface.hpp"
+
+namespace dashcam::worker {
+
+struct MotionThresholds {
+  int diff = 12;    // |cur - prev| above this counts as a changed pixel
+  int dark = 24;    // luma below this is underexposed
+  int bright = 232; // luma above this is overexposed
+};
+
+// Integer sums over one low-res luma plane. Every kernel variant produces the
+// exact same sums, so results never depend on the machine a task ran on.
+struct MotionSums {
+  std::uint64_t pixels = 0;
+  std::uint64_t abs_diff = 0;   // sum |cur - prev|
+  std::uint64_t changed = 0;    // pixels with |cur - prev| > diff
+  std::uint64_t luma = 0;       // sum cur
+  std::uint64_t dark = 0;
+  std::uint64_t bright = 0;
+  std::uint64_t gradient = 0;   // sum |dx| + |dy| (sharpness)
+  std::uint64_t gradient_terms = 0;
+};
+
+// Single pass over `cur` (and `prev`, which may be null for the first frame
+// of a video). Both are CPU-side views of the same size; each is read once,
+// in place.
+using MotionKernelFn = void (*)(const PlaneView& cur, const PlaneView* prev,
+                                const MotionThresholds& thresholds, MotionSums& out);
+
+void motion_kernel_scalar(const PlaneView& cur, const PlaneView* prev,
+                          const MotionThresholds& thresholds, MotionSums& out);
+#if DASHCAM_HAVE_X86_SIMD
+void motion_kernel_avx2(const PlaneView& cur, const PlaneView* prev,
+                        const MotionThresholds& thresholds, MotionSums& out);
+void motion_kernel_avx512(const PlaneView& cur, const PlaneView* prev,
+                          const MotionThresholds& thresholds, MotionSums& out);
+#endif
+
+struct MotionKernel {
+  const char* name;
+  MotionKernelFn fn;
+};
+
+// Widest variant this CPU supports. DASHCAM_SIMD=scalar|avx2|avx512 in the
+// environment forces a narrower one (for A/B runs and benchmarks).
+MotionKernel select_motion_kernel();
+
+namespace detail {
+
+// Per-pixel tail shared by all variants, for columns the vector body skips.
+inline void motion_pixel(const std::uint8_t* cur, const std::uint8_t* below,
+                         const std::uint8_t* prev, int x, int width,
+                         const MotionThresholds& t, MotionSums& out) {
+  int p = cur[x];
+  out.luma += static_cast<std::uint64_t>(p);
+  out.dark += p < t.dark ? 1 : 0;
+  out.bright += p > t.bright ? 1 : 0;
+  if (prev != nullptr) {
+    int d = p > prev[x] ? p - prev[x] : prev[x] - p;
+    out.abs_diff += static_cast<std::uint64_t>(d);
+    out.changed += d > t.diff ? 1 : 0;
+  }
+  if (x + 1 < width) {
+    int dx = p > cur[x + 1] ? p - cur[x + 1] : cur[x + 1] - p;
+    out.gradient += static_cast<std::uint64_t>(dx);
+    ++out.gradient_terms;
+  }
+  if (below != nullptr) {
+    int dy = p > below[x] ? p - below[x] : below[x] - p;
+    out.gradient += static_cast<std::uint64_t>(dy);
+    ++out.gradient_terms;
+  }
+}
+
+}  // namespace detail
+
+}  // namespace dashcam::worker
@@ -0,0 +1,87 @@
+// Compiled with AVX2 enabled; only called after select_motion_kernel() has
+// checked the CPU.
+
+#include <immintrin.h>
+
+#include <bit>
+
+#include "worker/motion/motion_kernel.hpp"
+
+namespace dashcam::worker {
+
+namespace {
+
+inline std::uint64_t hsum_epi64(__m256i v) {
+  __m128i lo = _mm256_castsi256_si128(v);
+  __m128i hi = _mm256_extracti128_si256(v, 1);
+  __m128i sum = _mm_add_epi64(lo, hi);
+  return static_cast<std::uint64_t>(_mm_cvtsi128_si64(sum)) +
+         static_cast<std::uint64_t>(_mm_extract_epi64(sum, 1));
+}
+
+// Lanes where `v` is non-zero.
+inline std::uint64_t count_nonzero(__m256i v) {
+  __m256i zero_lanes = _mm256_cmpeq_epi8(v, _mm256_setzero_si256());
+  auto mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(zero_lanes));
+  return 32u - static_cast<std::uint64_t>(std::popcount(mask));
+}
+
+}  // namespace
+
+void motion_kernel_avx2(const PlaneView& cur, const PlaneView* prev,
+                        const MotionThresholds& thresholds, MotionSums& out) {
+  constexpr int kLanes = 32;
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i t_diff = _mm256_set1_epi8(static_cast<char>(thresholds.diff));
+  const __m256i t_dark = _mm256_set1_epi8(static_cast<char>(thresholds.dark));
+  const __m256i t_bright = _mm256_set1_epi8(static_cast<char>(thresholds.bright));
+
+  for (int y = 0; y < cur.height; ++y) {
+    const std::uint8_t* row = cur.row(y);
+    const std::uint8_t* below = y + 1 < cur.height ? cur.row(y + 1) : nullptr;
+    const std::uint8_t* before = prev != nullptr ? prev->row(y) : nullptr;
+
+    __m256i luma = zero;
+    __m256i sad = zero;
+    __m256i gradient = zero;
+    std::uint64_t changed = 0;
+    std::uint64_t dark = 0;
+    std::uint64_t bright = 0;
+
+    // The body needs x + 32 in bounds for the horizontal gradient.
+    int x = 0;
+    for (; x + kLanes < cur.width; x += kLanes) {
+      __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + x));
+      luma = _mm256_add_epi64(luma, _mm256_sad_epu8(v, zero));
+      dark += count_nonzero(_mm256_subs_epu8(t_dark, v));
+      bright += count_nonzero(_mm256_subs_epu8(v, t_bright));
+
+      __m256i right = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + x + 1));
+      gradient = _mm256_add_epi64(gradient, _mm256_sad_epu8(v, right));
+      if (below != nullptr) {
+        __m256i down = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(below + x));
+        gradient = _mm256_add_epi64(gradient, _mm256_sad_epu8(v, down));
+      }
+      if (before != nullptr) {
+        __m256i p = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(before + x));
+        sad = _mm256_add_epi64(sad, _mm256_sad_epu8(v, p));
+        __m256i diff = _mm256_or_si256(_mm256_subs_epu8(v, p), _mm256_subs_epu8(p, v));
+        changed += count_nonzero(_mm256_subs_epu8(diff, t_diff));
+      }
+    }
+
+    out.luma += hsum_epi64(luma);
+    out.abs_diff += hsum_epi64(sad);
+    out.gradient += hsum_epi64(gradient);
+    out.gradient_terms += static_cast<std::uint64_t>(x) * (below != nullptr ? 2u : 1u);
+    out.changed += changed;
+    out.dark += dark;
+    out.bright += bright;
+    for (; x < cur.width; ++x) {
+      detail::motion_pixel(row, below, before, x, cur.width, thresholds, out);
+    }
+  }
+  out.pixels += static_cast<std::uint64_t>(cur.width) * static_cast<std::uint64_t>(cur.height);
+}
+
+}  // namespace dashcam::worker
@@ -0,0 +1,74 @@
+// Compiled with AVX-512F/BW enabled; only called after select_motion_kernel()
+// has checked the CPU.
+
+#include <immintrin.h>
+
+#include <bit>
+
+#include "worker/motion/motion_kernel.hpp"
+
+namespace dashcam::worker {
+
+namespace {
+
+inline std::uint64_t count_nonzero(__m512i v) {
+  return static_cast<std::uint64_t>(std::popcount(_mm512_test_epi8_mask(v, v)));
+}
+
+}  // namespace
+
+void motion_kernel_avx512(const PlaneView& cur, const PlaneView* prev,
+                          const MotionThresholds& thresholds, MotionSums& out) {
+  constexpr int kLanes = 64;
+  const __m512i zero = _mm512_setzero_si512();
+  const __m512i t_diff = _mm512_set1_epi8(static_cast<char>(thresholds.diff));
+  const __m512i t_dark = _mm512_set1_epi8(static_cast<char>(thresholds.dark));
+  const __m512i t_bright = _mm512_set1_epi8(static_cast<char>(thresholds.bright));
+
+  for (int y = 0; y < cur.height; ++y) {
+    const std::uint8_t* row = cur.row(y);
+    const std::uint8_t* below = y + 1 < cur.height ? cur.row(y + 1) : nullptr;
+    const std::uint8_t* before = prev != nullptr ? prev->row(y) : nullptr;
+
+    __m512i luma = zero;
+    __m512i sad = zero;
+    __m512i gradient = zero;
+    std::uint64_t changed = 0;
+    std::uint64_t dark = 0;
+    std::uint64_t bright = 0;
+
+    int x = 0;
+    for (; x + kLanes < cur.width; x += kLanes) {
+      __m512i v = _mm512_loadu_si512(row + x);
+      luma = _mm512_add_epi64(luma, _mm512_sad_epu8(v, zero));
+      dark += count_nonzero(_mm512_subs_epu8(t_dark, v));
+      bright += count_nonzero(_mm512_subs_epu8(v, t_bright));
+
+      __m512i right = _mm512_loadu_si512(row + x + 1);
+      gradient = _mm512_add_epi64(gradient, _mm512_sad_epu8(v, right));
+      if (below != nullptr) {
+        gradient = _mm512_add_epi64(gradient, _mm512_sad_epu8(v, _mm512_loadu_si512(below + x)));
+      }
+      if (before != nullptr) {
+        __m512i p = _mm512_loadu_si512(before + x);
+        sad = _mm512_add_epi64(sad, _mm512_sad_epu8(v, p));
+        __m512i diff = _mm512_or_si512(_mm512_subs_epu8(v, p), _mm512_subs_epu8(p, v));
+        changed += count_nonzero(_mm512_subs_epu8(diff, t_diff));
+      }
+    }
+
+    out.luma += static_cast<std::uint64_t>(_mm512_reduce_add_epi64(luma));
+    out.abs_diff += static_cast<std::uint64_t>(_mm512_reduce_add_epi64(sad));
+    out.gradient += static_cast<std::uint64_t>(_mm512_reduce_add_epi64(gradient));
+    out.gradient_terms += static_cast<std::uint64_t>(x) * (below != nullptr ? 2u : 1u);
+    out.changed += changed;
+    out.dark += dark;
+    out.bright += bright;
+    for (; x < cur.width; ++x) {
+      detail::motion_pixel(row, below, before, x, cur.width, thresholds, out);
+    }
+  }
+  out.pixels += static_cast<std::uint64_t>(cur.width) * static_cast<std::uint64_t>(cur.height);
+}
+
+}  // namespace dashcam::worker
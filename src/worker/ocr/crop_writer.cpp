@@ -0,0 +1,140 @@
+#include "worker/ocr/crop_writer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "common/metrics.hpp"
+#include "common/trace.hpp"
+#include "worker/gpu/device_info.hpp"
+
+namespace dashcam::worker {
+
+CropWriter::CropWriter(CropWriterConfig config, JpegEncoder& encoder, int gpu_device)
+    : config_(config), encoder_(encoder), gpu_device_(gpu_device) {
+  config_.batch = std::max<std::size_t>(1, config_.batch);
+  config_.max_queued = std::max(config_.max_queued, config_.batch);
+  // Encoding belongs to the task that constructed the writer.
+  thread_ = std::thread([this, trace = current_trace()] {
+    bind_trace(trace);
+    if (trace != nullptr) {
+      trace->name_thread("crop_writer");
+    }
+    run();
+  });
+}
+
+CropWriter::~CropWriter() {
+  {
+    std::lock_guard lock(mutex_);
+    closing_ = true;
+  }
+  ready_.notify_all();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void CropWriter::add(PlateCrop crop) {
+  if (crop.pixels.empty()) {
+    return;
+  }
+  std::unique_lock lock(mutex_);
+  space_.wait(lock, [this] { return queue_.size() < config_.max_queued || error_ || closing_; });
+  if (error_ || closing_) {
+    return;  // reported by finish()
+  }
+  queue_.push_back(std::move(crop));
+  if (queue_.size() >= config_.batch) {
+    ready_.notify_one();
+  }
+}
+
+CropPackWriter CropWriter::finish() {
+  {
+    std::lock_guard lock(mutex_);
+    closing_ = true;
+  }
+  ready_.notify_all();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  if (error_) {
+    std::rethrow_exception(error_);
+  }
+  return std::move(pack_);
+}
+
+void CropWriter::run() {
+  std::deque<PlateCrop> batch;
+  while (true) {
+    {
+      std::unique_lock lock(mutex_);
+      ready_.wait(lock, [this] { return queue_.size() >= config_.batch || closing_; });
+      if (queue_.empty()) {
+        return;
+      }
+      std::size_t n = std::min(queue_.size(), config_.batch);
+      std::move(queue_.begin(), queue_.begin() + static_cast<std::ptrdiff_t>(n),
+                std::back_inserter(batch));
+      queue_.erase(queue_.begin(), queue_.begin() + static_cast<std::ptrdiff_t>(n));
+    }
+    space_.notify_all();
+    try {
+      use_device(gpu_device_);
+      encode(batch);
+    } catch (...) {
+      std::lock_guard lock(mutex_);
+      error_ = std::current_exception();
+      queue_.clear();
+      space_.notify_all();
+      return;
+    }
+    batch.clear();
+  }
+}
+
+void CropWriter::encode(std::deque<PlateCrop>& batch) {
+  std::vector<const PlateCrop*> crops;
+  crops.reserve(batch.size());
+  for (const PlateCrop& crop : batch) {
+    crops.push_back(&crop);
+  }
+  static Histogram& batch_seconds = default_metrics().histogram(
+      "dashcam_worker_crop_encode_seconds", "Time per batch of plate crops JPEG-encoded.");
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::vector<std::uint8_t>> jpegs;
+  {
+    ScopedTrace span("crop_encode", "encode", static_cast<std::int64_t>(crops.size()));
+    jpegs = encoder_.encode(crops);
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  stats_.encode_s += seconds;
+  batch_seconds.observe(seconds);
+  ++stats_.batches;
+
+  for (std::size_t i = 0; i < batch.size() && i < jpegs.size(); ++i) {
+    if (jpegs[i].empty()) {
+      continue;
+    }
+    const PlateCrop& crop = batch[i];
+    CropEntry entry;
+    entry.track = crop.track_id;
+    entry.frame = crop.frame_index;
+    entry.x0 = crop.box.x0;
+    entry.y0 = crop.box.y0;
+    entry.x1 = crop.box.x1;
+    entry.y1 = crop.box.y1;
+    entry.score = crop.score;
+    entry.quality = crop.quality;
+    entry.width = crop.width;
+    entry.height = crop.height;
+    pack_.append(entry, jpegs[i]);
+    ++stats_.crops;
+    stats_.bytes += jpegs[i].size();
+  }
+}
+
+}  // namespace dashcam::worker
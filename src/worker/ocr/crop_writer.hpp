@@ -0,0 +1,73 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#include "common/crop_pack.hpp"
+#include "worker/ocr/jpeg_encoder.hpp"
+#include "worker/ocr/plate_crop.hpp"
+
+namespace dashcam::worker {
+
+struct CropWriterConfig {
+  bool enabled = true;
+  int quality = 90;
+  // Crops per encode call; the GPU encoder syncs once per batch.
+  std::size_t batch = 32;
+  // add() blocks once this many crops wait for the encoder, so a slow
+  // encoder holds back tracking rather than growing without bound.
+  std::size_t max_queued = 256;
+};
+
+struct CropStats {
+  std::uint64_t crops = 0;
+  std::uint64_t bytes = 0;    // JPEG bytes in the pack
+  std::uint64_t batches = 0;
+  double encode_s = 0.0;
+};
+
+// Encodes one video's archived plate crops (workhorse.md §3.3) on a
+// background thread, in batches, into an in-memory crop pack. The encoder
+// is borrowed: one per processor, reused across videos, and runs on
+// `gpu_device`.
+class CropWriter {
+ public:
+  CropWriter(CropWriterConfig config, JpegEncoder& encoder, int gpu_device = 0);
+  ~CropWriter();
+
+  CropWriter(const CropWriter&) = delete;
+  CropWriter& operator=(const CropWriter&) = delete;
+
+  void add(PlateCrop crop);
+
+  // Encodes what is still queued and hands over the pack. Rethrows an
+  // encoder failure.
+  CropPackWriter finish();
+
+  const CropStats& stats() const { return stats_; }
+
+ private:
+  void run();
+  void encode(std::deque<PlateCrop>& batch);
+
+  CropWriterConfig config_;
+  JpegEncoder& encoder_;
+  int gpu_device_;
+  CropPackWriter pack_;
+  CropStats stats_;
+
+  std::mutex mutex_;
+  std::condition_variable ready_;
+  std::condition_variable space_;
+  std::deque<PlateCrop> queue_;
+  bool closing_ = false;
+  std::exception_ptr error_;
+  std::thread thread_;
+};
+
+}  // namespace dashcam::worker
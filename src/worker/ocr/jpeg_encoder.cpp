@@ -0,0 +1,215 @@
+#include "worker/ocr/jpeg_encoder.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "worker/gpu/gpu.hpp"
+
+#if DASHCAM_WITH_CUDA
+#include <nvjpeg.h>
+
+#include "worker/gpu/gpu_buffer.hpp"
+#include "worker/gpu/gpu_stream.hpp"
+#elif DASHCAM_HAVE_LIBJPEG
+#include <csetjmp>
+#include <cstdio>
+
+#include <jpeglib.h>
+#endif
+
+namespace dashcam::worker {
+
+namespace {
+
+#if DASHCAM_WITH_CUDA
+
+#define DASHCAM_NVJPEG_CHECK(expr)                                                  \
+  do {                                                                              \
+    nvjpegStatus_t dashcam_nvjpeg_status_ = (expr);                                 \
+    if (dashcam_nvjpeg_status_ != NVJPEG_STATUS_SUCCESS) {                          \
+      throw GpuError(std::string(#expr) + ": nvjpeg status " +                      \
+                     std::to_string(static_cast<int>(dashcam_nvjpeg_status_)));     \
+    }                                                                               \
+  } while (0)
+
+// The batch is staged in pinned host memory and moved to the device in one
+// copy; every crop then gets its own encoder state so all encodes are queued
+// on the stream back to back and the batch syncs once.
+class NvjpegEncoder : public JpegEncoder {
+ public:
+  explicit NvjpegEncoder(int quality) {
+    DASHCAM_NVJPEG_CHECK(nvjpegCreateSimple(&handle_));
+    DASHCAM_NVJPEG_CHECK(nvjpegEncoderParamsCreate(handle_, &params_, stream_.get()));
+    DASHCAM_NVJPEG_CHECK(nvjpegEncoderParamsSetQuality(params_, quality, stream_.get()));
+    DASHCAM_NVJPEG_CHECK(
+        nvjpegEncoderParamsSetSamplingFactors(params_, NVJPEG_CSS_GRAY, stream_.get()));
+    DASHCAM_NVJPEG_CHECK(nvjpegEncoderParamsSetOptimizedHuffman(params_, 0, stream_.get()));
+  }
+
+  ~NvjpegEncoder() override {
+    for (nvjpegEncoderState_t state : states_) {
+      nvjpegEncoderStateDestroy(state);
+    }
+    nvjpegEncoderParamsDestroy(params_);
+    nvjpegDestroy(handle_);
+  }
+
+  std::vector<std::vector<std::uint8_t>> encode(
+      std::span<const PlateCrop* const> crops) override {
+    std::vector<std::vector<std::uint8_t>> out(crops.size());
+    std::vector<std::size_t> offsets(crops.size());
+    std::size_t total = 0;
+    for (std::size_t i = 0; i < crops.size(); ++i) {
+      offsets[i] = total;
+      total += crops[i]->pixels.size();
+    }
+    if (total == 0) {
+      return out;
+    }
+    if (staging_.size() < total) {
+      // Grown geometrically; a video's batches settle on one size quickly.
+      std::size_t bytes = std::max(total, staging_.size() * 2);
+      staging_ = GpuBuffer(bytes, MemoryKind::MappedHost);
+      device_ = GpuBuffer(bytes, MemoryKind::Device);
+    }
+    for (std::size_t i = 0; i < crops.size(); ++i) {
+      std::memcpy(staging_.host_ptr() + offsets[i], crops[i]->pixels.data(),
+                  crops[i]->pixels.size());
+    }
+    DASHCAM_CUDA_CHECK(cudaMemcpyAsync(device_.device_ptr(), staging_.host_ptr(), total,
+                                       cudaMemcpyHostToDevice, stream_.get()));
+
+    while (states_.size() < crops.size()) {
+      nvjpegEncoderState_t state = nullptr;
+      DASHCAM_NVJPEG_CHECK(nvjpegEncoderStateCreate(handle_, &state, stream_.get()));
+      states_.push_back(state);
+    }
+    for (std::size_t i = 0; i < crops.size(); ++i) {
+      const PlateCrop& crop = *crops[i];
+      if (crop.pixels.empty()) {
+        continue;
+      }
+      nvjpegImage_t image{};
+      image.channel[0] = device_.device_ptr() + offsets[i];
+      image.pitch[0] = static_cast<std::size_t>(crop.width);
+      DASHCAM_NVJPEG_CHECK(nvjpegEncodeYUV(handle_, states_[i], params_, &image, NVJPEG_CSS_GRAY,
+                                           crop.width, crop.height, stream_.get()));
+    }
+    stream_.synchronize();
+
+    for (std::size_t i = 0; i < crops.size(); ++i) {
+      if (crops[i]->pixels.empty()) {
+        continue;
+      }
+      std::size_t length = 0;
+      DASHCAM_NVJPEG_CHECK(
+          nvjpegEncodeRetrieveBitstream(handle_, states_[i], nullptr, &length, stream_.get()));
+      out[i].resize(length);
+      DASHCAM_NVJPEG_CHECK(nvjpegEncodeRetrieveBitstream(handle_, states_[i], out[i].data(),
+                                                         &length, stream_.get()));
+      out[i].resize(length);
+    }
+    stream_.synchronize();
+    return out;
+  }
+
+  const char* name() const override { return "nvjpeg"; }
+
+ private:
+  OwnedStream stream_;
+  nvjpegHandle_t handle_ = nullptr;
+  nvjpegEncoderParams_t params_ = nullptr;
+  std::vector<nvjpegEncoderState_t> states_;
+  GpuBuffer staging_;
+  GpuBuffer device_;
+};
+
+#elif DASHCAM_HAVE_LIBJPEG
+
+struct ErrorManager {
+  jpeg_error_mgr base;
+  std::jmp_buf jump;
+  char message[JMSG_LENGTH_MAX];
+};
+
+void on_error(j_common_ptr cinfo) {
+  auto* errors = reinterpret_cast<ErrorManager*>(cinfo->err);
+  (*cinfo->err->format_message)(cinfo, errors->message);
+  std::longjmp(errors->jump, 1);
+}
+
+// CPU fallback for builds without CUDA; one crop at a time.
+class LibjpegEncoder : public JpegEncoder {
+ public:
+  explicit LibjpegEncoder(int quality) : quality_(quality) {}
+
+  std::vector<std::vector<std::uint8_t>> encode(
+      std::span<const PlateCrop* const> crops) override {
+    std::vector<std::vector<std::uint8_t>> out(crops.size());
+    for (std::size_t i = 0; i < crops.size(); ++i) {
+      if (!crops[i]->pixels.empty()) {
+        out[i] = encode_one(*crops[i]);
+      }
+    }
+    return out;
+  }
+
+  const char* name() const override { return "libjpeg"; }
+
+ private:
+  std::vector<std::uint8_t> encode_one(const PlateCrop& crop) const {
+    jpeg_compress_struct cinfo{};
+    ErrorManager errors{};
+    cinfo.err = jpeg_std_error(&errors.base);
+    errors.base.error_exit = on_error;
+    unsigned char* buffer = nullptr;
+    unsigned long length = 0;
+    if (setjmp(errors.jump) != 0) {
+      jpeg_destroy_compress(&cinfo);
+      std::free(buffer);
+      throw std::runtime_error(std::string("jpeg encode failed: ") + errors.message);
+    }
+    jpeg_create_compress(&cinfo);
+    jpeg_mem_dest(&cinfo, &buffer, &length);
+    cinfo.image_width = static_cast<JDIMENSION>(crop.width);
+    cinfo.image_height = static_cast<JDIMENSION>(crop.height);
+    cinfo.input_components = 1;
+    cinfo.in_color_space = JCS_GRAYSCALE;
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, quality_, TRUE);
+    jpeg_start_compress(&cinfo, TRUE);
+    while (cinfo.next_scanline < cinfo.image_height) {
+      auto* row = const_cast<JSAMPLE*>(crop.pixels.data() +
+                                       static_cast<std::size_t>(cinfo.next_scanline) * crop.width);
+      jpeg_write_scanlines(&cinfo, &row, 1);
+    }
+    jpeg_finish_compress(&cinfo);
+    std::vector<std::uint8_t> jpeg(buffer, buffer + length);
+    jpeg_destroy_compress(&cinfo);
+    std::free(buffer);
+    return jpeg;
+  }
+
+  int quality_;
+};
+
+#endif
+
+}  // namespace
+
+std::unique_ptr<JpegEncoder> make_jpeg_encoder(int quality) {
+  quality = std::clamp(quality, 1, 100);
+#if DASHCAM_WITH_CUDA
+  return std::make_unique<NvjpegEncoder>(quality);
+#elif DASHCAM_HAVE_LIBJPEG
+  return std::make_unique<LibjpegEncoder>(quality);
+#else
+  (void)quality;
+  return nullptr;
+#endif
+}
+
+}  // namespace dashcam::worker
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "worker/ocr/plate_crop.hpp"
+
+namespace dashcam::worker {
+
+// Batch JPEG encoder for plate crops (workhorse.md §3.3). One call encodes a
+// batch of grayscale crops and returns one JPEG per crop, in order; an empty
+// crop gets an empty result. Not thread-safe; the crop writer owns one.
+class JpegEncoder {
+ public:
+  virtual ~JpegEncoder() = default;
+  virtual std::vector<std::vector<std::uint8_t>> encode(
+      std::span<const PlateCrop* const> crops) = 0;
+  virtual const char* name() const = 0;
+};
+
+// nvJPEG on CUDA builds, else libjpeg when it was found at configure time;
+// nullptr when neither is available (crops are then not archived).
+// `quality` is the JPEG quality, 1-100.
+std::unique_ptr<JpegEncoder> make_jpeg_encoder(int quality);
+
+}  // namespace dashcam::worker
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <span>
+#include <string>
+#include <vector>
+
+#include "worker/ocr/plate_crop.hpp"
+
+namespace dashcam::worker {
+
+struct OcrRead {
+  std::string text;
+  float confidence = 0.0f;  // 0..1
+};
+
+// GPU OCR backend (workhorse.md §3.4). One call reads a batch of crops and
+// returns one read per crop, in order; an unreadable crop gets empty text.
+class OcrEngine {
+ public:
+  virtual ~OcrEngine() = default;
+  virtual std::vector<OcrRead> read(std::span<const PlateCrop* const> crops) = 0;
+};
+
+}  // namespace dashcam::worker
@@ -0,0 +1,57 @@
+#include "worker/ocr/plate_crop.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include "worker/gpu/gpu_stream.hpp"
+
+namespace dashcam::worker {
+
+PlateCrop extract_plate_crop(const FrameSurface& frame, const Box& box, float padding,
+                             GpuStream stream, std::pmr::memory_resource* memory) {
+  PlaneView luma = frame.luma();
+  float pad_x = box.width() * padding;
+  float pad_y = box.height() * padding;
+  int x0 = std::clamp(static_cast<int>(std::floor(box.x0 - pad_x)), 0, luma.width);
+  int y0 = std::clamp(static_cast<int>(std::floor(box.y0 - pad_y)), 0, luma.height);
+  int x1 = std::clamp(static_cast<int>(std::ceil(box.x1 + pad_x)), 0, luma.width);
+  int y1 = std::clamp(static_cast<int>(std::ceil(box.y1 + pad_y)), 0, luma.height);
+
+  PlateCrop crop;
+  crop.pixels = std::pmr::vector<std::uint8_t>(memory);
+  crop.frame_index = frame.frame_index;
+  crop.box = {static_cast<float>(x0), static_cast<float>(y0), static_cast<float>(x1),
+              static_cast<float>(y1)};
+  crop.width = std::max(0, x1 - x0);
+  crop.height = std::max(0, y1 - y0);
+  if (crop.width == 0 || crop.height == 0) {
+    return crop;
+  }
+  crop.pixels.resize(static_cast<std::size_t>(crop.width) * static_cast<std::size_t>(crop.height));
+  download_2d(crop.pixels.data(), static_cast<std::size_t>(crop.width), luma.row(y0) + x0,
+              luma.pitch, static_cast<std::size_t>(crop.width),
+              static_cast<std::size_t>(crop.height), stream);
+#if DASHCAM_WITH_CUDA
+  DASHCAM_CUDA_CHECK(cudaStreamSynchronize(stream));
+#endif
+  return crop;
+}
+
+float crop_sharpness(const PlateCrop& crop) {
+  if (crop.width < 2 || crop.height < 2) {
+    return 0.0f;
+  }
+  std::uint64_t sum = 0;
+  for (int y = 0; y + 1 < crop.height; ++y) {
+    const std::uint8_t* row = crop.pixels.data() + static_cast<std::size_t>(y) * crop.width;
+    const std::uint8_t* below = row + crop.width;
+    for (int x = 0; x + 1 < crop.width; ++x) {
+      sum += static_cast<std::uint64_t>(std::abs(row[x] - row[x + 1]) + std::abs(row[x] - below[x]));
+    }
+  }
+  auto terms = static_cast<double>(crop.width - 1) * static_cast<double>(crop.height - 1) * 2.0;
+  return static_cast<float>(static_cast<double>(sum) / terms);
+}
+
+}  // namespace dashcam::worker
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+#include "worker/decode/frame_surface.hpp"
+#include "worker/gpu/gpu.hpp"
+#include "worker/inference/detection.hpp"
+
+namespace dashcam::worker {
+
+// Full-resolution grayscale plate crop (workhorse.md §3.3), copied off the
+// frame surface so the surface can go back to the decoder pool while the crop
+// waits for OCR.
+struct PlateCrop {
+  std::int64_t frame_index = 0;
+  int track_id = -1;
+  Box box;            // cropped region in frame pixels, padding included
+  float score = 0.0f; // detector confidence
+  float quality = 0.0f;
+  int width = 0;
+  int height = 0;
+  std::pmr::vector<std::uint8_t> pixels;  // row-major, pitch == width
+};
+
+// Copies `box` grown by `padding` (fraction of the box size) out of the
+// frame's luma plane, clamped to the frame, into pixels taken from `memory`.
+// Synchronous.
+PlateCrop extract_plate_crop(const FrameSurface& frame, const Box& box, float padding,
+                             GpuStream stream,
+                             std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+
+// Mean |dx| + |dy| over the crop; low values mean motion blur or defocus.
+float crop_sharpness(const PlateCrop& crop);
+
+}  // namespace dashcam::worker
@@ -0,0 +1,196 @@
+#include "worker/ocr/plate_reader.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <utility>
+
+#include "common/metrics.hpp"
+#include "common/trace.hpp"
+
+namespace dashcam::worker {
+
+PlateReader::PlateReader(PlateReaderConfig config, std::shared_ptr<OcrEngine> engine,
+                         CropWriter* crops, std::pmr::memory_resource* memory)
+    : config_(config),
+      engine_(std::move(engine)),
+      crops_(crops),
+      memory_(memory),
+      tracker_(config_.tracker) {}
+
+float PlateReader::quality(const Detection& det, float sharpness) const {
+  float size = std::min(1.0f, det.box.height() / config_.full_quality_height);
+  // Saturating in sharpness: past ~10 gray levels per pixel a crop is sharp
+  // enough and size and confidence decide.
+  return det.score * size * (sharpness / (sharpness + 10.0f));
+}
+
+void PlateReader::consider(TrackState& state, const FrameSurface& frame, const Detection& det) {
+  ++state.window_seen;
+  // Crop-free estimate at a nominal sharpness; replaced by the measured value
+  // when the observation is actually cropped.
+  float q = quality(det, 10.0f);
+  bool can_win = !state.window_best || quality(det, 1e9f) > state.window_best->quality;
+  if ((engine_ || crops_ != nullptr) && !state.vote->done && can_win) {
+    PlateCrop crop =
+        extract_plate_crop(frame, det.box, config_.crop_padding, stream_.get(), memory_);
+    crop.track_id = det.track_id;
+    crop.score = det.score;
+    crop.quality = q = quality(det, crop_sharpness(crop));
+    if (!crop.pixels.empty() &&
+        (!state.window_best || crop.quality > state.window_best->quality)) {
+      // emplace, not assignment: moving between vectors on different
+      // resources would copy the pixels.
+      state.window_best.emplace(std::move(crop));
+    }
+  }
+
+  PlateRead& r = state.read;
+  if (q > r.best_quality) {
+    r.best_frame = frame.frame_index;
+    r.best_box = det.box;
+    r.best_quality = q;
+  }
+  if (!state.vote->done && state.window_seen >= config_.window) {
+    queue(state);
+  }
+}
+
+void PlateReader::queue(TrackState& state) {
+  if (state.window_best) {
+    pending_.emplace_back(state.read.track_id, std::move(*state.window_best));
+  }
+  state.window_best.reset();
+  state.window_seen = 0;
+}
+
+void PlateReader::run_pending() {
+  if (pending_.empty()) {
+    return;
+  }
+  if (!engine_) {
+    archive_pending();
+    return;
+  }
+  std::vector<const PlateCrop*> crops;
+  crops.reserve(pending_.size());
+  for (const auto& [id, crop] : pending_) {
+    crops.push_back(&crop);
+  }
+  static Histogram& batch_seconds = default_metrics().histogram(
+      "dashcam_worker_ocr_seconds", "Time per OCR call, batched across tracks (§3.4).");
+  static Counter& calls = default_metrics().counter("dashcam_worker_ocr_reads_total",
+                                                    "Plate crops read by OCR (§3.4).");
+  std::vector<OcrRead> reads;
+  {
+    ScopedTrace span("ocr", "ocr", static_cast<std::int64_t>(crops.size()));
+    auto start = std::chrono::steady_clock::now();
+    reads = engine_->read(crops);
+    batch_seconds.observe(
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+  }
+  calls.add(pending_.size());
+  stats_.ocr_calls += pending_.size();
+
+  for (std::size_t i = 0; i < pending_.size() && i < reads.size(); ++i) {
+    TrackState& state = states_.at(pending_[i].first);
+    VehicleVote& vote = *state.vote;
+    vote.vote.add(reads[i]);
+    ++vote.reads;
+    ++state.read.reads;
+    if (vote.vote.converged() || vote.reads >= config_.max_reads) {
+      vote.done = true;
+      state.window_best.reset();
+    }
+  }
+  archive_pending();
+}
+
+void PlateReader::archive_pending() {
+  if (crops_ != nullptr) {
+    for (auto& [id, crop] : pending_) {
+      crops_->add(std::move(crop));
+    }
+  }
+  pending_.clear();
+}
+
+void PlateReader::retire(const std::vector<Track>& tracks) {
+  for (const Track& t : tracks) {
+    TrackState& state = states_.at(t.id);
+    if (!state.vote->done) {
+      queue(state);
+    }
+  }
+  run_pending();
+  for (const Track& t : tracks) {
+    auto it = states_.find(t.id);
+    retired_.emplace_back(std::move(it->second.read), std::move(it->second.vote));
+    states_.erase(it);
+  }
+}
+
+void PlateReader::observe(FrameJob& job) {
+  const FrameSurface& frame = *job.frame;
+  tracker_.update(frame.frame_index, job.detections);
+
+  for (const Detection& det : job.detections) {
+    if (det.track_id < 0) {
+      continue;
+    }
+    auto [it, inserted] = states_.try_emplace(det.track_id);
+    TrackState& state = it->second;
+    if (inserted) {
+      state.read.track_id = det.track_id;
+      state.read.first_frame = frame.frame_index;
+      state.read.first_box = det.box;
+      ++stats_.tracks;
+      std::optional<TrackFusion::Match> fused;
+      if (fusion_ != nullptr) {
+        fused = fusion_->match(camera_, frame.pts_us, det.box, frame.geometry().width);
+      }
+      if (fused) {
+        state.vote = std::move(fused->vote);
+        state.read.fused_track = fused->track_id;
+        ++stats_.fused_tracks;
+      } else {
+        state.vote = std::make_shared<VehicleVote>();
+        state.vote->vote = PlateVote(config_.vote);
+      }
+    }
+    if (fusion_ != nullptr) {
+      fusion_->observe(camera_, det.track_id, frame.pts_us, det.box, frame.geometry().width,
+                       state.vote);
+    }
+    state.read.last_frame = frame.frame_index;
+    state.read.last_box = det.box;
+    ++state.read.crops_seen;
+    ++stats_.crops_seen;
+    consider(state, frame, det);
+  }
+
+  run_pending();
+  retire(tracker_.take_retired());
+}
+
+std::vector<PlateRead> PlateReader::finish() {
+  tracker_.finish();
+  retire(tracker_.take_retired());
+  std::vector<PlateRead> results;
+  results.reserve(retired_.size());
+  for (auto& [read, vote] : retired_) {
+    read.text = vote->vote.leader();
+    read.share = vote->vote.leader_share();
+    read.converged = vote->vote.converged();
+    if (read.converged) {
+      ++stats_.converged_tracks;
+    }
+    results.push_back(std::move(read));
+  }
+  retired_.clear();
+  std::sort(results.begin(), results.end(),
+            [](const PlateRead& a, const PlateRead& b) { return a.track_id < b.track_id; });
+  return results;
+}
+
+}  // namespace dashcam::worker
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "worker/gpu/gpu_stream.hpp"
+#include "worker/heavy/frame_job.hpp"
+#include "worker/ocr/crop_writer.hpp"
+#include "worker/ocr/ocr_engine.hpp"
+#include "worker/ocr/plate_crop.hpp"
+#include "worker/ocr/plate_vote.hpp"
+#include "worker/ocr/track_fusion.hpp"
+#include "worker/tracking/plate_tracker.hpp"
+
+namespace dashcam::worker {
+
+struct PlateReaderConfig {
+  TrackerConfig tracker;
+  VoteConfig vote;
+  // Each track's crops are ranked in windows of this many; only the best
+  // crop of a window is read. Tracks shorter than a window get one read.
+  int window = 5;
+  // Hard cap on reads per track when the vote never converges.
+  int max_reads = 8;
+  float crop_padding = 0.1f;
+  // Plates at least this tall (pixels) get full size credit in the quality
+  // score; smaller ones are ranked down proportionally.
+  float full_quality_height = 48.0f;
+};
+
+// Per-video OCR workload: crops_seen is what reading every crop would have
+// cost, ocr_calls what actually ran.
+struct OcrStats {
+  std::uint64_t tracks = 0;
+  std::uint64_t converged_tracks = 0;
+  std::uint64_t crops_seen = 0;
+  std::uint64_t ocr_calls = 0;
+  std::uint64_t fused_tracks = 0;  // tracks that joined another camera's vote
+
+  std::uint64_t saved() const { return crops_seen - ocr_calls; }
+};
+
+// One tracked plate's outcome (input to §3.6 / §3.7).
+struct PlateRead {
+  int track_id = -1;
+  std::string text;    // normalised; empty when nothing was readable
+  float share = 0.0f;  // leader's share of the vote
+  bool converged = false;
+  int reads = 0;
+  std::int64_t crops_seen = 0;
+  std::int64_t first_frame = 0;
+  std::int64_t last_frame = 0;
+  // Where the plate was when the track started and ended; lets shards of a
+  // video stitch tracks that cross their boundary.
+  Box first_box;
+  Box last_box;
+  // Best-quality observation, for best-crop selection.
+  std::int64_t best_frame = -1;
+  Box best_box;
+  float best_quality = 0.0f;
+  // In a paired run, the other camera's track of the same vehicle; both
+  // carry the result of their shared vote.
+  int fused_track = -1;
+};
+
+// workhorse.md §3.3/§3.4 for one video: tracks plates across frames, crops
+// only the observations worth reading, and OCRs a quality-ranked subset of
+// each track until its vote converges. Frames must be fed in decode order.
+// A null engine still tracks (track ids, best crops) but reads nothing.
+//
+// With a crop writer, every crop chosen for reading (each window's best) is
+// also handed over for archiving, whether or not there is an engine.
+//
+// In a paired run (set_fusion), a track starting where the other camera's
+// reader just lost a vehicle joins that track's vote instead of starting its
+// own; see TrackFusion.
+//
+// Crop pixels come from `memory` (the task arena's pinned crop pool in a
+// heavy run) and are moved, never copied, on their way to OCR and the writer.
+class PlateReader {
+ public:
+  PlateReader(PlateReaderConfig config, std::shared_ptr<OcrEngine> engine,
+              CropWriter* crops = nullptr,
+              std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+
+  // Assigns track ids to the job's plate detections and runs any OCR that
+  // became due, batched across tracks.
+  void observe(FrameJob& job);
+
+  // Shares plate tracks with the other camera's reader through `fusion`;
+  // `camera` tells the two apart.
+  void set_fusion(TrackFusion* fusion, int camera) {
+    fusion_ = fusion;
+    camera_ = camera;
+  }
+
+  // Flushes open tracks; returns every track of the video in id order.
+  std::vector<PlateRead> finish();
+
+  const OcrStats& stats() const { return stats_; }
+
+ private:
+  struct TrackState {
+    std::shared_ptr<VehicleVote> vote;
+    PlateRead read;
+    std::optional<PlateCrop> window_best;
+    int window_seen = 0;
+  };
+
+  float quality(const Detection& det, float sharpness) const;
+  void consider(TrackState& state, const FrameSurface& frame, const Detection& det);
+  void queue(TrackState& state);
+  void run_pending();
+  void archive_pending();
+  void retire(const std::vector<Track>& tracks);
+
+  PlateReaderConfig config_;
+  std::shared_ptr<OcrEngine> engine_;
+  CropWriter* crops_;
+  std::pmr::memory_resource* memory_;
+  OwnedStream stream_;
+  PlateTracker tracker_;
+  std::map<int, TrackState> states_;
+  std::vector<std::pair<int, PlateCrop>> pending_;
+  // Retired tracks; their text is taken at finish(), since a fused track on
+  // the other camera may still be adding to the vote.
+  std::vector<std::pair<PlateRead, std::shared_ptr<VehicleVote>>> retired_;
+  TrackFusion* fusion_ = nullptr;
+  int camera_ = 0;
+  OcrStats stats_;
+};
+
+}  // namespace dashcam::worker
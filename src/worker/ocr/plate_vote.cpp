@@ -0,0 +1,45 @@
+#include "worker/ocr/plate_vote.hpp"
+
+namespace dashcam::worker {
+
+void PlateVote::add(const OcrRead& read) {
+  if (read.confidence < config_.min_confidence) {
+    return;
+  }
+  std::string text = normalize_plate(read.text);
+  if (text.empty()) {
+    return;
+  }
+  Tally& t = tallies_[text];
+  ++t.reads;
+  t.weight += read.confidence;
+  total_ += read.confidence;
+}
+
+const std::pair<const std::string, PlateVote::Tally>* PlateVote::top() const {
+  const std::pair<const std::string, Tally>* best = nullptr;
+  for (const auto& entry : tallies_) {
+    if (best == nullptr || entry.second.weight > best->second.weight) {
+      best = &entry;
+    }
+  }
+  return best;
+}
+
+bool PlateVote::converged() const {
+  const auto* best = top();
+  return best != nullptr && best->second.reads >= config_.min_agreeing &&
+         best->second.weight >= config_.min_share * total_;
+}
+
+std::string PlateVote::leader() const {
+  const auto* best = top();
+  return best != nullptr ? best->first : std::string();
+}
+
+float PlateVote::leader_share() const {
+  const auto* best = top();
+  return best != nullptr ? best->second.weight / total_ : 0.0f;
+}
+
+}  // namespace dashcam::worker
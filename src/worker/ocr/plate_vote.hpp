@@ -0,0 +1,45 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <string_view>
+
+#include "common/plate_text.hpp"
+#include "worker/ocr/ocr_engine.hpp"
+
+namespace dashcam::worker {
+
+struct VoteConfig {
+  // The vote has converged once the leading text has at least min_agreeing
+  // reads and holds min_share of the total confidence.
+  int min_agreeing = 3;
+  float min_share = 0.75f;
+  // Reads below this confidence are ignored.
+  float min_confidence = 0.2f;
+};
+
+// Confidence-weighted vote over one track's OCR reads.
+class PlateVote {
+ public:
+  explicit PlateVote(VoteConfig config = {}) : config_(config) {}
+
+  void add(const OcrRead& read);
+
+  bool empty() const { return total_ == 0.0f; }
+  bool converged() const;
+  std::string leader() const;
+  float leader_share() const;  // leader's fraction of the total confidence
+
+ private:
+  struct Tally {
+    int reads = 0;
+    float weight = 0.0f;
+  };
+  const std::pair<const std::string, Tally>* top() const;
+
+  VoteConfig config_;
+  std::map<std::string, Tally> tallies_;
+  float total_ = 0.0f;
+};
+
+}  // namespace dashcam::worker
@@ -0,0 +1,57 @@
+#include "worker/ocr/track_fusion.hpp"
+
+namespace dashcam::worker {
+
+bool TrackFusion::at_edge(const Box& box, int frame_width) const {
+  float edge = config_.edge_fraction * static_cast<float>(frame_width);
+  return box.x0 <= edge || box.x1 >= static_cast<float>(frame_width) - edge;
+}
+
+void TrackFusion::observe(int camera, int track_id, std::int64_t pts_us, const Box& box,
+                          int frame_width, const std::shared_ptr<VehicleVote>& vote) {
+  Sighting& s = last_[{camera, track_id}];
+  s.pts_us = pts_us;
+  s.box = box;
+  s.frame_width = frame_width;
+  s.vote = vote;
+
+  // Sightings too old to be handed off from any more are dropped; a pass
+  // over the few tracks seen in the last seconds.
+  for (auto it = last_.begin(); it != last_.end();) {
+    if (it->second.pts_us < pts_us - config_.max_handoff_us) {
+      it = last_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+std::optional<TrackFusion::Match> TrackFusion::match(int camera, std::int64_t pts_us,
+                                                     const Box& box, int frame_width) {
+  if (!at_edge(box, frame_width)) {
+    return std::nullopt;
+  }
+  // The most recently seen candidate: with several vehicles passing, the
+  // one that just left is the one just arriving.
+  auto best = last_.end();
+  for (auto it = last_.begin(); it != last_.end(); ++it) {
+    const Sighting& s = it->second;
+    if (it->first.first == camera || s.fused || s.vote->tracks > 1 ||
+        s.pts_us < pts_us - config_.max_handoff_us ||
+        s.pts_us > pts_us + config_.max_overlap_us || !at_edge(s.box, s.frame_width)) {
+      continue;
+    }
+    if (best == last_.end() || s.pts_us > best->second.pts_us) {
+      best = it;
+    }
+  }
+  if (best == last_.end()) {
+    return std::nullopt;
+  }
+  best->second.fused = true;
+  ++best->second.vote->tracks;
+  ++fused_;
+  return Match{best->first.first, best->first.second, best->second.vote};
+}
+
+}  // namespace dashcam::worker
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <utility>
+
+#include "worker/inference/detection.hpp"
+#include "worker/ocr/plate_vote.hpp"
+
+namespace dashcam::worker {
+
+// One vehicle's OCR vote. A plate track owns one; tracks fused across
+// cameras share it, so their reads count towards a single vote and stop
+// together once it converges.
+struct VehicleVote {
+  PlateVote vote;
+  int reads = 0;  // over every track sharing the vote
+  bool done = false;
+  int tracks = 1;
+};
+
+struct FusionConfig {
+  // A vehicle passing from one camera's view to the other's enters the
+  // second at most this long after it was last seen in the first...
+  std::int64_t max_handoff_us = 4'000'000;
+  // ...or at most this long before, while it is still visible in both.
+  std::int64_t max_overlap_us = 500'000;
+  // Both sightings must reach into the outer fraction of their frame, left
+  // or right: a passing vehicle leaves and enters at the side.
+  float edge_fraction = 0.25f;
+};
+
+// Cross-camera track fusion for a front/rear pair run together. Each
+// camera's PlateReader reports every plate sighting; a track that starts on
+// one camera is fused with the other camera's track the vehicle most likely
+// just left, so a vehicle overtaking (rear to front) or being overtaken
+// (front to rear) is voted on once. Both readers must run on one thread
+// and be fed in presentation order across cameras.
+class TrackFusion {
+ public:
+  explicit TrackFusion(FusionConfig config = {}) : config_(config) {}
+
+  struct Match {
+    int camera = 0;
+    int track_id = -1;
+    std::shared_ptr<VehicleVote> vote;
+  };
+
+  // Latest sighting of `track_id` on `camera`.
+  void observe(int camera, int track_id, std::int64_t pts_us, const Box& box, int frame_width,
+               const std::shared_ptr<VehicleVote>& vote);
+
+  // For a track starting on `camera` with this first sighting: the other
+  // camera's track to fuse it with, if any. Each track is fused at most once.
+  std::optional<Match> match(int camera, std::int64_t pts_us, const Box& box, int frame_width);
+
+  std::uint64_t fused() const { return fused_; }
+
+ private:
+  struct Sighting {
+    std::int64_t pts_us = 0;
+    Box box;
+    int frame_width = 0;
+    std::shared_ptr<VehicleVote> vote;
+    bool fused = false;
+  };
+
+  bool at_edge(const Box& box, int frame_width) const;
+
+  FusionConfig config_;
+  std::map<std::pair<int, int>, Sighting> last_;  // (camera, track id)
+  std::uint64_t fused_ = 0;
+};
+
+}  // namespace dashcam::worker
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <utility>
+
+namespace dashcam::worker {
+
+// Bounded multi-producer/multi-consumer queue (Vyukov's array queue). The
+// push/pop fast paths are lock-free; the blocking variants park on C++20
+// atomic waits when the queue is full/empty, which is what turns a full
+// downstream stage into backpressure on its producers.
+//
+// close() ends the stream: pushes fail from then on, pops drain what is left
+// and then return std::nullopt.
+template <typename T>
+class BoundedQueue {
+ public:
+  explicit BoundedQueue(std::size_t capacity)
+      : mask_(std::bit_ceil(capacity < 2 ? std::size_t{2} : capacity) - 1),
+        cells_(std::make_unique<Cell[]>(mask_ + 1)) {
+    for (std::size_t i = 0; i <= mask_; ++i) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  ~BoundedQueue() {
+    while (raw_pop()) {
+    }
+  }
+
+  BoundedQueue(const BoundedQueue&) = delete;
+  BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+  std::size_t capacity() const { return mask_ + 1; }
+
+  // Approximate; exact only when no other thread is operating on the queue.
+  std::size_t size() const {
+    auto tail = enqueue_pos_.load(std::memory_order_relaxed);
+    auto head = dequeue_pos_.load(std::memory_order_relaxed);
+    return tail > head ? tail - head : 0;
+  }
+
+  bool closed() const { return closed_.load(std::memory_order_acquire); }
+
+  // Leaves `value` untouched on failure.
+  bool try_push(T&& value) {
+    if (closed() || !raw_push(std::move(value))) {
+      return false;
+    }
+    signal(pushes_);
+    return true;
+  }
+
+  std::optional<T> try_pop() {
+    auto value = raw_pop();
+    if (value) {
+      signal(pops_);
+    }
+    return value;
+  }
+
+  // Blocks while full. Returns false if the queue was closed first.
+  bool push(T&& value) {
+    while (true) {
+      auto seen = pops_.load(std::memory_order_acquire);
+      if (closed()) {
+        return false;
+      }
+      if (raw_push(std::move(value))) {
+        signal(pushes_);
+        return true;
+      }
+      pops_.wait(seen, std::memory_order_acquire);
+    }
+  }
+
+  // Blocks while empty. Returns std::nullopt once closed and drained.
+  std::optional<T> pop() {
+    while (true) {
+      auto seen = pushes_.load(std::memory_order_acquire);
+      bool was_closed = closed();
+      if (auto value = raw_pop()) {
+        signal(pops_);
+        return value;
+      }
+      if (was_closed) {
+        return std::nullopt;
+      }
+      pushes_.wait(seen, std::memory_order_acquire);
+    }
+  }
+
+  void close() {
+    closed_.store(true, std::memory_order_release);
+    signal(pushes_);
+    signal(pops_);
+  }
+
+ private:
+  struct Cell {
+    std::atomic<std::size_t> sequence{0};
+    alignas(T) unsigned char storage[sizeof(T)];
+  };
+
+  static void signal(std::atomic<std::uint32_t>& counter) {
+    counter.fetch_add(1, std::memory_order_release);
+    counter.notify_all();
+  }
+
+  bool raw_push(T&& value) {
+    Cell* cell = nullptr;
+    auto pos = enqueue_pos_.load(std::memory_order_relaxed);
+    while (true) {
+      cell = &cells_[pos & mask_];
+      auto seq = cell->sequence.load(std::memory_order_acquire);
+      auto diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    ::new (static_cast<void*>(cell->storage)) T(std::move(value));
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  std::optional<T> raw_pop() {
+    Cell* cell = nullptr;
+    auto pos = dequeue_pos_.load(std::memory_order_relaxed);
+    while (true) {
+      cell = &cells_[pos & mask_];
+      auto seq = cell->sequence.load(std::memory_order_acquire);
+      auto diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return std::nullopt;
+      } else {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    T* slot = std::launder(reinterpret_cast<T*>(cell->storage));
+    std::optional<T> value(std::move(*slot));
+    slot->~T();
+    cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+    return value;
+  }
+
+  static constexpr std::size_t kCacheLine = 64;
+
+  const std::size_t mask_;
+  std::unique_ptr<Cell[]> cells_;
+  alignas(kCacheLine) std::atomic<std::size_t> enqueue_pos_{0};
+  alignas(kCacheLine) std::atomic<std::size_t> dequeue_pos_{0};
+  alignas(kCacheLine) std::atomic<std::uint32_t> pushes_{0};
+  alignas(kCacheLine) std::atomic<std::uint32_t> pops_{0};
+  std::atomic<bool> closed_{false};
+};
+
+}  // namespace dashcam::worker
@@ -0,0 +1,507 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "common/metrics.hpp"
+#include "common/trace.hpp"
+#include "worker/pipeline/bounded_queue.hpp"
+#include "worker/pipeline/pipeline_gate.hpp"
+#include "worker/pipeline/stage_stats.hpp"
+
+namespace dashcam::worker {
+
+struct StageOptions {
+  std::string name;
+  std::size_t threads = 1;
+  // Capacity of the stage's input queue. Together with the thread counts this
+  // bounds how many items can be in flight between the source and the stage.
+  std::size_t queue_capacity = 8;
+  // Process items in source order (single-threaded stages only). Needed by
+  // stages that carry state across frames, e.g. tracking.
+  bool ordered = false;
+  // GPU work: held to the gate's GPU share while the worker is throttled.
+  bool throttled = false;
+};
+
+// Dynamic batching for stages that run on the GPU. A batch closes when it
+// reaches max_batch items or when its first item has waited max_latency,
+// whichever comes first, so bursts fill the GPU and stragglers are not held
+// hostage by an empty queue.
+struct BatchOptions {
+  std::size_t max_batch = 16;
+  std::chrono::microseconds max_latency{8000};
+};
+
+// The local-task queue of one heavy-processing task (task_system_overview.md
+// §4) as a chain of stages, each with its own thread pool, joined by bounded
+// queues. A slow stage fills its input queue and blocks everything upstream,
+// so memory in flight is bounded no matter how far ahead the source could run.
+//
+// Stage functions return false to drop an item. Dropped items keep flowing as
+// empty placeholders so ordered stages downstream can still see every
+// sequence number; their payload is released at the drop.
+//
+// With a gate set, every thread checks it between items: a paused gate
+// stops the pipeline at those boundaries with its items still in memory,
+// and a throttled one paces the throttled stages and caps batch sizes.
+//
+// With a trace buffer set, every stage call (one item, or one batch) is a
+// span named after its stage, and the pipeline's threads are bound to the
+// buffer (common/trace.hpp), so spans recorded inside stage functions land
+// there too. With metrics set, the same durations go to a histogram per
+// stage.
+//
+// A Pipeline runs once. The first exception thrown by any stage, the source or
+// the sink cancels every stage and is rethrown from run().
+template <typename Item>
+class Pipeline {
+ public:
+  using Source = std::function<std::optional<Item>()>;
+  using StageFn = std::function<bool(Item&)>;
+  using Sink = std::function<void(Item&&)>;
+  // Batch stages cannot drop; the items of each batch are in arrival order.
+  using BatchFn = std::function<void(std::span<Item*>)>;
+
+  explicit Pipeline(std::string source_name = "source", std::size_t sink_capacity = 8)
+      : source_name_(std::move(source_name)), sink_queue_(sink_capacity) {}
+
+  Pipeline(const Pipeline&) = delete;
+  Pipeline& operator=(const Pipeline&) = delete;
+
+  void add_stage(StageOptions options, StageFn fn) {
+    if (options.threads == 0) {
+      throw std::invalid_argument("stage " + options.name + " needs at least one thread");
+    }
+    if (options.ordered && options.threads != 1) {
+      throw std::invalid_argument("ordered stage " + options.name + " must be single-threaded");
+    }
+    stages_.push_back(std::make_unique<Stage>(std::move(options), std::move(fn)));
+  }
+
+  void add_batch_stage(StageOptions options, BatchOptions batch, BatchFn fn) {
+    if (options.threads == 0 || batch.max_batch == 0) {
+      throw std::invalid_argument("batch stage " + options.name + " needs threads and a batch size");
+    }
+    if (options.ordered) {
+      throw std::invalid_argument("batch stage " + options.name + " cannot be ordered");
+    }
+    auto stage = std::make_unique<Stage>(std::move(options), nullptr);
+    stage->batch = batch;
+    stage->batch_fn = std::move(fn);
+    stages_.push_back(std::move(stage));
+  }
+
+  // Runs first on every thread run() starts (not the caller's), e.g. to make
+  // the task's GPU current on it.
+  void set_thread_init(std::function<void()> init) { thread_init_ = std::move(init); }
+
+  void set_gate(std::shared_ptr<PipelineGate> gate) { gate_ = std::move(gate); }
+
+  // Both must outlive run().
+  void set_trace(TraceBuffer* trace) { trace_ = trace; }
+  void set_metrics(MetricsRegistry* metrics, std::string histogram_name) {
+    metrics_ = metrics;
+    histogram_name_ = std::move(histogram_name);
+  }
+
+  // Pulls from `source` on a dedicated thread until it returns std::nullopt,
+  // runs every stage, and hands surviving items to `sink` on the calling
+  // thread. Returns when everything has drained.
+  void run(Source source, Sink sink) {
+    instrument(source_probe_, source_name_);
+    instrument(sink_probe_, "sink");
+    for (auto& stage : stages_) {
+      instrument(stage->probe, stage->options.name);
+    }
+    start_ns_.store(now_ns(), std::memory_order_release);
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < stages_.size(); ++i) {
+      Stage& stage = *stages_[i];
+      stage.running = stage.options.threads;
+      for (std::size_t t = 0; t < stage.options.threads; ++t) {
+        std::string thread_name = stage.options.name;
+        if (stage.options.threads > 1) {
+          thread_name += "/" + std::to_string(t);
+        }
+        threads.emplace_back([this, i, thread_name = std::move(thread_name)] {
+          guarded([&] {
+            init_thread(thread_name);
+            stage_loop(i);
+          });
+        });
+      }
+    }
+    threads.emplace_back([this, &source] {
+      guarded([&] {
+        init_thread(source_name_);
+        source_loop(source);
+      });
+    });
+
+    guarded([&] { sink_loop(sink); });
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    finish_ns_.store(now_ns(), std::memory_order_release);
+    if (error_) {
+      std::rethrow_exception(error_);
+    }
+  }
+
+  // Safe to call while run() is in progress.
+  std::vector<StageSnapshot> snapshot() const {
+    auto start = start_ns_.load(std::memory_order_acquire);
+    auto finish = finish_ns_.load(std::memory_order_acquire);
+    auto wall = std::chrono::nanoseconds(start == 0 ? 0 : (finish != 0 ? finish : now_ns()) - start);
+    std::vector<StageSnapshot> out;
+    out.push_back(snapshot_counters(source_name_, 1, source_counters_, wall, 0, 0));
+    for (const auto& stage : stages_) {
+      out.push_back(snapshot_counters(stage->options.name, stage->options.threads,
+                                      stage->counters, wall, stage->input.size(),
+                                      stage->input.capacity()));
+    }
+    out.push_back(snapshot_counters("sink", 1, sink_counters_, wall, sink_queue_.size(),
+                                    sink_queue_.capacity()));
+    return out;
+  }
+
+ private:
+  static std::int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  struct Slot {
+    std::uint64_t seq = 0;
+    std::optional<Item> item;  // empty: dropped upstream
+  };
+
+  // Where a stage's calls are recorded; both null when not instrumented.
+  struct Probe {
+    const char* span = nullptr;  // interned in the trace buffer
+    Histogram* seconds = nullptr;
+  };
+
+  struct Stage {
+    Stage(StageOptions o, StageFn f)
+        : options(std::move(o)), fn(std::move(f)), input(options.queue_capacity) {}
+    StageOptions options;
+    StageFn fn;
+    BatchOptions batch;
+    BatchFn batch_fn;  // set for batch stages instead of fn
+    StageCounters counters;
+    Probe probe;
+    BoundedQueue<Slot> input;
+    std::atomic<std::size_t> running{0};
+  };
+
+  void init_thread(const std::string& name) {
+    if (trace_ != nullptr) {
+      bind_trace(trace_);
+      trace_->name_thread(name);
+    }
+    if (thread_init_) {
+      thread_init_();
+    }
+  }
+
+  void instrument(Probe& probe, const std::string& name) {
+    if (trace_ != nullptr) {
+      probe.span = trace_->intern(name);
+    }
+    if (metrics_ != nullptr) {
+      probe.seconds = &metrics_->histogram(histogram_name_,
+                                           "Time per pipeline stage call (an item, or a batch).",
+                                           {{"stage", name}});
+    }
+  }
+
+  // Records one call that started at `start`; `items` for batches.
+  void observe(const Probe& probe, std::chrono::steady_clock::time_point start,
+               std::int64_t items = -1) {
+    if (probe.span == nullptr && probe.seconds == nullptr) {
+      return;
+    }
+    auto end = std::chrono::steady_clock::now();
+    if (probe.span != nullptr) {
+      trace_->record(probe.span, "stage", start, end, items);
+    }
+    if (probe.seconds != nullptr) {
+      probe.seconds->observe(std::chrono::duration<double>(end - start).count());
+    }
+  }
+
+  // False once cancelled; waits out a pause in short steps so a
+  // cancellation is still seen promptly.
+  bool hold() {
+    while (gate_ && !cancelled() && !gate_->wait_running(std::chrono::milliseconds(100))) {
+    }
+    return !cancelled();
+  }
+
+  void pace(const Stage& stage, std::chrono::steady_clock::time_point since) {
+    if (gate_ && stage.options.throttled) {
+      gate_->pace(std::chrono::steady_clock::now() - since);
+    }
+  }
+
+  BoundedQueue<Slot>& output_of(std::size_t stage) {
+    return stage + 1 < stages_.size() ? stages_[stage + 1]->input : sink_queue_;
+  }
+
+  BoundedQueue<Slot>& first_queue() { return stages_.empty() ? sink_queue_ : stages_[0]->input; }
+
+  static std::optional<Slot> timed_pop(BoundedQueue<Slot>& queue, StageCounters& counters) {
+    if (auto slot = queue.try_pop()) {
+      return slot;
+    }
+    ScopedNanos wait(counters.starved_ns);
+    return queue.pop();
+  }
+
+  static bool timed_push(BoundedQueue<Slot>& queue, Slot&& slot, StageCounters& counters) {
+    if (queue.try_push(std::move(slot))) {
+      return true;
+    }
+    ScopedNanos wait(counters.blocked_ns);
+    return queue.push(std::move(slot));
+  }
+
+  void source_loop(Source& source) {
+    BoundedQueue<Slot>& out = first_queue();
+    std::uint64_t seq = 0;
+    while (hold()) {
+      std::optional<Item> item;
+      auto start = std::chrono::steady_clock::now();
+      {
+        ScopedNanos busy(source_counters_.busy_ns);
+        ScopedAllocations allocs(source_counters_.allocations);
+        item = source();
+      }
+      observe(source_probe_, start);
+      if (!item) {
+        break;
+      }
+      source_counters_.items_out.fetch_add(1, std::memory_order_relaxed);
+      if (!timed_push(out, Slot{seq++, std::move(item)}, source_counters_)) {
+        break;
+      }
+    }
+    out.close();
+  }
+
+  void stage_loop(std::size_t index) {
+    Stage& stage = *stages_[index];
+    if (stage.batch_fn) {
+      batch_loop(index);
+      return;
+    }
+    BoundedQueue<Slot>& out = output_of(index);
+    std::map<std::uint64_t, Slot> reorder;
+    std::uint64_t next_seq = 0;
+    bool open = true;
+
+    auto process = [&](Slot& slot) {
+      if (slot.item) {
+        if (!hold()) {
+          open = false;
+          return;
+        }
+        stage.counters.items_in.fetch_add(1, std::memory_order_relaxed);
+        bool keep = false;
+        auto start = std::chrono::steady_clock::now();
+        {
+          ScopedNanos busy(stage.counters.busy_ns);
+          ScopedAllocations allocs(stage.counters.allocations);
+          keep = stage.fn(*slot.item);
+        }
+        observe(stage.probe, start);
+        pace(stage, start);
+        if (keep) {
+          stage.counters.items_out.fetch_add(1, std::memory_order_relaxed);
+        } else {
+          stage.counters.dropped.fetch_add(1, std::memory_order_relaxed);
+          slot.item.reset();
+        }
+      }
+      open = timed_push(out, std::move(slot), stage.counters);
+    };
+
+    while (open && !cancelled()) {
+      auto slot = timed_pop(stage.input, stage.counters);
+      if (!slot) {
+        break;
+      }
+      if (!stage.options.ordered) {
+        process(*slot);
+        continue;
+      }
+      reorder.emplace(slot->seq, std::move(*slot));
+      while (open && !reorder.empty() && reorder.begin()->first == next_seq) {
+        Slot ready = std::move(reorder.begin()->second);
+        reorder.erase(reorder.begin());
+        process(ready);
+        ++next_seq;
+      }
+    }
+    if (stage.running.fetch_sub(1) == 1) {
+      out.close();
+    }
+  }
+
+  void batch_loop(std::size_t index) {
+    Stage& stage = *stages_[index];
+    BoundedQueue<Slot>& out = output_of(index);
+    std::vector<Slot> batch;
+    std::vector<Item*> items;
+    batch.reserve(stage.batch.max_batch);
+    items.reserve(stage.batch.max_batch);
+    bool open = true;
+
+    // Placeholders for dropped items need no work and are forwarded at once.
+    auto take = [&](Slot&& slot) {
+      if (slot.item) {
+        batch.push_back(std::move(slot));
+      } else {
+        open = timed_push(out, std::move(slot), stage.counters);
+      }
+    };
+
+    while (open && !cancelled()) {
+      auto first = timed_pop(stage.input, stage.counters);
+      if (!first) {
+        break;
+      }
+      take(std::move(*first));
+      if (batch.empty()) {
+        continue;
+      }
+      {
+        ScopedNanos waiting(stage.counters.starved_ns);
+        auto deadline = std::chrono::steady_clock::now() + stage.batch.max_latency;
+        auto backoff = std::chrono::microseconds(20);
+        std::size_t limit = gate_ ? gate_->batch_limit(stage.batch.max_batch)
+                                  : stage.batch.max_batch;
+        while (open && batch.size() < limit) {
+          if (auto slot = stage.input.try_pop()) {
+            take(std::move(*slot));
+            continue;
+          }
+          if (stage.input.closed() || std::chrono::steady_clock::now() >= deadline) {
+            break;
+          }
+          std::this_thread::sleep_for(backoff);
+          backoff = std::min(backoff * 2, std::chrono::microseconds(1000));
+        }
+      }
+
+      if (!hold()) {
+        break;
+      }
+      items.clear();
+      for (Slot& slot : batch) {
+        items.push_back(&*slot.item);
+      }
+      stage.counters.items_in.fetch_add(items.size(), std::memory_order_relaxed);
+      stage.counters.batches.fetch_add(1, std::memory_order_relaxed);
+      auto start = std::chrono::steady_clock::now();
+      {
+        ScopedNanos busy(stage.counters.busy_ns);
+        ScopedAllocations allocs(stage.counters.allocations);
+        stage.batch_fn(std::span<Item*>(items));
+      }
+      observe(stage.probe, start, static_cast<std::int64_t>(items.size()));
+      pace(stage, start);
+      stage.counters.items_out.fetch_add(items.size(), std::memory_order_relaxed);
+      for (Slot& slot : batch) {
+        if (open) {
+          open = timed_push(out, std::move(slot), stage.counters);
+        }
+      }
+      batch.clear();
+    }
+    if (stage.running.fetch_sub(1) == 1) {
+      out.close();
+    }
+  }
+
+  void sink_loop(Sink& sink) {
+    while (!cancelled()) {
+      auto slot = timed_pop(sink_queue_, sink_counters_);
+      if (!slot) {
+        break;
+      }
+      if (!slot->item) {
+        continue;
+      }
+      sink_counters_.items_in.fetch_add(1, std::memory_order_relaxed);
+      auto start = std::chrono::steady_clock::now();
+      {
+        ScopedNanos busy(sink_counters_.busy_ns);
+        ScopedAllocations allocs(sink_counters_.allocations);
+        sink(std::move(*slot->item));
+      }
+      observe(sink_probe_, start);
+    }
+  }
+
+  template <typename Fn>
+  void guarded(Fn&& fn) {
+    try {
+      fn();
+    } catch (...) {
+      cancel(std::current_exception());
+    }
+  }
+
+  bool cancelled() const { return cancelled_.load(std::memory_order_acquire); }
+
+  void cancel(std::exception_ptr error) {
+    {
+      std::lock_guard lock(error_mutex_);
+      if (!error_) {
+        error_ = std::move(error);
+      }
+    }
+    cancelled_.store(true, std::memory_order_release);
+    for (auto& stage : stages_) {
+      stage->input.close();
+    }
+    sink_queue_.close();
+  }
+
+  std::string source_name_;
+  std::function<void()> thread_init_;
+  std::shared_ptr<PipelineGate> gate_;
+  TraceBuffer* trace_ = nullptr;
+  MetricsRegistry* metrics_ = nullptr;
+  std::string histogram_name_;
+  std::vector<std::unique_ptr<Stage>> stages_;
+  BoundedQueue<Slot> sink_queue_;
+  StageCounters source_counters_;
+  StageCounters sink_counters_;
+  Probe source_probe_;
+  Probe sink_probe_;
+  std::atomic<std::int64_t> start_ns_{0};
+  std::atomic<std::int64_t> finish_ns_{0};
+  std::atomic<bool> cancelled_{false};
+  std::mutex error_mutex_;
+  std::exception_ptr error_;
+};
+
+}  // namespace dashcam::worker
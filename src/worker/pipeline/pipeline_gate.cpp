@@ -0,0 +1,62 @@
+#include "worker/pipeline/pipeline_gate.hpp"
+
+#include <algorithm>
+
+namespace dashcam::worker {
+
+namespace {
+
+// One paced pause never exceeds this, so a long batch cannot park its
+// thread for longer than a user would notice after throttling ends.
+constexpr std::chrono::seconds kMaxPace{1};
+
+}  // namespace
+
+void PipelineGate::set(const ThrottleLevel& level) {
+  {
+    std::lock_guard lock(mutex_);
+    level_ = level;
+    level_.gpu_share = std::clamp(level_.gpu_share, 0.01, 1.0);
+    paused_.store(level_.paused, std::memory_order_release);
+    throttled_.store(level_.paused || level_.gpu_share < 1.0 || level_.max_batch > 0,
+                     std::memory_order_release);
+  }
+  changed_.notify_all();
+}
+
+ThrottleLevel PipelineGate::level() const {
+  std::lock_guard lock(mutex_);
+  return level_;
+}
+
+bool PipelineGate::wait_running(std::chrono::milliseconds timeout) {
+  if (!paused()) {
+    return true;
+  }
+  std::unique_lock lock(mutex_);
+  return changed_.wait_for(lock, timeout, [this] { return !level_.paused; });
+}
+
+std::size_t PipelineGate::batch_limit(std::size_t max_batch) const {
+  if (!throttled_.load(std::memory_order_acquire)) {
+    return max_batch;
+  }
+  std::lock_guard lock(mutex_);
+  return level_.max_batch > 0 ? std::min(max_batch, level_.max_batch) : max_batch;
+}
+
+void PipelineGate::pace(std::chrono::nanoseconds busy) {
+  if (!throttled_.load(std::memory_order_acquire)) {
+    return;
+  }
+  std::unique_lock lock(mutex_);
+  double share = level_.gpu_share;
+  if (share >= 1.0) {
+    return;
+  }
+  auto idle = std::chrono::duration_cast<std::chrono::nanoseconds>(busy * (1.0 / share - 1.0));
+  changed_.wait_for(lock, std::min<std::chrono::nanoseconds>(idle, kMaxPace),
+                    [this] { return level_.gpu_share >= 1.0; });
+}
+
+}  // namespace dashcam::worker
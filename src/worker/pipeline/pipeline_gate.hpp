@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+
+namespace dashcam::worker {
+
+// How hard the pipelines may run right now.
+struct ThrottleLevel {
+  // Every stage stops at its next item boundary and waits, holding what it
+  // has in memory, so resuming loses no work.
+  bool paused = false;
+  // Share of the wall time each throttled (GPU) stage thread may be busy,
+  // in (0, 1]: after a batch taking t it idles t * (1 / share - 1).
+  double gpu_share = 1.0;
+  // Cap on batch stage sizes; 0 keeps each stage's own.
+  std::size_t max_batch = 0;
+
+  bool operator==(const ThrottleLevel&) const = default;
+};
+
+// Shared by every pipeline of the worker and set by its activity governor
+// (worker/throttle/activity_governor.hpp), so one decision throttles all
+// running tasks together. Thread-safe; the running, unthrottled path is a
+// single atomic load.
+class PipelineGate {
+ public:
+  void set(const ThrottleLevel& level);
+  ThrottleLevel level() const;
+
+  bool paused() const { return paused_.load(std::memory_order_acquire); }
+
+  // Waits up to `timeout` for the gate to be unpaused; true when it is.
+  bool wait_running(std::chrono::milliseconds timeout);
+
+  std::size_t batch_limit(std::size_t max_batch) const;
+
+  // Idles after `busy` of GPU work to hold the stage to its share. Cut
+  // short when the share is raised back to 1.
+  void pace(std::chrono::nanoseconds busy);
+
+ private:
+  mutable std::mutex mutex_;
+  std::condition_variable changed_;
+  ThrottleLevel level_;
+  std::atomic<bool> paused_{false};
+  std::atomic<bool> throttled_{false};
+};
+
+}  // namespace dashcam::worker
@@ -0,0 +1,65 @@
+#include "worker/pipeline/stage_stats.hpp"
+
+#include <cstdio>
+
+namespace dashcam::worker {
+
+StageSnapshot snapshot_counters(const std::string& name, std::size_t threads,
+                                const StageCounters& counters, std::chrono::nanoseconds wall,
+                                std::size_t queue_depth, std::size_t queue_capacity) {
+  constexpr double kNanos = 1e9;
+  StageSnapshot s;
+  s.name = name;
+  s.threads = threads;
+  s.items_in = counters.items_in.load(std::memory_order_relaxed);
+  s.items_out = counters.items_out.load(std::memory_order_relaxed);
+  s.dropped = counters.dropped.load(std::memory_order_relaxed);
+  s.batches = counters.batches.load(std::memory_order_relaxed);
+  s.allocations = counters.allocations.load(std::memory_order_relaxed);
+  s.busy_s = static_cast<double>(counters.busy_ns.load(std::memory_order_relaxed)) / kNanos;
+  s.starved_s = static_cast<double>(counters.starved_ns.load(std::memory_order_relaxed)) / kNanos;
+  s.blocked_s = static_cast<double>(counters.blocked_ns.load(std::memory_order_relaxed)) / kNanos;
+  s.queue_depth = queue_depth;
+  s.queue_capacity = queue_capacity;
+  double capacity_s = static_cast<double>(wall.count()) / kNanos * static_cast<double>(threads);
+  s.occupancy = capacity_s > 0 ? s.busy_s / capacity_s : 0.0;
+  if (s.occupancy > 1.0) {
+    s.occupancy = 1.0;
+  }
+  return s;
+}
+
+std::string format_stage_report(const std::vector<StageSnapshot>& stages) {
+  std::string out;
+  char line[160];
+  std::snprintf(line, sizeof(line), "%-14s %4s %9s %9s %9s %9s %9s %9s %9s %6s %6s %8s\n",
+                "stage", "thr", "in", "out", "dropped", "busy_s", "starved_s", "blocked_s", "queue",
+                "occ", "batch", "allocs");
+  out += line;
+  for (const auto& s : stages) {
+    char queue[24];
+    std::snprintf(queue, sizeof(queue), "%zu/%zu", s.queue_depth, s.queue_capacity);
+    char batch[16] = "-";
+    if (s.batches > 0) {
+      std::snprintf(batch, sizeof(batch), "%.1f",
+                    static_cast<double>(s.items_in) / static_cast<double>(s.batches));
+    }
+    // Per item, the figure a regression moves; the source only emits items.
+    char allocs[16] = "-";
+    std::uint64_t items = s.items_in > 0 ? s.items_in : s.items_out;
+    if (items > 0) {
+      std::snprintf(allocs, sizeof(allocs), "%.2f",
+                    static_cast<double>(s.allocations) / static_cast<double>(items));
+    }
+    std::snprintf(line, sizeof(line),
+                  "%-14s %4zu %9llu %9llu %9llu %9.2f %9.2f %9.2f %9s %5.0f%% %6s %8s\n",
+                  s.name.c_str(), s.threads, static_cast<unsigned long long>(s.items_in),
+                  static_cast<unsigned long long>(s.items_out),
+                  static_cast<unsigned long long>(s.dropped), s.busy_s, s.starved_s, s.blocked_s,
+                  queue, s.occupancy * 100.0, batch, allocs);
+    out += line;
+  }
+  return out;
+}
+
+}  // namespace dashcam::worker
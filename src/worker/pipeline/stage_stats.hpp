@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "worker/memory/alloc_counter.hpp"
+
+namespace dashcam::worker {
+
+// Live counters for one pipeline stage, updated by its worker threads.
+// All times are summed across the stage's threads.
+struct StageCounters {
+  std::atomic<std::uint64_t> items_in{0};
+  std::atomic<std::uint64_t> items_out{0};
+  std::atomic<std::uint64_t> dropped{0};
+  std::atomic<std::uint64_t> busy_ns{0};     // inside the stage function
+  std::atomic<std::uint64_t> starved_ns{0};  // waiting for input
+  std::atomic<std::uint64_t> blocked_ns{0};  // waiting for room downstream
+  std::atomic<std::uint64_t> batches{0};     // batch stages only
+  std::atomic<std::uint64_t> allocations{0}; // heap allocations inside the stage function
+};
+
+// Point-in-time copy of a stage's counters.
+//
+// Reading a report: the bottleneck is the stage with the highest occupancy;
+// stages upstream of it show blocked time (backpressure), stages downstream
+// show starved time.
+struct StageSnapshot {
+  std::string name;
+  std::size_t threads = 0;
+  std::uint64_t items_in = 0;
+  std::uint64_t items_out = 0;
+  std::uint64_t dropped = 0;
+  std::uint64_t batches = 0;
+  std::uint64_t allocations = 0;
+  double busy_s = 0.0;
+  double starved_s = 0.0;
+  double blocked_s = 0.0;
+  std::size_t queue_depth = 0;  // input queue, 0 for the source
+  std::size_t queue_capacity = 0;
+  // busy time / (threads x wall time), in [0, 1].
+  double occupancy = 0.0;
+};
+
+StageSnapshot snapshot_counters(const std::string& name, std::size_t threads,
+                                const StageCounters& counters, std::chrono::nanoseconds wall,
+                                std::size_t queue_depth, std::size_t queue_capacity);
+
+// Fixed-width table, one row per stage, for logs and task summaries.
+std::string format_stage_report(const std::vector<StageSnapshot>& stages);
+
+// Accumulates the heap allocations the calling thread makes between
+// construction and destruction into `sink` (worker/memory/alloc_counter.hpp).
+class ScopedAllocations {
+ public:
+  explicit ScopedAllocations(std::atomic<std::uint64_t>& sink)
+      : sink_(sink), start_(thread_allocations()) {}
+  ~ScopedAllocations() {
+    sink_.fetch_add(thread_allocations() - start_, std::memory_order_relaxed);
+  }
+
+  ScopedAllocations(const ScopedAllocations&) = delete;
+  ScopedAllocations& operator=(const ScopedAllocations&) = delete;
+
+ private:
+  std::atomic<std::uint64_t>& sink_;
+  std::uint64_t start_;
+};
+
+// Accumulates the time between construction and destruction into `sink`.
+class ScopedNanos {
+ public:
+  explicit ScopedNanos(std::atomic<std::uint64_t>& sink)
+      : sink_(sink), start_(std::chrono::steady_clock::now()) {}
+  ~ScopedNanos() {
+    auto elapsed = std::chrono::steady_clock::now() - start_;
+    sink_.fetch_add(static_cast<std::uint64_t>(
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()),
+                    std::memory_order_relaxed);
+  }
+
+  ScopedNanos(const ScopedNanos&) = delete;
+  ScopedNanos& operator=(const ScopedNanos&) = delete;
+
+ private:
+  std::atomic<std::uint64_t>& sink_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+}  // namespace dashcam::worker
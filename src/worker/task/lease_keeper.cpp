@@ -0,0 +1,78 @@
+#include "worker/task/lease_keeper.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <utility>
+#include <vector>
+
+namespace dashcam::worker {
+
+LeaseKeeper::LeaseKeeper(std::string host, unsigned short port, std::string worker_id)
+    : client_(std::move(host), port, std::move(worker_id)), thread_([this] { run(); }) {}
+
+LeaseKeeper::~LeaseKeeper() {
+  {
+    std::lock_guard lock(mutex_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  thread_.join();
+  // Hand back anything still held so other workers need not wait out the
+  // TTL. Best effort: the leases expire on their own otherwise.
+  try {
+    client_.heartbeat({});
+  } catch (const std::exception&) {
+  }
+}
+
+void LeaseKeeper::hold(std::int64_t task_id) {
+  std::lock_guard lock(mutex_);
+  held_.insert(task_id);
+  lost_.erase(task_id);
+}
+
+void LeaseKeeper::release(std::int64_t task_id) {
+  std::lock_guard lock(mutex_);
+  held_.erase(task_id);
+  lost_.erase(task_id);
+  released_ = true;
+}
+
+void LeaseKeeper::set_lease_ttl(std::chrono::milliseconds ttl) {
+  std::lock_guard lock(mutex_);
+  period_ = std::max(std::chrono::milliseconds(100), ttl / 3);
+}
+
+bool LeaseKeeper::still_held(std::int64_t task_id) const {
+  std::lock_guard lock(mutex_);
+  return lost_.count(task_id) == 0;
+}
+
+void LeaseKeeper::run() {
+  std::unique_lock lock(mutex_);
+  while (!stop_) {
+    wake_.wait_for(lock, period_, [this] { return stop_; });
+    if (stop_ || (held_.empty() && !released_)) {
+      continue;
+    }
+    released_ = false;
+    std::vector<std::int64_t> ids(held_.begin(), held_.end());
+    lock.unlock();
+    std::vector<std::int64_t> lost;
+    try {
+      lost = client_.heartbeat(ids);
+    } catch (const std::exception& e) {
+      // Transient: the lease survives until its TTL, and a pending task is
+      // safe to run twice anyway.
+      std::fprintf(stderr, "heartbeat failed: %s\n", e.what());
+    }
+    lock.lock();
+    for (std::int64_t id : lost) {
+      if (held_.count(id) != 0 && lost_.insert(id).second) {
+        std::fprintf(stderr, "task %lld: lease lost\n", static_cast<long long>(id));
+      }
+    }
+  }
+}
+
+}  // namespace dashcam::worker
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+
+#include "worker/task/task_client.hpp"
+
+namespace dashcam::worker {
+
+// Background heartbeat for the tasks this worker holds, so their server-side
+// leases outlive long videos. Uses its own connection; the caller's
+// TaskClient stays single-threaded.
+class LeaseKeeper {
+ public:
+  LeaseKeeper(std::string host, unsigned short port, std::string worker_id);
+  ~LeaseKeeper();
+
+  LeaseKeeper(const LeaseKeeper&) = delete;
+  LeaseKeeper& operator=(const LeaseKeeper&) = delete;
+
+  // The next heartbeat renews exactly the held set; released tasks drop
+  // their leases with it.
+  void hold(std::int64_t task_id);
+  void release(std::int64_t task_id);
+
+  // Heartbeat period; a third of the lease TTL leaves room for two misses.
+  void set_lease_ttl(std::chrono::milliseconds ttl);
+
+  // False once the server reported the lease lost (another worker may now be
+  // running the task). The task can still be completed; the first completion
+  // wins and the other reports already_complete.
+  bool still_held(std::int64_t task_id) const;
+
+ private:
+  void run();
+
+  TaskClient client_;
+  mutable std::mutex mutex_;
+  std::condition_variable wake_;
+  std::set<std::int64_t> held_;
+  std::set<std::int64_t> lost_;
+  std::chrono::milliseconds period_{20000};
+  bool released_ = false;  // next heartbeat must go out to drop leases
+  bool stop_ = false;
+  std::thread thread_;
+};
+
+}  // namespace dashcam::worker
@@ -0,0 +1,108 @@
+#include "worker/task/task_client.hpp"
+
+#include <cstdlib>
+#include <stdexcept>
+#include <utility>
+
+#include "common/json_util.hpp"
+
+namespace dashcam::worker {
+
+TaskClient::TaskClient(std::string host, unsigned short port, std::string worker_id)
+    : http_(std::move(host), port), worker_id_(std::move(worker_id)) {}
+
+std::string default_worker_id() {
+  for (const char* var : {"COMPUTERNAME", "HOSTNAME"}) {
+    if (const char* value = std::getenv(var); value != nullptr && *value != '\0') {
+      return value;
+    }
+  }
+  return http::local_host_name();
+}
+
+Json::Value TaskClient::call(std::string_view target, const Json::Value& body) {
+  http::Response response = http_.post(target, to_json_string(body));
+  if (response.status != 200) {
+    throw std::runtime_error("task server: " + std::string(target) + " returned " +
+                             std::to_string(response.status) + ": " + response.body);
+  }
+  return parse_json(response.body);
+}
+
+std::vector<Task> TaskClient::pull(std::span<const std::string> task_types, std::size_t limit,
+                                   std::chrono::milliseconds wait) {
+  Json::Value body(Json::objectValue);
+  body["worker_id"] = worker_id_;
+  body["task_types"] = Json::Value(Json::arrayValue);
+  for (const std::string& type : task_types) {
+    body["task_types"].append(type);
+  }
+  body["limit"] = Json::UInt64(limit);
+  if (wait.count() > 0) {
+    body["wait_ms"] = Json::Int64(wait.count());
+  }
+  Json::Value response = call("/tasks/pull", body);
+  if (response["lease_ttl_ms"].isIntegral()) {
+    lease_ttl_ = std::chrono::milliseconds(response["lease_ttl_ms"].asInt64());
+  }
+  std::vector<Task> tasks;
+  for (const Json::Value& item : response["tasks"]) {
+    tasks.push_back(task_from_json(item));
+  }
+  return tasks;
+}
+
+std::vector<std::int64_t> TaskClient::heartbeat(std::span<const std::int64_t> task_ids) {
+  Json::Value body(Json::objectValue);
+  body["worker_id"] = worker_id_;
+  body["task_ids"] = Json::Value(Json::arrayValue);
+  for (std::int64_t id : task_ids) {
+    body["task_ids"].append(Json::Int64(id));
+  }
+  Json::Value response = call("/tasks/heartbeat", body);
+  std::vector<std::int64_t> lost;
+  for (const Json::Value& id : response["lost"]) {
+    lost.push_back(id.asInt64());
+  }
+  return lost;
+}
+
+void TaskClient::fail(std::span<const std::int64_t> task_ids) {
+  Json::Value body(Json::objectValue);
+  body["worker_id"] = worker_id_;
+  body["task_ids"] = Json::Value(Json::arrayValue);
+  for (std::int64_t id : task_ids) {
+    body["task_ids"].append(Json::Int64(id));
+  }
+  call("/tasks/fail", body);
+}
+
+std::vector<CompletionResult> TaskClient::complete(std::span<const TaskCompletion> completions) {
+  Json::Value body(Json::objectValue);
+  body["completions"] = Json::Value(Json::arrayValue);
+  for (const TaskCompletion& c : completions) {
+    body["completions"].append(to_json(c));
+  }
+  Json::Value response = call("/tasks/complete", body);
+  std::vector<CompletionResult> results;
+  for (const Json::Value& item : response["results"]) {
+    results.push_back(completion_result_from_json(item));
+  }
+  return results;
+}
+
+std::vector<std::int64_t> TaskClient::create(std::span<const NewTask> tasks) {
+  Json::Value body(Json::objectValue);
+  body["tasks"] = Json::Value(Json::arrayValue);
+  for (const NewTask& task : tasks) {
+    body["tasks"].append(to_json(task));
+  }
+  Json::Value response = call("/tasks", body);
+  std::vector<std::int64_t> ids;
+  for (const Json::Value& id : response["task_ids"]) {
+    ids.push_back(id.asInt64());
+  }
+  return ids;
+}
+
+}  // namespace dashcam::worker
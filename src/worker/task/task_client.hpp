@@ -0,0 +1,58 @@
+#pragma once
+
+#include <chrono>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "common/http/http_client.hpp"
+#include "common/task.hpp"
+
+namespace dashcam::worker {
+
+// Worker side of the task endpoints (server/task_api.hpp). Throws
+// std::runtime_error when the server is unreachable or rejects a call.
+class TaskClient {
+ public:
+  // `worker_id` names this device to the server's lease table; it must be
+  // stable across restarts so a restarted worker gets its own tasks back.
+  TaskClient(std::string host, unsigned short port, std::string worker_id);
+
+  const std::string& worker_id() const { return worker_id_; }
+
+  // Up to `limit` oldest pending tasks of the given types, in one round trip.
+  // Each comes with a soft lease that expires unless heartbeat() renews it
+  // within lease_ttl(). With a non-zero `wait` the server holds the call
+  // until a matching task is published, returning empty only after `wait`.
+  std::vector<Task> pull(std::span<const std::string> task_types, std::size_t limit,
+                         std::chrono::milliseconds wait = std::chrono::milliseconds(0));
+
+  // Renews the leases on `task_ids` (every task still in progress; leases
+  // not listed are released). Returns the ids whose lease was lost.
+  std::vector<std::int64_t> heartbeat(std::span<const std::int64_t> task_ids);
+
+  // Reports tasks this worker failed; the server holds each back from every
+  // puller for a delay that grows with its failures.
+  void fail(std::span<const std::int64_t> task_ids);
+
+  // As reported by the last pull.
+  std::chrono::milliseconds lease_ttl() const { return lease_ttl_; }
+
+  // Completes tasks and publishes their remote tasks atomically, in one
+  // round trip. Safe to retry: an already-complete task publishes nothing.
+  std::vector<CompletionResult> complete(std::span<const TaskCompletion> completions);
+
+  std::vector<std::int64_t> create(std::span<const NewTask> tasks);
+
+ private:
+  Json::Value call(std::string_view target, const Json::Value& body);
+
+  http::HttpClient http_;
+  std::string worker_id_;
+  std::chrono::milliseconds lease_ttl_{60000};
+};
+
+// Default worker id: the host name.
+std::string default_worker_id();
+
+}  // namespace dashcam::worker
@@ -0,0 +1,117 @@
+#include "worker/throttle/activity_governor.hpp"
+
+#include <cstdio>
+#include <exception>
+#include <utility>
+
+#include "common/metrics.hpp"
+
+namespace dashcam::worker {
+
+const char* to_string(ActivityMode mode) {
+  switch (mode) {
+    case ActivityMode::Full:
+      return "full";
+    case ActivityMode::Throttled:
+      return "throttled";
+    case ActivityMode::Paused:
+      return "paused";
+  }
+  return "unknown";
+}
+
+ActivityMode classify(const GovernorConfig& config, const ActivitySample& sample) {
+  double gpu = sample.other_gpu.value_or(0.0);
+  if (sample.pause_requested || !sample.watched.empty() || gpu >= config.gpu_pause) {
+    return ActivityMode::Paused;
+  }
+  if (sample.other_cpu >= config.cpu_busy || gpu >= config.gpu_busy) {
+    return ActivityMode::Throttled;
+  }
+  return ActivityMode::Full;
+}
+
+ActivityGovernor::ActivityGovernor(GovernorConfig config, std::shared_ptr<PipelineGate> gate)
+    : config_(std::move(config)), gate_(std::move(gate)), probe_(config_.probe) {
+  thread_ = std::thread([this] { run(); });
+}
+
+ActivityGovernor::~ActivityGovernor() {
+  {
+    std::lock_guard lock(mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  thread_.join();
+  // Nothing holds the pipelines back once the governor is gone.
+  gate_->set(ThrottleLevel{});
+}
+
+ActivityMode ActivityGovernor::mode() const {
+  std::lock_guard lock(mutex_);
+  return mode_;
+}
+
+void ActivityGovernor::run() {
+  std::unique_lock lock(mutex_);
+  while (!wake_.wait_for(lock, config_.poll, [this] { return stopping_; })) {
+    lock.unlock();
+    std::optional<ActivitySample> sample;
+    try {
+      sample = probe_.sample();
+    } catch (const std::exception& e) {
+      // A probe that cannot read /proc leaves the mode as it was.
+      std::fprintf(stderr, "activity probe failed: %s\n", e.what());
+    }
+    lock.lock();
+    if (sample) {
+      update(classify(config_, *sample), *sample, std::chrono::steady_clock::now());
+    }
+  }
+}
+
+void ActivityGovernor::update(ActivityMode wanted, const ActivitySample& sample,
+                              std::chrono::steady_clock::time_point now) {
+  if (wanted >= mode_) {
+    calm_since_.reset();
+    if (wanted == mode_) {
+      return;
+    }
+  } else {
+    if (!calm_since_) {
+      calm_since_ = now;
+    }
+    if (now - *calm_since_ < config_.settle) {
+      return;
+    }
+    calm_since_.reset();
+  }
+
+  static Gauge& mode = default_metrics().gauge(
+      "dashcam_worker_activity_mode", "Activity governor mode: 0 full, 1 throttled, 2 paused.");
+  mode.set(static_cast<double>(wanted));
+  mode_ = wanted;
+  ThrottleLevel level;
+  if (wanted == ActivityMode::Throttled) {
+    level = config_.throttled;
+    level.paused = false;
+  } else if (wanted == ActivityMode::Paused) {
+    level.paused = true;
+  }
+  gate_->set(level);
+
+  std::string reason;
+  if (sample.pause_requested) {
+    reason = "pause file present";
+  } else if (!sample.watched.empty()) {
+    reason = sample.watched.front() + " running";
+  } else {
+    char text[96];
+    std::snprintf(text, sizeof text, "other CPU %.0f%%, other GPU %.0f%%", sample.other_cpu * 100,
+                  sample.other_gpu.value_or(0.0) * 100);
+    reason = text;
+  }
+  std::fprintf(stderr, "activity: %s (%s)\n", to_string(wanted), reason.c_str());
+}
+
+}  // namespace dashcam::worker
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+#include "worker/pipeline/pipeline_gate.hpp"
+#include "worker/throttle/activity_probe.hpp"
+
+namespace dashcam::worker {
+
+enum class ActivityMode { Full, Throttled, Paused };
+
+const char* to_string(ActivityMode mode);
+
+struct GovernorConfig {
+  ProbeConfig probe;
+  std::chrono::milliseconds poll{1000};
+  // Other programs' shares that make the worker back off: above cpu_busy or
+  // gpu_busy it runs throttled, above gpu_pause (or with a watched process
+  // running, or the pause file present) it pauses.
+  double cpu_busy = 0.5;
+  double gpu_busy = 0.10;
+  double gpu_pause = 0.40;
+  ThrottleLevel throttled{false, 0.25, 4};
+  // Backing off is immediate; stepping back up waits until the lower mode
+  // has been called for this long without a break.
+  std::chrono::milliseconds settle{5000};
+};
+
+// Mode for one sample, before any settling.
+ActivityMode classify(const GovernorConfig& config, const ActivitySample& sample);
+
+// The workhorse yields to its user (workhorse.md §7, §8): a background
+// thread samples foreground activity and throttles, pauses or releases
+// every pipeline through the shared gate. A pause stops the stages at their
+// next item boundary (the GPU batch in flight finishes) with their frames
+// and state kept in memory, leases still renewed, so a task carries on
+// where it stopped once the user is done.
+class ActivityGovernor {
+ public:
+  ActivityGovernor(GovernorConfig config, std::shared_ptr<PipelineGate> gate);
+  ~ActivityGovernor();
+
+  ActivityGovernor(const ActivityGovernor&) = delete;
+  ActivityGovernor& operator=(const ActivityGovernor&) = delete;
+
+  ActivityMode mode() const;
+
+ private:
+  void run();
+  // Applies a sample's mode: escalations at once, de-escalations once settled.
+  void update(ActivityMode wanted, const ActivitySample& sample,
+              std::chrono::steady_clock::time_point now);
+
+  GovernorConfig config_;
+  std::shared_ptr<PipelineGate> gate_;
+  ActivityProbe probe_;
+  ActivityMode mode_ = ActivityMode::Full;
+  std::optional<std::chrono::steady_clock::time_point> calm_since_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable wake_;
+  bool stopping_ = false;
+  std::thread thread_;
+};
+
+}  // namespace dashcam::worker
@@ -0,0 +1,169 @@
+#include "worker/throttle/activity_probe.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <system_error>
+#include <utility>
+
+#if DASHCAM_WITH_CUDA
+#include <nvml.h>
+#endif
+
+namespace dashcam::worker {
+
+namespace {
+
+// /proc/<pid>/comm keeps this many characters of the name.
+constexpr std::size_t kCommLength = 15;
+
+}  // namespace
+
+ActivityProbe::ActivityProbe(ProbeConfig config) : config_(std::move(config)) {
+  last_cpu_ = read_cpu();
+#if DASHCAM_WITH_CUDA
+  if (nvmlInit_v2() == NVML_SUCCESS) {
+    nvml_ = true;
+    for (int index : config_.gpus) {
+      nvmlDevice_t device = nullptr;
+      if (nvmlDeviceGetHandleByIndex_v2(static_cast<unsigned>(index), &device) == NVML_SUCCESS) {
+        nvml_devices_.push_back(device);
+        nvml_seen_.push_back(0);
+      }
+    }
+  } else {
+    std::fprintf(stderr, "NVML unavailable; GPU use by other programs is not watched\n");
+  }
+#endif
+}
+
+ActivityProbe::~ActivityProbe() {
+#if DASHCAM_WITH_CUDA
+  if (nvml_) {
+    nvmlShutdown();
+  }
+#endif
+}
+
+ActivitySample ActivityProbe::sample() {
+  ActivitySample out;
+  CpuTimes now = read_cpu();
+  if (now.total > last_cpu_.total) {
+    std::uint64_t busy = now.busy - std::min(now.busy, last_cpu_.busy);
+    std::uint64_t self = now.self - std::min(now.self, last_cpu_.self);
+    double others = static_cast<double>(busy - std::min(busy, self));
+    out.other_cpu = std::clamp(others / static_cast<double>(now.total - last_cpu_.total), 0.0, 1.0);
+  }
+  last_cpu_ = now;
+  out.other_gpu = other_gpu();
+  out.watched = find_watched();
+  if (!config_.pause_file.empty()) {
+    std::error_code ec;
+    out.pause_requested = std::filesystem::exists(config_.pause_file, ec);
+  }
+  return out;
+}
+
+ActivityProbe::CpuTimes ActivityProbe::read_cpu() {
+  CpuTimes times;
+  // cpu  user nice system idle iowait irq softirq steal ...
+  std::ifstream stat("/proc/stat");
+  std::string label;
+  stat >> label;
+  std::uint64_t value = 0;
+  for (int field = 0; field < 8 && stat >> value; ++field) {
+    times.total += value;
+    if (field != 3 && field != 4) {
+      times.busy += value;
+    }
+  }
+  // utime and stime are fields 14 and 15, after the parenthesised name,
+  // which may itself contain spaces.
+  std::ifstream self("/proc/self/stat");
+  std::string line;
+  std::getline(self, line);
+  auto close = line.rfind(')');
+  if (close != std::string::npos) {
+    std::istringstream rest(line.substr(close + 1));
+    std::string field;
+    for (int i = 3; i <= 15 && rest >> field; ++i) {
+      if (i >= 14) {
+        times.self += std::stoull(field);
+      }
+    }
+  }
+  return times;
+}
+
+std::vector<std::string> ActivityProbe::find_watched() const {
+  std::vector<std::string> found;
+  if (config_.watch.empty()) {
+    return found;
+  }
+  std::error_code ec;
+  for (const auto& entry : std::filesystem::directory_iterator("/proc", ec)) {
+    const std::string pid = entry.path().filename().string();
+    if (pid.empty() || !std::all_of(pid.begin(), pid.end(), [](unsigned char c) {
+          return std::isdigit(c) != 0;
+        })) {
+      continue;
+    }
+    std::ifstream comm(entry.path() / "comm");
+    std::string name;
+    if (!std::getline(comm, name)) {
+      continue;  // exited meanwhile
+    }
+    for (const std::string& watched : config_.watch) {
+      if (watched.substr(0, kCommLength) == name &&
+          std::find(found.begin(), found.end(), watched) == found.end()) {
+        found.push_back(watched);
+      }
+    }
+  }
+  return found;
+}
+
+std::optional<double> ActivityProbe::other_gpu() {
+#if DASHCAM_WITH_CUDA
+  if (nvml_devices_.empty()) {
+    return std::nullopt;
+  }
+  const unsigned self = static_cast<unsigned>(::getpid());
+  double busiest = 0.0;
+  for (std::size_t i = 0; i < nvml_devices_.size(); ++i) {
+    auto device = static_cast<nvmlDevice_t>(nvml_devices_[i]);
+    // Per-process samples newer than the last call; the first call only
+    // asks how many there are.
+    unsigned count = 0;
+    nvmlReturn_t status = nvmlDeviceGetProcessUtilization(device, nullptr, &count, nvml_seen_[i]);
+    if (status == NVML_ERROR_NOT_FOUND || count == 0) {
+      continue;  // nobody ran since the last sample
+    }
+    if (status != NVML_ERROR_INSUFFICIENT_SIZE && status != NVML_SUCCESS) {
+      continue;
+    }
+    std::vector<nvmlProcessUtilizationSample_t> samples(count);
+    if (nvmlDeviceGetProcessUtilization(device, samples.data(), &count, nvml_seen_[i]) !=
+        NVML_SUCCESS) {
+      continue;
+    }
+    double others = 0.0;
+    for (unsigned s = 0; s < count; ++s) {
+      nvml_seen_[i] = std::max(nvml_seen_[i], samples[s].timeStamp);
+      if (samples[s].pid != self) {
+        others += samples[s].smUtil / 100.0;
+      }
+    }
+    busiest = std::max(busiest, std::min(others, 1.0));
+  }
+  return busiest;
+#else
+  return std::nullopt;
+#endif
+}
+
+}  // namespace dashcam::worker
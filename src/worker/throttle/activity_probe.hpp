@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace dashcam::worker {
+
+// What the rest of the machine is doing, as seen between two samples. Our
+// own process is left out of every share.
+struct ActivitySample {
+  // Busy share of all cores used by other processes, in [0, 1].
+  double other_cpu = 0.0;
+  // SM utilization of other processes on the busiest watched GPU, in
+  // [0, 1]; unknown without NVML (CPU-only builds).
+  std::optional<double> other_gpu;
+  // Watched processes (games) found running.
+  std::vector<std::string> watched;
+  // The pause file exists.
+  bool pause_requested = false;
+};
+
+struct ProbeConfig {
+  // Process names to look for, as in /proc/<pid>/comm; names longer than
+  // the kernel's 15 characters match on their first 15.
+  std::vector<std::string> watch;
+  // Created by the user or a launcher script to pause the worker by hand.
+  std::filesystem::path pause_file;
+  std::vector<int> gpus;  // devices whose other users count
+};
+
+// Samples foreground load from /proc (CPU, processes) and NVML (GPU). Each
+// sample covers the time since the previous one, so the first is of the
+// time since construction. Not thread-safe.
+class ActivityProbe {
+ public:
+  explicit ActivityProbe(ProbeConfig config);
+  ~ActivityProbe();
+
+  ActivityProbe(const ActivityProbe&) = delete;
+  ActivityProbe& operator=(const ActivityProbe&) = delete;
+
+  ActivitySample sample();
+
+ private:
+  struct CpuTimes {
+    std::uint64_t total = 0;  // clock ticks, all cores
+    std::uint64_t busy = 0;
+    std::uint64_t self = 0;   // this process
+  };
+
+  static CpuTimes read_cpu();
+  std::vector<std::string> find_watched() const;
+  std::optional<double> other_gpu();
+
+  ProbeConfig config_;
+  CpuTimes last_cpu_;
+  // NVML device handles and the newest sample time seen on each.
+  bool nvml_ = false;
+  std::vector<void*> nvml_devices_;
+  std::vector<unsigned long long> nvml_seen_;
+};
+
+}  // namespace dashcam::worker
@@ -0,0 +1,72 @@
+#include "worker/tracking/kalman_box.hpp"
+
+#include <algorithm>
+
+namespace dashcam::worker {
+
+void KalmanBox::Axis::predict(float dt, float q) {
+  pos += vel * dt;
+  // P = F P F' + Q with the white-acceleration Q.
+  float dt2 = dt * dt;
+  p00 += dt * (2.0f * p01 + dt * p11) + q * dt2 * dt2 / 4.0f;
+  p01 += dt * p11 + q * dt2 * dt / 2.0f;
+  p11 += q * dt2;
+}
+
+void KalmanBox::Axis::update(float z, float r) {
+  float s = p00 + r;
+  float k0 = p00 / s;
+  float k1 = p01 / s;
+  float y = z - pos;
+  pos += k0 * y;
+  vel += k1 * y;
+  float n00 = (1.0f - k0) * p00;
+  float n01 = (1.0f - k0) * p01;
+  float n11 = p11 - k1 * p01;
+  p00 = n00;
+  p01 = n01;
+  p11 = n11;
+}
+
+KalmanBox::KalmanBox(const Box& box, Noise noise) : noise_(noise) {
+  float h = std::max(box.height(), 1.0f);
+  float r = noise_.measurement * h * noise_.measurement * h;
+  // Velocity starts unknown: a large variance lets the second hit set it.
+  for (Axis* a : {&cx_, &cy_, &w_, &h_}) {
+    a->p00 = r;
+    a->p11 = 4.0f * h * h;
+  }
+  cx_.pos = (box.x0 + box.x1) * 0.5f;
+  cy_.pos = (box.y0 + box.y1) * 0.5f;
+  w_.pos = box.width();
+  h_.pos = box.height();
+  predicted_ = box;
+}
+
+const Box& KalmanBox::predict(float frames) {
+  float h = std::max(h_.pos, 1.0f);
+  float q = noise_.process * h * noise_.process * h;
+  for (Axis* a : {&cx_, &cy_, &w_, &h_}) {
+    a->predict(frames, q);
+  }
+  predicted_ = to_box();
+  return predicted_;
+}
+
+void KalmanBox::update(const Box& box) {
+  float h = std::max(box.height(), 1.0f);
+  float r = noise_.measurement * h * noise_.measurement * h;
+  cx_.update((box.x0 + box.x1) * 0.5f, r);
+  cy_.update((box.y0 + box.y1) * 0.5f, r);
+  w_.update(box.width(), r);
+  h_.update(box.height(), r);
+  predicted_ = to_box();
+}
+
+Box KalmanBox::to_box() const {
+  float w = std::max(w_.pos, 1.0f) * 0.5f;
+  float h = std::max(h_.pos, 1.0f) * 0.5f;
+  return {cx_.pos - w, cy_.pos - h, cx_.pos + w, cy_.pos + h};
+}
+
+}  // namespace dashcam::worker
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "worker/inference/detection.hpp"
+
+namespace dashcam::worker {
+
+// Constant-velocity Kalman filter over a box's centre and size, one
+// independent position/velocity filter per coordinate (the SORT model with a
+// diagonal covariance). Time is in frames, so gaps left by the motion filter
+// are predicted across rather than treated as a single step.
+class KalmanBox {
+ public:
+  struct Noise {
+    // Both are relative to the box height, so near and far plates track
+    // equally well.
+    float process = 0.05f;      // acceleration std-dev per frame
+    float measurement = 0.10f;  // detector jitter std-dev
+  };
+
+  KalmanBox(const Box& box, Noise noise);
+
+  const Box& predict(float frames);
+  void update(const Box& box);
+
+  Box box() const { return predicted_; }
+
+ private:
+  struct Axis {
+    float pos = 0;
+    float vel = 0;
+    float p00 = 0;
+    float p01 = 0;
+    float p11 = 0;
+
+    void predict(float dt, float q);
+    void update(float z, float r);
+  };
+
+  Box to_box() const;
+
+  Noise noise_;
+  Axis cx_;
+  Axis cy_;
+  Axis w_;
+  Axis h_;
+  Box predicted_;
+};
+
+}  // namespace dashcam::worker
@@ -0,0 +1,80 @@
+#include "worker/tracking/plate_tracker.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+namespace dashcam::worker {
+
+PlateTracker::PlateTracker(TrackerConfig config) : config_(config) {}
+
+void PlateTracker::update(std::int64_t frame_index, std::span<Detection> detections) {
+  float dt = last_frame_ < 0 ? 0.0f : static_cast<float>(frame_index - last_frame_);
+  last_frame_ = frame_index;
+
+  for (Track& t : tracks_) {
+    t.filter.predict(dt);
+  }
+
+  struct Pair {
+    float iou;
+    std::size_t track;
+    std::size_t det;
+  };
+  std::vector<Pair> pairs;
+  for (std::size_t d = 0; d < detections.size(); ++d) {
+    if (detections[d].cls != ObjectClass::Plate) {
+      continue;
+    }
+    for (std::size_t t = 0; t < tracks_.size(); ++t) {
+      float overlap = iou(tracks_[t].filter.box(), detections[d].box);
+      if (overlap >= config_.min_iou) {
+        pairs.push_back({overlap, t, d});
+      }
+    }
+  }
+  std::sort(pairs.begin(), pairs.end(), [](const Pair& a, const Pair& b) { return a.iou > b.iou; });
+
+  std::vector<bool> track_used(tracks_.size(), false);
+  std::vector<bool> det_used(detections.size(), false);
+  for (const Pair& p : pairs) {
+    if (track_used[p.track] || det_used[p.det]) {
+      continue;
+    }
+    track_used[p.track] = true;
+    det_used[p.det] = true;
+    Track& t = tracks_[p.track];
+    t.filter.update(detections[p.det].box);
+    t.last_frame = frame_index;
+    ++t.hits;
+    detections[p.det].track_id = t.id;
+  }
+
+  for (std::size_t d = 0; d < detections.size(); ++d) {
+    Detection& det = detections[d];
+    if (det.cls != ObjectClass::Plate || det_used[d] || det.score < config_.min_start_score) {
+      continue;
+    }
+    det.track_id = next_id_;
+    tracks_.push_back({next_id_++, KalmanBox(det.box, config_.noise), frame_index, frame_index, 1});
+  }
+
+  auto stale = std::stable_partition(tracks_.begin(), tracks_.end(), [&](const Track& t) {
+    return frame_index - t.last_frame <= config_.max_gap_frames;
+  });
+  std::move(stale, tracks_.end(), std::back_inserter(retired_));
+  tracks_.erase(stale, tracks_.end());
+}
+
+std::vector<Track> PlateTracker::take_retired() {
+  std::vector<Track> out = std::move(retired_);
+  retired_.clear();
+  return out;
+}
+
+void PlateTracker::finish() {
+  std::move(tracks_.begin(), tracks_.end(), std::back_inserter(retired_));
+  tracks_.clear();
+}
+
+}  // namespace dashcam::worker
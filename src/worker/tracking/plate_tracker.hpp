@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "worker/inference/detection.hpp"
+#include "worker/tracking/kalman_box.hpp"
+
+namespace dashcam::worker {
+
+struct TrackerConfig {
+  // Minimum IoU between a track's predicted box and a detection to match.
+  float min_iou = 0.2f;
+  // Detections below this score update tracks but never start one.
+  float min_start_score = 0.4f;
+  // A track with no match for this many frames is retired. Counted in decoded
+  // frames, so frames dropped by the motion filter count too.
+  std::int64_t max_gap_frames = 30;
+  KalmanBox::Noise noise;
+};
+
+struct Track {
+  int id = 0;
+  KalmanBox filter;
+  std::int64_t first_frame = 0;
+  std::int64_t last_frame = 0;
+  std::int64_t hits = 0;
+};
+
+// IoU tracker with Kalman prediction (SORT-style) for plate detections in
+// one video. Frames must be fed in decode order.
+class PlateTracker {
+ public:
+  explicit PlateTracker(TrackerConfig config = {});
+
+  // Sets track_id on every plate detection of this frame (other classes are
+  // left at -1). Matching is greedy by IoU, which is as good as optimal
+  // assignment when plates rarely overlap.
+  void update(std::int64_t frame_index, std::span<Detection> detections);
+
+  // Tracks retired since the last call, oldest first. finish() retires
+  // everything still open.
+  std::vector<Track> take_retired();
+  void finish();
+
+  std::size_t active() const { return tracks_.size(); }
+
+ private:
+  TrackerConfig config_;
+  std::vector<Track> tracks_;
+  std::vector<Track> retired_;
+  std::int64_t last_frame_ = -1;
+  int next_id_ = 0;
+};
+
+}  // namespace dashcam::worker
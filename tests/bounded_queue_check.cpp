@@ -0,0 +1,117 @@
+// BoundedQueue ordering: FIFO through many wrap-arounds on one thread, and
+// with several producers and consumers every item is delivered exactly once
+// with each producer's items seen in push order by every consumer. close()
+// lets consumers drain what is left and then stop.
+//
+//   bounded_queue_check [items per producer]
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "worker/pipeline/bounded_queue.hpp"
+
+using dashcam::worker::BoundedQueue;
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const std::string& what) {
+  if (!ok && ++failures <= 10) {
+    std::fprintf(stderr, "%s\n", what.c_str());
+  }
+}
+
+void check_single_thread() {
+  BoundedQueue<int> queue(5);
+  check(queue.capacity() == 8, "capacity should round up to a power of two");
+  int next_in = 0;
+  int next_out = 0;
+  for (int round = 0; round < 100; ++round) {
+    // Fill to capacity, then drain part of it, so positions wrap often.
+    while (true) {
+      int value = next_in;
+      if (!queue.try_push(std::move(value))) {
+        break;
+      }
+      ++next_in;
+    }
+    check(queue.size() == queue.capacity(), "full queue size wrong");
+    for (int i = 0; i < 3 + round % 5; ++i) {
+      std::optional<int> value = queue.try_pop();
+      check(value && *value == next_out, "single thread: out of order");
+      ++next_out;
+    }
+  }
+  queue.close();
+  int rejected = -1;
+  check(!queue.try_push(std::move(rejected)) && !queue.push(std::move(rejected)),
+        "push accepted after close");
+  while (std::optional<int> value = queue.pop()) {
+    check(*value == next_out++, "drain after close: out of order");
+  }
+  check(next_out == next_in, "drain after close lost items");
+}
+
+void check_threads(int per_producer) {
+  constexpr int kProducers = 4;
+  constexpr int kConsumers = 4;
+  // Small, so producers block on a full queue and consumers on an empty one.
+  BoundedQueue<std::pair<int, int>> queue(16);
+
+  std::vector<std::vector<std::pair<int, int>>> received(kConsumers);
+  std::vector<std::thread> consumers;
+  for (int c = 0; c < kConsumers; ++c) {
+    consumers.emplace_back([&, c] {
+      while (std::optional<std::pair<int, int>> item = queue.pop()) {
+        received[c].push_back(*item);
+      }
+    });
+  }
+  std::vector<std::thread> producers;
+  for (int p = 0; p < kProducers; ++p) {
+    producers.emplace_back([&, p] {
+      for (int i = 0; i < per_producer; ++i) {
+        queue.push({p, i});
+      }
+    });
+  }
+  for (std::thread& t : producers) {
+    t.join();
+  }
+  queue.close();
+  for (std::thread& t : consumers) {
+    t.join();
+  }
+
+  std::vector<std::vector<int>> seen(kProducers, std::vector<int>(per_producer, 0));
+  for (int c = 0; c < kConsumers; ++c) {
+    std::vector<int> last(kProducers, -1);
+    for (const auto& [p, i] : received[c]) {
+      check(i > last[p], "consumer " + std::to_string(c) + " saw producer " +
+                             std::to_string(p) + " out of order");
+      last[p] = i;
+      ++seen[p][i];
+    }
+  }
+  for (int p = 0; p < kProducers; ++p) {
+    for (int i = 0; i < per_producer; ++i) {
+      check(seen[p][i] == 1, "item " + std::to_string(p) + "/" + std::to_string(i) +
+                                 " delivered " + std::to_string(seen[p][i]) + " times");
+    }
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int per_producer = argc > 1 ? std::atoi(argv[1]) : 200000;
+  check_single_thread();
+  check_threads(per_producer);
+  std::printf("bounded_queue_check: %d failures\n", failures);
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,185 @@
+// Checkpoint segments round-trip: what CheckpointWriter records comes back
+// from CheckpointStore::load for every complete segment, resuming a writer
+// does not rewrite them, and a damaged, truncated or foreign segment ends
+// the resume there instead of being read.
+//
+//   checkpoint_check
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "worker/heavy/checkpoint.hpp"
+
+using namespace dashcam::worker;
+
+namespace {
+
+constexpr std::int64_t kSegmentFrames = 100;
+constexpr std::int64_t kFirstFrame = 3000;  // a shard that starts mid-video
+
+int failures = 0;
+
+void check(bool ok, const std::string& what) {
+  if (!ok && ++failures <= 10) {
+    std::fprintf(stderr, "%s\n", what.c_str());
+  }
+}
+
+using Frames = std::unordered_map<std::int64_t, std::vector<Detection>>;
+
+bool same(const Detection& a, const Detection& b) {
+  return a.box.x0 == b.box.x0 && a.box.y0 == b.box.y0 && a.box.x1 == b.box.x1 &&
+         a.box.y1 == b.box.y1 && a.score == b.score && a.cls == b.cls &&
+         a.model_class == b.model_class;
+}
+
+// `want` restricted to frames below `end`.
+bool matches(const Frames& got, const Frames& want, std::int64_t end) {
+  std::size_t expected = 0;
+  for (const auto& [frame, detections] : want) {
+    if (frame >= end) {
+      continue;
+    }
+    ++expected;
+    auto it = got.find(frame);
+    if (it == got.end() || it->second.size() != detections.size()) {
+      return false;
+    }
+    for (std::size_t i = 0; i < detections.size(); ++i) {
+      if (!same(it->second[i], detections[i])) {
+        return false;
+      }
+    }
+  }
+  return got.size() == expected;
+}
+
+// Every third frame kept, with up to three detections; some kept frames
+// have none.
+Frames make_frames(std::int64_t end, std::mt19937_64& rng) {
+  std::uniform_real_distribution<float> coord(0.0f, 1920.0f);
+  Frames frames;
+  for (std::int64_t f = kFirstFrame; f < end; f += 3) {
+    std::vector<Detection>& detections = frames[f];
+    for (int i = std::uniform_int_distribution<int>(0, 3)(rng); i > 0; --i) {
+      Detection d;
+      d.box = {coord(rng), coord(rng), coord(rng), coord(rng)};
+      d.score = std::uniform_real_distribution<float>(0.0f, 1.0f)(rng);
+      d.cls = static_cast<ObjectClass>(i % 3);
+      d.model_class = i * 7;
+      detections.push_back(d);
+    }
+  }
+  return frames;
+}
+
+void record(CheckpointWriter& writer, const Frames& frames, std::int64_t from, std::int64_t end) {
+  for (std::int64_t f = from; f < end; ++f) {
+    if (auto it = frames.find(f); it != frames.end()) {
+      writer.record(f, it->second);
+    }
+  }
+}
+
+std::filesystem::path segment(const std::filesystem::path& dir, int index) {
+  char name[32];
+  std::snprintf(name, sizeof(name), "seg-%06d.ckpt", index);
+  return dir / name;
+}
+
+}  // namespace
+
+int main() {
+  std::filesystem::path root = std::filesystem::temp_directory_path() /
+                               ("checkpoint_check-" + std::to_string(std::random_device{}()));
+  std::filesystem::remove_all(root);
+
+  CheckpointConfig config;
+  config.dir = root;
+  config.segment_frames = kSegmentFrames;
+  CheckpointStore store(config);
+  CheckpointKey key;
+  key.video_name = "front 2024/05";
+  key.video_hash = 1;
+  key.model_hash = 2;
+  key.params_hash = 3;
+  std::filesystem::path dir = store.entry_dir(key);
+  check(dir.parent_path() == root, "entry dir escapes the checkpoint dir");
+
+  std::mt19937_64 rng(7);
+  const std::int64_t end = kFirstFrame + 5 * kSegmentFrames + 40;
+  Frames frames = make_frames(end, rng);
+
+  // Nothing on disk yet: resume from the start.
+  CheckpointResume empty = store.load(key, kFirstFrame);
+  check(empty.end_frame == kFirstFrame && empty.detections.empty(), "empty entry not empty");
+
+  // Interrupted partway through segment 2: segments 0 and 1 are on disk.
+  {
+    CheckpointWriter writer(dir, kSegmentFrames, kFirstFrame, kFirstFrame);
+    record(writer, frames, kFirstFrame, kFirstFrame + 2 * kSegmentFrames + 50);
+  }
+  CheckpointResume partial = store.load(key, kFirstFrame);
+  check(partial.end_frame == kFirstFrame + 2 * kSegmentFrames, "partial run: wrong end frame");
+  check(matches(partial.detections, frames, partial.end_frame), "partial run: detections differ");
+
+  // Resumed: the writer skips what is covered and carries on.
+  std::filesystem::file_time_type first_written =
+      std::filesystem::last_write_time(segment(dir, 0));
+  {
+    CheckpointWriter writer(dir, kSegmentFrames, kFirstFrame, partial.end_frame);
+    record(writer, frames, kFirstFrame, end);
+  }
+  check(std::filesystem::last_write_time(segment(dir, 0)) == first_written,
+        "resume rewrote a covered segment");
+  CheckpointResume full = store.load(key, kFirstFrame);
+  check(full.end_frame == kFirstFrame + 5 * kSegmentFrames, "resumed run: wrong end frame");
+  check(matches(full.detections, frames, full.end_frame), "resumed run: detections differ");
+
+  // Loaded for another range start, no segment matches.
+  check(store.load(key, kFirstFrame + 1).end_frame == kFirstFrame + 1,
+        "segments accepted for another range");
+  CheckpointConfig other = config;
+  other.segment_frames = kSegmentFrames * 2;
+  check(CheckpointStore(other).load(key, kFirstFrame).end_frame == kFirstFrame,
+        "segments accepted with another segment size");
+
+  // One flipped byte in segment 3's payload: resume stops before it.
+  {
+    std::fstream file(segment(dir, 3), std::ios::in | std::ios::out | std::ios::binary);
+    file.seekg(40);
+    char byte = 0;
+    file.read(&byte, 1);
+    file.seekp(40);
+    byte = static_cast<char>(byte ^ 0x10);
+    file.write(&byte, 1);
+  }
+  CheckpointResume damaged = store.load(key, kFirstFrame);
+  check(damaged.end_frame == kFirstFrame + 3 * kSegmentFrames, "damaged segment accepted");
+  check(matches(damaged.detections, frames, damaged.end_frame),
+        "damaged segment: earlier detections differ");
+
+  // Truncated segment 1, and a bad magic on segment 0.
+  std::filesystem::resize_file(segment(dir, 1), std::filesystem::file_size(segment(dir, 1)) - 5);
+  check(store.load(key, kFirstFrame).end_frame == kFirstFrame + kSegmentFrames,
+        "truncated segment accepted");
+  {
+    std::fstream file(segment(dir, 0), std::ios::in | std::ios::out | std::ios::binary);
+    file.write("XXXX", 4);
+  }
+  CheckpointResume foreign = store.load(key, kFirstFrame);
+  check(foreign.end_frame == kFirstFrame && foreign.detections.empty(),
+        "segment with a bad magic accepted");
+
+  store.discard(key);
+  check(!std::filesystem::exists(dir), "discard left the entry");
+  std::filesystem::remove_all(root);
+
+  std::printf("checkpoint_check: %d failures\n", failures);
+  return failures == 0 ? 0 : 1;
+}
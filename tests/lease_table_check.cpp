@@ -0,0 +1,76 @@
+// LeaseTable on a synthetic clock: leases exclude other workers until they
+// expire, heartbeats renew exactly the listed leases and drop the rest, and
+// deferred tasks are held from every worker until their delay lapses.
+//
+//   lease_table_check
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "server/lease_table.hpp"
+
+using namespace dashcam::server;
+using namespace std::chrono_literals;
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const char* what) {
+  if (!ok && ++failures <= 10) {
+    std::fprintf(stderr, "%s\n", what);
+  }
+}
+
+}  // namespace
+
+int main() {
+  const LeaseTable::Clock::time_point t0{};
+  LeaseTable leases(60s);
+
+  check(leases.acquire(1, "a", t0), "free task not granted");
+  check(!leases.acquire(1, "b", t0 + 59s), "live lease granted to another worker");
+  check(leases.acquire(1, "a", t0 + 30s), "holder cannot re-acquire its own lease");
+  check(leases.held_by(1, "a", t0 + 89s) && !leases.held_by(1, "b", t0 + 89s),
+        "held_by wrong after re-acquire");
+  // Re-acquiring at 30 s renewed the lease to 90 s.
+  check(!leases.acquire(1, "b", t0 + 89s), "renewed lease expired early");
+  check(!leases.held_by(1, "a", t0 + 90s), "expired lease still held");
+  check(leases.acquire(1, "b", t0 + 90s), "expired lease not granted to another worker");
+
+  check(leases.next_expiry() == t0 + 150s, "next_expiry wrong");
+  check(leases.purge(t0 + 149s) == 1 && leases.purge(t0 + 150s) == 0,
+        "purge kept or dropped the wrong leases");
+  check(!leases.next_expiry(), "next_expiry with no leases");
+
+  // Heartbeats renew the listed leases, drop the worker's others, and report
+  // the listed ones it does not hold.
+  leases.acquire(2, "a", t0);
+  leases.acquire(3, "a", t0);
+  leases.acquire(4, "b", t0);
+  const std::vector<std::int64_t> listed{2, 4, 5};
+  std::vector<std::int64_t> lost = leases.heartbeat("a", listed, t0 + 50s);
+  check(lost == std::vector<std::int64_t>{4, 5}, "heartbeat lost ids wrong");
+  check(leases.held_by(2, "a", t0 + 100s), "heartbeat did not renew");
+  check(!leases.held_by(3, "a", t0 + 1s) && leases.acquire(3, "b", t0 + 1s),
+        "heartbeat did not release an unlisted lease");
+  check(leases.held_by(4, "b", t0 + 1s), "heartbeat touched another worker's lease");
+
+  // A deferred task is held for no one, its last holder included, and is not
+  // released by that holder's heartbeats.
+  leases.defer(2, t0 + 200s);
+  check(!leases.held_by(2, "a", t0 + 51s), "deferred task still held by its worker");
+  check(!leases.acquire(2, "a", t0 + 199s) && !leases.acquire(2, "b", t0 + 199s),
+        "deferred task granted early");
+  leases.heartbeat("a", {}, t0 + 100s);
+  check(!leases.acquire(2, "b", t0 + 150s), "heartbeat released a deferral");
+  check(leases.acquire(2, "b", t0 + 200s), "deferred task not granted after its delay");
+
+  leases.release(2);
+  check(leases.acquire(2, "c", t0 + 200s), "released task not granted");
+
+  std::printf("lease_table_check: %d failures\n", failures);
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,170 @@
+// plate_distance against a plain weighted edit distance, and
+// SightingIndex::match_plates (bigram count filter, then plate_distance)
+// against a brute-force scan of every indexed text. Texts are drawn from
+// an alphabet rich in OCR confusables, and queries are indexed texts with
+// random misreads, insertions and deletions.
+//
+//   plate_search_check [texts] [queries] [seed]
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "common/plate_text.hpp"
+#include "server/sighting_index.hpp"
+
+using namespace dashcam;
+using namespace dashcam::server;
+
+namespace {
+
+int failures = 0;
+
+void fail(const std::string& what) {
+  if (++failures <= 10) {
+    std::fprintf(stderr, "%s\n", what.c_str());
+  }
+}
+
+// Full dynamic program, no bound and no early exit.
+double reference_distance(const std::string& a, const std::string& b) {
+  std::vector<std::vector<double>> d(a.size() + 1, std::vector<double>(b.size() + 1));
+  for (std::size_t i = 0; i <= a.size(); ++i) {
+    d[i][0] = static_cast<double>(i);
+  }
+  for (std::size_t j = 0; j <= b.size(); ++j) {
+    d[0][j] = static_cast<double>(j);
+  }
+  for (std::size_t i = 1; i <= a.size(); ++i) {
+    for (std::size_t j = 1; j <= b.size(); ++j) {
+      double sub = a[i - 1] == b[j - 1]                ? 0.0
+                   : confusable(a[i - 1], b[j - 1]) ? kConfusionCost
+                                                      : 1.0;
+      d[i][j] = std::min({d[i - 1][j] + 1.0, d[i][j - 1] + 1.0, d[i - 1][j - 1] + sub});
+    }
+  }
+  return d[a.size()][b.size()];
+}
+
+const std::string kAlphabet = "0ODQ1IL2Z5S6G8BACEHKMNPRTUVWXY34679";
+
+char random_char(std::mt19937_64& rng) {
+  return kAlphabet[std::uniform_int_distribution<std::size_t>(0, kAlphabet.size() - 1)(rng)];
+}
+
+std::string random_plate(std::mt19937_64& rng) {
+  std::string plate(std::uniform_int_distribution<int>(4, 8)(rng), ' ');
+  for (char& c : plate) {
+    c = random_char(rng);
+  }
+  return plate;
+}
+
+// Up to `edits` random substitutions, insertions and deletions.
+std::string misread(std::string plate, int edits, std::mt19937_64& rng) {
+  for (int e = 0; e < edits && !plate.empty(); ++e) {
+    std::size_t at = std::uniform_int_distribution<std::size_t>(0, plate.size() - 1)(rng);
+    switch (std::uniform_int_distribution<int>(0, 2)(rng)) {
+      case 0:
+        plate[at] = random_char(rng);
+        break;
+      case 1:
+        plate.insert(plate.begin() + static_cast<std::ptrdiff_t>(at), random_char(rng));
+        break;
+      default:
+        plate.erase(at, 1);
+    }
+  }
+  return plate;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int count = argc > 1 ? std::atoi(argv[1]) : 5000;
+  int queries = argc > 2 ? std::atoi(argv[2]) : 300;
+  std::mt19937_64 rng(argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 19);
+
+  // Texts come in families of near-duplicates, as OCR produces them.
+  std::set<std::string> distinct;
+  while (distinct.size() < static_cast<std::size_t>(count)) {
+    std::string base = random_plate(rng);
+    distinct.insert(base);
+    for (int i = 0; i < 3; ++i) {
+      if (std::string near = misread(base, 1 + i % 2, rng); !near.empty()) {
+        distinct.insert(near);
+      }
+    }
+  }
+  std::vector<std::string> texts(distinct.begin(), distinct.end());
+
+  // plate_distance is exact within its bound and above it otherwise.
+  for (int i = 0; i < 20 * queries; ++i) {
+    const std::string& a = texts[static_cast<std::size_t>(i) % texts.size()];
+    std::string b = misread(a, std::uniform_int_distribution<int>(0, 4)(rng), rng);
+    double want = reference_distance(a, b);
+    for (double bound : {0.0, 0.5, 1.0, 1.5, 2.0, 3.0}) {
+      double got = plate_distance(a, b, bound);
+      if (want <= bound ? got != want : got <= bound) {
+        fail("plate_distance(" + a + ", " + b + ", " + std::to_string(bound) +
+             ") = " + std::to_string(got) + ", reference " + std::to_string(want));
+      }
+    }
+  }
+
+  SightingIndex index(":memory:");
+  std::vector<Sighting> sightings;
+  for (std::size_t i = 0; i < texts.size(); ++i) {
+    Sighting s;
+    s.video_id = "v" + std::to_string(i / 100);
+    s.track_id = static_cast<int>(i);
+    s.plate = texts[i];
+    s.share = 1.0;
+    sightings.push_back(std::move(s));
+    if (i + 1 == texts.size() || (i + 1) % 100 == 0) {
+      VideoRecord video;
+      video.video_id = sightings.front().video_id;
+      index.replace_video(video, sightings);
+      sightings.clear();
+    }
+  }
+
+  for (int i = 0; i < queries; ++i) {
+    PlateQuery q;
+    q.text = misread(texts[std::uniform_int_distribution<std::size_t>(0, texts.size() - 1)(rng)],
+                     std::uniform_int_distribution<int>(0, 3)(rng), rng);
+    if (q.text.empty()) {
+      continue;
+    }
+    const double bounds[] = {0.0, 0.5, 1.0, 1.5, 2.0, 3.0};
+    q.max_distance = bounds[static_cast<std::size_t>(i) % std::size(bounds)];
+    q.limit = std::numeric_limits<std::size_t>::max();
+
+    std::vector<std::pair<std::string, double>> want;
+    for (const std::string& text : texts) {
+      if (double d = reference_distance(q.text, text); d <= q.max_distance) {
+        want.emplace_back(text, d);
+      }
+    }
+    std::vector<std::pair<std::string, double>> got;
+    for (const PlateMatch& m : index.match_plates(q)) {
+      got.emplace_back(m.plate, m.distance);
+    }
+    std::sort(want.begin(), want.end());
+    std::sort(got.begin(), got.end());
+    if (got != want) {
+      fail("match_plates(" + q.text + ", " + std::to_string(q.max_distance) + "): " +
+           std::to_string(got.size()) + " texts, brute force " + std::to_string(want.size()));
+    }
+  }
+
+  std::printf("plate_search_check: %zu texts, %d queries, %d failures\n", texts.size(), queries,
+              failures);
+  return failures == 0 ? 0 : 1;
+}
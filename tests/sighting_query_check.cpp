@@ -0,0 +1,184 @@
+// SightingIndex::query and detail::cover_box against a brute-force scan:
+// random sightings over the whole globe (dense along the antimeridian and
+// near the poles) across three years, and random boxes and date ranges,
+// including boxes that cross the antimeridian.
+//
+//   sighting_query_check [sightings] [queries] [seed]
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "server/sighting_index.hpp"
+
+using namespace dashcam::server;
+
+namespace {
+
+constexpr std::int64_t kDayUs = 86'400'000'000;
+constexpr std::int64_t kStartUs = 1'650'000'000'000'000;  // April 2022
+
+int failures = 0;
+
+void fail(const char* what, const SightingQuery& q, std::size_t got, std::size_t want) {
+  if (++failures <= 10) {
+    std::fprintf(stderr,
+                 "%s: box (%.6f, %.6f, %.6f, %.6f) dates [%lld, %lld]: %zu, brute force %zu\n",
+                 what, q.south, q.west, q.north, q.east,
+                 static_cast<long long>(q.from_us.value_or(-1)),
+                 static_cast<long long>(q.to_us.value_or(-1)), got, want);
+  }
+}
+
+bool inside(const SightingQuery& q, double lat, double lon, std::int64_t t) {
+  bool in_lon = q.west > q.east ? lon >= q.west || lon <= q.east : lon >= q.west && lon <= q.east;
+  return in_lon && lat >= q.south && lat <= q.north && (!q.from_us || t >= *q.from_us) &&
+         (!q.to_us || t <= *q.to_us);
+}
+
+double wrap_lon(double lon) {
+  while (lon > 180.0) {
+    lon -= 360.0;
+  }
+  while (lon < -180.0) {
+    lon += 360.0;
+  }
+  return lon;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int count = argc > 1 ? std::atoi(argv[1]) : 20000;
+  int queries = argc > 2 ? std::atoi(argv[2]) : 400;
+  std::mt19937_64 rng(argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 18);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+  // A third anywhere, a third within a degree of the antimeridian, a third
+  // in a few dense cities; a handful exactly on the edges of the grid.
+  const std::pair<double, double> cities[] = {
+      {51.5, -0.12}, {-33.87, 151.21}, {64.14, -21.94}, {-36.85, 174.76}, {89.9, 0.0}};
+  std::vector<Sighting> all;
+  for (int i = 0; i < count; ++i) {
+    Sighting s;
+    s.video_id = "v" + std::to_string(i / 200);
+    s.track_id = i;
+    s.plate = "P" + std::to_string(i % 997);
+    s.share = 1.0;
+    s.t_us = kStartUs + static_cast<std::int64_t>(unit(rng) * 3 * 365 * kDayUs);
+    switch (i % 3) {
+      case 0:
+        s.lat = -90.0 + 180.0 * unit(rng);
+        s.lon = -180.0 + 360.0 * unit(rng);
+        break;
+      case 1:
+        s.lat = -60.0 + 120.0 * unit(rng);
+        s.lon = wrap_lon(179.0 + 2.0 * unit(rng));
+        break;
+      default: {
+        const auto& [lat, lon] = cities[static_cast<std::size_t>(i) % std::size(cities)];
+        s.lat = std::clamp(lat + 0.05 * (unit(rng) - 0.5), -90.0, 90.0);
+        s.lon = wrap_lon(lon + 0.05 * (unit(rng) - 0.5));
+      }
+    }
+    all.push_back(std::move(s));
+  }
+  for (double lat : {-90.0, 90.0}) {
+    for (double lon : {-180.0, 180.0, 0.0}) {
+      Sighting s;
+      s.video_id = "edges";
+      s.track_id = static_cast<int>(all.size());
+      s.share = 1.0;
+      s.t_us = kStartUs;
+      s.lat = lat;
+      s.lon = lon;
+      all.push_back(std::move(s));
+    }
+  }
+
+  SightingIndex index(":memory:");
+  for (std::size_t begin = 0; begin < all.size();) {
+    std::size_t end = begin;
+    while (end < all.size() && all[end].video_id == all[begin].video_id) {
+      ++end;
+    }
+    VideoRecord video;
+    video.video_id = all[begin].video_id;
+    video.finalized_ms = kStartUs / 1000;
+    index.replace_video(video, {all.data() + begin, end - begin});
+    begin = end;
+  }
+
+  // Every point inside a box lies in one of its cover's runs.
+  for (int i = 0; i < queries; ++i) {
+    double south = -90.0 + 180.0 * unit(rng);
+    double north = std::min(90.0, south + 30.0 * unit(rng) * unit(rng));
+    double west = -180.0 + 360.0 * unit(rng);
+    double east = std::min(180.0, west + 60.0 * unit(rng) * unit(rng));
+    auto runs = detail::cover_box(south, west, north, east);
+    for (int j = 0; j < 50; ++j) {
+      double lat = j == 0 ? south : j == 1 ? north : south + (north - south) * unit(rng);
+      double lon = j == 0 ? west : j == 1 ? east : west + (east - west) * unit(rng);
+      std::uint64_t cell = detail::cell_of(lat, lon);
+      bool covered = std::any_of(runs.begin(), runs.end(), [cell](const auto& run) {
+        return cell >= run.first && cell < run.second;
+      });
+      if (!covered) {
+        SightingQuery q;
+        q.south = south, q.west = west, q.north = north, q.east = east;
+        fail("cover_box misses a point", q, 0, 1);
+        break;
+      }
+    }
+  }
+
+  for (int i = 0; i < queries; ++i) {
+    SightingQuery q;
+    q.limit = all.size() + 1;
+    // Mostly small boxes around the dense areas, some world-sized; west >
+    // east in about a third.
+    double size = i % 4 == 0 ? 180.0 * unit(rng) : 3.0 * unit(rng) * unit(rng);
+    double lat = -90.0 + 180.0 * unit(rng);
+    if (i % 4 == 1) {
+      lat = cities[static_cast<std::size_t>(i) % std::size(cities)].first;
+    }
+    double lon = i % 3 == 0 ? 180.0 - size / 2 : -180.0 + 360.0 * unit(rng);
+    q.south = std::max(-90.0, lat - size / 2);
+    q.north = std::min(90.0, lat + size / 2);
+    q.west = wrap_lon(lon - size);
+    q.east = wrap_lon(lon + size);
+    if (i % 5 == 0) {
+      q.west = -180.0;
+      q.east = 180.0;
+    }
+    if (i % 2 == 0) {
+      std::int64_t from = kStartUs + static_cast<std::int64_t>(unit(rng) * 3 * 365 * kDayUs);
+      q.from_us = from;
+      q.to_us = from + static_cast<std::int64_t>(unit(rng) * 120 * kDayUs);
+    }
+
+    std::vector<std::pair<std::string, int>> want;
+    for (const Sighting& s : all) {
+      if (inside(q, *s.lat, *s.lon, *s.t_us)) {
+        want.emplace_back(s.video_id, s.track_id);
+      }
+    }
+    std::vector<std::pair<std::string, int>> got;
+    for (const Sighting& s : index.query(q).sightings) {
+      got.emplace_back(s.video_id, s.track_id);
+    }
+    std::sort(want.begin(), want.end());
+    std::sort(got.begin(), got.end());
+    if (got != want) {
+      fail("query differs", q, got.size(), want.size());
+    }
+  }
+
+  std::printf("sighting_query_check: %zu sightings, %d queries, %d failures\n", all.size(),
+              queries, failures);
+  return failures == 0 ? 0 : 1;
+}
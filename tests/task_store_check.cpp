@@ -0,0 +1,177 @@
+// TaskStore pulls and completions on a throwaway database: oldest first per
+// type, completion publishing its remote tasks exactly once, and the join of
+// a sharded video's FINALIZE_VIDEO parts into one task, including a shard
+// re-run after the join, which waits for a full set of parts again.
+//
+//   task_store_check
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "common/task.hpp"
+#include "server/task_store.hpp"
+
+using namespace dashcam;
+using namespace dashcam::server;
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const std::string& what) {
+  if (!ok && ++failures <= 10) {
+    std::fprintf(stderr, "%s\n", what.c_str());
+  }
+}
+
+NewTask make_task(std::string_view type, const std::string& video_id) {
+  NewTask task;
+  task.task_type = std::string(type);
+  task.video_id = video_id;
+  task.inputs.push_back({"indoor_nas", "/videos/" + video_id + ".mp4", "video"});
+  return task;
+}
+
+NewTask finalize_part(const std::string& video_id, int index, int count) {
+  NewTask part = make_task(kFinalizeVideo, video_id);
+  part.inputs.push_back(
+      {"indoor_nas", "/heavy/" + video_id + "/" + std::to_string(index), "heavy_output"});
+  ShardSpec shard;
+  shard.index = index;
+  shard.count = count;
+  shard.first_frame = 1000 * index;
+  shard.end_frame = index + 1 == count ? -1 : 1000 * (index + 1);
+  part.params["shard"] = to_json(shard);
+  return part;
+}
+
+CompletionResult complete_one(TaskStore& store, std::int64_t task_id,
+                              std::vector<NewTask> publish = {}) {
+  TaskCompletion completion;
+  completion.task_id = task_id;
+  completion.publish = std::move(publish);
+  std::vector<CompletionResult> results = store.complete({&completion, 1});
+  return results.empty() ? CompletionResult{} : results.front();
+}
+
+std::vector<std::int64_t> pending_ids(TaskStore& store, std::string_view type) {
+  const std::vector<std::string> types{std::string(type)};
+  std::vector<std::int64_t> ids;
+  for (const Task& task : store.pull(types, TaskStore::kMaxPullBatch)) {
+    ids.push_back(task.task_id);
+  }
+  return ids;
+}
+
+void check_pull_and_complete() {
+  TaskStore store(":memory:");
+  std::vector<NewTask> tasks{make_task(kHeavyProcessVideo, "a"), make_task(kArchiveVideo, "b"),
+                             make_task(kHeavyProcessVideo, "c")};
+  std::vector<std::int64_t> ids = store.create(tasks);
+  check(ids.size() == 3, "create: expected three ids");
+
+  const std::vector<std::string> heavy{std::string(kHeavyProcessVideo)};
+  std::vector<Task> pulled = store.pull(heavy, 10);
+  check(pulled.size() == 2 && pulled[0].task_id == ids[0] && pulled[1].task_id == ids[2],
+        "pull: expected the two heavy tasks, oldest first");
+  check(!pulled.empty() && pulled[0].video_id == "a" && pulled[0].state == TaskState::Pending &&
+            pulled[0].inputs.size() == 1 && pulled[0].inputs[0].path == "/videos/a.mp4",
+        "pull: task fields do not round-trip");
+  check(store.pull(heavy, 1).size() == 1, "pull: limit not applied");
+  const std::vector<std::string> both{std::string(kArchiveVideo),
+                                      std::string(kHeavyProcessVideo)};
+  check(store.pull(both, 10).size() == 3, "pull: expected every task of either type");
+
+  CompletionResult first = complete_one(store, ids[0], {make_task(kFinalizeVideo, "a")});
+  check(first.status == CompletionStatus::Completed && first.published.size() == 1,
+        "complete: expected one published task");
+  check(pending_ids(store, kHeavyProcessVideo) == std::vector<std::int64_t>{ids[2]},
+        "complete: task still pending");
+  check(!first.published.empty() &&
+            pending_ids(store, kFinalizeVideo) == std::vector<std::int64_t>{first.published[0]},
+        "complete: published task not pending");
+
+  // A retried completion publishes nothing again.
+  CompletionResult again = complete_one(store, ids[0], {make_task(kFinalizeVideo, "a")});
+  check(again.status == CompletionStatus::AlreadyComplete && again.published.empty(),
+        "complete: retry should be already_complete and publish nothing");
+  check(pending_ids(store, kFinalizeVideo).size() == 1, "complete: retry published twice");
+  check(complete_one(store, 9999).status == CompletionStatus::NotFound,
+        "complete: unknown task should be not_found");
+
+  std::optional<Task> done = store.get(ids[0]);
+  check(done && done->state == TaskState::Complete && done->completed_at,
+        "get: completed task not in history");
+  TaskStore::Counts counts = store.counts();
+  check(counts.pending == 3 && counts.complete == 1, "counts: expected 3 pending, 1 complete");
+}
+
+void check_shard_join() {
+  TaskStore store(":memory:");
+  constexpr int kShards = 3;
+  std::vector<NewTask> shards;
+  for (int i = 0; i < kShards; ++i) {
+    shards.push_back(make_task(kHeavyProcessVideo, "long"));
+  }
+  std::vector<std::int64_t> ids = store.create(shards);
+
+  // Parts completing out of order are held back until the last one is in.
+  for (int i : {2, 0}) {
+    CompletionResult r = complete_one(store, ids[i], {finalize_part("long", i, kShards)});
+    check(r.status == CompletionStatus::Completed && r.published.empty(),
+          "shard join: part " + std::to_string(i) + " published early");
+  }
+  check(pending_ids(store, kFinalizeVideo).empty(), "shard join: finalize queued early");
+  CompletionResult last = complete_one(store, ids[1], {finalize_part("long", 1, kShards)});
+  check(last.published.size() == 1, "shard join: last part should publish the joined task");
+
+  std::vector<std::int64_t> finalize = pending_ids(store, kFinalizeVideo);
+  check(finalize.size() == 1, "shard join: expected exactly one finalize task");
+  if (!finalize.empty()) {
+    std::optional<Task> joined = store.get(finalize.front());
+    check(joined && !joined->params.isMember("shard") && joined->params["shards"] == kShards,
+          "shard join: joined params should carry shards, not shard");
+    std::vector<std::string> outputs;
+    for (const TaskInput& input : joined ? joined->inputs : std::vector<TaskInput>{}) {
+      if (input.type == "heavy_output") {
+        outputs.push_back(input.path);
+      }
+    }
+    check(outputs == std::vector<std::string>{"/heavy/long/0", "/heavy/long/1", "/heavy/long/2"},
+          "shard join: heavy outputs not in shard order");
+    check(joined && joined->inputs.size() == kShards + 1,
+          "shard join: shared video input should appear once");
+    complete_one(store, finalize.front());
+  }
+
+  // A shard re-run after the join (re-ingestion) does not re-publish the old
+  // set; it waits for a full new set of parts.
+  std::vector<std::int64_t> rerun = store.create(std::vector<NewTask>(
+      kShards, make_task(kHeavyProcessVideo, "long")));
+  CompletionResult repeat = complete_one(store, rerun[0], {finalize_part("long", 0, kShards)});
+  check(repeat.published.empty() && pending_ids(store, kFinalizeVideo).empty(),
+        "shard rejoin: a lone re-run part must not publish");
+  // The same part twice replaces itself instead of counting twice.
+  complete_one(store, rerun[1], {finalize_part("long", 0, kShards)});
+  check(pending_ids(store, kFinalizeVideo).empty(), "shard rejoin: duplicate part counted");
+  complete_one(store, rerun[2], {finalize_part("long", 1, kShards),
+                                 finalize_part("long", 2, kShards)});
+  check(pending_ids(store, kFinalizeVideo).size() == 1,
+        "shard rejoin: full new set should publish one task");
+
+  // Parts of another video or another count never join with these.
+  std::vector<std::int64_t> other = store.create(std::vector<NewTask>(
+      2, make_task(kHeavyProcessVideo, "other")));
+  complete_one(store, other[0], {finalize_part("other", 0, 2), finalize_part("long", 0, 2)});
+  check(pending_ids(store, kFinalizeVideo).size() == 1, "shard join: mixed up videos or counts");
+}
+
+}  // namespace
+
+int main() {
+  check_pull_and_complete();
+  check_shard_join();
+  std::printf("task_store_check: %d failures\n", failures);
+  return failures == 0 ? 0 : 1;
+}